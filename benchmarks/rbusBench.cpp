@@ -0,0 +1,373 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+    Microbenchmarks for the rbus data paths that run per get/set/event.
+    Run with --benchmark_format=json (or the bench_json target) to get output
+    that can be diffed between releases.
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <rbus.h>
+#include <rbus_core.h>
+#include "../src/rbus_buffer.h"
+#include "../src/rbus_element.h"
+#include "../src/rbus_tokenchain.h"
+#include "../src/rbus_subscriptions.h"
+
+extern "C" {
+/*defined in rbus.c*/
+void rbusValue_initFromMessage(rbusValue_t* value, rbusMessage msg);
+void rbusValue_appendToMessage(char const* name, rbusValue_t value, rbusMessage msg);
+}
+
+static void initValue(rbusValue_t* value, rbusValueType_t type)
+{
+    rbusValue_Init(value);
+    switch(type)
+    {
+    case RBUS_BOOLEAN:  rbusValue_SetBoolean(*value, true); break;
+    case RBUS_INT32:    rbusValue_SetInt32(*value, -123456); break;
+    case RBUS_UINT64:   rbusValue_SetUInt64(*value, 1234567890123ULL); break;
+    case RBUS_DOUBLE:   rbusValue_SetDouble(*value, 3.14159); break;
+    default:            rbusValue_SetString(*value, "Device.WiFi.AccessPoint.1.AssociatedDevice.1.MACAddress"); break;
+    }
+}
+
+/*build a tree with a table of 'rows' rows, each having 'props' properties*/
+static elementNode* createTree(int rows, int props)
+{
+    char name[RBUS_MAX_NAME_LENGTH];
+    elementNode* root = getEmptyElementNode();
+    elementNode* table;
+    rbusDataElement_t elem;
+
+    root->name = strdup("root");
+    root->fullName = strdup("root");
+
+    memset(&elem, 0, sizeof(elem));
+    elem.name = (char*)"Device.Bench.Table.{i}.";
+    elem.type = RBUS_ELEMENT_TYPE_TABLE;
+    insertElement(root, &elem);
+
+    for(int p = 0; p < props; ++p)
+    {
+        snprintf(name, sizeof(name), "Device.Bench.Table.{i}.Prop%d", p);
+        elem.name = name;
+        elem.type = RBUS_ELEMENT_TYPE_PROPERTY;
+        insertElement(root, &elem);
+    }
+
+    table = retrieveElement(root, "Device.Bench.Table.");
+    for(int r = 1; r <= rows; ++r)
+        instantiateTableRow(table, r, NULL);
+    return root;
+}
+
+static void BM_rbusValue_Encode(benchmark::State& state)
+{
+    rbusValue_t value;
+    rbusBuffer_t buff;
+
+    initValue(&value, (rbusValueType_t)state.range(0));
+    for(auto _ : state)
+    {
+        rbusBuffer_Create(&buff);
+        rbusValue_Encode(value, buff);
+        benchmark::DoNotOptimize(buff->posWrite);
+        rbusBuffer_Destroy(buff);
+    }
+    rbusValue_Release(value);
+}
+BENCHMARK(BM_rbusValue_Encode)->Arg(RBUS_BOOLEAN)->Arg(RBUS_INT32)->Arg(RBUS_UINT64)->Arg(RBUS_DOUBLE)->Arg(RBUS_STRING);
+
+static void BM_rbusValue_Decode(benchmark::State& state)
+{
+    rbusValue_t value;
+    rbusBuffer_t buff;
+
+    initValue(&value, (rbusValueType_t)state.range(0));
+    rbusBuffer_Create(&buff);
+    rbusValue_Encode(value, buff);
+    rbusValue_Release(value);
+
+    for(auto _ : state)
+    {
+        buff->posRead = 0;
+        rbusValue_Decode(&value, buff);
+        rbusValue_Release(value);
+    }
+    rbusBuffer_Destroy(buff);
+}
+BENCHMARK(BM_rbusValue_Decode)->Arg(RBUS_BOOLEAN)->Arg(RBUS_INT32)->Arg(RBUS_UINT64)->Arg(RBUS_DOUBLE)->Arg(RBUS_STRING);
+
+static void BM_rbusValue_appendToMessage(benchmark::State& state)
+{
+    rbusValue_t value;
+    rbusMessage msg;
+
+    initValue(&value, (rbusValueType_t)state.range(0));
+    for(auto _ : state)
+    {
+        rbusMessage_Init(&msg);
+        rbusValue_appendToMessage("Device.Bench.Prop", value, msg);
+        rbusMessage_Release(msg);
+    }
+    rbusValue_Release(value);
+}
+BENCHMARK(BM_rbusValue_appendToMessage)->Arg(RBUS_INT32)->Arg(RBUS_STRING);
+
+static void BM_rbusValue_initFromMessage(benchmark::State& state)
+{
+    rbusValue_t value;
+    rbusMessage msg;
+    uint8_t* data;
+    uint32_t length;
+
+    initValue(&value, (rbusValueType_t)state.range(0));
+    rbusMessage_Init(&msg);
+    rbusValue_appendToMessage("Device.Bench.Prop", value, msg);
+    rbusValue_Release(value);
+    rbusMessage_ToBytes(msg, &data, &length);
+
+    for(auto _ : state)
+    {
+        rbusMessage in;
+        char const* name;
+        rbusMessage_FromBytes(&in, data, length);
+        rbusMessage_GetString(in, &name);
+        rbusValue_initFromMessage(&value, in);
+        rbusValue_Release(value);
+        rbusMessage_Release(in);
+    }
+    rbusMessage_Release(msg);
+}
+BENCHMARK(BM_rbusValue_initFromMessage)->Arg(RBUS_INT32)->Arg(RBUS_STRING);
+
+/*legacy components send every value as text.  the second input of each pair has a
+  leading space, which the fast parser declines, so it measures the generic strto and
+  strptime path the same value used to take*/
+static char const* const gLegacyStrings[][2] = {
+    { "1234567890", " 1234567890" },
+    { "-31415.9265", " -31415.9265" },
+    { "2023-06-15T10:20:30+05:30", " 2023-06-15T10:20:30+05:30" }
+};
+
+static void BM_rbusValue_SetFromString(benchmark::State& state)
+{
+    static const rbusValueType_t types[] = { RBUS_UINT32, RBUS_DOUBLE, RBUS_DATETIME };
+    rbusValueType_t type = types[state.range(0)];
+    char const* str = gLegacyStrings[state.range(0)][state.range(1)];
+    rbusValue_t value;
+
+    rbusValue_Init(&value);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(rbusValue_SetFromString(value, type, str));
+    rbusValue_Release(value);
+    state.SetLabel(state.range(1) ? "generic" : "fast");
+}
+BENCHMARK(BM_rbusValue_SetFromString)->ArgsProduct({{0, 1, 2}, {0, 1}});
+
+static void BM_rbusValue_Format(benchmark::State& state)
+{
+    static const rbusValueType_t types[] = { RBUS_UINT32, RBUS_INT64, RBUS_DATETIME, RBUS_BYTES };
+    char buf[RBUS_VALUE_FORMAT_MAX];
+    rbusValue_t value;
+
+    rbusValue_Init(&value);
+    rbusValue_SetFromString(value, RBUS_UINT32, "1234567890");
+    if(types[state.range(0)] == RBUS_INT64)
+        rbusValue_SetInt64(value, -1234567890123456789LL);
+    else if(types[state.range(0)] == RBUS_DATETIME)
+        rbusValue_SetFromString(value, RBUS_DATETIME, "2023-06-15T10:20:30+05:30");
+    else if(types[state.range(0)] == RBUS_BYTES)
+        rbusValue_SetBytes(value, (uint8_t const*)"0123456789abcdef", 16);
+    for(auto _ : state)
+    {
+        if(state.range(1))
+        {
+            char* s = rbusValue_ToString(value, NULL, 0);
+            benchmark::DoNotOptimize(s);
+            free(s);
+        }
+        else
+        {
+            benchmark::DoNotOptimize(rbusValue_Format(value, buf, sizeof(buf)));
+        }
+    }
+    rbusValue_Release(value);
+    state.SetLabel(state.range(1) ? "ToString" : "Format");
+}
+BENCHMARK(BM_rbusValue_Format)->ArgsProduct({{0, 1, 2, 3}, {0, 1}});
+
+static void BM_rbusObject_Build(benchmark::State& state)
+{
+    char name[32];
+    rbusValue_t value;
+
+    initValue(&value, RBUS_INT32);
+    for(auto _ : state)
+    {
+        rbusObject_t obj;
+        rbusObject_Init(&obj, NULL);
+        for(int i = 0; i < state.range(0); ++i)
+        {
+            snprintf(name, sizeof(name), "prop%d", i);
+            rbusObject_SetValue(obj, name, value);
+        }
+        rbusObject_Release(obj);
+    }
+    rbusValue_Release(value);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_rbusObject_Build)->Range(4, 256);
+
+static void BM_rbusObject_GetValue(benchmark::State& state)
+{
+    char name[32];
+    rbusValue_t value;
+    rbusObject_t obj;
+    int count = (int)state.range(0);
+
+    initValue(&value, RBUS_INT32);
+    rbusObject_Init(&obj, NULL);
+    for(int i = 0; i < count; ++i)
+    {
+        snprintf(name, sizeof(name), "prop%d", i);
+        rbusObject_SetValue(obj, name, value);
+    }
+    rbusValue_Release(value);
+
+    /*look up the last property which is the worst case for a linear search*/
+    snprintf(name, sizeof(name), "prop%d", count - 1);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(rbusObject_GetValue(obj, name));
+    rbusObject_Release(obj);
+}
+BENCHMARK(BM_rbusObject_GetValue)->Range(4, 256);
+
+static void BM_retrieveInstanceElement(benchmark::State& state)
+{
+    char name[RBUS_MAX_NAME_LENGTH];
+    int rows = (int)state.range(0);
+    elementNode* root = createTree(rows, 10);
+
+    snprintf(name, sizeof(name), "Device.Bench.Table.%d.Prop9", rows);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(retrieveInstanceElement(root, name));
+    freeElementNode(root);
+}
+BENCHMARK(BM_retrieveInstanceElement)->Range(8, 4096);
+
+static void BM_TokenChain_match(benchmark::State& state)
+{
+    char name[RBUS_MAX_NAME_LENGTH];
+    int rows = (int)state.range(0);
+    elementNode* root = createTree(rows, 10);
+    elementNode* regElem = retrieveElement(root, "Device.Bench.Table.{i}.Prop5");
+    TokenChain* tokens = TokenChain_create("Device.Bench.Table.*.Prop5", regElem);
+    elementNode* instNode;
+
+    snprintf(name, sizeof(name), "Device.Bench.Table.%d.Prop5", rows);
+    instNode = retrieveInstanceElement(root, name);
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(TokenChain_match(tokens, instNode));
+
+    TokenChain_destroy(tokens);
+    freeElementNode(root);
+}
+BENCHMARK(BM_TokenChain_match)->Arg(8)->Arg(512);
+
+static void BM_rbusFilter_Apply(benchmark::State& state)
+{
+    rbusValue_t v1, v2, test;
+    rbusFilter_t gt, lt, both;
+
+    rbusValue_Init(&v1);
+    rbusValue_Init(&v2);
+    rbusValue_Init(&test);
+    rbusValue_SetInt32(v1, 10);
+    rbusValue_SetInt32(v2, 100);
+    rbusValue_SetInt32(test, 50);
+    rbusFilter_InitRelation(&gt, RBUS_FILTER_OPERATOR_GREATER_THAN, v1);
+    rbusFilter_InitRelation(&lt, RBUS_FILTER_OPERATOR_LESS_THAN, v2);
+    rbusFilter_InitLogic(&both, RBUS_FILTER_OPERATOR_AND, gt, lt);
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(rbusFilter_Apply(both, test));
+
+    rbusFilter_Release(both);
+    rbusFilter_Release(gt);
+    rbusFilter_Release(lt);
+    rbusValue_Release(v1);
+    rbusValue_Release(v2);
+    rbusValue_Release(test);
+}
+BENCHMARK(BM_rbusFilter_Apply);
+
+/*add and then remove N subscriptions to a wildcard event on a table with 64 rows.
+  This includes writing the subscription cache file on each change, same as a provider does.*/
+static void BM_rbusSubscriptions_AddRemove(benchmark::State& state)
+{
+    char tmpDir[] = "/tmp/rbus_benchXXXXXX";
+    char listener[64];
+    int count = (int)state.range(0);
+    elementNode* root = createTree(64, 10);
+    elementNode* regElem = retrieveElement(root, "Device.Bench.Table.{i}.Prop5");
+    rbusSubscription_t** subs = (rbusSubscription_t**)malloc(sizeof(rbusSubscription_t*) * count);
+
+    if(!mkdtemp(tmpDir))
+    {
+        state.SkipWithError("mkdtemp failed");
+        return;
+    }
+
+    for(auto _ : state)
+    {
+        rbusSubscriptions_t subscriptions;
+        rbusSubscriptions_create(&subscriptions, NULL, "rbusBench", root, tmpDir);
+        for(int i = 0; i < count; ++i)
+        {
+            snprintf(listener, sizeof(listener), "consumer%d", i);
+            subs[i] = rbusSubscriptions_addSubscription(subscriptions, listener, "Device.Bench.Table.*.Prop5", NULL, 0, 0, 0, false, false, regElem);
+        }
+        for(int i = count - 1; i >= 0; --i)
+            rbusSubscriptions_removeSubscription(subscriptions, subs[i]);
+        rbusSubscriptions_destroy(subscriptions);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+
+    free(subs);
+    freeElementNode(root);
+    {
+        char path[RBUS_MAX_NAME_LENGTH];
+        snprintf(path, sizeof(path), "%s/rbus_subs_rbusBench", tmpDir);
+        unlink(path);
+        rmdir(tmpDir);
+    }
+}
+BENCHMARK(BM_rbusSubscriptions_AddRemove)->Arg(16)->Arg(128);
+
+BENCHMARK_MAIN();
@@ -69,6 +69,7 @@
  * @defgroup    Events          Events
  * @defgroup    Methods         Methods
  * @defgroup    Discovery       Discovery
+ * @defgroup    Configuration   Configuration
  */
 
 #ifndef RBUS_H
@@ -92,6 +93,11 @@ struct _rbusHandle;
 ///  @brief     An RBus handle which identifies an opened component
 typedef struct _rbusHandle* rbusHandle_t;
 
+struct _rbusSessionLease;
+
+///  @brief     A session lease which hands out session ids, see rbusSessionLease_Open
+typedef struct _rbusSessionLease* rbusSessionLease_t;
+
 ///  @brief     The maximum length a name can be for any element.
 #define RBUS_MAX_NAME_LENGTH 256
 
@@ -300,6 +306,22 @@ typedef struct _rbusEventSubscription
     rbusSubscribeAsyncRespHandler_t asyncHandler;/** Private use only: The async handler being used for any background subscription retries */
 } rbusEventSubscription_t;
 
+/// @brief rbusEventRateOptions_t
+/// Delivery rate options for a subscription, passed to rbusEvent_SubscribeExWithRate
+typedef struct _rbusEventRateOptions
+{
+    uint32_t            publishInterval;/** Minimum time in milliseconds between two events
+                                            delivered to this subscriber (i.e. the maximum delivery rate).
+                                            Enforced by the provider, so events over the rate are never sent.
+                                            Pass "0" to receive every event.
+                                          */
+    bool                coalesce;   /** Used with publishInterval. If true, the latest event
+                                        published during an interval is delivered once the interval
+                                        elapses ("latest value wins"). If false, events published
+                                        during an interval are dropped.
+                                      */
+} rbusEventRateOptions_t;
+
 /** @} */
 
 /** @fn typedef void (* rbusMethodAsyncRespHandler_t)(
@@ -323,6 +345,29 @@ typedef void (*rbusMethodAsyncRespHandler_t)(
     rbusObject_t params
 );
 
+/** @fn typedef bool (* rbusGetExtStreamHandler_t)(
+ *          rbusHandle_t handle,
+ *          int numProps,
+ *          rbusProperty_t properties,
+ *          void* userData)
+ *  @brief A component will receive this API callback for each chunk of results
+ *  returned by rbus_getExtStream.
+
+ *  Used by: Any component that calls rbus_getExtStream.
+ *  @param handle     Bus Handle
+ *  @param numProps   The number of properties in this chunk
+ *  @param properties The list of properties in this chunk.  The list is released
+ *                    after the callback returns, so call rbusProperty_Retain to keep it.
+ *  @param userData   The userData passed to rbus_getExtStream
+ *  @return true to continue receiving chunks or false to stop the stream
+ */
+typedef bool (*rbusGetExtStreamHandler_t)(
+    rbusHandle_t handle,
+    int numProps,
+    rbusProperty_t properties,
+    void* userData
+);
+
 /** @addtogroup Providers
   * @{ 
   */
@@ -550,6 +595,15 @@ typedef struct
                                              callback can be NULL, if no usage*/
 }rbusDataElement_t;
 
+/** @struct rbusGetCachePolicy_t
+ *  @brief How the results of a property's getHandler may be reused, see rbus_setGetCachePolicy
+ */
+typedef struct _rbusGetCachePolicy
+{
+    uint32_t    maxAge;             /**< Milliseconds a result is reused, 0 for no caching */
+    bool        invalidateOnSet;    /**< Drop the cached result when the property is set */
+} rbusGetCachePolicy_t;
+
 /**
  * @enum        rbusStatus_t
  * @brief       The type of events which can be subscribed to or published
@@ -654,6 +708,135 @@ rbusError_t rbus_open(
  */
 rbusError_t rbus_close(
     rbusHandle_t handle);
+
+/**
+ * @struct      rbusDeliveryStats_t
+ * @brief       The counters of the delivery threads of a bus handle
+ */
+typedef struct
+{
+    uint64_t delivered;     /**< Number of handler calls run by the delivery threads */
+    uint64_t dropped;       /**< Number of handler calls dropped because their queue was full */
+    uint32_t queued;        /**< Number of handler calls currently queued */
+    uint32_t maxQueued;     /**< Largest number of handler calls queued for one thread at once */
+} rbusDeliveryStats_t;
+
+/** @fn rbusError_t rbus_setDeliveryThreads(
+ *          rbusHandle_t handle,
+ *          int numThreads,
+ *          int queueDepth)
+ *  @brief  Run the event handlers and message listeners of a handle on a pool of
+ *  delivery threads instead of the thread reading from the bus, so slow handlers
+ *  don't hold up other traffic such as get and set responses.                 \n
+ *  The handlers of one subscription or listener expression are called one at a time
+ *  in the order received, while those of different subscriptions run in parallel.
+ *  Each thread has a queue of queueDepth handler calls. When it is full further calls
+ *  are dropped and counted in rbusDeliveryStats_t.dropped.                    \n
+ *  Handlers are called inline, as by default, when numThreads is 0.
+ *  Reconfiguring or rbus_close first runs the handler calls already queued, so
+ *  rbus_setDeliveryThreads may not be called from a handler running on a delivery
+ *  thread.  rbus_close may; the calls queued behind that handler on its thread are
+ *  then dropped, and the thread stops once the handler returns.                
+
+ *  Unsubscribing or removing a listener waits for its handler if it is running,
+ *  except from a handler on a delivery thread, which doesn't wait; the subscription
+ *  is then freed once its running handler returns.
+ *  @param      handle          Bus Handle
+ *  @param      numThreads      Number of delivery threads, from 0 to 32
+ *  @param      queueDepth      Handler calls queued per thread, or 0 for RBUS_CONFIG_DELIVERY_QUEUE_DEPTH (1024)
+ *  @return                     RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_INVALID_OPERATION, RBUS_ERROR_OUT_OF_RESOURCES
+ */
+rbusError_t rbus_setDeliveryThreads(
+    rbusHandle_t handle,
+    int numThreads,
+    int queueDepth);
+
+/** @fn rbusError_t rbus_getDeliveryStats(
+ *          rbusHandle_t handle,
+ *          rbusDeliveryStats_t* stats)
+ *  @brief  Get the counters of the delivery threads set with rbus_setDeliveryThreads.
+ *  The counters start from zero each time the threads are set.
+ *  @param      handle          Bus Handle
+ *  @param      stats           Returns the counters
+ *  @return                     RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_INPUT
+ */
+rbusError_t rbus_getDeliveryStats(
+    rbusHandle_t handle,
+    rbusDeliveryStats_t* stats);
+/** @} */
+
+/** @addtogroup Configuration
+ *  @{
+ */
+
+///  @brief     The process wide settings of rbus_setConfig and rbus_getConfig.
+///             Each is named in a config file or environment variable as RBUS_ followed
+///             by the name after RBUS_CONFIG_, for example RBUS_VALUECHANGE_PERIOD.
+typedef enum _rbusConfigSetting
+{
+    RBUS_CONFIG_TMP_DIRECTORY = 0,      /**< RBUS_STRING directory where rbus persists data, default /tmp.
+                                             Can only be changed while no handle is open */
+    RBUS_CONFIG_SUBSCRIBE_TIMEOUT,      /**< RBUS_INT32 milliseconds to retry a subscribe, default 600000 */
+    RBUS_CONFIG_SUBSCRIBE_MAXWAIT,      /**< RBUS_INT32 max milliseconds between subscribe retries, default 60000 */
+    RBUS_CONFIG_VALUECHANGE_PERIOD,     /**< RBUS_INT32 milliseconds between value-change polls, default 2000 */
+    RBUS_CONFIG_SHM_THRESHOLD,          /**< RBUS_INT32 min bytes to send a message through shared memory, default 65536 */
+    RBUS_CONFIG_SHM_LINGER,             /**< RBUS_INT32 milliseconds an unconfirmed shared memory message stays, default 10000 */
+    RBUS_CONFIG_REG_ELEMENTS_THREADS,   /**< RBUS_INT32 threads registering elements in rbus_regDataElements, 1 to 16, default 4.
+                                             Read when a call starts, calls already running keep their threads */
+    RBUS_CONFIG_SUBSCRIBE_THREADS,      /**< RBUS_INT32 threads sending rbusEvent_SubscribeEx entries, 1 to 16, default 8.
+                                             Read when a call starts, calls already running keep their threads */
+    RBUS_CONFIG_DELIVERY_QUEUE_DEPTH,   /**< RBUS_INT32 queue depth when rbus_setDeliveryThreads is passed 0, default 1024.
+                                             Only used by later rbus_setDeliveryThreads calls, existing threads keep their depth */
+    RBUS_CONFIG_SEND_WINDOW,            /**< RBUS_INT32 initial window of rbusMessage_SendAsync, 1 to 64, default 8.
+                                             Only used by handles that haven't sent yet, use rbusMessage_SetSendWindow for the others */
+    RBUS_CONFIG_MAX
+} rbusConfigSetting_t;
+
+/** @fn rbusError_t rbus_setConfig(
+ *          rbusConfigSetting_t setting,
+ *          rbusValue_t value)
+ *  @brief  Change a setting while rbus is running.                            \n
+ *  Settings start from their defaults, then the file named by the RBUS_CONFIG_FILE
+ *  environment variable, then environment variables of the same names.
+ *  Changes apply to work started afterwards, for example the next value-change poll
+ *  or the next rbus_regDataElements call; thread pools and queues that already exist
+ *  are not resized. Changes last for the life of the process, across closing and
+ *  opening handles.
+ *  @param      setting     The setting to change
+ *  @param      value       The new value, an integer type or a string to be parsed
+ *  @return                 RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_INVALID_OPERATION
+ */
+rbusError_t rbus_setConfig(
+    rbusConfigSetting_t setting,
+    rbusValue_t value);
+
+/** @fn rbusError_t rbus_getConfig(
+ *          rbusConfigSetting_t setting,
+ *          rbusValue_t* value)
+ *  @brief  Get the current value of a setting.
+ *  @param      setting     The setting to get
+ *  @param      value       Returns the value, which the caller must release
+ *  @return                 RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_INPUT
+ */
+rbusError_t rbus_getConfig(
+    rbusConfigSetting_t setting,
+    rbusValue_t* value);
+
+/** @fn rbusError_t rbus_loadConfig(
+ *          char const* filePath)
+ *  @brief  Apply the settings in a file, as rbus_setConfig would.             \n
+ *  Each line is NAME=value, such as RBUS_VALUECHANGE_PERIOD=500. Blank lines and
+ *  lines starting with # are skipped. Lines that fail don't stop the rest.
+ *  @param      filePath    The config file
+ *  @return                 RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_INPUT if the file can't be read or any line fails
+ */
+rbusError_t rbus_loadConfig(
+    char const* filePath);
 /** @} */
 
 /** @addtogroup Discovery
@@ -758,12 +941,38 @@ rbusError_t rbus_regDataElements(
  *  @return RBus error code as defined by rbusError_t.
  *  Possible values are:
  *  RBUS_ERROR_ELEMENT_NAME_MISSING: No data element names provided.
+ *  RBUS_ERROR_OUT_OF_RESOURCES: Memory allocation failed, and nothing was unregistered.
  */
 rbusError_t rbus_unregDataElements (
     rbusHandle_t handle,
     int numDataElements,
     rbusDataElement_t *elements);
 
+/** @fn rbusError_t rbus_setGetCachePolicy(
+ *          rbusHandle_t handle,
+ *          char const* name,
+ *          rbusGetCachePolicy_t const* policy)
+ *  @brief  Let gets of a property be answered from the result of an earlier
+ *  call to its getHandler, for properties whose value changes rarely but are
+ *  read often.                                                               \n
+ *  Call it after rbus_regDataElements with the registered name. The policy applies
+ *  to every row instance of the property, including rows added later. A cached
+ *  result is dropped when maxAge passes, when the value-change detector sees a new
+ *  value and, if invalidateOnSet is true, when the property is set. A getHandler
+ *  whose result depends on the requesting component must not be cached.
+ *  Used by:  Providers with getHandlers that are costly to call
+ *  @param      handle      Bus Handle
+ *  @param      name        The registered name of a property with a getHandler
+ *  @param      policy      The cache policy; a maxAge of 0 turns caching off
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_ELEMENT_DOES_NOT_EXIST,
+ *  RBUS_ERROR_OUT_OF_RESOURCES
+ */
+rbusError_t rbus_setGetCachePolicy(
+    rbusHandle_t handle,
+    char const* name,
+    rbusGetCachePolicy_t const* policy);
+
 /** @} */
 
 /** @addtogroup Consumers
@@ -849,6 +1058,44 @@ rbusError_t rbus_getExt(
     int *numProps,
     rbusProperty_t* properties);
 
+/** @fn rbusError_t rbus_getExtStream(
+ *          rbusHandle_t handle,
+ *          char const* partialPath,
+ *          int chunkSize,
+ *          rbusGetExtStreamHandler_t handler,
+ *          void* userData)
+ *  @brief Gets the values of a partial path or wildcard query in chunks.
+ *  Each provider answers with at most chunkSize properties at a time and the
+ *  handler is called as each chunk arrives, so the consumer only holds one chunk.
+
+ *  A provider walks the query only as far as it needs to fill each chunk and resumes
+ *  from where it stopped when the next chunk is requested, so the first chunk arrives
+ *  without waiting for the whole walk.  Between chunks it holds its place in the walk and
+ *  at most the results of one getHandler call that didn't fit, such as a table getHandler
+ *  answering for every row.  Each chunk reflects the data model when it was walked: rows
+ *  added after the walk passed them are not returned, and if the row the walk stopped at is
+ *  removed the walk continues from the row that took its place.  What a provider holds for a
+ *  consumer that stops asking for chunks is dropped after 60 seconds.
+
+ *  Providers built before this API was added answer with all their results in one chunk.
+
+ *  Used by: All components that need to dump large parts of the data model
+ *  @param      handle          Bus Handle
+ *  @param      partialPath     The query, as for Option 3 or 4 of rbus_getExt
+ *  @param      chunkSize       The maximum number of properties per chunk, or 0 for a default
+ *  @param      handler         Called for each chunk
+ *  @param      userData        Passed to handler
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible values are the same as rbus_getExt.
+ *  An error returned after some chunks were delivered means the results are incomplete.
+ */
+rbusError_t rbus_getExtStream(
+    rbusHandle_t handle,
+    char const* partialPath,
+    int chunkSize,
+    rbusGetExtStreamHandler_t handler,
+    void* userData);
+
 /** @fn rbusError_t rbus_getInt(
  *          rbusHandle_t handle,
  *          char const* paramName,
@@ -937,6 +1184,19 @@ rbusError_t rbus_set(
  *          rbusSetOptions_t* opts)
  *  @brief A component uses this to perform a set operation for multiple
  *  parameters at once.  \n
+ *  When the parameters are owned by more than one component and opts commits the
+ *  set, it is done under the session of opts, or else a session it creates and
+ *  closes.  Every component's setHandlers are first called in parallel with commit
+ *  false, to check and remember their values as for any set that is not committed.
+ *  Only if all of them succeed is each component sent a commit, which finalizes the
+ *  values its setHandlers remembered; otherwise no commit is sent.  \n
+ *  A setHandler that ignores the commit flag and applies its value straight away
+ *  can't be rolled back, nor can the other components be once one fails its commit.
+ *  When no session can be created the components are sent committed sets at once,
+ *  and one failing leaves the others set.  \n
+ *  A component checks every parameter of a set before calling any setHandler, so a
+ *  set owned by a single component is rejected as a whole when one of its parameters
+ *  is not registered or has no setHandler, where the other parameters used to be set.  \n
  *  Used by: All components that need to set multiple parameters
  *  @param      handle          Bus Handle
  *  @param      numProps        The number (count) of parameters
@@ -951,6 +1211,8 @@ rbusError_t rbus_set(
  *  Possible values are:
  *  RBUS_ERROR_ACCESS_NOT_ALLOWED: Access to requested parameter is not permitted.
  *  RBUS_ERROR_DESTINATION_NOT_REACHABLE: Destination element was not reachable.
+ *  RBUS_ERROR_INVALID_OPERATION: A parameter has no setHandler.
+ *  RBUS_ERROR_OUT_OF_RESOURCES: Memory allocation failed.
  */
 rbusError_t rbus_setMulti(
     rbusHandle_t handle,
@@ -1235,6 +1497,9 @@ rbusError_t rbusEvent_Unsubscribe(
  * If timeout is positive, internal retries will be attempted if the subscription
  * cannot be routed to an existing provider, and the retries will continue until
  * either a provider is found, an unrecoverable error occurs, or retry timeout reached.
+ * Several subscriptions are sent concurrently, so the retry timeout applies to
+ * each subscription rather than to the array as a whole.  If more than one fails,
+ * the error of the first failed entry in the array is returned.
  *  @param      handle            Bus Handle
  *  @param      subscription      The array of subscriptions to register to
  *  @param      numSubscriptions  The number of subscriptions to register to
@@ -1284,6 +1549,62 @@ rbusError_t rbusEvent_SubscribeExAsync(
     rbusSubscribeAsyncRespHandler_t subscribeHandler,
     int                             timeout);
 
+/** @fn rbusError_t  rbusEvent_SubscribeExWithRate (
+ *          rbusHandle_t handle,
+ *          rbusEventSubscription_t* subscription,
+ *          rbusEventRateOptions_t const* rate,
+ *          int numSubscriptions,
+ *          int timeout)
+ *  @brief  Subscribe to one or more events like rbusEvent_SubscribeEx, limiting the
+ *          rate at which the provider delivers each of them\n
+ *  Used by: Components that need to subscribe to events.
+ * rate[i] applies to subscription[i].  Providers that don't support rate limiting
+ * ignore the options and deliver every event.
+ *  @param      handle            Bus Handle
+ *  @param      subscription      The array of subscriptions to register to
+ *  @param      rate              The array of rate options, one per subscription, or NULL for none
+ *  @param      numSubscriptions  The number of subscriptions to register to
+ *  @param      timeout           Max time in seconds to attempt retrying subscribe
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_EVENT
+ *  @ingroup Events
+ */
+rbusError_t rbusEvent_SubscribeExWithRate(
+    rbusHandle_t                    handle,
+    rbusEventSubscription_t*        subscription,
+    rbusEventRateOptions_t const*   rate,
+    int                             numSubscriptions,
+    int                             timeout);
+
+/** @fn rbusError_t  rbusEvent_SubscribeExAsyncWithRate (
+ *          rbusHandle_t handle,
+ *          rbusEventSubscription_t* subscription,
+ *          rbusEventRateOptions_t const* rate,
+ *          int numSubscriptions,
+ *          rbusSubscribeAsyncRespHandler_t subscribeHandler,
+ *          int timeout)
+ *  @brief  Subscribe asynchronously to one or more events like rbusEvent_SubscribeExAsync,
+ *          limiting the rate at which the provider delivers each of them\n
+ *  Used by: Components that need to subscribe asynchronously to events.
+ * rate[i] applies to subscription[i].
+ *  @param      handle            Bus Handle
+ *  @param      subscription      The array of subscriptions to register to
+ *  @param      rate              The array of rate options, one per subscription, or NULL for none
+ *  @param      numSubscriptions  The number of subscriptions to register to
+ *  @param      subscribeHandler  The subscribe callback handler
+ *  @param      timeout           Max time in seconds to attempt retrying subscribe
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_INVALID_EVENT
+ *  @ingroup Events
+ */
+rbusError_t rbusEvent_SubscribeExAsyncWithRate(
+    rbusHandle_t                    handle,
+    rbusEventSubscription_t*        subscription,
+    rbusEventRateOptions_t const*   rate,
+    int                             numSubscriptions,
+    rbusSubscribeAsyncRespHandler_t subscribeHandler,
+    int                             timeout);
+
 /** @fn rbusError_t  rbusEvent_UnsubscribeEx(
  *          rbusHandle_t handle, 
  *          rbusEventSubscription_t* subscriptions,
@@ -1474,6 +1795,78 @@ rbusError_t rbus_closeSession(
     rbusHandle_t handle,
     uint32_t sessionId);
 
+/** @fn rbusError_t rbusSessionLease_Open(
+ *          rbusHandle_t handle,
+ *          uint32_t blockSize,
+ *          rbusSessionLease_t* pLease)
+ *
+ *  @brief Opens a session lease, which hands out session ids without a round-trip
+ *      to the session manager for every session. \n
+ *  The lease reserves a block of blockSize session ids and numbers sessions locally
+ *  from it, reserving the next block once it is used up.  A used up block is ended
+ *  when the last of its ids is released.  If the session manager replies that it
+ *  cannot reserve blocks, or replies without a block, the lease falls back to
+ *  rbus_createSession and rbus_closeSession for each session, so callers need not
+ *  check.  The session manager then allows only one of those sessions to be open at
+ *  a time, and Acquire fails with RBUS_ERROR_SESSION_ALREADY_EXIST until it is
+ *  released.  Other failures,
+ *  such as a timeout, are returned and the next call asks for a block again.
+ *  Used by: Components that open many short sessions, such as a config manager.
+ *
+ *  @param handle Bus Handle
+ *  @param blockSize the number of session ids to reserve at a time
+ *  @param pLease the opened lease, which must be closed with rbusSessionLease_Close
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible values are: RBUS_ERROR_SUCCESS, RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_OUT_OF_RESOURCES,
+ *  or the error reserving the first block.
+ */
+rbusError_t rbusSessionLease_Open(
+    rbusHandle_t handle,
+    uint32_t blockSize,
+    rbusSessionLease_t* pLease);
+
+/** @fn rbusError_t rbusSessionLease_Acquire(
+ *          rbusSessionLease_t lease,
+ *          uint32_t* pSessionId)
+ *
+ *  @brief Gets a session id from the lease, to be used in place of rbus_createSession.
+ *      May be called from several threads.
+ *
+ *  @param lease the lease
+ *  @param pSessionId the session id
+ *  @return RBus error code as defined by rbusError_t.
+ */
+rbusError_t rbusSessionLease_Acquire(
+    rbusSessionLease_t lease,
+    uint32_t* pSessionId);
+
+/** @fn rbusError_t rbusSessionLease_Release(
+ *          rbusSessionLease_t lease,
+ *          uint32_t sessionId)
+ *
+ *  @brief Ends a session got from rbusSessionLease_Acquire, to be used in place of
+ *      rbus_closeSession.  Ids from a reserved block need no session manager call.
+ *
+ *  @param lease the lease
+ *  @param sessionId the session id to end
+ *  @return RBus error code as defined by rbusError_t.
+ */
+rbusError_t rbusSessionLease_Release(
+    rbusSessionLease_t lease,
+    uint32_t sessionId);
+
+/** @fn rbusError_t rbusSessionLease_Close(
+ *          rbusSessionLease_t lease)
+ *
+ *  @brief Returns the lease's reserved blocks to the session manager and frees the lease.
+ *      Ids acquired and not yet released are ended with their block.
+ *
+ *  @param lease the lease
+ *  @return RBus error code as defined by rbusError_t.
+ */
+rbusError_t rbusSessionLease_Close(
+    rbusSessionLease_t lease);
+
 /** @fn rbusError_t rbus_registerLogHandler(
  *          rbusLogHandler logHandler)
  *
@@ -1507,6 +1900,7 @@ rbusError_t rbus_setLogLevel(rbusLogLevel_t level);
 #endif
 
 #include <rbus_message.h>
+#include <rbus_stats.h>
 
 #endif
 
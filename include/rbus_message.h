@@ -30,6 +30,7 @@
 #define RBUS_MESSAGE_H
 
 #include <rbus.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,11 +55,42 @@ typedef enum
 {
   RBUS_MESSAGE_NONE = 0, /**< The message is sent non-blocking with no
                                          confirmation of delivery */
-  RBUS_MESSAGE_CONFIRM_RECEIPT = 1     /**< The message is sent, blocking until a response
+  RBUS_MESSAGE_CONFIRM_RECEIPT = 1,    /**< The message is sent, blocking until a response
                                          returns indicating whether the message
                                          was received by a listener or not */
+  RBUS_MESSAGE_SHARED_MEMORY = 2       /**< May be combined with the other options.
+                                         Data larger than RBUS_SHM_THRESHOLD (64K by default)
+                                         is placed in POSIX shared memory and only its name
+                                         goes over the bus.  Listeners map it read-only and the
+                                         mapping is released when their handler returns unless
+                                         it is kept with rbusMessage_RetainData.
+                                         Listeners must be on the same host, running as the
+                                         same user, and using an rbus which supports it; others
+                                         don't receive the message at all */
 } rbusMessageSendOptions_t;
 
+/** @fn typedef void (*rbusMessageSendCallback_t)(
+ *          rbusHandle_t handle,
+ *          rbusMessage_t* message,
+ *          rbusError_t error,
+ *          void* userData)
+ *  @brief A component will receive this API callback when a message sent with
+ *  rbusMessage_SendAsync completes.  It is called on an internal send thread.
+ *  The callback may call rbus_close on the handle; the messages still queued
+ *  are then sent on the callback's thread before rbus_close returns.
+ *  @param handle Bus Handle
+ *  @param message The message which was sent
+ *  @param error RBUS_ERROR_SUCCESS if a listener confirmed receipt or the error
+ *         rbusMessage_Send with RBUS_MESSAGE_CONFIRM_RECEIPT would have returned
+ *  @param userData The user data passed to rbusMessage_SendAsync
+ *  @return void
+ */
+typedef void (*rbusMessageSendCallback_t)(
+    rbusHandle_t handle,
+    rbusMessage_t* message,
+    rbusError_t error,
+    void* userData);
+
 /** @fn typedef void (*rbusMessageHandler_t)(
  *          rbusHandle_t handle, 
  *          rbusMessage_t message, 
@@ -82,12 +114,17 @@ typedef void (*rbusMessageHandler_t)(
  *          rbusMessageHandler_t callback,
  *          void * userData)
  *  @brief  Add a message listener.
+ *
+ *  An expression can have one listener per handle.  A listener added while
+ *  another is still subscribing with the same expression waits for it, and
+ *  subscribes itself if that fails.
  *  @param  handle Bus Handle
  *  @param  expression A topic or a topic expression
  *  @param  handler The message callback handler
  *  @param  userData User data to be passed back to the callback handler
  *  @return RBus error code as defined by rbusError_t.
- *  Possible errors are: RBUS_ERROR_BUS_ERROR
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT, including when the expression already has
+ *  a listener, RBUS_ERROR_OUT_OF_RESOURCES, RBUS_ERROR_BUS_ERROR
  */
 rbusError_t rbusMessage_AddListener(
     rbusHandle_t handle,
@@ -98,11 +135,11 @@ rbusError_t rbusMessage_AddListener(
 /** @fn rbusError_t rbusMessage_RemoveListener(
  *          rbusHandle_t handle,
  *          char const* expression)
- *  @brief  Remove a message listener.
+ *  @brief  Remove the message listener added with an expression.
  *  @param  handle Bus Handle
  *  @param  expression A topic or a topic expression
  *  @return RBus error code as defined by rbusError_t.
- *  Possible errors are: RBUS_ERROR_BUS_ERROR
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_BUS_ERROR
  */
 rbusError_t rbusMessage_RemoveListener(
     rbusHandle_t handle,
@@ -119,6 +156,32 @@ rbusError_t rbusMessage_RemoveListener(
 rbusError_t rbusMessage_RemoveAllListeners(
     rbusHandle_t handle);
 
+/** @fn rbusError_t rbusMessage_RetainData(
+ *          rbusMessage_t const* message,
+ *          uint8_t const** data)
+ *  @brief  Keep the data of a received message after the handler returns.
+ *          Data sent through shared memory is kept mapped, without a copy,
+ *          and any other data is copied.  Only call this from a message handler.
+ *          Each call must be matched by a call to rbusMessage_ReleaseData.
+ *  @param  message The message passed to the handler
+ *  @param  data Returns the data, which is message->length bytes long
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_OUT_OF_RESOURCES
+ */
+rbusError_t rbusMessage_RetainData(
+    rbusMessage_t const* message,
+    uint8_t const** data);
+
+/** @fn rbusError_t rbusMessage_ReleaseData(
+ *          uint8_t const* data)
+ *  @brief  Release data kept with rbusMessage_RetainData.
+ *  @param  data The data returned by rbusMessage_RetainData
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT
+ */
+rbusError_t rbusMessage_ReleaseData(
+    uint8_t const* data);
+
 /** @fn rbusError_t rbusMessage_Send(
  *          rbusHandle_t handle,
  *          rbusMessage_t* message,
@@ -135,6 +198,102 @@ rbusError_t rbusMessage_Send(
     rbusMessage_t* message,
     rbusMessageSendOptions_t opts);
 
+/** @fn rbusError_t rbusMessage_SendBatch(
+ *          rbusHandle_t handle,
+ *          rbusMessage_t* messages,
+ *          int count,
+ *          rbusMessageSendOptions_t opts,
+ *          int* numSent)
+ *  @brief  Send a batch of messages, in order, with the same options.
+ *          Consecutive messages to the same topic are packed into frames of up to 64K,
+ *          each sent in one write and, with RBUS_MESSAGE_CONFIRM_RECEIPT, confirmed once.
+ *          Listeners unpack a frame and receive its messages one by one as usual.
+ *          A message larger than a frame, or sent through shared memory, goes on its own.
+ *          Listeners must be using an rbus which supports batches; others drop the frames.
+ *          Sending stops at the first frame or message which fails.
+ *  @param  handle Bus Handle
+ *  @param  messages The messages to send
+ *  @param  count The number of messages
+ *  @param  opts Options to control how the messages are sent
+ *  @param  numSent Returns the number of messages sent before any failure; may be NULL
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_BUS_ERROR, RBUS_ERROR_DESTINATION_NOT_FOUND,
+ *  RBUS_ERROR_OUT_OF_RESOURCES
+ */
+rbusError_t rbusMessage_SendBatch(
+    rbusHandle_t handle,
+    rbusMessage_t* messages,
+    int count,
+    rbusMessageSendOptions_t opts,
+    int* numSent);
+
+/** @fn rbusError_t rbusMessage_SendV(
+ *          rbusHandle_t handle,
+ *          char const* topic,
+ *          struct iovec const* iov,
+ *          int iovcnt,
+ *          rbusMessageSendOptions_t opts)
+ *  @brief  Send a message whose data is gathered from several buffers,
+ *          e.g. a header and a body, so the caller doesn't have to join them.
+ *          Listeners receive the buffers joined in order as a single message.
+ *          The connection takes a single buffer, so several buffers are joined into
+ *          one before sending, except through shared memory where they are written
+ *          straight into the shared object.
+ *  @param  handle Bus Handle
+ *  @param  topic The topic the message is sent to
+ *  @param  iov The buffers holding the message data
+ *  @param  iovcnt The number of buffers
+ *  @param  opts Options to control how the message is sent
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_BUS_ERROR, RBUS_ERROR_DESTINATION_NOT_FOUND,
+ *  RBUS_ERROR_OUT_OF_RESOURCES
+ */
+rbusError_t rbusMessage_SendV(
+    rbusHandle_t handle,
+    char const* topic,
+    struct iovec const* iov,
+    int iovcnt,
+    rbusMessageSendOptions_t opts);
+
+/** @fn rbusError_t rbusMessage_SendAsync(
+ *          rbusHandle_t handle,
+ *          rbusMessage_t* message,
+ *          rbusMessageSendCallback_t callback,
+ *          void* userData)
+ *  @brief  Send a message with confirmation of receipt without waiting for it.
+ *          The message is copied and queued, and up to the send window's worth
+ *          of messages wait for their confirmation at the same time.
+ *          Once the window is full, this blocks until a message completes.
+ *          Messages may complete out of order. rbus_close waits for any still queued,
+ *          including when it is called from a completion callback.
+ *  @param  handle Bus Handle
+ *  @param  message The message to send
+ *  @param  callback Called when the message completes; may be NULL
+ *  @param  userData User data to be passed back to the callback
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_OUT_OF_RESOURCES
+ */
+rbusError_t rbusMessage_SendAsync(
+    rbusHandle_t handle,
+    rbusMessage_t* message,
+    rbusMessageSendCallback_t callback,
+    void* userData);
+
+/** @fn rbusError_t rbusMessage_SetSendWindow(
+ *          rbusHandle_t handle,
+ *          int window)
+ *  @brief  Set how many messages sent with rbusMessage_SendAsync may be
+ *          pending at once.  The default is RBUS_CONFIG_SEND_WINDOW (8)
+ *          and the maximum is 64.
+ *  @param  handle Bus Handle
+ *  @param  window The number of pending messages
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT, RBUS_ERROR_OUT_OF_RESOURCES
+ */
+rbusError_t rbusMessage_SetSendWindow(
+    rbusHandle_t handle,
+    int window);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,132 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/**
+ * @file        rbus_stats.h
+ * @brief       rbusStats
+ * @defgroup    rbusStats
+ * @brief       rbusStats exposes always-on call counters and latency histograms
+                measured inside the rbus library of the calling process.
+ * @{
+ */
+
+#ifndef RBUS_STATS_H
+#define RBUS_STATS_H
+
+#include <rbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum        rbusStatsMetric_t
+ * @brief       The operations that are measured
+ */
+typedef enum
+{
+    RBUS_STATS_GET = 0,             /**< rbus_get called by a consumer */
+    RBUS_STATS_GET_EXT,             /**< rbus_getExt called by a consumer */
+    RBUS_STATS_SET,                 /**< rbus_set called by a consumer */
+    RBUS_STATS_EVENT_PUBLISH,       /**< rbusEvent_Publish called by a provider */
+    RBUS_STATS_METHOD_INVOKE,       /**< rbusMethod_Invoke/rbusMethod_InvokeAsync called by a consumer */
+    RBUS_STATS_GET_HANDLER,         /**< a provider getHandler serving a get request */
+    RBUS_STATS_SET_HANDLER,         /**< a provider setHandler serving a set request */
+    RBUS_STATS_VALUE_CHANGE_POLL,   /**< one value-change polling cycle over all auto-published properties */
+    RBUS_STATS_GET_CACHE_HIT,       /**< a get request answered from a property's get cache, see rbus_setGetCachePolicy */
+    RBUS_STATS_MAX
+} rbusStatsMetric_t;
+
+/** Number of latency histogram buckets */
+#define RBUS_STATS_HISTOGRAM_BUCKETS 24
+
+/**
+ * @struct      rbusStats_t
+ * @brief       The counters and latency histogram of one metric
+ */
+typedef struct
+{
+    uint64_t count;         /**< Number of calls measured */
+    uint64_t errors;        /**< Number of calls that failed */
+    uint64_t totalUsec;     /**< Sum of the latencies of all calls in microseconds */
+    uint64_t maxUsec;       /**< Largest latency in microseconds */
+    uint64_t buckets[RBUS_STATS_HISTOGRAM_BUCKETS];
+                            /**< Log2 latency histogram. Bucket 0 counts calls under 2 microseconds,
+                                 bucket i counts calls from 2^i up to 2^(i+1) microseconds and the
+                                 last bucket also counts every call above its range */
+} rbusStats_t;
+
+/** @fn char const* rbusStats_MetricToString(
+ *          rbusStatsMetric_t metric)
+ *  @brief  Get the name of a metric, as used in the Device.X_RBUS.Stats. data elements
+ *  @param  metric The metric
+ *  @return The name of the metric or NULL if the metric is invalid
+ */
+char const* rbusStats_MetricToString(
+    rbusStatsMetric_t metric);
+
+/** @fn rbusError_t rbusStats_Get(
+ *          rbusStatsMetric_t metric,
+ *          rbusStats_t* stats)
+ *  @brief  Get the current counters of a metric.
+ *          Counters are updated without locking so the fields are read one at a time
+ *          and may not be exactly consistent with each other while calls are in progress.
+ *  @param  metric The metric
+ *  @param  stats Returns the counters
+ *  @return RBus error code as defined by rbusError_t.
+ *  Possible errors are: RBUS_ERROR_INVALID_INPUT
+ */
+rbusError_t rbusStats_Get(
+    rbusStatsMetric_t metric,
+    rbusStats_t* stats);
+
+/** @fn void rbusStats_Reset()
+ *  @brief  Reset the counters of all metrics to zero.
+ */
+void rbusStats_Reset(void);
+
+/** @fn rbusError_t rbusStats_RegisterDataElements(
+ *          rbusHandle_t handle)
+ *  @brief  Register read-only data elements publishing the counters of this process as
+ *          Device.X_RBUS.Stats.<component>.<metric>.{Count,Errors,TotalUsec,MaxUsec,Histogram}.
+ *          Any '.' in the component name is replaced with '_'.
+ *          Histogram is a comma separated list of the bucket counts.
+ *          Once registered, the stats of all registered components can be read with a
+ *          partial path get of Device.X_RBUS.Stats.
+ *  @param  handle Bus Handle
+ *  @return RBus error code as defined by rbusError_t.
+ */
+rbusError_t rbusStats_RegisterDataElements(
+    rbusHandle_t handle);
+
+/** @fn rbusError_t rbusStats_UnregisterDataElements(
+ *          rbusHandle_t handle)
+ *  @brief  Unregister the data elements registered with rbusStats_RegisterDataElements.
+ *  @param  handle Bus Handle
+ *  @return RBus error code as defined by rbusError_t.
+ */
+rbusError_t rbusStats_UnregisterDataElements(
+    rbusHandle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+
+/** @} */
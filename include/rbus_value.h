@@ -186,6 +186,27 @@ void rbusValue_SetPointer(rbusValue_t* value1, rbusValue_t value2);
  */
 void rbusValue_Copy(rbusValue_t dest, rbusValue_t source);
 
+/** @def RBUS_VALUE_FORMAT_MAX
+ *  @brief Buffer size that holds the null terminated text of any value that is
+ *         not an RBUS_STRING or RBUS_BYTES (the longest being a negative DBL_MAX).
+ *         An RBUS_STRING needs its strlen + 1 and RBUS_BYTES needs 2 * length + 1.
+ */
+#define RBUS_VALUE_FORMAT_MAX 328
+
+/** @fn int rbusValue_Format(rbusValue_t value, char* buf, size_t buflen)
+ *  @brief Writes the same text as rbusValue_ToString into a caller buffer without allocating.
+ *         Like snprintf, the output is always null terminated when buflen is non-zero,
+ *         is truncated if buf is too small, and the full length is returned, so a
+ *         call with buf NULL and buflen 0 gives the size needed.
+ *         RBUS_BYTES output is truncated on a whole byte (2 hex characters).
+ *  @param value the value to convert to a string
+ *  @param buf buffer to write the string to, or NULL to only compute the length
+ *  @param buflen the size of buf
+ *  @return The length of the full string not counting the null terminator,
+ *          or -1 if value is NULL or of type RBUS_NONE.
+ */
+int rbusValue_Format(rbusValue_t value, char* buf, size_t buflen);
+
 /** @fn char* rbusValue_ToString(rbusValue_t value, char* buf, size_t buflen)
  *  @brief Returns a null terminated string representing the data of the value.  
  *         Parameters buf and buflen are optional and allow the caller to pass in a buffer 
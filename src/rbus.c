@@ -30,11 +30,15 @@
 #include "rbus_buffer.h"
 #include "rbus_element.h"
 #include "rbus_valuechange.h"
+#include "rbus_eventrate.h"
 #include "rbus_subscriptions.h"
 #include "rbus_asyncsubscribe.h"
 #include "rbus_config.h"
 #include "rbus_log.h"
 #include "rbus_handle.h"
+#include "rbus_stats_internal.h"
+#include "rbus_message_internal.h"
+#include "rbus_delivery.h"
 
 //******************************* MACROS *****************************************//
 #define UNUSED1(a)              (void)(a)
@@ -44,8 +48,13 @@
 #define UNUSED5(a,b,c,d,e)      UNUSED1(a),UNUSED4(b,c,d,e)
 #define UNUSED6(a,b,c,d,e,f)    UNUSED1(a),UNUSED5(b,c,d,e,f)
 
-#define MAX_COMPS_PER_PROCESS               5
 #define INVOKE_TIMEOUT                      60000
+#define GET_STREAM_CHUNK_SIZE               256
+#define GET_STREAM_TIMEOUT                  INVOKE_TIMEOUT
+#define GET_OPTION_BINARY                   0x1
+#define GET_OPTION_NAME_PREFIX              0x2
+#define REG_ELEMENTS_PARALLEL_MIN           16
+#define SUBSCRIBE_BATCH_PARALLEL_MIN        4
 #ifndef FALSE
 #define FALSE                               0
 #endif
@@ -64,14 +73,6 @@ struct _rbusMethodAsyncHandle
     rtMessageHeader hdr;
 };
 
-struct _rbusHandle handle_array[MAX_COMPS_PER_PROCESS] = {
-    {0,"", NULL, NULL, NULL, NULL, NULL},
-    {0,"", NULL, NULL, NULL, NULL, NULL},
-    {0,"", NULL, NULL, NULL, NULL, NULL},
-    {0,"", NULL, NULL, NULL, NULL, NULL},
-    {0,"", NULL, NULL, NULL, NULL, NULL}
-};
-
 typedef enum _rbus_legacy_support
 {
     RBUS_LEGACY_STRING = 0,    /**< Null terminated string                                           */
@@ -211,6 +212,13 @@ static rbusError_t CCSPError_to_rbusError(rtError e)
   return err;
 }
 
+/*a subscription made by this process; callbacks are handed &sub, so it must stay first*/
+typedef struct _rbusEventSubscriptionInternal
+{
+    rbusEventSubscription_t sub;
+    rbusEventRateOptions_t  rate;
+} rbusEventSubscriptionInternal_t;
+
 static void rbusEventSubscription_free(void* p)
 {
     rbusEventSubscription_t* sub = (rbusEventSubscription_t*)p;
@@ -832,7 +840,7 @@ void valueChangeTableRowUpdate(rbusHandle_t handle, elementNode* rowNode, bool a
     }
 }
 
-int subscribeHandlerImpl(rbusHandle_t handle, bool added, elementNode* el, char const* eventName, char const* listener, int32_t interval, int32_t duration, rbusFilter_t filter)
+int subscribeHandlerImpl(rbusHandle_t handle, bool added, elementNode* el, char const* eventName, char const* listener, int32_t interval, int32_t duration, uint32_t publishInterval, bool coalesce, rbusFilter_t filter)
 {
     rbusSubscription_t* subscription = NULL;
     struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
@@ -860,7 +868,7 @@ int subscribeHandlerImpl(rbusHandle_t handle, bool added, elementNode* el, char
 
     if(added)
     {
-        subscription = rbusSubscriptions_addSubscription(handleInfo->subscriptions, listener, eventName, filter, interval, duration, autoPublish, el);
+        subscription = rbusSubscriptions_addSubscription(handleInfo->subscriptions, listener, eventName, filter, interval, duration, publishInterval, coalesce, autoPublish, el);
 
         if(!subscription)
         {
@@ -1039,6 +1047,8 @@ static int _event_subscribe_callback_handler(char const* object,  char const* ev
     {
         int32_t interval = 0;
         int32_t duration = 0;
+        int32_t publishInterval = 0;
+        int32_t coalesce = 0;
         rbusFilter_t filter = NULL;
 
         /* copy the optional filter */
@@ -1052,11 +1062,20 @@ static int _event_subscribe_callback_handler(char const* object,  char const* ev
             {
                 rbusFilter_InitFromMessage(&filter, payload);
             }
+            /* the optional rate limit is absent when sent by older consumers */
+            if(rbusMessage_GetInt32(payload, &publishInterval) == RT_OK)
+            {
+                rbusMessage_GetInt32(payload, &coalesce);
+            }
+            if(publishInterval < 0)
+            {
+                publishInterval = 0;
+            }
         }
 
         RBUSLOG_DEBUG("%s: found element of type %d", __FUNCTION__, el->type);
 
-        err = subscribeHandlerImpl(handle, added, el, eventName, listener, interval, duration, filter);
+        err = subscribeHandlerImpl(handle, added, el, eventName, listener, interval, duration, (uint32_t)publishInterval, coalesce != 0, filter);
 
         if(filter)
         {
@@ -1071,20 +1090,17 @@ static int _event_subscribe_callback_handler(char const* object,  char const* ev
     return err;
 }
 
-static void _client_disconnect_callback_handler(const char * listener)
+static void _client_disconnect_handle(struct _rbusHandle* handle, char const* listener)
 {
-    int i;
-    for(i = 0; i < MAX_COMPS_PER_PROCESS; i++)
+    if(handle->subscriptions)
     {
-        if(handle_array[i].inUse)
-        {
-            if(handle_array[i].subscriptions)
-            {
-                rbusSubscriptions_handleClientDisconnect(&handle_array[i], handle_array[i].subscriptions, listener);
-            }
-        }
+        rbusSubscriptions_handleClientDisconnect(handle, handle->subscriptions, listener);
     }
+}
 
+static void _client_disconnect_callback_handler(const char * listener)
+{
+    rbusHandle_DispatchClientDisconnect(listener, _client_disconnect_handle);
 }
 
 void _subscribe_async_callback_handler(rbusHandle_t handle, rbusEventSubscription_t* subscription, rbusError_t error)
@@ -1103,6 +1119,30 @@ void _subscribe_async_callback_handler(rbusHandle_t handle, rbusEventSubscriptio
     }
 }
 
+/*an event queued for a delivery thread, owning a copy of its name*/
+typedef struct
+{
+    rbusEventSubscription_t*    subscription;
+    rbusEvent_t                 event;
+} rbusEventDelivery_t;
+
+static void _event_delivery_run(void* p)
+{
+    rbusEventDelivery_t* delivery = (rbusEventDelivery_t*)p;
+    rbusEventHandler_t handler = (rbusEventHandler_t)delivery->subscription->handler;
+
+    (*handler)(delivery->subscription->handle, &delivery->event, delivery->subscription);
+}
+
+static void _event_delivery_release(void* p)
+{
+    rbusEventDelivery_t* delivery = (rbusEventDelivery_t*)p;
+
+    rbusObject_Release(delivery->event.data);
+    free((void*)delivery->event.name);
+    free(delivery);
+}
+
 int _event_callback_handler (char const* objectName, char const* eventName, rbusMessage message, void* userData)
 {
     rbusEventSubscription_t* subscription;
@@ -1122,7 +1162,24 @@ int _event_callback_handler (char const* objectName, char const* eventName, rbus
     handler = (rbusEventHandler_t)subscription->handler;
 
     rbusEvent_updateFromMessage(&event, message);
-    
+
+    if(subscription->handle->delivery)
+    {
+        /*the name points into message, which is released once this returns*/
+        rbusEventDelivery_t* delivery = calloc(1, sizeof(rbusEventDelivery_t));
+        if(delivery)
+        {
+            delivery->subscription = subscription;
+            delivery->event.name = strdup(event.name);
+            delivery->event.type = event.type;
+            delivery->event.data = event.data;
+            if(delivery->event.name && rbusDelivery_Submit(subscription->handle, subscription, _event_delivery_run, _event_delivery_release, delivery))
+                return 0;
+            free((void*)delivery->event.name);
+            free(delivery);
+        }
+    }
+
     (*handler)(subscription->handle, &event, subscription);
 
     rbusObject_Release(event.data);
@@ -1130,6 +1187,67 @@ int _event_callback_handler (char const* objectName, char const* eventName, rbus
     return 0;
 }
 
+static rbusError_t _set_validate_properties(struct _rbusHandle* handleInfo, rbusProperty_t* properties, int numProps, char const** pFailedElement)
+{
+    int i;
+    for(i = 0; i < numProps; i++)
+    {
+        char const* paramName = rbusProperty_GetName(properties[i]);
+        elementNode* el = retrieveInstanceElement(handleInfo->elementRoot, paramName);
+        if(el == NULL)
+        {
+            RBUSLOG_WARN("Set Failed for %s; No Element registered", paramName);
+            *pFailedElement = paramName;
+            return RBUS_ERROR_ELEMENT_DOES_NOT_EXIST;
+        }
+        if(!el->cbTable.setHandler)
+        {
+            RBUSLOG_WARN("Set Failed for %s; No Handler found", paramName);
+            *pFailedElement = paramName;
+            return RBUS_ERROR_INVALID_OPERATION;
+        }
+    }
+    return RBUS_ERROR_SUCCESS;
+}
+
+static rbusError_t _set_apply_properties(rbusHandle_t handle, rbusProperty_t* properties, int numProps, rbusSetHandlerOptions_t* opts, char const** pFailedElement)
+{
+    struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
+    rbusError_t rc = RBUS_ERROR_SUCCESS;
+    int i;
+
+    for(i = 0; i < numProps; i++)
+    {
+        /* Retrive the element node */
+        char const* paramName = rbusProperty_GetName(properties[i]);
+        elementNode* el = retrieveInstanceElement(handleInfo->elementRoot, paramName);
+        rtTime_t start;
+
+        /*validated before applying anything, but a setHandler may have removed a row since*/
+        if(el == NULL || !el->cbTable.setHandler)
+        {
+            RBUSLOG_WARN("Set Failed for %s; No Element registered", paramName);
+            *pFailedElement = paramName;
+            return RBUS_ERROR_ELEMENT_DOES_NOT_EXIST;
+        }
+
+        rtTime_Now(&start);
+        rc = el->cbTable.setHandler(handle, properties[i], opts);
+        rbusStats_Record(RBUS_STATS_SET_HANDLER, &start, rc != RBUS_ERROR_SUCCESS);
+        /*even a failed set may have changed some of the state a cached get reflects*/
+        if(__atomic_load_n(&el->cacheInvalidateOnSet, __ATOMIC_RELAXED) && __atomic_load_n(&el->cacheMaxAge, __ATOMIC_RELAXED))
+            invalidateElementCache(el);
+        if (rc != RBUS_ERROR_SUCCESS)
+        {
+            RBUSLOG_WARN("Set Failed for %s; Component Owner returned Error", paramName);
+            *pFailedElement = paramName;
+            return rc;
+        }
+        setPropertyChangeComponent(el, opts->requestingComponent);
+    }
+    return rc;
+}
+
 static void _set_callback_handler (rbusHandle_t handle, rbusMessage request, rbusMessage *response)
 {
     rbusError_t rc = 0;
@@ -1151,63 +1269,39 @@ static void _set_callback_handler (rbusHandle_t handle, rbusMessage request, rbu
 
     if(numVals > 0)
     {
-        /* Update the Get Handler input options */
-        opts.sessionId = sessionId;
-        opts.requestingComponent = pCompName;
-
-        elementNode* el = NULL;
-
         pProperties = (rbusProperty_t*)malloc(numVals*sizeof(rbusProperty_t));
+        if(!pProperties)
+        {
+            RBUSLOG_ERROR("%s: failed to allocate %d properties", __FUNCTION__, numVals);
+            rbusMessage_Init(response);
+            rbusMessage_SetInt32(*response, RBUS_ERROR_OUT_OF_RESOURCES);
+            rbusMessage_SetString(*response, pCompName ? pCompName : "");
+            return;
+        }
         for (loopCnt = 0; loopCnt < numVals; loopCnt++)
         {
             rbusProperty_initFromMessage(&pProperties[loopCnt], request);
         }
+    }
 
-        rbusMessage_GetString(request, (char const**) &pIsCommit);
+    rbusMessage_GetString(request, (char const**) &pIsCommit);
 
-        /* Since we set as string, this needs to compared with string..
-         * Otherwise, just the #define in the top for TRUE/FALSE should be used.
-         */
-        if (strncasecmp("TRUE", pIsCommit, 4) == 0)
-            opts.commit = true;
+    /* Update the Set Handler input options */
+    opts.sessionId = sessionId;
+    opts.requestingComponent = pCompName;
 
-        for (loopCnt = 0; loopCnt < numVals; loopCnt++)
-        {
-            /* Retrive the element node */
-            char const* paramName = rbusProperty_GetName(pProperties[loopCnt]);
-            el = retrieveInstanceElement(handleInfo->elementRoot, paramName);
-            if(el != NULL)
-            {
-                if(el->cbTable.setHandler)
-                {
-                    rc = el->cbTable.setHandler(handle, pProperties[loopCnt], &opts);
-                    if (rc != RBUS_ERROR_SUCCESS)
-                    {
-                        RBUSLOG_WARN("Set Failed for %s; Component Owner returned Error", paramName);
-                        pFailedElement = paramName;
-                        break;
-                    }
-                    else
-                    {
-                        setPropertyChangeComponent(el, pCompName);
-                    }
-                }
-                else
-                {
-                    RBUSLOG_WARN("Set Failed for %s; No Handler found", paramName);
-                    rc = RBUS_ERROR_INVALID_OPERATION;
-                    pFailedElement = paramName;
-                    break;
-                }
-            }
-            else
-            {
-                RBUSLOG_WARN("Set Failed for %s; No Element registered", paramName);
-                rc = RBUS_ERROR_ELEMENT_DOES_NOT_EXIST;
-                pFailedElement = paramName;
-                break;
-            }
-        }
+    /* Since we set as string, this needs to compared with string..
+     * Otherwise, just the #define in the top for TRUE/FALSE should be used.
+     */
+    if (pIsCommit && strncasecmp("TRUE", pIsCommit, 4) == 0)
+        opts.commit = true;
+
+    if(numVals > 0)
+    {
+        /*validate everything first so a bad name doesn't leave the set partly applied*/
+        rc = _set_validate_properties(handleInfo, pProperties, numVals, &pFailedElement);
+        if(rc == RBUS_ERROR_SUCCESS)
+            rc = _set_apply_properties(handle, pProperties, numVals, &opts, &pFailedElement);
     }
     else
     {
@@ -1218,8 +1312,8 @@ static void _set_callback_handler (rbusHandle_t handle, rbusMessage request, rbu
 
     rbusMessage_Init(response);
     rbusMessage_SetInt32(*response, (int) rc);
-    if (pFailedElement)
-        rbusMessage_SetString(*response, pFailedElement);
+    if (pFailedElement || rc != RBUS_ERROR_SUCCESS)
+        rbusMessage_SetString(*response, pFailedElement ? pFailedElement : "");
 
     if(pProperties)
     {
@@ -1307,11 +1401,266 @@ static char const* _convert_reg_name_to_instance_name(char const* registrationNa
     return buffer;
 }
 
+/*  collects the results of a wildcard get.  the tail is tracked so appending stays O(1)
+    and collecting N properties is linear instead of walking the list on every append
+ */
+typedef struct _rbusPropertyCollector
+{
+    rbusProperty_t first;
+    rbusProperty_t last;
+    int count;
+} rbusPropertyCollector_t;
+
+/*append a property, or a list of properties, and return how many were added*/
+static int _property_collector_append(rbusPropertyCollector_t* collector, rbusProperty_t properties)
+{
+    int count = 1;
+    if(collector->last)
+    {
+        rbusProperty_SetNext(collector->last, properties);
+    }
+    else
+    {
+        collector->first = properties;
+        rbusProperty_Retain(properties);
+    }
+    collector->last = properties;
+    while(rbusProperty_GetNext(collector->last))
+    {
+        collector->last = rbusProperty_GetNext(collector->last);
+        count++;
+    }
+    collector->count += count;
+    return count;
+}
+
+/*rbus_getExtStream sends [cursor][chunk size] as the get options.  The first request has cursor 0:
+  the provider walks the query until it has a chunk, answers with it and keeps where the walk stopped
+  here under a new cursor, which it appends to the response.  Later requests carry that cursor and the
+  walk resumes from the node it stopped at, found again by name so rows removed in between are never
+  touched.  Only the results of the last getHandler that didn't fit in a chunk are kept, so a stream
+  holds at most one getHandler's worth of results.  A negative chunk size ends a stream early.
+  A cursor of 0 in a response means there is nothing left.*/
+#define GET_STREAM_MAX_DEPTH (RBUS_MAX_NAME_LENGTH / 2)
+
+typedef struct _rbusGetStream
+{
+    char*                           requestingComponent;
+    int32_t                         cursor;
+    rbusProperty_t                  remaining;  /*results of the last getHandler that didn't fit in a chunk*/
+    int                             depth;      /*number of names in path, 0 once the walk is done*/
+    char                            path[RBUS_MAX_NAME_LENGTH]; /*names of the node the walk stopped at and its
+                                                                   parents below the queried node, top down*/
+    int                             offset[GET_STREAM_MAX_DEPTH];/*where each name starts in path*/
+    int                             index[GET_STREAM_MAX_DEPTH];/*and the node's position among its siblings*/
+    rtTime_t                        expires;
+    struct _rbusGetStream*          next;
+} rbusGetStream_t;
+
+/*getStreams is changed by get requests and emptied by rbus_close*/
+static pthread_mutex_t gGetStreamsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void _get_stream_free(rbusGetStream_t* stream)
+{
+    if(stream->remaining)
+        rbusProperty_Release(stream->remaining);
+    free(stream->requestingComponent);
+    free(stream);
+}
+
+/*unlink and return a component's stream, dropping any whose consumer stopped asking for chunks*/
+static rbusGetStream_t* _get_stream_take(struct _rbusHandle* handleInfo, char const* requestingComponent, int32_t cursor)
+{
+    rbusGetStream_t** link;
+    rbusGetStream_t* found = NULL;
+    rbusGetStream_t* expired = NULL;
+    rtTime_t now;
+
+    rtTime_Now(&now);
+    pthread_mutex_lock(&gGetStreamsMutex);
+    link = &handleInfo->getStreams;
+    while(*link)
+    {
+        rbusGetStream_t* stream = *link;
+        if(!found && stream->cursor == cursor && requestingComponent && strcmp(stream->requestingComponent, requestingComponent) == 0)
+        {
+            *link = stream->next;
+            found = stream;
+        }
+        else if(rtTime_Compare(&stream->expires, &now) <= 0)
+        {
+            *link = stream->next;
+            stream->next = expired;
+            expired = stream;
+        }
+        else
+        {
+            link = &stream->next;
+        }
+    }
+    pthread_mutex_unlock(&gGetStreamsMutex);
+    while(expired)
+    {
+        rbusGetStream_t* stream = expired;
+        expired = stream->next;
+        RBUSLOG_WARN("%s: dropping get stream %d from %s which was never finished", __FUNCTION__, stream->cursor, stream->requestingComponent);
+        _get_stream_free(stream);
+    }
+    if(found)
+        found->next = NULL;
+    return found;
+}
+
+static rbusGetStream_t* _get_stream_new(char const* requestingComponent)
+{
+    static int32_t lastCursor = 0;
+    rbusGetStream_t* stream = calloc(1, sizeof(rbusGetStream_t));
+
+    if(!stream || !(stream->requestingComponent = strdup(requestingComponent ? requestingComponent : "")))
+    {
+        RBUSLOG_ERROR("%s: out of memory", __FUNCTION__);
+        free(stream);
+        return NULL;
+    }
+    do
+    {
+        stream->cursor = __atomic_add_fetch(&lastCursor, 1, __ATOMIC_RELAXED) & 0x7fffffff;
+    } while(stream->cursor == 0);
+    return stream;
+}
+
+/*keep a stream for its next chunk and return the cursor to fetch it with*/
+static int32_t _get_stream_keep(struct _rbusHandle* handleInfo, rbusGetStream_t* stream)
+{
+    rtTime_t now;
+
+    rtTime_Now(&now);
+    rtTime_Later(&now, GET_STREAM_TIMEOUT, &stream->expires);
+    pthread_mutex_lock(&gGetStreamsMutex);
+    stream->next = handleInfo->getStreams;
+    handleInfo->getStreams = stream;
+    pthread_mutex_unlock(&gGetStreamsMutex);
+    return stream->cursor;
+}
+
+/*split the first limit properties off list, returning them and leaving list at the rest*/
+static rbusProperty_t _get_stream_split(rbusProperty_t* list, int limit, int* count)
+{
+    rbusProperty_t first = *list;
+    rbusProperty_t last = first;
+
+    *count = 0;
+    if(!first)
+        return NULL;
+    *count = 1;
+    while(*count < limit && rbusProperty_GetNext(last))
+    {
+        last = rbusProperty_GetNext(last);
+        (*count)++;
+    }
+    *list = rbusProperty_GetNext(last);
+    if(*list)
+    {
+        rbusProperty_Retain(*list);
+        rbusProperty_SetNext(last, NULL);
+    }
+    return first;
+}
+
+/*A node found by its registration name stands in for every instance of it, so only
+  gets of the node's own name can use its cache*/
+static bool _get_cacheable(elementNode* el, char const* name)
+{
+    return __atomic_load_n(&el->cacheMaxAge, __ATOMIC_RELAXED) && strcmp(el->fullName, name) == 0;
+}
+
+/*call the getHandler of a property, or answer from its cache if rbus_setGetCachePolicy enabled it*/
+static rbusError_t _get_property_value(rbusHandle_t handle, elementNode* el, rbusProperty_t property, rbusGetHandlerOptions_t* options)
+{
+    rbusError_t result;
+    uint32_t generation = 0;
+    bool cacheable = _get_cacheable(el, rbusProperty_GetName(property));
+    rtTime_t start;
+
+    rtTime_Now(&start);
+    if(cacheable && getElementCachedValue(el, property, &generation))
+    {
+        rbusStats_Record(RBUS_STATS_GET_CACHE_HIT, &start, false);
+        return RBUS_ERROR_SUCCESS;
+    }
+    result = el->cbTable.getHandler(handle, property, options);
+    rbusStats_Record(RBUS_STATS_GET_HANDLER, &start, result != RBUS_ERROR_SUCCESS);
+    if(cacheable && result == RBUS_ERROR_SUCCESS)
+        setElementCachedValue(el, rbusProperty_GetValue(property), generation);
+    return result;
+}
+
 /*
     node can be either an instance node or a registration node (if an instance node doesn't exist).
     query will be set if node is a registration node, so that registration names can be converted to instance names
  */
-static void _get_recursive_wildcard_handler(elementNode* node, char const* query, rbusHandle_t handle, const char* pRequestingComp, rbusProperty_t properties, int *pCount, int level)
+
+/*call a table getHandler, which answers for every row of the table, and collect its results*/
+static void _get_wildcard_table(elementNode* node, char const* query, rbusHandle_t handle, rbusGetHandlerOptions_t* options, rbusPropertyCollector_t* collector, int level)
+{
+    rbusError_t result;
+    rbusProperty_t tmpProperties;
+    char instanceName[RBUS_MAX_NAME_LENGTH];
+    char partialPath[RBUS_MAX_NAME_LENGTH];
+    rtTime_t start;
+
+    snprintf(partialPath, RBUS_MAX_NAME_LENGTH-1, "%s.", 
+             query ? _convert_reg_name_to_instance_name(node->fullName, query, instanceName) : node->fullName);
+
+    RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler calling table getHandler partialPath=%s", level*4, " ", partialPath);
+
+    rbusProperty_Init(&tmpProperties, partialPath, NULL);
+
+    rtTime_Now(&start);
+    result = node->cbTable.getHandler(handle, tmpProperties, options);
+    rbusStats_Record(RBUS_STATS_GET_HANDLER, &start, result != RBUS_ERROR_SUCCESS);
+
+    if (result == RBUS_ERROR_SUCCESS )
+    {
+        int count = 0;
+
+        /*the first property is just the partialPath we passed in so take the second property, which is a list*/
+        if(rbusProperty_GetNext(tmpProperties))
+            count = _property_collector_append(collector, rbusProperty_GetNext(tmpProperties));
+
+        RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler table getHandler returned %d properties", level*4, " ", count);
+    }
+    else
+    {
+        RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler table getHandler failed rc=%d", level*4, " ", result);
+    }
+    rbusProperty_Release(tmpProperties);
+}
+
+static void _get_wildcard_property(elementNode* child, char const* query, rbusHandle_t handle, rbusGetHandlerOptions_t* options, rbusPropertyCollector_t* collector, int level)
+{
+    rbusError_t result;
+    char instanceName[RBUS_MAX_NAME_LENGTH];
+    rbusProperty_t tmpProperties;
+
+    RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler calling property getHandler node=%s", level*4, " ", child->fullName);
+
+    rbusProperty_Init(&tmpProperties, query ? _convert_reg_name_to_instance_name(child->fullName, query, instanceName) : child->fullName, NULL);
+    result = _get_property_value(handle, child, tmpProperties, options);
+    if (result == RBUS_ERROR_SUCCESS)
+    {
+        _property_collector_append(collector, tmpProperties);
+    }
+    rbusProperty_Release(tmpProperties);
+}
+
+/*recurse into children that are not row templates without table getHandler*/
+static bool _get_wildcard_recurses(elementNode* child)
+{
+    return child->child && !(child->parent->type == RBUS_ELEMENT_TYPE_TABLE && strcmp(child->name, "{i}") == 0 && child->cbTable.getHandler == NULL);
+}
+
+static void _get_recursive_wildcard_handler(elementNode* node, char const* query, rbusHandle_t handle, const char* pRequestingComp, rbusPropertyCollector_t* collector, int level)
 {
     rbusGetHandlerOptions_t options;
     memset(&options, 0, sizeof(options));
@@ -1326,39 +1675,7 @@ static void _get_recursive_wildcard_handler(elementNode* node, char const* query
         /*if table getHandler, then pass the query to it and stop recursion*/
         if((node->type == RBUS_ELEMENT_TYPE_TABLE) && (node->cbTable.getHandler))
         {
-            rbusError_t result;
-            rbusProperty_t tmpProperties;
-            char instanceName[RBUS_MAX_NAME_LENGTH];
-            char partialPath[RBUS_MAX_NAME_LENGTH];
-
-            snprintf(partialPath, RBUS_MAX_NAME_LENGTH-1, "%s.", 
-                     query ? _convert_reg_name_to_instance_name(node->fullName, query, instanceName) : node->fullName);
-
-            RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler calling table getHandler partialPath=%s", level*4, " ", partialPath);
-
-            rbusProperty_Init(&tmpProperties, partialPath, NULL);
-
-            result = node->cbTable.getHandler(handle, tmpProperties, &options);
-
-            if (result == RBUS_ERROR_SUCCESS )
-            {
-                int count = rbusProperty_Count(tmpProperties);
-
-                RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler table getHandler returned %d properties", level*4, " ", count-1);
-
-                /*the first property is just the partialPath we passed in */
-                if(count > 1)
-                {
-                    /*take the second property, which is a list*/
-                    rbusProperty_PushBack(properties, rbusProperty_GetNext(tmpProperties));
-                    *pCount += count - 1;
-                }
-            }
-            else
-            {
-                RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler table getHandler failed rc=%d", level*4, " ", result);
-            }
-            rbusProperty_Release(tmpProperties);
+            _get_wildcard_table(node, query, handle, &options, collector, level);
             return;
         }
 
@@ -1368,26 +1685,12 @@ static void _get_recursive_wildcard_handler(elementNode* node, char const* query
         {
             if((child->type == RBUS_ELEMENT_TYPE_PROPERTY) && (child->cbTable.getHandler))
             {
-                rbusError_t result;
-                char instanceName[RBUS_MAX_NAME_LENGTH];
-                rbusProperty_t tmpProperties;
-
-                RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler calling property getHandler node=%s", level*4, " ", child->fullName);
-
-                rbusProperty_Init(&tmpProperties, query ? _convert_reg_name_to_instance_name(child->fullName, query, instanceName) : child->fullName, NULL);
-                result = child->cbTable.getHandler(handle, tmpProperties, &options);
-                if (result == RBUS_ERROR_SUCCESS)
-                {
-                    rbusProperty_PushBack(properties, tmpProperties);
-                    *pCount += 1;
-                }
-                rbusProperty_Release(tmpProperties);
+                _get_wildcard_property(child, query, handle, &options, collector, level);
             }
-            /*recurse into children that are not row templates without table getHandler*/
-            else if( child->child && !(child->parent->type == RBUS_ELEMENT_TYPE_TABLE && strcmp(child->name, "{i}") == 0 && child->cbTable.getHandler == NULL) )
+            else if(_get_wildcard_recurses(child))
             {
                 RBUSLOG_DEBUG("%*s_get_recursive_wildcard_handler recurse into %s", level*4, " ", child->fullName);
-                _get_recursive_wildcard_handler(child, query, handle, pRequestingComp, properties, pCount, level+1);
+                _get_recursive_wildcard_handler(child, query, handle, pRequestingComp, collector, level+1);
             }
             else
             {
@@ -1399,42 +1702,353 @@ static void _get_recursive_wildcard_handler(elementNode* node, char const* query
     }
 }
 
-static void _get_callback_handler (rbusHandle_t handle, rbusMessage request, rbusMessage *response)
+/*remember that the walk of a stream stopped at node, depth levels below the queried node.
+  Returns false if the path doesn't fit, in which case the walk carries on*/
+static bool _get_stream_walk_stop(rbusGetStream_t* stream, elementNode* node, int depth)
 {
-    struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
-    int paramSize = 1, i = 0;
-    rbusError_t result = RBUS_ERROR_SUCCESS;
-    char const *parameterName = NULL;
-    char const *pCompName = NULL;
-    rbusProperty_t* properties = NULL;
-    rbusGetHandlerOptions_t options;
+    elementNode* nodes[GET_STREAM_MAX_DEPTH];
+    int length = 0;
+    int d;
 
-    memset(&options, 0, sizeof(options));
-    rbusMessage_GetString(request, &pCompName);
-    rbusMessage_GetInt32(request, &paramSize);
+    for(d = depth; d >= 0; d--)
+    {
+        nodes[d] = node;
+        node = node->parent;
+    }
+    for(d = 0; d <= depth; d++)
+    {
+        int size = strlen(nodes[d]->name) + 1;
+        elementNode* sibling;
 
-    RBUSLOG_DEBUG("Param Size [%d]", paramSize);
+        if(length + size > (int)sizeof(stream->path))
+            return false;
+        memcpy(stream->path + length, nodes[d]->name, size);
+        stream->offset[d] = length;
+        length += size;
 
-    if(paramSize > 0)
+        stream->index[d] = 0;
+        for(sibling = nodes[d]->parent->child; sibling != nodes[d]; sibling = sibling->nextSibling)
+            stream->index[d]++;
+    }
+    stream->depth = depth + 1;
+    return true;
+}
+
+/*Walk node like _get_recursive_wildcard_handler, stopping once collector holds limit results.
+  With resume set, start after the node the stream's last walk stopped at.  Returns true,
+  with the stream's path set to where it stopped, if the walk didn't finish*/
+static bool _get_stream_walk(rbusGetStream_t* stream, elementNode* node, char const* query, rbusHandle_t handle,
+    rbusGetHandlerOptions_t* options, rbusPropertyCollector_t* collector, int limit, int depth, bool resume)
+{
+    elementNode* child = node->child;
+    bool resumeChild = false;
+
+    if((node->type == RBUS_ELEMENT_TYPE_TABLE) && (node->cbTable.getHandler))
     {
-        /* Update the Get Handler input options */
-        options.requestingComponent = pCompName;
+        _get_wildcard_table(node, query, handle, options, collector, depth);
+        return false;
+    }
 
-        properties = malloc(paramSize*sizeof(rbusProperty_t));
+    if(resume && depth < stream->depth)
+    {
+        char const* name = stream->path + stream->offset[depth];
 
-        for(i = 0; i < paramSize; i++)
+        while(child && strcmp(child->name, name) != 0)
+            child = child->nextSibling;
+        if(!child)
         {
-            rbusProperty_Init(&properties[i], NULL, NULL);
+            /*removed since the last chunk, carry on from the node that took its place*/
+            int index;
+            for(child = node->child, index = 0; child && index < stream->index[depth]; child = child->nextSibling)
+                index++;
         }
-
-        for(i = 0; i < paramSize; i++)
+        else if(depth == stream->depth - 1)
         {
-            elementNode* el = NULL;
+            /*already walked*/
+            child = child->nextSibling;
+        }
+        else
+        {
+            resumeChild = true;
+        }
+    }
 
-            parameterName = NULL;
-            rbusMessage_GetString(request, &parameterName);
+    for(; child; child = child->nextSibling)
+    {
+        if((child->type == RBUS_ELEMENT_TYPE_PROPERTY) && (child->cbTable.getHandler))
+        {
+            _get_wildcard_property(child, query, handle, options, collector, depth);
+        }
+        else if(_get_wildcard_recurses(child))
+        {
+            if(depth + 1 < GET_STREAM_MAX_DEPTH)
+            {
+                if(_get_stream_walk(stream, child, query, handle, options, collector, limit, depth + 1, resumeChild))
+                    return true;
+            }
+            else
+            {
+                _get_recursive_wildcard_handler(child, query, handle, options->requestingComponent, collector, depth + 1);
+            }
+        }
+        resumeChild = false;
 
-            RBUSLOG_DEBUG("Param Name [%d]:[%s]", i, parameterName);
+        if(collector->count >= limit && _get_stream_walk_stop(stream, child, depth))
+            return true;
+    }
+    return false;
+}
+
+/*Fill a chunk of up to limit results for a stream, first from what the last chunk didn't
+  take and then by walking on from where it stopped, or from the start for the first chunk.
+  Results over limit are kept in the stream*/
+static rbusProperty_t _get_stream_next_chunk(rbusGetStream_t* stream, bool first, elementNode* el, char const* query, rbusHandle_t handle,
+    char const* requestingComponent, int limit, int* count)
+{
+    rbusPropertyCollector_t collector = { NULL, NULL, 0 };
+    rbusGetHandlerOptions_t options;
+    rbusProperty_t chunk;
+
+    memset(&options, 0, sizeof(options));
+    options.requestingComponent = requestingComponent;
+
+    if(stream->remaining)
+    {
+        _property_collector_append(&collector, stream->remaining);
+        rbusProperty_Release(stream->remaining);
+        stream->remaining = NULL;
+    }
+    if(!el)
+    {
+        /*the element the stream walks was unregistered*/
+        stream->depth = 0;
+    }
+    else if(collector.count < limit && (first || stream->depth > 0))
+    {
+        if(!_get_stream_walk(stream, el, query, handle, &options, &collector, limit, 0, !first))
+            stream->depth = 0;
+    }
+
+    chunk = _get_stream_split(&collector.first, limit, count);
+    stream->remaining = collector.first;
+    return chunk;
+}
+
+/*get requests end with optional [cursor][limit][flags], which older providers never read
+  and older consumers never send*/
+static void _get_request_append_options(rbusMessage request, int32_t cursor, int32_t limit)
+{
+    rbusMessage_SetInt32(request, cursor);
+    rbusMessage_SetInt32(request, limit);
+    rbusMessage_SetInt32(request, GET_OPTION_BINARY | GET_OPTION_NAME_PREFIX);
+}
+
+static bool _get_request_read_options(rbusMessage request, int32_t* cursor, int32_t* limit, int32_t* flags)
+{
+    *cursor = *limit = *flags = 0;
+    if(rbusMessage_GetInt32(request, cursor) != RT_OK || rbusMessage_GetInt32(request, limit) != RT_OK)
+    {
+        *cursor = *limit = 0;
+        return false;
+    }
+    if(rbusMessage_GetInt32(request, flags) != RT_OK)
+        *flags = 0;
+    return true;
+}
+
+/*With GET_OPTION_BINARY the properties of a get response are sent as a negative count, the options applied
+  and a single blob of encoded properties instead of a count followed by each name, type and value field.
+  With GET_OPTION_NAME_PREFIX as well, names are encoded relative to the previous name, starting from base,
+  which is the requested name when the request has only one or else NULL.
+  Properties are taken from array if given or else by walking the list from first.
+  Returns false, having written nothing, if a property can't be encoded so the caller can fall back to legacy.*/
+static bool _get_response_append_binary(rbusMessage response, int32_t flags, char const* base, int count, rbusProperty_t* array, rbusProperty_t first)
+{
+    rbusBuffer_t buff;
+    rbusProperty_t prop = first;
+    char const* previous = base;
+    bool encoded = true;
+    int i;
+
+    flags &= GET_OPTION_BINARY | GET_OPTION_NAME_PREFIX;
+    rbusBuffer_Create(&buff);
+    for(i = 0; i < count && encoded; i++)
+    {
+        if(array)
+            prop = array[i];
+        if(flags & GET_OPTION_NAME_PREFIX)
+        {
+            encoded = rbusProperty_EncodeRelative(prop, previous, buff) == 0;
+            previous = rbusProperty_GetName(prop);
+        }
+        else
+        {
+            encoded = rbusProperty_Encode(prop, buff) == 0;
+        }
+        if(!array)
+            prop = rbusProperty_GetNext(prop);
+    }
+    if(encoded)
+    {
+        rbusMessage_SetInt32(response, -count);
+        rbusMessage_SetInt32(response, flags);
+        rbusMessage_SetBytes(response, buff->data, buff->posWrite);
+    }
+    rbusBuffer_Destroy(buff);
+    return encoded;
+}
+
+/*append a successful response holding count properties from the list at first*/
+static void _get_response_append_list(rbusMessage response, int32_t flags, char const* base, int count, rbusProperty_t first)
+{
+    rbusProperty_t prop;
+
+    rbusMessage_SetInt32(response, (int) RBUS_ERROR_SUCCESS);
+    if((flags & GET_OPTION_BINARY) && count > 0 && _get_response_append_binary(response, flags, base, count, NULL, first))
+        return;
+    rbusMessage_SetInt32(response, count);
+    for(prop = first; prop; prop = rbusProperty_GetNext(prop))
+    {
+        rbusValue_appendToMessage(rbusProperty_GetName(prop), rbusProperty_GetValue(prop), response);
+    }
+}
+
+/*answer a request of a stream with its next chunk, keeping the stream if there is more*/
+static void _get_stream_answer(struct _rbusHandle* handleInfo, rbusGetStream_t* stream, bool first, elementNode* el, char const* query,
+    char const* requestingComponent, char const* base, int32_t limit, int32_t flags, rbusMessage response)
+{
+    rbusProperty_t chunk;
+    int count = 0;
+
+    chunk = _get_stream_next_chunk(stream, first, el, query, handleInfo, requestingComponent, limit, &count);
+    if(first && count == 0)
+    {
+        rbusMessage_SetInt32(response, (int) RBUS_ERROR_ELEMENT_DOES_NOT_EXIST);
+        _get_stream_free(stream);
+        return;
+    }
+    _get_response_append_list(response, flags, base, count, chunk);
+    if(chunk)
+        rbusProperty_Release(chunk);
+    if(stream->remaining || stream->depth > 0)
+    {
+        rbusMessage_SetInt32(response, _get_stream_keep(handleInfo, stream));
+    }
+    else
+    {
+        rbusMessage_SetInt32(response, 0);
+        _get_stream_free(stream);
+    }
+}
+
+/*answer a later request of a stream*/
+static void _get_stream_continue(struct _rbusHandle* handleInfo, elementNode* el, char const* query, char const* requestingComponent, char const* base, int32_t cursor, int32_t limit, int32_t flags, rbusMessage response)
+{
+    rbusGetStream_t* stream = _get_stream_take(handleInfo, requestingComponent, cursor);
+
+    if(!stream)
+    {
+        RBUSLOG_WARN("%s: no get stream %d from %s", __FUNCTION__, cursor, requestingComponent);
+        rbusMessage_SetInt32(response, (int) RBUS_ERROR_INVALID_INPUT);
+        return;
+    }
+    if(limit < 0)
+    {
+        /*the consumer stopped early*/
+        _get_stream_free(stream);
+        _get_response_append_list(response, flags, base, 0, NULL);
+        rbusMessage_SetInt32(response, 0);
+        return;
+    }
+    if(limit == 0)
+        limit = GET_STREAM_CHUNK_SIZE;
+    _get_stream_answer(handleInfo, stream, false, el, query, requestingComponent, base, limit, flags, response);
+}
+
+static int _get_response_decode_binary(rbusMessage response, char const* base, int count, rbusProperty_t* retProperties)
+{
+    struct _rbusBuffer buff;
+    uint8_t const* data = NULL;
+    uint32_t length = 0;
+    int32_t flags = 0;
+    rbusProperty_t last = NULL;
+    int i;
+
+    *retProperties = NULL;
+    if(rbusMessage_GetInt32(response, &flags) != RT_OK ||
+       rbusMessage_GetBytes(response, &data, &length) != RT_OK || length > INT32_MAX)
+        return -1;
+
+    /*decode in place, the reads are bounded by lenAlloc*/
+    buff.data = (uint8_t*)data;
+    buff.lenAlloc = buff.posWrite = (int)length;
+    buff.posRead = 0;
+
+    if(flags & GET_OPTION_NAME_PREFIX)
+        return rbusPropertyList_DecodeRelative(retProperties, count, base, &buff);
+
+    for(i = 0; i < count; i++)
+    {
+        rbusProperty_t prop;
+        if(rbusProperty_Decode(&prop, &buff) < 0)
+        {
+            RBUSLOG_WARN("%s failed at property %d of %d", __FUNCTION__, i, count);
+            if(*retProperties)
+                rbusProperty_Release(*retProperties);
+            *retProperties = NULL;
+            return -1;
+        }
+        if(last)
+        {
+            rbusProperty_SetNext(last, prop);
+            rbusProperty_Release(prop);
+        }
+        else
+        {
+            *retProperties = prop;
+        }
+        last = prop;
+    }
+    return 0;
+}
+
+static void _get_callback_handler (rbusHandle_t handle, rbusMessage request, rbusMessage *response)
+{
+    struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
+    int paramSize = 1, i = 0;
+    rbusError_t result = RBUS_ERROR_SUCCESS;
+    char const *parameterName = NULL;
+    char const *pCompName = NULL;
+    rbusProperty_t* properties = NULL;
+    rbusGetHandlerOptions_t options;
+    int32_t cursor, limit, flags;
+
+    memset(&options, 0, sizeof(options));
+    rbusMessage_GetString(request, &pCompName);
+    rbusMessage_GetInt32(request, &paramSize);
+
+    RBUSLOG_DEBUG("Param Size [%d]", paramSize);
+
+    if(paramSize > 0)
+    {
+        /* Update the Get Handler input options */
+        options.requestingComponent = pCompName;
+
+        properties = malloc(paramSize*sizeof(rbusProperty_t));
+
+        for(i = 0; i < paramSize; i++)
+        {
+            rbusProperty_Init(&properties[i], NULL, NULL);
+        }
+
+        for(i = 0; i < paramSize; i++)
+        {
+            elementNode* el = NULL;
+
+            parameterName = NULL;
+            rbusMessage_GetString(request, &parameterName);
+
+            RBUSLOG_DEBUG("Param Name [%d]:[%s]", i, parameterName);
 
             rbusProperty_SetName(properties[i], parameterName);
 
@@ -1446,40 +2060,47 @@ static void _get_callback_handler (rbusHandle_t handle, rbusMessage request, rbu
                 RBUSLOG_DEBUG("handle the wildcard request..");
                 rbusMessage_Init(response);
 
+                /*rbus_getExtStream sets a cursor and the size of the chunk it wants*/
+                flags = 0;
+                cursor = limit = 0;
+                if(i == paramSize - 1)
+                    _get_request_read_options(request, &cursor, &limit, &flags);
+
                 el = retrieveInstanceElement(handleInfo->elementRoot, parameterName);
-                if (el != NULL)
+                if(el && strstr(el->fullName, "{i}"))
+                    hasInstance = 0;
+
+                if(cursor != 0)
                 {
-                    rbusProperty_t xproperties, first;
-                    rbusValue_t xtmp;
-                    int count = 0;
-
-                    if(strstr(el->fullName, "{i}"))
-                        hasInstance = 0;
-                        
-                    rbusValue_Init(&xtmp);
-                    rbusValue_SetString(xtmp, "tmpValue");
-                    rbusProperty_Init(&xproperties, "tmpProp", xtmp);
-                    rbusValue_Release(xtmp);
-                    _get_recursive_wildcard_handler(el, hasInstance ? NULL : parameterName, handle, pCompName, xproperties, &count, 0);
-                    RBUSLOG_DEBUG("We have identified %d entries that are matching the request and got the value. Lets return it.", count);
-
-                    if (count > 0)
+                    _get_stream_continue(handleInfo, el, hasInstance ? NULL : parameterName, pCompName, parameterName, cursor, limit, flags, *response);
+                }
+                else if(el && limit > 0)
+                {
+                    /*the first chunk of a stream*/
+                    rbusGetStream_t* stream = _get_stream_new(pCompName);
+
+                    if(stream)
+                        _get_stream_answer(handleInfo, stream, true, el, hasInstance ? NULL : parameterName, pCompName, paramSize == 1 ? parameterName : NULL, limit, flags, *response);
+                    else
+                        rbusMessage_SetInt32(*response, (int) RBUS_ERROR_OUT_OF_RESOURCES);
+                }
+                else if(el)
+                {
+                    rbusPropertyCollector_t collector = { NULL, NULL, 0 };
+
+                    _get_recursive_wildcard_handler(el, hasInstance ? NULL : parameterName, handle, pCompName, &collector, 0);
+                    RBUSLOG_DEBUG("We have identified %d entries that are matching the request and got the value. Lets return it.", collector.count);
+
+                    if (collector.count > 0)
                     {
-                        first = rbusProperty_GetNext(xproperties);
-                        rbusMessage_SetInt32(*response, (int) RBUS_ERROR_SUCCESS);
-                        rbusMessage_SetInt32(*response, count);
-                        for(i = 0; i < count; i++)
-                        {
-                            rbusValue_appendToMessage(rbusProperty_GetName(first), rbusProperty_GetValue(first), *response);
-                            first = rbusProperty_GetNext(first);
-                        }
+                        _get_response_append_list(*response, flags, paramSize == 1 ? parameterName : NULL, collector.count, collector.first);
+                        /* Release the memory */
+                        rbusProperty_Release(collector.first);
                     }
                     else
                     {
                         rbusMessage_SetInt32(*response, (int) RBUS_ERROR_ELEMENT_DOES_NOT_EXIST);
                     }
-                    /* Release the memory */
-                    rbusProperty_Release(xproperties);
                 }
                 else
                 {
@@ -1506,7 +2127,7 @@ static void _get_callback_handler (rbusHandle_t handle, rbusMessage request, rbu
                 {
                     RBUSLOG_DEBUG("Table and CB exists for [%s], call the CB!", parameterName);
 
-                    result = el->cbTable.getHandler(handle, properties[i], &options);
+                    result = _get_property_value(handle, el, properties[i], &options);
 
                     if (result != RBUS_ERROR_SUCCESS)
                     {
@@ -1529,9 +2150,15 @@ static void _get_callback_handler (rbusHandle_t handle, rbusMessage request, rbu
             }
         }
 
+        /*the options follow the names, so they can only be read once all names were*/
+        flags = 0;
+        if (result == RBUS_ERROR_SUCCESS)
+            _get_request_read_options(request, &cursor, &limit, &flags);
+
         rbusMessage_Init(response);
         rbusMessage_SetInt32(*response, (int) result);
-        if (result == RBUS_ERROR_SUCCESS)
+        if (result == RBUS_ERROR_SUCCESS &&
+            (!(flags & GET_OPTION_BINARY) || !_get_response_append_binary(*response, flags, paramSize == 1 ? parameterName : NULL, paramSize, properties, NULL)))
         {
             rbusMessage_SetInt32(*response, paramSize);
             for(i = 0; i < paramSize; i++)
@@ -1791,9 +2418,7 @@ rbusError_t rbus_open(rbusHandle_t* handle, char const* componentName)
 {
     rbusError_t errorcode = RBUS_ERROR_SUCCESS;
     rbus_error_t err = RTMESSAGE_BUS_SUCCESS;
-    int foundIndex = -1;
-    int  i = 0;
-    rbusHandle_t tmpHandle;
+    struct _rbusHandle* tmpHandle;
 
     VERIFY_NULL(handle);
     VERIFY_NULL(componentName);
@@ -1806,29 +2431,10 @@ rbusError_t rbus_open(rbusHandle_t* handle, char const* componentName)
         Per spec: If a component calls this API more than once, any previous busHandle 
         and all previous data element registrations will be canceled.
     */
-    for(i = 0; i < MAX_COMPS_PER_PROCESS; i++)
+    while((tmpHandle = rbusHandle_FindByComponent(componentName)) != NULL)
     {
-        if(handle_array[i].inUse && strcmp(componentName, handle_array[i].componentName) == 0)
-        {
-            rbus_close(&handle_array[i]);
-        }
-    }
-
-    /*  Find open item in array: 
-        TODO why can't this just be a rtVector we push/remove from? */
-    for(i = 0; i < MAX_COMPS_PER_PROCESS; i++)
-    {
-        if(!handle_array[i].inUse)
-        {
-            foundIndex = i;
+        if(rbus_close(tmpHandle) != RBUS_ERROR_SUCCESS)
             break;
-        }
-    }
-
-    if(foundIndex == -1)
-    {
-        RBUSLOG_ERROR("<%s>: Exceeded the allowed number of components per process!", __FUNCTION__);
-        return RBUS_ERROR_OUT_OF_RESOURCES;
     }
 
     /*
@@ -1851,7 +2457,10 @@ rbusError_t rbus_open(rbusHandle_t* handle, char const* componentName)
     err = rbus_registerClientDisconnectHandler(_client_disconnect_callback_handler);
     RBUSLOG_DEBUG("registering client disconnect handler %s", err == RTMESSAGE_BUS_SUCCESS ? "succeeded" : "failed");
 
-    tmpHandle = &handle_array[foundIndex];
+    if((tmpHandle = calloc(1, sizeof(struct _rbusHandle))) == NULL)
+    {
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
 
     RBUSLOG_INFO("Bus registration successfull!");
     RBUSLOG_DEBUG("<%s>: Try rbus_registerObj() for component base object [%s]!", __FUNCTION__, componentName);
@@ -1862,6 +2471,7 @@ rbusError_t rbus_open(rbusHandle_t* handle, char const* componentName)
           because rbus_registerObj doesn't allow the same name to be registered twice.  This would
           also fail if ccsp using rbus-core has registered the same object name */
         RBUSLOG_ERROR("<%s>: rbus_registerObj() failed with %d", __FUNCTION__, err);
+        free(tmpHandle);
         return RBUS_ERROR_BUS_ERROR;
     }
 
@@ -1870,17 +2480,26 @@ rbusError_t rbus_open(rbusHandle_t* handle, char const* componentName)
     if((err = rbus_registerSubscribeHandler(componentName, _event_subscribe_callback_handler, tmpHandle)) != RTMESSAGE_BUS_SUCCESS)
     {
         RBUSLOG_ERROR("<%s>: rbus_registerSubscribeHandler() failed with %d", __FUNCTION__, err);
+        rbus_unregisterObj(componentName);
+        free(tmpHandle);
         return RBUS_ERROR_BUS_ERROR;
     }
 
     RBUSLOG_DEBUG("<%s>: rbus_registerSubscribeHandler() Success!", __FUNCTION__);
 
-    handle_array[foundIndex].inUse = 1;
-    handle_array[foundIndex].componentName = strdup(componentName);
+    tmpHandle->componentName = strdup(componentName);
+    rtVector_Create(&tmpHandle->eventSubs);
+    tmpHandle->connection = rbus_getConnection();
+
+    if((errorcode = rbusHandle_Register(tmpHandle)) != RBUS_ERROR_SUCCESS)
+    {
+        rbus_unregisterObj(componentName);
+        rtVector_Destroy(tmpHandle->eventSubs, NULL);
+        free(tmpHandle->componentName);
+        free(tmpHandle);
+        return errorcode;
+    }
     *handle = tmpHandle;
-    rtVector_Create(&handle_array[foundIndex].eventSubs);
-    rtVector_Create(&handle_array[foundIndex].messageCallbacks);
-    handle_array[foundIndex].connection = rbus_getConnection();
 
     return errorcode;
 }
@@ -1893,6 +2512,11 @@ rbusError_t rbus_close(rbusHandle_t handle)
 
     VERIFY_NULL(handle);
 
+    rbusHandle_Unregister(handleInfo);
+
+    rbusDelivery_CloseHandle(handle);
+    rbusMessage_CloseHandle(handle);
+
     if(handleInfo->eventSubs)
     {
         while(rtVector_Size(handleInfo->eventSubs))
@@ -1910,23 +2534,27 @@ rbusError_t rbus_close(rbusHandle_t handle)
         handleInfo->eventSubs = NULL;
     }
 
-    if (handleInfo->messageCallbacks)
-    {
-        rbusMessage_RemoveAllListeners(handle);
-        rtVector_Destroy(handleInfo->messageCallbacks, NULL);
-        handleInfo->messageCallbacks = NULL;
-    }
-
     if(handleInfo->subscriptions != NULL)
     {
         rbusSubscriptions_destroy(handleInfo->subscriptions);
         handleInfo->subscriptions = NULL;
     }
 
+    rbusEventRate_CloseHandle(handle);
+
     rbusValueChange_CloseHandle(handle);//called before freeElementNode below
 
     rbusAsyncSubscribe_CloseHandle(handle);
 
+    pthread_mutex_lock(&gGetStreamsMutex);
+    while(handleInfo->getStreams)
+    {
+        rbusGetStream_t* stream = handleInfo->getStreams;
+        handleInfo->getStreams = stream->next;
+        _get_stream_free(stream);
+    }
+    pthread_mutex_unlock(&gGetStreamsMutex);
+
     if(handleInfo->elementRoot)
     {
         freeElementNode(handleInfo->elementRoot);
@@ -1937,25 +2565,19 @@ rbusError_t rbus_close(rbusHandle_t handle)
     {
         RBUSLOG_WARN("<%s>: rbus_unregisterObj() for [%s] fails with %d", __FUNCTION__, handleInfo->componentName, err);
         errorcode = RBUS_ERROR_INVALID_HANDLE;
+        /*the broker still routes to it, so keep it around for a later rbus_open of the component to retry*/
+        rbusHandle_Register(handleInfo);
     }
     else
     {
-        int canClose = 1;
-        int i;
+        int canClose;
 
         RBUSLOG_DEBUG("<%s>: rbus_unregisterObj() for [%s] Success!!", __FUNCTION__, handleInfo->componentName);
         free(handleInfo->componentName);
         handleInfo->componentName = NULL;
-        handleInfo->inUse = 0;
+        free(handleInfo);
 
-        for(i = 0; i < MAX_COMPS_PER_PROCESS; i++)
-        {
-            if(handle_array[i].inUse)
-            {
-                canClose = 0;
-                break;
-            }
-        }
+        canClose = rbusHandle_Count() == 0;
 
         if(canClose)
         {
@@ -1971,14 +2593,74 @@ rbusError_t rbus_close(rbusHandle_t handle)
             {
                 RBUSLOG_INFO("Bus unregistration Successfull!");
             }
-
-            rbusConfig_Destroy();
         }
     }
 
     return errorcode;
 }
 
+/*elements registered with the broker by rbus_regDataElements, regElementsThreads at a time*/
+typedef struct
+{
+    char const*         componentName;
+    rbusDataElement_t*  elements;
+    int*                added;      /*1 once added with core, -1 if that failed*/
+    int                 count;
+    int                 next;
+    int                 failed;
+} rbusRegisterElements_t;
+
+static void* _register_elements_thread_func(void* p)
+{
+    rbusRegisterElements_t* reg = (rbusRegisterElements_t*)p;
+
+    while(!__atomic_load_n(&reg->failed, __ATOMIC_RELAXED))
+    {
+        rbus_error_t err;
+        int i = __atomic_fetch_add(&reg->next, 1, __ATOMIC_RELAXED);
+        if(i >= reg->count)
+            break;
+        if((err = rbus_addElement(reg->componentName, reg->elements[i].name)) != RTMESSAGE_BUS_SUCCESS)
+        {
+            RBUSLOG_ERROR("<%s>: failed to add element with core [%s] err=%d!!", __FUNCTION__, reg->elements[i].name, err);
+            reg->added[i] = -1;
+            __atomic_store_n(&reg->failed, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            reg->added[i] = 1;
+            RBUSLOG_INFO("%s inserted successfully!", reg->elements[i].name);
+        }
+    }
+    return NULL;
+}
+
+/*Each name is a separate round trip to the broker, so with many elements several
+  requests are kept in flight at once instead of waiting for each in turn.
+  rbus_addElement is a request to the broker over the process's one connection, like the
+  gets that applications already make from several threads at once, with each response
+  matched to its caller by rtConnection_SendRequest.  Setting
+  RBUS_CONFIG_REG_ELEMENTS_THREADS to 1 registers one name at a time.*/
+static void _register_elements_with_core(rbusRegisterElements_t* reg)
+{
+    pthread_t threads[RBUS_REG_ELEMENTS_THREADS_MAX];
+    int maxThreads = rbusConfig_Get()->regElementsThreads;
+    int numThreads = 0;
+    int i;
+
+    if(reg->count >= REG_ELEMENTS_PARALLEL_MIN)
+    {
+        for(i = 0; i < maxThreads - 1; i++)
+        {
+            if(pthread_create(&threads[numThreads], NULL, _register_elements_thread_func, reg) == 0)
+                numThreads++;
+        }
+    }
+    _register_elements_thread_func(reg);
+    for(i = 0; i < numThreads; i++)
+        pthread_join(threads[i], NULL);
+}
+
 rbusError_t rbus_regDataElements(
     rbusHandle_t handle,
     int numDataElements,
@@ -1987,6 +2669,9 @@ rbusError_t rbus_regDataElements(
     int i;
     rbusError_t rc = RBUS_ERROR_SUCCESS;
     struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
+    elementNode** nodes;
+    char const** names;
+    rbusRegisterElements_t reg;
 
     VERIFY_NULL(handleInfo);
     VERIFY_NULL(elements);
@@ -1995,63 +2680,97 @@ rbusError_t rbus_regDataElements(
     for(i=0; i<numDataElements; ++i)
     {
         char* name = elements[i].name;
-        rbus_error_t err = RTMESSAGE_BUS_SUCCESS;
-
         if((!name) || (0 == strlen(name))) {
-            rc = RBUS_ERROR_INVALID_INPUT;
-            break ;
+            return RBUS_ERROR_INVALID_INPUT;
         }
+    }
 
-        RBUSLOG_DEBUG("rbus_getDataElements: %s", name);
+    if(handleInfo->elementRoot == NULL)
+    {
+        RBUSLOG_DEBUG("First Time, create the root node for [%s]!", handleInfo->componentName);
+        handleInfo->elementRoot = getEmptyElementNode();
+        handleInfo->elementRoot->name = strdup(handleInfo->componentName);
+        RBUSLOG_DEBUG("Root node created for [%s]", handleInfo->elementRoot->name);
+    }
 
-        if(handleInfo->elementRoot == NULL)
-        {
-            RBUSLOG_DEBUG("First Time, create the root node for [%s]!", handleInfo->componentName);
-            handleInfo->elementRoot = getEmptyElementNode();
-            handleInfo->elementRoot->name = strdup(handleInfo->componentName);
-            RBUSLOG_DEBUG("Root node created for [%s]", handleInfo->elementRoot->name);
-        }
+    if(handleInfo->subscriptions == NULL)
+    {
+        rbusSubscriptions_create(&handleInfo->subscriptions, handle, handleInfo->componentName, handleInfo->elementRoot, rbusConfig_Get()->tmpDir);
+    }
 
-        if(handleInfo->subscriptions == NULL)
-        {
-            rbusSubscriptions_create(&handleInfo->subscriptions, handle, handleInfo->componentName, handleInfo->elementRoot, rbusConfig_Get()->tmpDir);
-        }
+    nodes = calloc(numDataElements, sizeof(elementNode*));
+    names = calloc(numDataElements, sizeof(char const*));
+    memset(&reg, 0, sizeof(reg));
+    reg.componentName = handleInfo->componentName;
+    reg.elements = elements;
+    reg.added = calloc(numDataElements, sizeof(int));
+    reg.count = numDataElements;
+    if(!nodes || !names || !reg.added)
+    {
+        free(nodes);
+        free(names);
+        free(reg.added);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
 
-        elementNode* node;
-        if((node = insertElement(handleInfo->elementRoot, &elements[i])) == NULL)
+    for(i=0; i<numDataElements; ++i)
+    {
+        RBUSLOG_DEBUG("rbus_getDataElements: %s", elements[i].name);
+        names[i] = elements[i].name;
+        if((nodes[i] = insertElement(handleInfo->elementRoot, &elements[i])) == NULL)
         {
-            RBUSLOG_ERROR("<%s>: failed to insert element [%s]!!", __FUNCTION__, name);
+            RBUSLOG_ERROR("<%s>: failed to insert element [%s]!!", __FUNCTION__, elements[i].name);
             rc = RBUS_ERROR_OUT_OF_RESOURCES;
             break;
         }
-        else
+    }
+
+    if(rc == RBUS_ERROR_SUCCESS)
+    {
+        _register_elements_with_core(&reg);
+        if(reg.failed)
+            rc = RBUS_ERROR_ELEMENT_NAME_DUPLICATE;
+    }
+
+    if(rc == RBUS_ERROR_SUCCESS)
+    {
+        rbusSubscriptions_resubscribeCache(handle, handleInfo->subscriptions, numDataElements, names, nodes);
+        rbusAsyncSubscribe_AnnounceElements(handle, numDataElements, names);
+    }
+    else
+    {
+        /*TODO: need to review if this is how we should handle any failed register.
+          To avoid a provider having a half registered data model, and to avoid
+          the complexity of returning a list of error codes for each element in the list,
+          we treat rbus_regDataElements as a transaction.  If any element from the elements list
+          fails to register, we abort the whole thing.  Elements that never made it to the
+          broker are removed here and those that did are unregistered.*/
+        rbusDataElement_t* registered = malloc(numDataElements * sizeof(rbusDataElement_t));
+        int numRegistered = 0;
+
+        for(i=numDataElements-1; i>=0; --i)
         {
-            if((err = rbus_addElement(handleInfo->componentName, name)) != RTMESSAGE_BUS_SUCCESS)
+            if(reg.added[i] == 1)
             {
-                RBUSLOG_ERROR("<%s>: failed to add element with core [%s] err=%d!!", __FUNCTION__, name, err);
-                removeElement(node);
-                rc = RBUS_ERROR_ELEMENT_NAME_DUPLICATE;
-                break;
+                /*without the list, unregister them one at a time*/
+                if(registered)
+                    registered[numRegistered++] = elements[i];
+                else if(rbus_unregDataElements(handle, 1, &elements[i]) != RBUS_ERROR_SUCCESS)
+                    RBUSLOG_ERROR("<%s>: failed to unregister [%s] after the register failed", __FUNCTION__, elements[i].name);
             }
-            else
+            else if(nodes[i])
             {
-                rbusSubscriptions_resubscribeCache(handle, handleInfo->subscriptions, name, node);
-                RBUSLOG_INFO("%s inserted successfully!", name);
+                removeElement(nodes[i]);
             }
         }
+        if(numRegistered > 0 && rbus_unregDataElements(handle, numRegistered, registered) != RBUS_ERROR_SUCCESS)
+            RBUSLOG_ERROR("<%s>: failed to unregister %d elements after the register failed", __FUNCTION__, numRegistered);
+        free(registered);
     }
 
-    /*TODO: need to review if this is how we should handle any failed register.
-      To avoid a provider having a half registered data model, and to avoid
-      the complexity of returning a list of error codes for each element in the list,
-      we treat rbus_regDataElements as a transaction.  If any element from the elements list
-      fails to register, we abort the whole thing.  We do this as follows: As soon 
-      as 1 fail occurs above, we break out of loop and we unregister all the 
-      successfully registered elements that happened during this call, before we failed.
-      Thus we unregisters elements 0 to i (i was when we broke from loop above).*/
-    if(rc != RBUS_ERROR_SUCCESS && i > 0)
-        rbus_unregDataElements(handle, i, elements);
-
+    free(reg.added);
+    free(names);
+    free(nodes);
     return rc;
 }
 
@@ -2061,12 +2780,28 @@ rbusError_t rbus_unregDataElements(
     rbusDataElement_t *elements)
 {
     struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
+    elementNodeSet removed;
     int i;
 
     VERIFY_NULL(handleInfo);
     VERIFY_NULL(elements);
     VERIFY_ZERO(numDataElements);
 
+    memset(&removed, 0, sizeof(removed));
+
+    /*collect the registration elements and every instance they created first, so that
+      nothing is removed unless everything referring to them can be detached*/
+    for(i=0; i<numDataElements && handleInfo->elementRoot; ++i)
+    {
+        elementNode* el = retrieveElement(handleInfo->elementRoot, elements[i].name);
+        if(el && addElementInstancesToSet(&removed, el) != RBUS_ERROR_SUCCESS)
+        {
+            RBUSLOG_ERROR("<%s>: failed to collect the instances of [%s]; nothing removed", __FUNCTION__, elements[i].name);
+            freeElementSet(&removed);
+            return RBUS_ERROR_OUT_OF_RESOURCES;
+        }
+    }
+
     for(i=0; i<numDataElements; ++i)
     {
         char const* name = elements[i].name;
@@ -2076,15 +2811,51 @@ rbusError_t rbus_unregDataElements(
 */
         if(rbus_removeElement(handleInfo->componentName, name) != RTMESSAGE_BUS_SUCCESS)
             RBUSLOG_WARN("<%s>: failed to remove element from core [%s]!!", __FUNCTION__, name);
+    }
 
-/*      TODO: we need to remove all instance elements that this registration element instantiated
-        rbusValueChange_RemoveParameter(handle, NULL, name);
-        removeElement(&(handleInfo->elementRoot), name);
-*/
+    /*detach everything that refers to the nodes in one pass each, before freeing them*/
+    sortElementSet(&removed);
+    rbusValueChange_RemovePropertyNodes(handle, &removed);
+    if(handleInfo->subscriptions)
+        rbusSubscriptions_onElementsRemoved(handleInfo->subscriptions, &removed);
+    freeElementSet(&removed);
+
+    for(i=0; i<numDataElements && handleInfo->elementRoot; ++i)
+    {
+        /*look up again as removing an earlier element may have removed this one with it*/
+        elementNode* el = retrieveElement(handleInfo->elementRoot, elements[i].name);
+        if(el && el != handleInfo->elementRoot)
+            removeElement(el);
     }
     return RBUS_ERROR_SUCCESS;
 }
 
+rbusError_t rbus_setGetCachePolicy(
+    rbusHandle_t handle,
+    char const* name,
+    rbusGetCachePolicy_t const* policy)
+{
+    struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
+    elementNode* el;
+
+    VERIFY_NULL(handleInfo);
+    VERIFY_NULL(name);
+    VERIFY_NULL(policy);
+
+    if(!handleInfo->elementRoot || (el = retrieveElement(handleInfo->elementRoot, name)) == NULL)
+    {
+        RBUSLOG_WARN("%s: %s is not registered", __FUNCTION__, name);
+        return RBUS_ERROR_ELEMENT_DOES_NOT_EXIST;
+    }
+    if(el->type != RBUS_ELEMENT_TYPE_PROPERTY || !el->cbTable.getHandler)
+    {
+        RBUSLOG_WARN("%s: %s is not a property with a getHandler", __FUNCTION__, name);
+        return RBUS_ERROR_INVALID_INPUT;
+    }
+
+    return setElementCachePolicy(el, policy->maxAge, policy->invalidateOnSet);
+}
+
 //************************* Discovery related Operations *******************//
 rbusError_t rbus_discoverComponentName (rbusHandle_t handle,
                             int numElements, char const** elementNames,
@@ -2140,7 +2911,7 @@ rbusError_t rbus_discoverComponentDataElements (rbusHandle_t handle,
 }
 
 //************************* Parameters related Operations *******************//
-rbusError_t rbus_get(rbusHandle_t handle, char const* name, rbusValue_t* value)
+static rbusError_t rbus_getImpl(rbusHandle_t handle, char const* name, rbusValue_t* value)
 {
     rbusError_t errorcode = RBUS_ERROR_SUCCESS;
     rbus_error_t err = RTMESSAGE_BUS_SUCCESS;
@@ -2169,6 +2940,7 @@ rbusError_t rbus_get(rbusHandle_t handle, char const* name, rbusValue_t* value)
     /* Param Size */
     rbusMessage_SetInt32(request, (int32_t)1);
     rbusMessage_SetString(request, name);
+    _get_request_append_options(request, 0, 0);
 
     RBUSLOG_DEBUG("Calling rbus_invokeRemoteMethod for [%s]", name);
 
@@ -2179,7 +2951,7 @@ rbusError_t rbus_get(rbusHandle_t handle, char const* name, rbusValue_t* value)
     }
     else
     {
-        int valSize;
+        int valSize = 0;
         rbusLegacyReturn_t legacyRetCode = RBUS_LEGACY_ERR_FAILURE;
 
         RBUSLOG_DEBUG("Received response for remote method invocation!");
@@ -2196,7 +2968,25 @@ rbusError_t rbus_get(rbusHandle_t handle, char const* name, rbusValue_t* value)
             errorcode = RBUS_ERROR_SUCCESS;
             RBUSLOG_DEBUG("Received valid response!");
             rbusMessage_GetInt32(response, &valSize);
-            if(1/*valSize*/)
+            if(valSize < 0)
+            {
+                rbusProperty_t prop = NULL;
+
+                if(_get_response_decode_binary(response, name, -valSize, &prop) == 0 && prop &&
+                   rbusProperty_GetName(prop) && strcmp(name, rbusProperty_GetName(prop)) == 0)
+                {
+                    *value = rbusProperty_GetValue(prop);
+                    rbusValue_Retain(*value);
+                }
+                else
+                {
+                    RBUSLOG_WARN("Invalid binary response for [%s]", name);
+                    errorcode = RBUS_ERROR_INVALID_RESPONSE_FROM_DESTINATION;
+                }
+                if(prop)
+                    rbusProperty_Release(prop);
+            }
+            else
             {
                 char const *buff = NULL;
 
@@ -2229,7 +3019,19 @@ rbusError_t rbus_get(rbusHandle_t handle, char const* name, rbusValue_t* value)
     return errorcode;
 }
 
-rbusError_t _getExt_response_parser(rbusMessage response, int *numValues, rbusProperty_t* retProperties)
+rbusError_t rbus_get(rbusHandle_t handle, char const* name, rbusValue_t* value)
+{
+    rbusError_t rc;
+    rtTime_t start;
+    rtTime_Now(&start);
+    rc = rbus_getImpl(handle, name, value);
+    rbusStats_Record(RBUS_STATS_GET, &start, rc != RBUS_ERROR_SUCCESS);
+    return rc;
+}
+
+/*base is the name requested if the request had only one, which names in the response may be relative to.
+  nextCursor, if not NULL, receives the cursor of the next chunk of a streamed get or 0 if there is none*/
+static rbusError_t _getExt_response_parser_ex(rbusMessage response, char const* base, int *numValues, rbusProperty_t* retProperties, int32_t* nextCursor)
 {
     rbusError_t errorcode = RBUS_ERROR_SUCCESS;
     rbusLegacyReturn_t legacyRetCode = RBUS_LEGACY_ERR_FAILURE;
@@ -2251,10 +3053,18 @@ rbusError_t _getExt_response_parser(rbusMessage response, int *numValues, rbusPr
         errorcode = RBUS_ERROR_SUCCESS;
         RBUSLOG_DEBUG("Received valid response!");
         rbusMessage_GetInt32(response, &numOfVals);
-        *numValues = numOfVals;
         RBUSLOG_DEBUG("Number of return params = %d", numOfVals);
 
-        if(numOfVals)
+        if(numOfVals < 0)
+        {
+            numOfVals = -numOfVals;
+            if(_get_response_decode_binary(response, base, numOfVals, retProperties) != 0)
+            {
+                errorcode = RBUS_ERROR_INVALID_RESPONSE_FROM_DESTINATION;
+                numOfVals = 0;
+            }
+        }
+        else if(numOfVals)
         {
             rbusProperty_t last;
             for(i = 0; i < numOfVals; i++)
@@ -2275,6 +3085,7 @@ rbusError_t _getExt_response_parser(rbusMessage response, int *numValues, rbusPr
                 }
             }
         }
+        *numValues = numOfVals;
     }
     else
     {
@@ -2285,12 +3096,24 @@ rbusError_t _getExt_response_parser(rbusMessage response, int *numValues, rbusPr
             errorcode = CCSPError_to_rbusError(legacyRetCode);
         }
     }
+
+    if(nextCursor)
+    {
+        /*providers which don't support chunking send all results without a cursor*/
+        if(errorcode != RBUS_ERROR_SUCCESS || rbusMessage_GetInt32(response, nextCursor) != RT_OK)
+            *nextCursor = 0;
+    }
     rbusMessage_Release(response);
 
     return errorcode;
 }
 
-rbusError_t rbus_getExt(rbusHandle_t handle, int paramCount, char const** pParamNames, int *numValues, rbusProperty_t* retProperties)
+rbusError_t _getExt_response_parser(rbusMessage response, int *numValues, rbusProperty_t* retProperties)
+{
+    return _getExt_response_parser_ex(response, NULL, numValues, retProperties, NULL);
+}
+
+static rbusError_t rbus_getExtImpl(rbusHandle_t handle, int paramCount, char const** pParamNames, int *numValues, rbusProperty_t* retProperties)
 {
     rbusError_t errorcode = RBUS_ERROR_SUCCESS;
     rbus_error_t err = RTMESSAGE_BUS_SUCCESS;
@@ -2333,6 +3156,7 @@ rbusError_t rbus_getExt(rbusHandle_t handle, int paramCount, char const** pParam
                     rbusMessage_SetString(request, handleInfo->componentName);
                     rbusMessage_SetInt32(request, 1);
                     rbusMessage_SetString(request, pParamNames[0]);
+                    _get_request_append_options(request, 0, 0);
                     /* Invoke the method */
                     if((err = rbus_invokeRemoteMethod(destinations[i], METHOD_GETPARAMETERVALUES, request, INVOKE_TIMEOUT, &response)) != RTMESSAGE_BUS_SUCCESS)
                     {
@@ -2343,13 +3167,13 @@ rbusError_t rbus_getExt(rbusHandle_t handle, int paramCount, char const** pParam
                     {
                         if (0 == i)
                         {
-                            errorcode = _getExt_response_parser(response, &tmpNumOfValues, retProperties);
+                            errorcode = _getExt_response_parser_ex(response, pParamNames[0], &tmpNumOfValues, retProperties, NULL);
                             last = *retProperties;
                         }
                         else
                         {
                             rbusProperty_t tmpProperties;
-                            errorcode = _getExt_response_parser(response, &tmpNumOfValues, &tmpProperties);
+                            errorcode = _getExt_response_parser_ex(response, pParamNames[0], &tmpNumOfValues, &tmpProperties, NULL);
                             rbusProperty_PushBack(last, tmpProperties);
                             last = tmpProperties;
                         }
@@ -2458,6 +3282,7 @@ rbusError_t rbus_getExt(rbusHandle_t handle, int paramCount, char const** pParam
                             componentNames[i] = NULL;
                         }
                     }                  
+                    _get_request_append_options(request, 0, 0);
 
                     RBUSLOG_DEBUG("%s sending batch request with %d params to component %s", __FUNCTION__, batchCount, componentName);
                     free(componentName);
@@ -2472,7 +3297,7 @@ rbusError_t rbus_getExt(rbusHandle_t handle, int paramCount, char const** pParam
                     {
                         rbusProperty_t batchResult;
                         int batchNumVals;
-                        if((errorcode = _getExt_response_parser(response, &batchNumVals, &batchResult)) != RBUS_ERROR_SUCCESS)
+                        if((errorcode = _getExt_response_parser_ex(response, batchCount == 1 ? firstParamName : NULL, &batchNumVals, &batchResult, NULL)) != RBUS_ERROR_SUCCESS)
                         {
                             RBUSLOG_ERROR("%s error parsing response %d", __FUNCTION__, errorcode);
                         }
@@ -2509,6 +3334,118 @@ rbusError_t rbus_getExt(rbusHandle_t handle, int paramCount, char const** pParam
     return errorcode;
 }
 
+rbusError_t rbus_getExt(rbusHandle_t handle, int paramCount, char const** pParamNames, int *numValues, rbusProperty_t* retProperties)
+{
+    rbusError_t rc;
+    rtTime_t start;
+    rtTime_Now(&start);
+    rc = rbus_getExtImpl(handle, paramCount, pParamNames, numValues, retProperties);
+    rbusStats_Record(RBUS_STATS_GET_EXT, &start, rc != RBUS_ERROR_SUCCESS);
+    return rc;
+}
+
+rbusError_t rbus_getExtStream(rbusHandle_t handle, char const* partialPath, int chunkSize, rbusGetExtStreamHandler_t handler, void* userData)
+{
+    rbusError_t errorcode = RBUS_ERROR_SUCCESS;
+    rbus_error_t err = RTMESSAGE_BUS_SUCCESS;
+    struct _rbusHandle* handleInfo = (struct _rbusHandle*) handle;
+    int numDestinations = 0;
+    char** destinations = NULL;
+    bool stop = false;
+    int i;
+
+    VERIFY_NULL(handleInfo);
+    VERIFY_NULL(partialPath);
+    VERIFY_NULL(handler);
+
+    if(!_is_wildcard_query(partialPath))
+    {
+        /*a single parameter is returned as a single chunk*/
+        int numValues = 0;
+        rbusProperty_t properties = NULL;
+
+        errorcode = rbus_getExt(handle, 1, &partialPath, &numValues, &properties);
+        if(errorcode == RBUS_ERROR_SUCCESS && numValues > 0)
+            handler(handle, numValues, properties, userData);
+        if(properties)
+            rbusProperty_Release(properties);
+        return errorcode;
+    }
+
+    if(chunkSize <= 0)
+        chunkSize = GET_STREAM_CHUNK_SIZE;
+
+    err = rbus_discoverWildcardDestinations(partialPath, &numDestinations, &destinations);
+    if (RTMESSAGE_BUS_SUCCESS != err)
+    {
+        RBUSLOG_DEBUG("Query for expression %s was not successful.", partialPath);
+        return RBUS_ERROR_ELEMENT_DOES_NOT_EXIST;
+    }
+
+    /*with no destinations the query is routed by name, e.g. a table owned by a single component*/
+    for(i = 0; i < (numDestinations ? numDestinations : 1) && !stop; i++)
+    {
+        char const* destination = numDestinations ? destinations[i] : partialPath;
+        int32_t cursor = 0;
+
+        do
+        {
+            rbusMessage request, response;
+            rbusProperty_t properties = NULL;
+            int numValues = 0;
+
+            rbusMessage_Init(&request);
+            rbusMessage_SetString(request, handleInfo->componentName);
+            rbusMessage_SetInt32(request, 1);
+            rbusMessage_SetString(request, partialPath);
+            _get_request_append_options(request, cursor, chunkSize);
+
+            RBUSLOG_DEBUG("%s requesting %s from %s cursor %d", __FUNCTION__, partialPath, destination, cursor);
+
+            if((err = rbus_invokeRemoteMethod(destination, METHOD_GETPARAMETERVALUES, request, INVOKE_TIMEOUT, &response)) != RTMESSAGE_BUS_SUCCESS)
+            {
+                RBUSLOG_ERROR("%s by %s failed; Received error %d from RBUS Daemon for the object %s", __FUNCTION__, handle->componentName, err, destination);
+                errorcode = rbuscoreError_to_rbusError(err);
+                stop = true;
+                break;
+            }
+
+            errorcode = _getExt_response_parser_ex(response, partialPath, &numValues, &properties, &cursor);
+            if(errorcode != RBUS_ERROR_SUCCESS)
+            {
+                RBUSLOG_WARN("Failed to get the data from %s Component", destination);
+                stop = true;
+                break;
+            }
+
+            if(numValues > 0 && !handler(handle, numValues, properties, userData))
+                stop = true;
+            if(properties)
+                rbusProperty_Release(properties);
+        } while(cursor != 0 && !stop);
+
+        if(cursor != 0 && errorcode == RBUS_ERROR_SUCCESS)
+        {
+            /*let the provider drop what it kept for the chunks the handler didn't want*/
+            rbusMessage request, response;
+
+            rbusMessage_Init(&request);
+            rbusMessage_SetString(request, handleInfo->componentName);
+            rbusMessage_SetInt32(request, 1);
+            rbusMessage_SetString(request, partialPath);
+            _get_request_append_options(request, cursor, -1);
+            if(rbus_invokeRemoteMethod(destination, METHOD_GETPARAMETERVALUES, request, INVOKE_TIMEOUT, &response) == RTMESSAGE_BUS_SUCCESS)
+                rbusMessage_Release(response);
+        }
+    }
+
+    for(i = 0; i < numDestinations; i++)
+        free(destinations[i]);
+    free(destinations);
+
+    return errorcode;
+}
+
 static rbusError_t rbus_getByType(rbusHandle_t handle, char const* paramName, void* paramVal, rbusValueType_t type)
 {
     rbusError_t errorcode = RBUS_ERROR_INVALID_INPUT;
@@ -2566,7 +3503,7 @@ rbusError_t rbus_getStr (rbusHandle_t handle, char const* paramName, char** para
     return rbus_getByType(handle, paramName, paramVal, RBUS_STRING);
 }
 
-rbusError_t rbus_set(rbusHandle_t handle, char const* name,rbusValue_t value, rbusSetOptions_t* opts)
+static rbusError_t rbus_setImpl(rbusHandle_t handle, char const* name,rbusValue_t value, rbusSetOptions_t* opts)
 {
     rbusError_t errorcode = RBUS_ERROR_INVALID_INPUT;
     rbus_error_t err = RTMESSAGE_BUS_SUCCESS;
@@ -2636,11 +3573,136 @@ rbusError_t rbus_set(rbusHandle_t handle, char const* name,rbusValue_t value, rb
     return errorcode;
 }
 
+rbusError_t rbus_set(rbusHandle_t handle, char const* name,rbusValue_t value, rbusSetOptions_t* opts)
+{
+    rbusError_t rc;
+    rtTime_t start;
+    rtTime_Now(&start);
+    rc = rbus_setImpl(handle, name, value, opts);
+    rbusStats_Record(RBUS_STATS_SET, &start, rc != RBUS_ERROR_SUCCESS);
+    return rc;
+}
+
+/*the set request of one component, in either phase of a multi-component rbus_setMulti*/
+typedef struct
+{
+    char*           componentName;
+    char const*     firstParamName;
+    rbusProperty_t  lastProperty;
+    int             numProps;
+    rbusMessage     request;
+    rbusError_t     errorcode;
+} rbusSetBatch_t;
+
+static rbusMessage _set_request_create(struct _rbusHandle* handleInfo, uint32_t sessionId, int numProps)
+{
+    rbusMessage setRequest;
+
+    rbusMessage_Init(&setRequest);
+
+    /* Set the Session ID first */
+    rbusMessage_SetInt32(setRequest, (int32_t)sessionId);
+
+    /* Set the Component name that invokes the set */
+    rbusMessage_SetString(setRequest, handleInfo->componentName);
+    /* Set the Size of params */
+    rbusMessage_SetInt32(setRequest, numProps);
+    return setRequest;
+}
+
+static void _set_request_finish(rbusMessage setRequest, bool commit)
+{
+    /* Set the Commit value; FIXME: Should we use string? */
+    rbusMessage_SetString(setRequest, commit ? "TRUE" : "FALSE");
+}
+
+static void _set_batch_invoke(rbusSetBatch_t* batch)
+{
+    rbus_error_t err;
+    rbusMessage setResponse;
+
+    if((err = rbus_invokeRemoteMethod(batch->firstParamName, METHOD_SETPARAMETERVALUES, batch->request, INVOKE_TIMEOUT, &setResponse)) != RTMESSAGE_BUS_SUCCESS)
+    {
+        RBUSLOG_ERROR("%s failed; Received error %d from RBUS Daemon for the object %s", __FUNCTION__, err, batch->firstParamName);
+        batch->errorcode = rbuscoreError_to_rbusError(err);
+    }
+    else
+    {
+        char const* pErrorReason = NULL;
+        rbusLegacyReturn_t legacyRetCode = RBUS_LEGACY_ERR_FAILURE;
+        int ret = -1;
+        rbusMessage_GetInt32(setResponse, &ret);
+
+        RBUSLOG_DEBUG("Response from the remote method is [%d]!", ret);
+        batch->errorcode = (rbusError_t) ret;
+        legacyRetCode = (rbusLegacyReturn_t) ret;
+
+        if((batch->errorcode == RBUS_ERROR_SUCCESS) || (legacyRetCode == RBUS_LEGACY_ERR_SUCCESS))
+        {
+            batch->errorcode = RBUS_ERROR_SUCCESS;
+            RBUSLOG_DEBUG("Successfully Set the Value");
+        }
+        else
+        {
+            rbusMessage_GetString(setResponse, &pErrorReason);
+            RBUSLOG_WARN("Failed to Set the Value for %s", pErrorReason);
+            if(legacyRetCode > RBUS_LEGACY_ERR_SUCCESS)
+            {
+                batch->errorcode = CCSPError_to_rbusError(legacyRetCode);
+            }
+        }
+
+        /* Release the reponse message */
+        rbusMessage_Release(setResponse);
+    }
+    batch->request = NULL;
+}
+
+static void* _set_batch_thread_func(void* p)
+{
+    _set_batch_invoke((rbusSetBatch_t*)p);
+    return NULL;
+}
+
+/*send the request of every batch that has one, each on its own thread but the first,
+  and wait for all the responses*/
+static void _set_batches_invoke(rbusSetBatch_t* batches, int numBatches)
+{
+    pthread_t* threads = malloc(numBatches * sizeof(pthread_t));
+    bool* started = calloc(numBatches, sizeof(bool));
+    rbusSetBatch_t* inline_batch = NULL;
+    int i;
+
+    if(!threads || !started)
+        RBUSLOG_WARN("%s: failed to allocate threads, sending %d requests one at a time", __FUNCTION__, numBatches);
+
+    for(i = 0; i < numBatches; i++)
+    {
+        if(!batches[i].request)
+            continue;
+        if(!inline_batch)
+            inline_batch = &batches[i];
+        else if(threads && started && pthread_create(&threads[i], NULL, _set_batch_thread_func, &batches[i]) == 0)
+            started[i] = true;
+        else
+            _set_batch_invoke(&batches[i]);
+    }
+
+    if(inline_batch)
+        _set_batch_invoke(inline_batch);
+
+    for(i = 0; i < numBatches; i++)
+    {
+        if(started && started[i])
+            pthread_join(threads[i], NULL);
+    }
+    free(started);
+    free(threads);
+}
+
 rbusError_t rbus_setMulti(rbusHandle_t handle, int numProps, rbusProperty_t properties, rbusSetOptions_t* opts)
 {
     rbusError_t errorcode = RBUS_ERROR_INVALID_INPUT;
-    rbus_error_t err = RTMESSAGE_BUS_SUCCESS;
-    rbusMessage setRequest, setResponse;
     struct _rbusHandle* handleInfo = (struct _rbusHandle*) handle;
     rbusValueType_t type = RBUS_NONE;
     rbusProperty_t current;
@@ -2656,6 +3718,11 @@ rbusError_t rbus_setMulti(rbusHandle_t handle, int numProps, rbusProperty_t prop
 
         /*create list of paramNames to pass to rbus_discoverComponentName*/
         pParamNames = malloc(sizeof(char*) * numProps);
+        if(!pParamNames)
+        {
+            RBUSLOG_ERROR("%s: failed to allocate %d names", __FUNCTION__, numProps);
+            return RBUS_ERROR_OUT_OF_RESOURCES;
+        }
         current = properties;
         i = 0;
         while(current && i < numProps)
@@ -2681,13 +3748,14 @@ rbusError_t rbus_setMulti(rbusHandle_t handle, int numProps, rbusProperty_t prop
         errorcode = rbus_discoverComponentName(handle, numProps, pParamNames, &numComponents, &componentNames);
         if(errorcode == RBUS_ERROR_SUCCESS && numProps == numComponents)
         {
-#if 0
-            RBUSLOG_DEBUG("rbus_discoverComponentName return %d component for %d params", numComponents, numProps);
-            for(i = 0; i < numComponents; ++i)
-            {
-                RBUSLOG_DEBUG("%d: %s %s",i, pParamNames[i], componentNames[i]);
-            }
-#endif
+            rbusSetBatch_t* batches;
+            int* batchOf;
+            int numBatches = 0;
+            uint32_t sessionId = opts ? opts->sessionId : 0;
+            bool commit = !opts || opts->commit;
+            bool prepare = false;
+            bool ownSession = false;
+
             current = properties;
             for(i = 0; i < numProps; ++i, current = rbusProperty_GetNext(current))
             {
@@ -2700,111 +3768,153 @@ rbusError_t rbus_setMulti(rbusHandle_t handle, int numProps, rbusProperty_t prop
 
             if(errorcode == RBUS_ERROR_INVALID_INPUT)
             {
+                for(i = 0; i < numComponents; i++)
+                    free(componentNames[i]);
                 free(componentNames);
+                free(pParamNames);
                 return RBUS_ERROR_INVALID_INPUT;
             }
 
+            /*group the params into one batch per component*/
+            batches = calloc(numProps, sizeof(rbusSetBatch_t));
+            batchOf = malloc(numProps * sizeof(int));
+            if(!batches || !batchOf)
+            {
+                RBUSLOG_ERROR("%s: failed to allocate %d batches", __FUNCTION__, numProps);
+                for(i = 0; i < numComponents; i++)
+                    free(componentNames[i]);
+                free(componentNames);
+                free(batches);
+                free(batchOf);
+                free(pParamNames);
+                return RBUS_ERROR_OUT_OF_RESOURCES;
+            }
             for(;;)
             {
-                char* componentName = NULL;
-                char const* firstParamName = NULL;
-                int batchCount = 0;
+                rbusSetBatch_t* batch = &batches[numBatches];
+                int first = -1;
 
-                for(i = 0; i < numProps; ++i)
+                for(i = 0; i < numProps && first < 0; ++i)
                 {
                     if(componentNames[i])
-                    {
-                        if(!componentName)
-                        {
-                            RBUSLOG_DEBUG("%s starting batch for component %s", __FUNCTION__, componentNames[i]);
-                            componentName = strdup(componentNames[i]);
-                            firstParamName = pParamNames[i];
-                            batchCount = 1;
-                        }
-                        else if(strcmp(componentName, componentNames[i]) == 0)
-                        {
-                            batchCount++;
-                        }
-                    }
+                        first = i;
                 }
 
-                if(componentName)
-                {
-
-                    rbusMessage_Init(&setRequest);
-
-                    /* Set the Session ID first */
-                    if ((opts) && (opts->sessionId != 0))
-                        rbusMessage_SetInt32(setRequest, opts->sessionId);
-                    else
-                        rbusMessage_SetInt32(setRequest, 0);
+                if(first < 0)
+                    break;
 
-                    /* Set the Component name that invokes the set */
-                    rbusMessage_SetString(setRequest, handleInfo->componentName);
-                    /* Set the Size of params */
-                    rbusMessage_SetInt32(setRequest, batchCount);
+                RBUSLOG_DEBUG("%s starting batch for component %s", __FUNCTION__, componentNames[first]);
+                if(!(batch->componentName = strdup(componentNames[first])))
+                {
+                    RBUSLOG_ERROR("%s: failed to allocate batch for %s", __FUNCTION__, componentNames[first]);
+                    errorcode = RBUS_ERROR_OUT_OF_RESOURCES;
+                    break;
+                }
+                batch->firstParamName = pParamNames[first];
 
-                    current = properties;
-                    for(i = 0; i < numProps; ++i, current = rbusProperty_GetNext(current))
+                current = properties;
+                for(i = 0; i < numProps; ++i, current = rbusProperty_GetNext(current))
+                {
+                    if(componentNames[i] && strcmp(batch->componentName, componentNames[i]) == 0)
                     {
-                        if(componentNames[i] && strcmp(componentName, componentNames[i]) == 0)
-                        {
-                            if(strcmp(pParamNames[i], rbusProperty_GetName(current)))
-                                RBUSLOG_ERROR("paramName doesn't match current property");
+                        if(strcmp(pParamNames[i], rbusProperty_GetName(current)))
+                            RBUSLOG_ERROR("paramName doesn't match current property");
 
-                            RBUSLOG_DEBUG("%s adding %s to batch", __FUNCTION__, rbusProperty_GetName(current));                            
-                            rbusValue_appendToMessage(rbusProperty_GetName(current), rbusProperty_GetValue(current), setRequest);
+                        batchOf[i] = numBatches;
+                        batch->lastProperty = current;
+                        batch->numProps++;
 
-                            /*free here so its removed from batch scan*/
-                            free(componentNames[i]);
-                            componentNames[i] = NULL;
-                        }
-                    }  
+                        /*free here so its removed from batch scan*/
+                        free(componentNames[i]);
+                        componentNames[i] = NULL;
+                    }
+                }
+                numBatches++;
+            }
 
-                    /* Set the Commit value; FIXME: Should we use string? */
-                    rbusMessage_SetString(setRequest, (!opts || opts->commit) ? "TRUE" : "FALSE");
+            if(errorcode == RBUS_ERROR_OUT_OF_RESOURCES)
+            {
+                /*nothing has been sent yet*/
+                for(i = 0; i < numBatches; i++)
+                    free(batches[i].componentName);
+                for(i = 0; i < numProps; i++)
+                    free(componentNames[i]);
+                free(componentNames);
+                free(batches);
+                free(batchOf);
+                free(pParamNames);
+                return errorcode;
+            }
 
-                    if((err = rbus_invokeRemoteMethod(firstParamName, METHOD_SETPARAMETERVALUES, setRequest, INVOKE_TIMEOUT, &setResponse)) != RTMESSAGE_BUS_SUCCESS)
+            /*a set spanning several components is first sent to all of them with commit false,
+              so each setHandler checks and remembers its values under the session.  Only
+              once all of them succeed is each component sent a commit*/
+            if(numBatches > 1 && commit)
+            {
+                prepare = true;
+                if(sessionId == 0)
+                {
+                    if(rbus_createSession(handle, &sessionId) == RBUS_ERROR_SUCCESS)
                     {
-                        RBUSLOG_ERROR("%s by %s failed; Received error %d from RBUS Daemon for the object %s", __FUNCTION__, handle->componentName, err, firstParamName);
-                        errorcode = rbuscoreError_to_rbusError(err);
+                        ownSession = true;
                     }
                     else
                     {
-                        char const* pErrorReason = NULL;
-                        rbusLegacyReturn_t legacyRetCode = RBUS_LEGACY_ERR_FAILURE;
-                        int ret = -1;
-                        rbusMessage_GetInt32(setResponse, &ret);
-
-                        RBUSLOG_DEBUG("Response from the remote method is [%d]!", ret);
-                        errorcode = (rbusError_t) ret;
-                        legacyRetCode = (rbusLegacyReturn_t) ret;
+                        RBUSLOG_WARN("%s: no session available, so %d components commit the set independently", __FUNCTION__, numBatches);
+                        sessionId = 0;
+                        prepare = false;
+                    }
+                }
+            }
 
-                        if((errorcode == RBUS_ERROR_SUCCESS) || (legacyRetCode == RBUS_LEGACY_ERR_SUCCESS))
-                        {
-                            errorcode = RBUS_ERROR_SUCCESS;
-                            RBUSLOG_DEBUG("Successfully Set the Value");
-                        }
-                        else
-                        {
-                            rbusMessage_GetString(setResponse, &pErrorReason);
-                            RBUSLOG_WARN("Failed to Set the Value for %s", pErrorReason);
-                            if(legacyRetCode > RBUS_LEGACY_ERR_SUCCESS)
-                            {
-                                errorcode = CCSPError_to_rbusError(legacyRetCode);
-                            }
-                        }
+            for(i = 0; i < numBatches; i++)
+                batches[i].request = _set_request_create(handleInfo, sessionId, batches[i].numProps);
+            current = properties;
+            for(i = 0; i < numProps; ++i, current = rbusProperty_GetNext(current))
+            {
+                RBUSLOG_DEBUG("%s adding %s to batch", __FUNCTION__, rbusProperty_GetName(current));
+                rbusValue_appendToMessage(rbusProperty_GetName(current), rbusProperty_GetValue(current), batches[batchOf[i]].request);
+            }
+            for(i = 0; i < numBatches; i++)
+                _set_request_finish(batches[i].request, commit && !prepare);
+
+            _set_batches_invoke(batches, numBatches);
+
+            errorcode = RBUS_ERROR_SUCCESS;
+            for(i = 0; i < numBatches && errorcode == RBUS_ERROR_SUCCESS; i++)
+                errorcode = batches[i].errorcode;
 
-                        /* Release the reponse message */
-                        rbusMessage_Release(setResponse);
+            if(prepare)
+            {
+                if(errorcode == RBUS_ERROR_SUCCESS)
+                {
+                    /*the commit finalizes what the session remembered, so it only needs to
+                      carry one of the component's params*/
+                    for(i = 0; i < numBatches; i++)
+                    {
+                        batches[i].request = _set_request_create(handleInfo, sessionId, 1);
+                        rbusValue_appendToMessage(rbusProperty_GetName(batches[i].lastProperty), rbusProperty_GetValue(batches[i].lastProperty), batches[i].request);
+                        _set_request_finish(batches[i].request, true);
                     }
-                    free(componentName);
+
+                    _set_batches_invoke(batches, numBatches);
+
+                    for(i = 0; i < numBatches && errorcode == RBUS_ERROR_SUCCESS; i++)
+                        errorcode = batches[i].errorcode;
                 }
                 else
                 {
-                    break;
+                    RBUSLOG_WARN("%s: set failed with %d so none of %d components were sent a commit", __FUNCTION__, errorcode, numBatches);
                 }
+
+                if(ownSession)
+                    rbus_closeSession(handle, sessionId);
             }
+
+            for(i = 0; i < numBatches; i++)
+                free(batches[i].componentName);
+            free(batches);
+            free(batchOf);
         }
         else
         {
@@ -3148,11 +4258,13 @@ rbusError_t rbusTable_unregisterRow(
 
 //************************** Events ****************************//
 
-static rbusMessage rbusEvent_CreatePayloadEx(rbusEventSubscription_t* sub)
+/*sub must be one allocated by rbusEvent_SubscribeWithRetries*/
+rbusMessage rbusEvent_CreatePayloadEx(rbusEventSubscription_t* sub)
 {
+    rbusEventRateOptions_t const* rate = &((rbusEventSubscriptionInternal_t*)sub)->rate;
     rbusMessage payload = NULL;
 
-    if(sub->filter || sub->interval || sub->duration)
+    if(sub->filter || sub->interval || sub->duration || rate->publishInterval)
     {
         rbusMessage_Init(&payload);
 
@@ -3168,6 +4280,13 @@ static rbusMessage rbusEvent_CreatePayloadEx(rbusEventSubscription_t* sub)
         {
             rbusMessage_SetInt32(payload, 0);
         }
+
+        /*the rate limit is appended last so older providers, which stop reading after the filter, ignore it*/
+        if(rate->publishInterval)
+        {
+            rbusMessage_SetInt32(payload, (int32_t)rate->publishInterval);
+            rbusMessage_SetInt32(payload, rate->coalesce ? 1 : 0);
+        }
     }
 
     return payload;
@@ -3181,8 +4300,10 @@ static rbusError_t rbusEvent_SubscribeWithRetries(
     rbusFilter_t                    filter,
     int32_t                         interval,
     uint32_t                        duration,    
+    rbusEventRateOptions_t const*   rate,
     int                             timeout,
-    rbusSubscribeAsyncRespHandler_t async)
+    rbusSubscribeAsyncRespHandler_t async,
+    rbusEventSubscription_t**       subscribed)
 {
     rbus_error_t coreerr;
     int providerError = RBUS_ERROR_SUCCESS;
@@ -3201,16 +4322,23 @@ static rbusError_t rbusEvent_SubscribeWithRetries(
         destNotFoundTimeout = timeout * 1000; /*convert seconds to milliseconds */
     }
 
-    sub = malloc(sizeof(rbusEventSubscription_t));
+    sub = calloc(1, sizeof(rbusEventSubscriptionInternal_t));
+    if(!sub || !(sub->eventName = strdup(eventName)))
+    {
+        RBUSLOG_ERROR("%s: failed to allocate subscription for %s", __FUNCTION__, eventName);
+        free(sub);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
 
     sub->handle = handle;
-    sub->eventName = strdup(eventName);
     sub->handler = handler;
 
     sub->userData = userData;
     sub->filter = filter;
     sub->duration = duration;
     sub->interval = interval;
+    if(rate)
+        ((rbusEventSubscriptionInternal_t*)sub)->rate = *rate;
     sub->asyncHandler = async;
 
     if(sub->filter)
@@ -3220,6 +4348,11 @@ static rbusError_t rbusEvent_SubscribeWithRetries(
 
     if(sub->asyncHandler)
     {
+        if(payload)
+        {
+            rbusMessage_Release(payload);
+        }
+
         rbusAsyncSubscribe_AddSubscription(sub);
 
         return RBUS_ERROR_SUCCESS;
@@ -3266,7 +4399,11 @@ static rbusError_t rbusEvent_SubscribeWithRetries(
 
     if(coreerr == RTMESSAGE_BUS_SUCCESS)
     {
-        rtVector_PushBack(handleInfo->eventSubs, sub);
+        /*batched subscribes hand the sub back so the caller can add them all once every one succeeded*/
+        if(subscribed)
+            *subscribed = sub;
+        else
+            rtVector_PushBack(handleInfo->eventSubs, sub);
 
         RBUSLOG_INFO("%s: %s subscribe retries succeeded", __FUNCTION__, eventName);
         
@@ -3311,7 +4448,7 @@ rbusError_t  rbusEvent_Subscribe(
     VERIFY_NULL(eventName);
     VERIFY_NULL(handler);
 
-    errorcode = rbusEvent_SubscribeWithRetries(handle, eventName, handler, userData, NULL, 0, 0 , timeout, NULL);
+    errorcode = rbusEvent_SubscribeWithRetries(handle, eventName, handler, userData, NULL, 0, 0, NULL, timeout, NULL, NULL);
 
     if(errorcode != RBUS_ERROR_SUCCESS)
     {
@@ -3338,7 +4475,7 @@ rbusError_t  rbusEvent_SubscribeAsync(
     VERIFY_NULL(handler);
     VERIFY_NULL(subscribeHandler);
 
-    errorcode = rbusEvent_SubscribeWithRetries(handle, eventName, handler, userData, NULL, 0, 0, timeout, subscribeHandler);
+    errorcode = rbusEvent_SubscribeWithRetries(handle, eventName, handler, userData, NULL, 0, 0, NULL, timeout, subscribeHandler, NULL);
 
     if(errorcode != RBUS_ERROR_SUCCESS)
     {
@@ -3368,7 +4505,8 @@ rbusError_t rbusEvent_Unsubscribe(
     {
         rbus_error_t coreerr = rbus_unsubscribeFromEvent(NULL, eventName, NULL);
 
-        rtVector_RemoveItem(handleInfo->eventSubs, sub, rbusEventSubscription_free);
+        rtVector_RemoveItem(handleInfo->eventSubs, sub, NULL);
+        rbusDelivery_Cancel(handle, sub, rbusEventSubscription_free, sub);
 
         if(coreerr == RTMESSAGE_BUS_SUCCESS)
         {
@@ -3395,14 +4533,149 @@ rbusError_t rbusEvent_Unsubscribe(
     }
 }
 
+/*rbusEvent_SubscribeEx and rbusEvent_UnsubscribeEx entries are each a round trip to their
+  provider, so larger arrays are worked through subscribeThreads at a time.  The threads
+  only make the same rbus-core subscribe and unsubscribe calls that applications make
+  from their own threads, and write their own entry of subs and errors; the handle's
+  eventSubs is only changed by the calling thread, before or after they run.  Setting
+  RBUS_CONFIG_SUBSCRIBE_THREADS to 1 sends one entry at a time*/
+typedef struct _rbusSubscribeBatch
+{
+    rbusHandle_t                handle;
+    rbusEventSubscription_t*    subscription;   /*the caller's array*/
+    rbusEventRateOptions_t const* rate;         /*the caller's rate options per entry, or NULL*/
+    rbusEventSubscription_t**   subs;           /*the subscription made, or found to unsubscribe, per entry*/
+    rbusError_t*                errors;
+    int                         count;
+    int                         next;
+    int                         timeout;
+    int                         failed;
+} rbusSubscribeBatch_t;
+
+static void* _subscribe_batch_thread_func(void* p)
+{
+    rbusSubscribeBatch_t* batch = (rbusSubscribeBatch_t*)p;
+
+    /*SubscribeEx is a transaction so there's no point starting more once one failed*/
+    while(!__atomic_load_n(&batch->failed, __ATOMIC_RELAXED))
+    {
+        rbusEventSubscription_t* sub;
+        int i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+        if(i >= batch->count)
+            break;
+        sub = &batch->subscription[i];
+        batch->errors[i] = rbusEvent_SubscribeWithRetries(
+            batch->handle, sub->eventName, sub->handler, sub->userData,
+            sub->filter, sub->interval, sub->duration,
+            batch->rate ? &batch->rate[i] : NULL, batch->timeout, NULL, &batch->subs[i]);
+        if(batch->errors[i] != RBUS_ERROR_SUCCESS)
+        {
+            RBUSLOG_WARN("%s: %s failed err=%d", __FUNCTION__, sub->eventName, batch->errors[i]);
+            __atomic_store_n(&batch->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+static void* _unsubscribe_batch_thread_func(void* p)
+{
+    rbusSubscribeBatch_t* batch = (rbusSubscribeBatch_t*)p;
+
+    for(;;)
+    {
+        rbus_error_t coreerr;
+        rbusMessage payload;
+        int i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+        if(i >= batch->count)
+            break;
+        if(!batch->subs[i])
+            continue;
+
+        payload = rbusEvent_CreatePayloadEx(batch->subs[i]);
+
+        coreerr = rbus_unsubscribeFromEvent(NULL, batch->subscription[i].eventName, payload);
+
+        if(payload)
+        {
+            rbusMessage_Release(payload);
+        }
+
+        if(coreerr != RTMESSAGE_BUS_SUCCESS)
+        {
+            RBUSLOG_INFO("%s: %s failed with core err=%d", __FUNCTION__, batch->subscription[i].eventName, coreerr);
+            if(coreerr == RTMESSAGE_BUS_ERROR_DESTINATION_UNREACHABLE)
+                batch->errors[i] = RBUS_ERROR_ELEMENT_DOES_NOT_EXIST;
+            else
+                batch->errors[i] = RBUS_ERROR_BUS_ERROR;
+        }
+    }
+    return NULL;
+}
+
+static void _subscribe_batch_run(rbusSubscribeBatch_t* batch, void* (*threadFunc)(void*))
+{
+    pthread_t threads[RBUS_SUBSCRIBE_THREADS_MAX];
+    int maxThreads = rbusConfig_Get()->subscribeThreads;
+    int numThreads = 0;
+    int i;
+
+    if(batch->count >= SUBSCRIBE_BATCH_PARALLEL_MIN)
+    {
+        for(i = 0; i < maxThreads - 1 && i < batch->count - 1; i++)
+        {
+            if(pthread_create(&threads[numThreads], NULL, threadFunc, batch) == 0)
+                numThreads++;
+        }
+    }
+    threadFunc(batch);
+    for(i = 0; i < numThreads; i++)
+        pthread_join(threads[i], NULL);
+}
+
+static rbusError_t _subscribe_batch_init(rbusSubscribeBatch_t* batch, rbusHandle_t handle,
+    rbusEventSubscription_t* subscription, rbusEventRateOptions_t const* rate, int numSubscriptions, int timeout)
+{
+    int i;
+
+    memset(batch, 0, sizeof(*batch));
+    batch->handle = handle;
+    batch->subscription = subscription;
+    batch->rate = rate;
+    batch->count = numSubscriptions;
+    batch->timeout = timeout;
+    batch->subs = calloc(numSubscriptions, sizeof(rbusEventSubscription_t*));
+    batch->errors = malloc(numSubscriptions * sizeof(rbusError_t));
+    if(!batch->subs || !batch->errors)
+    {
+        free(batch->subs);
+        free(batch->errors);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+    for(i = 0; i < numSubscriptions; ++i)
+        batch->errors[i] = RBUS_ERROR_SUCCESS;
+    return RBUS_ERROR_SUCCESS;
+}
+
 rbusError_t rbusEvent_SubscribeEx(
     rbusHandle_t                handle,
     rbusEventSubscription_t*    subscription,
     int                         numSubscriptions,
     int                         timeout)
 {
+    return rbusEvent_SubscribeExWithRate(handle, subscription, NULL, numSubscriptions, timeout);
+}
+
+rbusError_t rbusEvent_SubscribeExWithRate(
+    rbusHandle_t                    handle,
+    rbusEventSubscription_t*        subscription,
+    rbusEventRateOptions_t const*   rate,
+    int                             numSubscriptions,
+    int                             timeout)
+{
+    struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
     rbusError_t errorcode = RBUS_ERROR_SUCCESS;
-    int i, j;
+    rbusSubscribeBatch_t batch;
+    int i;
 
     VERIFY_NULL(handle);
     VERIFY_NULL(subscription);
@@ -3411,31 +4684,49 @@ rbusError_t rbusEvent_SubscribeEx(
     for(i = 0; i < numSubscriptions; ++i)
     {
         RBUSLOG_INFO("%s: %s", __FUNCTION__, subscription[i].eventName);
+        VERIFY_NULL(subscription[i].eventName);
+    }
 
-        //FIXME/TODO -- since this is not using async path, this could block and thus block the rest of the subs to come
-        //For rbusEvent_Subscribe, since it a single subscribe, blocking is fine but for rbusEvent_SubscribeEx,
-        //where we can have multiple, we need to actually run all these in parallel.  So we might need to leverage
-        //the asyncsubscribe api to handle this.
-        errorcode = rbusEvent_SubscribeWithRetries(
-            handle, subscription[i].eventName, subscription[i].handler, subscription[i].userData, 
-            subscription[i].filter, subscription[i].interval, subscription[i].duration, timeout, NULL);
+    if((errorcode = _subscribe_batch_init(&batch, handle, subscription, rate, numSubscriptions, timeout)) != RBUS_ERROR_SUCCESS)
+        return errorcode;
 
-        if(errorcode != RBUS_ERROR_SUCCESS)
+    _subscribe_batch_run(&batch, _subscribe_batch_thread_func);
+
+    for(i = 0; i < numSubscriptions; ++i)
+    {
+        if(batch.errors[i] != RBUS_ERROR_SUCCESS)
         {
-            RBUSLOG_WARN("%s: %s failed err=%d", __FUNCTION__, subscription[i].eventName, errorcode);
+            errorcode = batch.errors[i];
+            break;
+        }
+    }
 
-            /*  Treat SubscribeEx like a transaction because
-                if any subs fails, how will the user know which ones succeeded and which failed ?
-                So, as a transaction, we just undo everything, which are all those from 0 to i-1.
-            */
-            for(j = 0; j < i; ++j)
+    if(errorcode == RBUS_ERROR_SUCCESS)
+    {
+        for(i = 0; i < numSubscriptions; ++i)
+            rtVector_PushBack(handleInfo->eventSubs, batch.subs[i]);
+    }
+    else
+    {
+        /*  Treat SubscribeEx like a transaction because
+            if any subs fails, how will the user know which ones succeeded and which failed ?
+            So, as a transaction, we just undo every one that succeeded.
+        */
+        for(i = 0; i < numSubscriptions; ++i)
+        {
+            if(batch.subs[i])
             {
-                rbusEvent_Unsubscribe(handle, subscription[i].eventName);
+                rbusMessage payload = rbusEvent_CreatePayloadEx(batch.subs[i]);
+                rbus_unsubscribeFromEvent(NULL, batch.subs[i]->eventName, payload);
+                if(payload)
+                    rbusMessage_Release(payload);
+                rbusDelivery_Cancel(handle, batch.subs[i], rbusEventSubscription_free, batch.subs[i]);
             }
-            break;
         }
     }
 
+    free(batch.subs);
+    free(batch.errors);
     return errorcode;
 }
 
@@ -3445,6 +4736,17 @@ rbusError_t rbusEvent_SubscribeExAsync(
     int                             numSubscriptions,
     rbusSubscribeAsyncRespHandler_t subscribeHandler,
     int                             timeout)
+{
+    return rbusEvent_SubscribeExAsyncWithRate(handle, subscription, NULL, numSubscriptions, subscribeHandler, timeout);
+}
+
+rbusError_t rbusEvent_SubscribeExAsyncWithRate(
+    rbusHandle_t                    handle,
+    rbusEventSubscription_t*        subscription,
+    rbusEventRateOptions_t const*   rate,
+    int                             numSubscriptions,
+    rbusSubscribeAsyncRespHandler_t subscribeHandler,
+    int                             timeout)
 {
     rbusError_t errorcode = RBUS_ERROR_SUCCESS;
     int i, j;
@@ -3460,7 +4762,8 @@ rbusError_t rbusEvent_SubscribeExAsync(
 
         errorcode = rbusEvent_SubscribeWithRetries(
             handle, subscription[i].eventName, subscription[i].handler, subscription[i].userData, 
-            subscription[i].filter, subscription[i].interval, subscription[i].duration, timeout, subscribeHandler);
+            subscription[i].filter, subscription[i].interval, subscription[i].duration,
+            rate ? &rate[i] : NULL, timeout, subscribeHandler, NULL);
 
         if(errorcode != RBUS_ERROR_SUCCESS)
         {
@@ -3472,7 +4775,7 @@ rbusError_t rbusEvent_SubscribeExAsync(
             */
             for(j = 0; j < i; ++j)
             {
-                rbusEvent_Unsubscribe(handle, subscription[i].eventName);
+                rbusEvent_Unsubscribe(handle, subscription[j].eventName);
             }
             break;
         }
@@ -3487,6 +4790,7 @@ rbusError_t rbusEvent_UnsubscribeEx(
     int                         numSubscriptions)
 {
     rbusError_t errorcode = RBUS_ERROR_SUCCESS;
+    rbusSubscribeBatch_t batch;
 
     VERIFY_NULL(handle);
     VERIFY_NULL(subscription);
@@ -3502,58 +4806,46 @@ rbusError_t rbusEvent_UnsubscribeEx(
     //its assumed that caller has successfully subscribed before so we need to attempt all 
     //to get as many as possible unsubscribed and off the bus
 
+    if((errorcode = _subscribe_batch_init(&batch, handle, subscription, NULL, numSubscriptions, 0)) != RBUS_ERROR_SUCCESS)
+        return errorcode;
+
+    /*subs are taken out of the list as they are found so duplicate entries each find their own*/
     for(i = 0; i < numSubscriptions; ++i)
     {
-        rbusEventSubscription_t* sub;
-
         RBUSLOG_INFO("%s: %s", __FUNCTION__, subscription[i].eventName);
 
-        /*the use of rtVector is inefficient here.  I have to loop through the vector to find the sub by name, 
-            then call RemoveItem, which loops through again to find the item by address to destroy */
-        sub = rbusEventSubscription_find(handleInfo->eventSubs, subscription[i].eventName, subscription[i].filter);
+        batch.subs[i] = rbusEventSubscription_find(handleInfo->eventSubs, subscription[i].eventName, subscription[i].filter);
 
-        if(sub)
+        if(batch.subs[i])
         {
-            rbus_error_t coreerr;
-            rbusMessage payload;
-
-            payload = rbusEvent_CreatePayloadEx(&subscription[i]);
-
-            coreerr = rbus_unsubscribeFromEvent(NULL, subscription[i].eventName, payload);
-
-            if(payload)
-            {
-                rbusMessage_Release(payload);
-            }
-
-            rtVector_RemoveItem(handleInfo->eventSubs, sub, rbusEventSubscription_free);
-
-            if(coreerr != RTMESSAGE_BUS_SUCCESS)
-            {
-                RBUSLOG_INFO("%s: %s failed with core err=%d", __FUNCTION__, subscription[i].eventName, coreerr);
-                
-                //FIXME -- we just overwrite any existing error that might have happened in a previous loop
-                if(coreerr == RTMESSAGE_BUS_ERROR_DESTINATION_UNREACHABLE)
-                {
-                    errorcode = RBUS_ERROR_ELEMENT_DOES_NOT_EXIST;
-                }
-                else
-                {
-                    errorcode = RBUS_ERROR_BUS_ERROR;
-                }
-            }
+            rtVector_RemoveItem(handleInfo->eventSubs, batch.subs[i], NULL);
         }
         else
         {
             RBUSLOG_INFO("%s: %s no existing subscription found", __FUNCTION__, subscription[i].eventName);
-            errorcode = RBUS_ERROR_INVALID_OPERATION; //TODO - is the the right error to return
+            batch.errors[i] = RBUS_ERROR_INVALID_OPERATION; //TODO - is the the right error to return
+        }
+    }
+
+    _subscribe_batch_run(&batch, _unsubscribe_batch_thread_func);
+
+    for(i = 0; i < numSubscriptions; ++i)
+    {
+        if(batch.subs[i])
+        {
+            rbusDelivery_Cancel(handle, batch.subs[i], rbusEventSubscription_free, batch.subs[i]);
         }
+        //FIXME -- we just overwrite any existing error that might have happened in a previous entry
+        if(batch.errors[i] != RBUS_ERROR_SUCCESS)
+            errorcode = batch.errors[i];
     }
 
+    free(batch.subs);
+    free(batch.errors);
     return errorcode;
 }
 
-rbusError_t  rbusEvent_Publish(
+static rbusError_t rbusEvent_PublishImpl(
   rbusHandle_t          handle,
   rbusEvent_t*          eventData)
 {
@@ -3565,7 +4857,7 @@ rbusError_t  rbusEvent_Publish(
     VERIFY_NULL(handle);
     VERIFY_NULL(eventData);
 
-    RBUSLOG_INFO("%s: %s", __FUNCTION__, eventData->name);
+    RBUSLOG_DEBUG("%s: %s", __FUNCTION__, eventData->name);
 
     /*get the node and walk its subscriber list, 
       publishing event to each subscriber*/
@@ -3713,7 +5005,17 @@ rbusError_t  rbusEvent_Publish(
             rbusMessage_Init(&msg);
             rbusEvent_appendToMessage(eventData, msg);
 
-            RBUSLOG_INFO("rbusEvent_Publish: publising event %s to listener %s", subscription->eventName, subscription->listener);
+            /* enforce the max delivery rate the subscriber asked for.
+               the event is either dropped or held to be sent when the interval elapses */
+            if(subscription->publishInterval && !rbusEventRate_CheckPublish(handle, subscription, msg))
+            {
+                RBUSLOG_DEBUG("rbusEvent_Publish: rate limited event %s to listener %s", subscription->eventName, subscription->listener);
+                rbusMessage_Release(msg);
+                rtListItem_GetNext(listItem, &listItem);
+                continue;
+            }
+
+            RBUSLOG_DEBUG("rbusEvent_Publish: publising event %s to listener %s", subscription->eventName, subscription->listener);
             err = rbus_publishSubscriberEvent(
                 handleInfo->componentName,  
                 subscription->eventName/*use the same eventName the consumer subscribed with; not event instance name eventData->name*/, 
@@ -3736,7 +5038,20 @@ rbusError_t  rbusEvent_Publish(
     return errOut == RTMESSAGE_BUS_SUCCESS ? RBUS_ERROR_SUCCESS: RBUS_ERROR_BUS_ERROR;
 }
 
-rbusError_t rbusMethod_InvokeInternal(
+rbusError_t  rbusEvent_Publish(
+  rbusHandle_t          handle,
+  rbusEvent_t*          eventData)
+{
+    rbusError_t rc;
+    rtTime_t start;
+    rtTime_Now(&start);
+    rc = rbusEvent_PublishImpl(handle, eventData);
+    /*having nobody to publish to is normal and not counted as a failure*/
+    rbusStats_Record(RBUS_STATS_EVENT_PUBLISH, &start, rc != RBUS_ERROR_SUCCESS && rc != RBUS_ERROR_NOSUBSCRIBERS);
+    return rc;
+}
+
+static rbusError_t rbusMethod_InvokeInternalImpl(
     rbusHandle_t handle, 
     char const* methodName, 
     rbusObject_t inParams, 
@@ -3794,6 +5109,21 @@ rbusError_t rbusMethod_InvokeInternal(
     return returnCode;
 }
 
+rbusError_t rbusMethod_InvokeInternal(
+    rbusHandle_t handle, 
+    char const* methodName, 
+    rbusObject_t inParams, 
+    rbusObject_t* outParams,
+    int timeout)
+{
+    rbusError_t rc;
+    rtTime_t start;
+    rtTime_Now(&start);
+    rc = rbusMethod_InvokeInternalImpl(handle, methodName, inParams, outParams, timeout);
+    rbusStats_Record(RBUS_STATS_METHOD_INVOKE, &start, rc != RBUS_ERROR_SUCCESS);
+    return rc;
+}
+
 rbusError_t rbusMethod_Invoke(
     rbusHandle_t handle, 
     char const* methodName, 
@@ -4006,6 +5336,233 @@ rbusError_t rbus_closeSession(rbusHandle_t handle, uint32_t sessionId)
     return rc;
 }
 
+/*A session lease hands out session ids without a session manager round-trip per session.
+  It reserves a block of ids with RBUS_SMGR_METHOD_REQUEST_SESSION_ID_BLOCK and numbers
+  sessions locally from it, ending the block with a single end_session on its first id
+  once every id has been handed out and released.  Session managers that do not know the
+  method reply that it is unsupported, or without a block, in which case every lease in
+  the process falls back to rbus_createSession/rbus_closeSession per session.  Any other failure, such as a
+  timeout, is returned to the caller and the block is asked for again next time.*/
+#ifndef RBUS_SMGR_METHOD_REQUEST_SESSION_ID_BLOCK
+#define RBUS_SMGR_METHOD_REQUEST_SESSION_ID_BLOCK "request_session_id_block"
+#endif
+
+#define SESSION_BLOCK_UNKNOWN       0
+#define SESSION_BLOCK_SUPPORTED     1
+#define SESSION_BLOCK_UNSUPPORTED   2
+
+static int gSessionBlockSupport = SESSION_BLOCK_UNKNOWN;
+
+typedef struct _rbusSessionBlock
+{
+    uint32_t                    first;
+    uint32_t                    end;
+    uint32_t                    outstanding;    /*ids acquired and not yet released*/
+    struct _rbusSessionBlock*   next;
+} rbusSessionBlock_t;
+
+struct _rbusSessionLease
+{
+    rbusHandle_t        handle;
+    pthread_mutex_t     mutex;
+    uint32_t            blockSize;
+    rbusSessionBlock_t* block;      /*block ids are handed out from, NULL if none*/
+    uint32_t            next;       /*next id to hand out from block*/
+    rbusSessionBlock_t* retired;    /*used up blocks whose ids are still held*/
+};
+
+static rbusError_t _session_lease_end_block(rbusSessionLease_t lease, rbusSessionBlock_t* block)
+{
+    rbusError_t rc = rbus_closeSession(lease->handle, block->first);
+    if(rc != RBUS_ERROR_SUCCESS)
+        RBUSLOG_WARN("Failed to end session id block %u to %u: %d", block->first, block->end - 1, rc);
+    free(block);
+    return rc;
+}
+
+/*reserves a new block of ids; called with lease->mutex held*/
+static rbusError_t _session_lease_reserve_block(rbusSessionLease_t lease)
+{
+    rbus_error_t err;
+    rbusMessage request;
+    rbusMessage response;
+    rbusSessionBlock_t* block;
+    int32_t status = 0;
+    int32_t first = 0;
+    int32_t count = 0;
+    bool hasBlock = false;
+
+    rbusMessage_Init(&request);
+    rbusMessage_SetInt32(request, (int32_t)lease->blockSize);
+    err = rbus_invokeRemoteMethod(RBUS_SMGR_DESTINATION_NAME, RBUS_SMGR_METHOD_REQUEST_SESSION_ID_BLOCK, request, INVOKE_TIMEOUT, &response);
+    if(err == RTMESSAGE_BUS_SUCCESS)
+    {
+        if(rbusMessage_GetInt32(response, &status) == RT_OK && status != RTMESSAGE_BUS_SUCCESS)
+            err = (rbus_error_t)status;
+        else
+            hasBlock = rbusMessage_GetInt32(response, &first) == RT_OK && rbusMessage_GetInt32(response, &count) == RT_OK && first != 0 && count > 0;
+        rbusMessage_Release(response);
+    }
+    /*a reply without a status or a block comes from a session manager that doesn't know the method*/
+    if(err == RTMESSAGE_BUS_ERROR_UNSUPPORTED_METHOD || (err == RTMESSAGE_BUS_SUCCESS && !hasBlock))
+    {
+        RBUSLOG_INFO("Session manager does not reserve session id blocks; using a session per request");
+        __atomic_store_n(&gSessionBlockSupport, SESSION_BLOCK_UNSUPPORTED, __ATOMIC_RELAXED);
+        return RBUS_ERROR_SUCCESS;
+    }
+    if(err != RTMESSAGE_BUS_SUCCESS)
+    {
+        RBUSLOG_ERROR("Failed to reserve session ids from %s for %s: %d", RBUS_SMGR_DESTINATION_NAME, lease->handle->componentName, err);
+        return rbuscoreError_to_rbusError(err);
+    }
+    __atomic_store_n(&gSessionBlockSupport, SESSION_BLOCK_SUPPORTED, __ATOMIC_RELAXED);
+
+    if((block = calloc(1, sizeof(rbusSessionBlock_t))) == NULL)
+    {
+        rbus_closeSession(lease->handle, (uint32_t)first);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+    block->first = (uint32_t)first;
+    block->end = (uint32_t)first + (uint32_t)count;
+    lease->block = block;
+    lease->next = block->first;
+    RBUSLOG_INFO("Reserved session ids %u to %u", block->first, block->end - 1);
+    return RBUS_ERROR_SUCCESS;
+}
+
+rbusError_t rbusSessionLease_Open(rbusHandle_t handle, uint32_t blockSize, rbusSessionLease_t* pLease)
+{
+    rbusSessionLease_t lease;
+    rbusError_t rc = RBUS_ERROR_SUCCESS;
+
+    VERIFY_NULL(handle);
+    VERIFY_NULL(pLease);
+    VERIFY_ZERO(blockSize);
+
+    *pLease = NULL;
+    if((lease = calloc(1, sizeof(struct _rbusSessionLease))) == NULL)
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    lease->handle = handle;
+    lease->blockSize = blockSize;
+    pthread_mutex_init(&lease->mutex, NULL);
+
+    if(__atomic_load_n(&gSessionBlockSupport, __ATOMIC_RELAXED) != SESSION_BLOCK_UNSUPPORTED)
+        rc = _session_lease_reserve_block(lease);
+
+    if(rc != RBUS_ERROR_SUCCESS)
+    {
+        pthread_mutex_destroy(&lease->mutex);
+        free(lease);
+        lease = NULL;
+    }
+    *pLease = lease;
+    return rc;
+}
+
+rbusError_t rbusSessionLease_Acquire(rbusSessionLease_t lease, uint32_t* pSessionId)
+{
+    rbusError_t rc = RBUS_ERROR_SUCCESS;
+    rbusSessionBlock_t* ended = NULL;
+
+    VERIFY_NULL(lease);
+    VERIFY_NULL(pSessionId);
+
+    *pSessionId = 0;
+    pthread_mutex_lock(&lease->mutex);
+    if(__atomic_load_n(&gSessionBlockSupport, __ATOMIC_RELAXED) != SESSION_BLOCK_UNSUPPORTED &&
+       (!lease->block || lease->next == lease->block->end))
+    {
+        /*a used up block is ended once its last id is released*/
+        if(lease->block)
+        {
+            if(lease->block->outstanding)
+            {
+                lease->block->next = lease->retired;
+                lease->retired = lease->block;
+            }
+            else
+            {
+                ended = lease->block;
+            }
+            lease->block = NULL;
+        }
+        rc = _session_lease_reserve_block(lease);
+    }
+    if(rc == RBUS_ERROR_SUCCESS && lease->block)
+    {
+        *pSessionId = lease->next++;
+        lease->block->outstanding++;
+    }
+    pthread_mutex_unlock(&lease->mutex);
+
+    if(ended)
+        _session_lease_end_block(lease, ended);
+    if(rc == RBUS_ERROR_SUCCESS && *pSessionId == 0)
+        rc = rbus_createSession(lease->handle, pSessionId);
+    return rc;
+}
+
+rbusError_t rbusSessionLease_Release(rbusSessionLease_t lease, uint32_t sessionId)
+{
+    rbusSessionBlock_t** pb;
+    rbusSessionBlock_t* ended = NULL;
+    bool leased = false;
+
+    VERIFY_NULL(lease);
+    VERIFY_ZERO(sessionId);
+
+    pthread_mutex_lock(&lease->mutex);
+    if(lease->block && sessionId >= lease->block->first && sessionId < lease->next)
+    {
+        leased = true;
+        if(lease->block->outstanding)
+            lease->block->outstanding--;
+    }
+    for(pb = &lease->retired; !leased && *pb; pb = &(*pb)->next)
+    {
+        if(sessionId >= (*pb)->first && sessionId < (*pb)->end)
+        {
+            leased = true;
+            if((*pb)->outstanding && --(*pb)->outstanding == 0)
+            {
+                ended = *pb;
+                *pb = ended->next;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lease->mutex);
+
+    /*ids from a block are only numbered locally, so there is nothing to end until the block is*/
+    if(ended)
+        _session_lease_end_block(lease, ended);
+    if(leased)
+        return RBUS_ERROR_SUCCESS;
+    return rbus_closeSession(lease->handle, sessionId);
+}
+
+rbusError_t rbusSessionLease_Close(rbusSessionLease_t lease)
+{
+    rbusError_t rc = RBUS_ERROR_SUCCESS;
+    rbusSessionBlock_t* block;
+
+    VERIFY_NULL(lease);
+
+    /*ends every block, including ids the caller still holds*/
+    if(lease->block)
+        rc = _session_lease_end_block(lease, lease->block);
+    while((block = lease->retired) != NULL)
+    {
+        rbusError_t err;
+        lease->retired = block->next;
+        if((err = _session_lease_end_block(lease, block)) != RBUS_ERROR_SUCCESS && rc == RBUS_ERROR_SUCCESS)
+            rc = err;
+    }
+    pthread_mutex_destroy(&lease->mutex);
+    free(lease);
+    return rc;
+}
+
 rbusStatus_t rbus_checkStatus(void)
 {
     rbuscore_bus_status_t busStatus = rbuscore_checkBusStatus();
@@ -1,10 +1,10 @@
 #define _GNU_SOURCE 1
 #include "rbus_asyncsubscribe.h"
 #include "rbus_config.h"
+#include "rbus_handle.h"
 #include <rbus_core.h>
 #include "rbus_log.h"
 #include <rtTime.h>
-#include <rtList.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <string.h>
@@ -24,223 +24,407 @@
 /*defined in rbus.c*/
 void _subscribe_async_callback_handler(rbusHandle_t handle, rbusEventSubscription_t* subscription, rbusError_t error);
 int _event_callback_handler(char const* objectName, char const* eventName, rbusMessage message, void* userData);
+rbusMessage rbusEvent_CreatePayloadEx(rbusEventSubscription_t* sub);
 
+typedef struct AsyncSubscription_t
+{
+    rbusEventSubscription_t* subscription;
+    int nextWaitTime;
+    rtTime_t startTime;
+    rtTime_t nextRetryTime;
+} AsyncSubscription_t;
+
+/*items are kept in a binary min-heap ordered by nextRetryTime so the thread
+  only ever looks at the root to know when to wake up next*/
 typedef struct AsyncSubscribeRetrier_t
 {
-    rtList items;
+    AsyncSubscription_t** heap;
+    int count;
+    int capacity;
     pthread_cond_t condItemAdded;
+    pthread_cond_t condIdle;
     pthread_mutex_t mutexQueue;
     int isRunning;
+    int isSending;
+    char** announced;       /*names announced since the thread last checked the heap*/
+    int announcedCount;
+    int announcedCapacity;
+    int announcedOverflow;  /*a name couldn't be kept, so retry the whole batch*/
     pthread_t threadId;
 } AsyncSubscribeRetrier_t;
 
-typedef struct AsyncSubscription_t
+static AsyncSubscribeRetrier_t* gRetrier = NULL;
+
+/*held by the announcement callback for as long as it uses gRetrier, so Destroy can
+  wait out one that is already running before freeing it*/
+static pthread_mutex_t gAnnounceMutex = PTHREAD_MUTEX_INITIALIZER;
+static bool gAnnounceListening = false;
+
+static int rbusAsyncSubscribeRetrier_Less(int a, int b)
 {
-    rbusEventSubscription_t* subscription;
-    int nextWaitTime;
-    rtTime_t startTime;
-    rtTime_t nextRetryTime;
-} AsyncSubscription_t;
+    return rtTime_Compare(&gRetrier->heap[a]->nextRetryTime, &gRetrier->heap[b]->nextRetryTime) < 0;
+}
 
-static AsyncSubscribeRetrier_t* gRetrier = NULL;
+static void rbusAsyncSubscribeRetrier_Swap(int a, int b)
+{
+    AsyncSubscription_t* tmp = gRetrier->heap[a];
+    gRetrier->heap[a] = gRetrier->heap[b];
+    gRetrier->heap[b] = tmp;
+}
 
-static int rbusAsyncSubscribeRetrier_CompareHandle(const void *pitem, const void *phandle)
+static void rbusAsyncSubscribeRetrier_SiftUp(int i)
 {
-    AsyncSubscription_t* item = (AsyncSubscription_t*)pitem;
+    while(i > 0 && rbusAsyncSubscribeRetrier_Less(i, (i - 1) / 2))
+    {
+        rbusAsyncSubscribeRetrier_Swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
 
-    if(item->subscription->handle == phandle)
-        return 1;
-    else
-        return 0;
+static void rbusAsyncSubscribeRetrier_SiftDown(int i)
+{
+    for(;;)
+    {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if(left < gRetrier->count && rbusAsyncSubscribeRetrier_Less(left, smallest))
+            smallest = left;
+        if(right < gRetrier->count && rbusAsyncSubscribeRetrier_Less(right, smallest))
+            smallest = right;
+        if(smallest == i)
+            break;
+        rbusAsyncSubscribeRetrier_Swap(i, smallest);
+        i = smallest;
+    }
 }
-#if 0
-static int rbusAsyncSubscribeRetrier_CompareSubscription(const void *pitem, const void *psubscription)
+
+static void rbusAsyncSubscribeRetrier_Push(AsyncSubscription_t* item)
 {
-    AsyncSubscription_t* item = (AsyncSubscription_t*)pitem;
+    if(gRetrier->count == gRetrier->capacity)
+    {
+        int capacity = gRetrier->capacity ? gRetrier->capacity * 2 : 16;
+        AsyncSubscription_t** heap = realloc(gRetrier->heap, capacity * sizeof(AsyncSubscription_t*));
+        if(!heap)
+        {
+            RBUSLOG_ERROR("%s: %s dropped, out of memory", __FUNCTION__, item->subscription->eventName);
+            free(item);
+            return;
+        }
+        gRetrier->heap = heap;
+        gRetrier->capacity = capacity;
+    }
+    gRetrier->heap[gRetrier->count++] = item;
+    rbusAsyncSubscribeRetrier_SiftUp(gRetrier->count - 1);
+}
 
-    if(item->subscription == psubscription)
-        return 1;
-    else
-        return 0;
+static AsyncSubscription_t* rbusAsyncSubscribeRetrier_Pop()
+{
+    AsyncSubscription_t* top = gRetrier->heap[0];
+
+    gRetrier->count--;
+    if(gRetrier->count > 0)
+    {
+        gRetrier->heap[0] = gRetrier->heap[gRetrier->count];
+        rbusAsyncSubscribeRetrier_SiftDown(0);
+    }
+    return top;
 }
-#endif
-static int rbusAsyncSubscribeRetrier_DetermineNextSendTime(rtTime_t* nextSendTime)
+
+/*true if the element name a provider registered covers the event name a consumer is
+  waiting on. "{i}" in the registered name and "*" in the event name match any single
+  segment, and a registered object or table (trailing '.') covers everything below it*/
+static bool rbusAsyncSubscribeRetrier_NameMatches(char const* eventName, char const* registered)
 {
-    rtTime_t now;
-    rtListItem li;
-    char tbuff[200];
-  
-    rtList_GetFront(gRetrier->items, &li);
+    char const* e = eventName;
+    char const* r = registered;
 
-    //find the earliest nextRetryTime using nextSendTime to compare and store
-    rtTime_Now(&now);
-    rtTime_Later(&now, rbusConfig_Get()->subscribeMaxWait + 1000, nextSendTime);
+    for(;;)
+    {
+        char const* eEnd = strchr(e, '.');
+        char const* rEnd = strchr(r, '.');
+        size_t eLen = eEnd ? (size_t)(eEnd - e) : strlen(e);
+        size_t rLen = rEnd ? (size_t)(rEnd - r) : strlen(r);
+
+        if(!(rLen == 3 && strncmp(r, "{i}", 3) == 0) &&
+           !(eLen == 1 && *e == '*') &&
+           !(eLen == rLen && strncmp(e, r, eLen) == 0))
+            return false;
+
+        if(!eEnd && !rEnd)
+            return true;
+        if(!eEnd || !rEnd)
+            return false;
+        e = eEnd + 1;
+        r = rEnd + 1;
+        if(*r == '\0' || *e == '\0')
+            return true;
+    }
+}
 
-    RBUSLOG_DEBUG("%s now=%s", __FUNCTION__, rtTime_ToString(&now, tbuff));
+/*true if any of the announced names covers the item's event*/
+static bool rbusAsyncSubscribeRetrier_Covered(AsyncSubscription_t* item, char const* const* names, int numNames)
+{
+    int i;
 
-    if(!li)
+    for(i = 0; i < numNames; ++i)
     {
-        return 0;
+        if(rbusAsyncSubscribeRetrier_NameMatches(item->subscription->eventName, names[i]))
+            return true;
     }
+    return false;
+}
+
+/*called by the thread with the lock held: makes every pending subscription that the
+  names announced since last time cover due now, then forgets the names*/
+static void rbusAsyncSubscribeRetrier_CheckAnnounced(rtTime_t const* now)
+{
+    int woken = 0;
+    int i;
+
+    if(gRetrier->announcedCount == 0 && !gRetrier->announcedOverflow)
+        return;
 
-    while(li)
+    for(i = 0; i < gRetrier->count; ++i)
     {
-        AsyncSubscription_t* item;
-        rtListItem_GetData(li, (void**)&item);
+        AsyncSubscription_t* item = gRetrier->heap[i];
 
-        RBUSLOG_INFO("%s item=%s", __FUNCTION__, rtTime_ToString(&item->nextRetryTime, tbuff));
+        if(rtTime_Compare(&item->nextRetryTime, now) <= 0)
+            continue;
 
-        if(rtTime_Compare(&item->nextRetryTime, nextSendTime) < 0)
+        if(gRetrier->announcedOverflow ||
+           rbusAsyncSubscribeRetrier_Covered(item, (char const* const*)gRetrier->announced, gRetrier->announcedCount))
         {
-          *nextSendTime = item->nextRetryTime;
+            RBUSLOG_INFO("%s: %s provider appeared", __FUNCTION__, item->subscription->eventName);
+            item->nextRetryTime = *now;
+            woken++;
         }
-
-        rtListItem_GetNext(li, &li);
-     }
-
-    //if nextSendTime is past due, return 1 so the caller knows to send requests now
-    if(rtTime_Compare(nextSendTime, &now) <= 0)
+    }
+    if(woken)
     {
-        RBUSLOG_INFO("%s subs past due", __FUNCTION__);
-        return 1;
+        for(i = gRetrier->count / 2 - 1; i >= 0; --i)
+            rbusAsyncSubscribeRetrier_SiftDown(i);
     }
 
-#if 0
-    //add a second to avoid doing a cond_timedwait for less then a second
-    //this will essentially batch all items due between now and this next time
-    rtTime_Later(nextSendTime, 1000, nextSendTime);
-#endif
-    RBUSLOG_INFO("%s subs due in %d miliseconds nextSendTime=%s", __FUNCTION__,
-                rtTime_Elapsed(&now, nextSendTime), 
-                rtTime_ToString(nextSendTime, tbuff));
-
-    return 0;//meaning there's nothing past due currently
+    while(gRetrier->announcedCount > 0)
+        free(gRetrier->announced[--gRetrier->announcedCount]);
+    gRetrier->announcedOverflow = false;
 }
 
-static void rbusAsyncSubscribeRetrier_SendSubscriptionRequests()
+/*called on the connection's reader thread when some provider announces newly registered
+  elements. Only the names are kept here: the retrier thread matches them against the
+  pending subscriptions and sends those they cover as one batch.*/
+static void rbusAsyncSubscribeRetrier_OnElementsAnnounced(rtMessageHeader const* hdr, uint8_t const* data, uint32_t dataLen, void* closure)
 {
-    rtListItem li;
-    rtTime_t now;
+    rbusMessage msg = NULL;
+    int32_t numNames = 0;
+    int i;
 
-    RBUSLOG_DEBUG("%s enter", __FUNCTION__);
+    (void)hdr;
+    (void)closure;
 
-    rtTime_Now(&now);
-
-    rtList_GetFront(gRetrier->items, &li);
+    rbusMessage_FromBytes(&msg, data, dataLen);
+    if(!msg)
+        return;
+    if(rbusMessage_GetInt32(msg, &numNames) != RT_OK || numNames <= 0)
+    {
+        rbusMessage_Release(msg);
+        return;
+    }
 
-    while(li)
+    ERROR_CHECK(pthread_mutex_lock(&gAnnounceMutex));
+    if(!gAnnounceListening)
     {
-        AsyncSubscription_t* item;
+        ERROR_CHECK(pthread_mutex_unlock(&gAnnounceMutex));
+        rbusMessage_Release(msg);
+        return;
+    }
 
-        rtListItem_GetData(li, (void**)&item);
+    LOCK();
+    for(i = 0; i < numNames && !gRetrier->announcedOverflow; ++i)
+    {
+        char const* announcedName = NULL;
+        char* name = NULL;
 
-        if(rtTime_Compare(&item->nextRetryTime, &now) <= 0)
+        if(rbusMessage_GetString(msg, &announcedName) != RT_OK)
+            break;
+        if(gRetrier->announcedCount == gRetrier->announcedCapacity)
         {
-            rbus_error_t coreerr;
-            int elapsed;
-            int providerError;
+            int capacity = gRetrier->announcedCapacity ? gRetrier->announcedCapacity * 2 : 16;
+            char** announced = realloc(gRetrier->announced, capacity * sizeof(char*));
+            if(announced)
+            {
+                gRetrier->announced = announced;
+                gRetrier->announcedCapacity = capacity;
+            }
+        }
+        if(gRetrier->announcedCount < gRetrier->announcedCapacity)
+            name = strdup(announcedName);
+        if(name)
+            gRetrier->announced[gRetrier->announcedCount++] = name;
+        else
+            gRetrier->announcedOverflow = true; /*a name couldn't be kept, so retry everything*/
+    }
+    UNLOCK();
 
-            RBUSLOG_INFO("%s: %s subscribing", __FUNCTION__, item->subscription->eventName);
+    ERROR_CHECK(pthread_cond_signal(&gRetrier->condItemAdded));
+    ERROR_CHECK(pthread_mutex_unlock(&gAnnounceMutex));
 
-            coreerr = rbus_subscribeToEvent(NULL, item->subscription->eventName, 
-                        _event_callback_handler, NULL, item->subscription, &providerError);
+    rbusMessage_Release(msg);
+}
 
-            rtTime_Now(&now);
+/*sends one subscribe request.  returns true when the item is finished, either subscribed
+  or given up on, and false when the provider wasn't found yet and it should be retried*/
+static bool rbusAsyncSubscribeRetrier_SendSubscriptionRequest(AsyncSubscription_t* item)
+{
+    rbus_error_t coreerr;
+    int elapsed;
+    int providerError;
+    rbusMessage payload;
+    rtTime_t now;
+    rbusError_t responseErr;
 
-            elapsed = rtTime_Elapsed(&item->startTime, &now);
+    RBUSLOG_INFO("%s: %s subscribing", __FUNCTION__, item->subscription->eventName);
 
-            if(coreerr == RTMESSAGE_BUS_ERROR_DESTINATION_UNREACHABLE &&  /*the only error that means provider not found yet*/
-             elapsed < rbusConfig_Get()->subscribeTimeout)    /*if we haven't timeout out yet*/
-            {
-                if(item->nextWaitTime == 0)
-                    item->nextWaitTime = 1000; //miliseconds
-                else
-                    item->nextWaitTime *= 2;//just double the time
+    payload = rbusEvent_CreatePayloadEx(item->subscription);
 
-                //apply a limit to our doubling
-                if(item->nextWaitTime > rbusConfig_Get()->subscribeMaxWait)
-                  item->nextWaitTime = rbusConfig_Get()->subscribeMaxWait;
+    coreerr = rbus_subscribeToEvent(NULL, item->subscription->eventName,
+                _event_callback_handler, payload, item->subscription, &providerError);
 
-                //update nextRetryTime to nextWaitTime miliseconds from now, without exceeding subscribeTimeout
-                if(elapsed + item->nextWaitTime < rbusConfig_Get()->subscribeTimeout)
-                {
-                    rtTime_Later(&now, item->nextWaitTime, &item->nextRetryTime);
-                }
-                else
-                {
-                    //its possible to have the odd situation, based on how subscribeTimeout/subscribeMaxWait are configured, 
-                    //where this final retry happens very close to the previous retry (e.g. ... wait 60, sub, wait 60, sub, wait 1, sub)
-                    rtTime_Later(&item->startTime, rbusConfig_Get()->subscribeTimeout, &item->nextRetryTime);
-                }
+    if(payload)
+        rbusMessage_Release(payload);
 
-                RBUSLOG_INFO("%s: %s no provider. retry in %d ms with %d left", 
-                    __FUNCTION__, 
-                    item->subscription->eventName, 
-                    rtTime_Elapsed(&now, &item->nextRetryTime), 
-                    rbusConfig_Get()->subscribeTimeout - elapsed );
-            }
-            else
-            {
-                rbusError_t responseErr;
-                rtListItem tmp;
+    rtTime_Now(&now);
 
-                if(coreerr == RTMESSAGE_BUS_SUCCESS)
-                {
-                    RBUSLOG_INFO("%s: %s subscribe retries succeeded", __FUNCTION__, item->subscription->eventName);
-                    responseErr = RBUS_ERROR_SUCCESS;
-                }
-                else
-                {
-                    if(coreerr == RTMESSAGE_BUS_ERROR_DESTINATION_UNREACHABLE)
-                    {
-                        RBUSLOG_INFO("%s: %s all subscribe retries failed and no provider found", __FUNCTION__, item->subscription->eventName);
-                        RBUSLOG_WARN("EVENT_SUBSCRIPTION_FAIL_NO_PROVIDER_COMPONENT  %s", item->subscription->eventName);/*RDKB-33658-AC7*/
-                        responseErr = RBUS_ERROR_TIMEOUT;
-                    }
-                    else if(providerError != RBUS_ERROR_SUCCESS)
-                    {
-                        RBUSLOG_INFO("%s: %s subscribe retries failed due provider error %d", __FUNCTION__, item->subscription->eventName, providerError);
-                        RBUSLOG_WARN("EVENT_SUBSCRIPTION_FAIL_INVALID_INPUT  %s", item->subscription->eventName);/*RDKB-33658-AC9*/
-                        responseErr = providerError;
-                    }
-                    else
-                    {  
-                        RBUSLOG_INFO("%s: %s subscribe retries failed due to core error %d", __FUNCTION__, item->subscription->eventName, coreerr);
-                        responseErr = RBUS_ERROR_BUS_ERROR;
-                    }
-                }
+    elapsed = rtTime_Elapsed(&item->startTime, &now);
 
-                _subscribe_async_callback_handler(item->subscription->handle, item->subscription, responseErr);
+    if(coreerr == RTMESSAGE_BUS_ERROR_DESTINATION_UNREACHABLE &&  /*the only error that means provider not found yet*/
+     elapsed < rbusConfig_Get()->subscribeTimeout)    /*if we haven't timeout out yet*/
+    {
+        if(item->nextWaitTime == 0)
+            item->nextWaitTime = 1000; //miliseconds
+        else
+            item->nextWaitTime *= 2;//just double the time
 
-                //store the next item, because we are removing this li item from list
-                rtListItem_GetNext(li, &tmp); 
+        //apply a limit to our doubling
+        if(item->nextWaitTime > rbusConfig_Get()->subscribeMaxWait)
+          item->nextWaitTime = rbusConfig_Get()->subscribeMaxWait;
 
-                rtList_RemoveItem(gRetrier->items, li, rtList_Cleanup_Free);
+        //update nextRetryTime to nextWaitTime miliseconds from now, without exceeding subscribeTimeout
+        if(elapsed + item->nextWaitTime < rbusConfig_Get()->subscribeTimeout)
+        {
+            rtTime_Later(&now, item->nextWaitTime, &item->nextRetryTime);
+        }
+        else
+        {
+            //its possible to have the odd situation, based on how subscribeTimeout/subscribeMaxWait are configured,
+            //where this final retry happens very close to the previous retry (e.g. ... wait 60, sub, wait 60, sub, wait 1, sub)
+            rtTime_Later(&item->startTime, rbusConfig_Get()->subscribeTimeout, &item->nextRetryTime);
+        }
+
+        RBUSLOG_INFO("%s: %s no provider. retry in %d ms with %d left",
+            __FUNCTION__,
+            item->subscription->eventName,
+            rtTime_Elapsed(&now, &item->nextRetryTime),
+            rbusConfig_Get()->subscribeTimeout - elapsed );
+        return false;
+    }
 
-                li = tmp;
-                continue;//li is already the next item so avoid GetNext below
-          }
+    if(coreerr == RTMESSAGE_BUS_SUCCESS)
+    {
+        RBUSLOG_INFO("%s: %s subscribe retries succeeded", __FUNCTION__, item->subscription->eventName);
+        responseErr = RBUS_ERROR_SUCCESS;
+    }
+    else
+    {
+        if(coreerr == RTMESSAGE_BUS_ERROR_DESTINATION_UNREACHABLE)
+        {
+            RBUSLOG_INFO("%s: %s all subscribe retries failed and no provider found", __FUNCTION__, item->subscription->eventName);
+            RBUSLOG_WARN("EVENT_SUBSCRIPTION_FAIL_NO_PROVIDER_COMPONENT  %s", item->subscription->eventName);/*RDKB-33658-AC7*/
+            responseErr = RBUS_ERROR_TIMEOUT;
+        }
+        else if(providerError != RBUS_ERROR_SUCCESS)
+        {
+            RBUSLOG_INFO("%s: %s subscribe retries failed due provider error %d", __FUNCTION__, item->subscription->eventName, providerError);
+            RBUSLOG_WARN("EVENT_SUBSCRIPTION_FAIL_INVALID_INPUT  %s", item->subscription->eventName);/*RDKB-33658-AC9*/
+            responseErr = providerError;
+        }
+        else
+        {
+            RBUSLOG_INFO("%s: %s subscribe retries failed due to core error %d", __FUNCTION__, item->subscription->eventName, coreerr);
+            responseErr = RBUS_ERROR_BUS_ERROR;
         }
-        rtListItem_GetNext(li, &li);    
     }
-    RBUSLOG_DEBUG("%s exit", __FUNCTION__);
+
+    _subscribe_async_callback_handler(item->subscription->handle, item->subscription, responseErr);
+    return true;
 }
 
 static void* AsyncSubscribeRetrier_threadFunc(void* data)
 {
+    AsyncSubscription_t** batch = NULL;
+    int batchCapacity = 0;
+
     (void)data;
     LOCK();
     while(gRetrier->isRunning)
     {
+        rtTime_t now;
         rtTime_t nextSendTime;
+        int batchSize = 0;
+        int i;
+
+        rtTime_Now(&now);
+
+        //this is also where names announced while a batch was out of the heap are
+        //checked against it, now that it's back
+        rbusAsyncSubscribeRetrier_CheckAnnounced(&now);
+
+        //take everything that is due in one go
+        while(gRetrier->count > 0 && rtTime_Compare(&gRetrier->heap[0]->nextRetryTime, &now) <= 0)
+        {
+            if(batchSize == batchCapacity)
+            {
+                int capacity = batchCapacity ? batchCapacity * 2 : 16;
+                AsyncSubscription_t** tmp = realloc(batch, capacity * sizeof(AsyncSubscription_t*));
+                if(!tmp)
+                    break;
+                batch = tmp;
+                batchCapacity = capacity;
+            }
+            batch[batchSize++] = rbusAsyncSubscribeRetrier_Pop();
+        }
 
-        while(rbusAsyncSubscribeRetrier_DetermineNextSendTime(&nextSendTime))
+        if(batchSize > 0)
         {
+            RBUSLOG_DEBUG("%s sending %d subscriptions", __FUNCTION__, batchSize);
+            gRetrier->isSending = true;
             UNLOCK();
-            rbusAsyncSubscribeRetrier_SendSubscriptionRequests();
+            for(i = 0; i < batchSize; ++i)
+            {
+                if(rbusAsyncSubscribeRetrier_SendSubscriptionRequest(batch[i]))
+                {
+                    free(batch[i]);
+                    batch[i] = NULL;
+                }
+            }
             LOCK();
+            for(i = 0; i < batchSize; ++i)
+            {
+                if(batch[i])
+                    rbusAsyncSubscribeRetrier_Push(batch[i]);
+            }
+            gRetrier->isSending = false;
+            ERROR_CHECK(pthread_cond_broadcast(&gRetrier->condIdle));
+            continue;
         }
 
+        if(gRetrier->count > 0)
+            nextSendTime = gRetrier->heap[0]->nextRetryTime;
+        else
+            rtTime_Later(&now, rbusConfig_Get()->subscribeMaxWait + 1000, &nextSendTime);
+
         if(gRetrier->isRunning)
         {
             char tbuff[200];
@@ -248,7 +432,7 @@ static void* AsyncSubscribeRetrier_threadFunc(void* data)
             int err;
 
             RBUSLOG_DEBUG("%s timedwait until %s", __FUNCTION__, rtTime_ToString(&nextSendTime, tbuff));
- 
+
             err = pthread_cond_timedwait(&gRetrier->condItemAdded,
                                          &gRetrier->mutexQueue,
                                          rtTime_ToTimespec(&nextSendTime, &ts));
@@ -258,11 +442,12 @@ static void* AsyncSubscribeRetrier_threadFunc(void* data)
             }
 
             RBUSLOG_DEBUG("%s waked up", __FUNCTION__);
-            //either we timed out or a new subscription was added
+            //either we timed out, a new subscription was added or a provider appeared
             //in either case, loop back to top and things will get handled properly
         }
     }
     UNLOCK();
+    free(batch);
     return NULL;
 }
 
@@ -270,26 +455,37 @@ static void rbusAsyncSubscribeRetrier_Create()
 {
     pthread_mutexattr_t mattrib;
     pthread_condattr_t cattrib;
+    rtError err;
 
     RBUSLOG_INFO("%s enter", __FUNCTION__);
 
-    gRetrier = malloc(sizeof(struct AsyncSubscribeRetrier_t));
+    gRetrier = calloc(1, sizeof(struct AsyncSubscribeRetrier_t));
 
     gRetrier->isRunning = true;
-    rtList_Create(&gRetrier->items);
 
     ERROR_CHECK(pthread_mutexattr_init(&mattrib));
     ERROR_CHECK(pthread_mutexattr_settype(&mattrib, PTHREAD_MUTEX_ERRORCHECK));
-    ERROR_CHECK(pthread_mutex_init(&gRetrier->mutexQueue, &mattrib));  
+    ERROR_CHECK(pthread_mutex_init(&gRetrier->mutexQueue, &mattrib));
     ERROR_CHECK(pthread_mutexattr_destroy(&mattrib));
 
     ERROR_CHECK(pthread_condattr_init(&cattrib));
     ERROR_CHECK(pthread_condattr_setclock(&cattrib, CLOCK_MONOTONIC));
     ERROR_CHECK(pthread_cond_init(&gRetrier->condItemAdded, &cattrib));
+    ERROR_CHECK(pthread_cond_init(&gRetrier->condIdle, &cattrib));
     ERROR_CHECK(pthread_condattr_destroy(&cattrib));
 
     ERROR_CHECK(pthread_create(&gRetrier->threadId, NULL, AsyncSubscribeRetrier_threadFunc, NULL));
 
+    ERROR_CHECK(pthread_mutex_lock(&gAnnounceMutex));
+    gAnnounceListening = true;
+    ERROR_CHECK(pthread_mutex_unlock(&gAnnounceMutex));
+
+    if((err = rtConnection_AddListener(rbus_getConnection(), RBUS_ELEMENTS_ANNOUNCE_TOPIC,
+            rbusAsyncSubscribeRetrier_OnElementsAnnounced, NULL)) != RT_OK)
+    {
+        RBUSLOG_WARN("%s: failed to listen for provider announcements: %s, falling back to polling", __FUNCTION__, rtStrError(err));
+    }
+
     RBUSLOG_INFO("%s exit", __FUNCTION__);
 }
 
@@ -297,6 +493,13 @@ static void rbusAsyncSubscribeRetrier_Destroy()
 {
     RBUSLOG_INFO("%s enter", __FUNCTION__);
 
+    rtConnection_RemoveListener(rbus_getConnection(), RBUS_ELEMENTS_ANNOUNCE_TOPIC);
+
+    //a callback already running on the reader thread finishes before this returns
+    ERROR_CHECK(pthread_mutex_lock(&gAnnounceMutex));
+    gAnnounceListening = false;
+    ERROR_CHECK(pthread_mutex_unlock(&gAnnounceMutex));
+
     LOCK();
     gRetrier->isRunning = false;
     UNLOCK();
@@ -307,7 +510,13 @@ static void rbusAsyncSubscribeRetrier_Destroy()
 
     ERROR_CHECK(pthread_mutex_destroy(&gRetrier->mutexQueue));
     ERROR_CHECK(pthread_cond_destroy(&gRetrier->condItemAdded));
-    rtList_Destroy(gRetrier->items, rtList_Cleanup_Free);
+    ERROR_CHECK(pthread_cond_destroy(&gRetrier->condIdle));
+    while(gRetrier->count > 0)
+        free(gRetrier->heap[--gRetrier->count]);
+    free(gRetrier->heap);
+    while(gRetrier->announcedCount > 0)
+        free(gRetrier->announced[--gRetrier->announcedCount]);
+    free(gRetrier->announced);
 
     free(gRetrier);
     gRetrier = NULL;
@@ -336,7 +545,7 @@ void rbusAsyncSubscribe_AddSubscription(rbusEventSubscription_t* subscription)
     RBUSLOG_INFO("%s %s %s", __FUNCTION__, subscription->eventName, rtTime_ToString(&item->startTime, tbuff));
 
     LOCK();
-    rtList_PushBack(gRetrier->items, item, NULL);
+    rbusAsyncSubscribeRetrier_Push(item);
     UNLOCK();
 
     //wake up worker thread so it can process new item
@@ -344,21 +553,32 @@ void rbusAsyncSubscribe_AddSubscription(rbusEventSubscription_t* subscription)
     (void)rc;
 }
 
-#if 0
-void rbusAsyncSubscribe_RemoveSubscription(rbusEventSubscription_t* subscription)
+void rbusAsyncSubscribe_AnnounceElements(rbusHandle_t handle, int numElements, char const** names)
 {
-    LOCK();
-
-    rtList_RemoveItemByCompare(gRetrier->items, subscription, 
-        rbusAsyncSubscribeRetrier_CompareSubscription, rtList_Cleanup_Free);
-
-    UNLOCK();
+    struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
+    rbusMessage msg;
+    uint8_t* data = NULL;
+    uint32_t dataLen = 0;
+    rtError err;
+    int i;
+
+    rbusMessage_Init(&msg);
+    rbusMessage_SetInt32(msg, numElements);
+    for(i = 0; i < numElements; ++i)
+        rbusMessage_SetString(msg, names[i]);
+    rbusMessage_ToBytes(msg, &data, &dataLen);
+
+    if((err = rtConnection_SendBinary(handleInfo->connection, data, dataLen, RBUS_ELEMENTS_ANNOUNCE_TOPIC)) != RT_OK)
+    {
+        RBUSLOG_DEBUG("%s: rtConnection_SendBinary:%s", __FUNCTION__, rtStrError(err));
+    }
+    rbusMessage_Release(msg);
 }
-#endif
 
 void rbusAsyncSubscribe_CloseHandle(rbusHandle_t handle)
 {
-    size_t size;
+    int size;
+    int i, j;
 
     if(!gRetrier)
         return;
@@ -367,16 +587,30 @@ void rbusAsyncSubscribe_CloseHandle(rbusHandle_t handle)
 
     LOCK();
 
-    //remove all items with this handle
-    rtList_RemoveItemByCompare(gRetrier->items, handle, 
-                             rbusAsyncSubscribeRetrier_CompareHandle, rtList_Cleanup_Free);
+    //let a batch that is being sent finish, it may hold items with this handle
+    while(gRetrier->isSending && !pthread_equal(pthread_self(), gRetrier->threadId))
+        ERROR_CHECK(pthread_cond_wait(&gRetrier->condIdle, &gRetrier->mutexQueue));
+
+    //remove all items with this handle and restore the heap
+    for(i = 0, j = 0; i < gRetrier->count; ++i)
+    {
+        if(gRetrier->heap[i]->subscription->handle == handle)
+        {
+            free(gRetrier->heap[i]);
+            continue;
+        }
+        gRetrier->heap[j++] = gRetrier->heap[i];
+    }
+    gRetrier->count = j;
+    for(i = gRetrier->count / 2 - 1; i >= 0; --i)
+        rbusAsyncSubscribeRetrier_SiftDown(i);
 
-    //if list is empty, we can destruct
-    rtList_GetSize(gRetrier->items, &size);
+    //if heap is empty, we can destruct
+    size = gRetrier->count;
 
     UNLOCK();
 
-    if(size == 0)
+    if(size == 0 && !pthread_equal(pthread_self(), gRetrier->threadId))
     {
         RBUSLOG_INFO("%s all handles removed", __FUNCTION__);
         rbusAsyncSubscribeRetrier_Destroy();
@@ -26,8 +26,13 @@
 extern "C" {
 #endif
 
+/*providers announce newly registered elements on this topic so consumers waiting
+  on them can retry their async subscriptions right away instead of on backoff*/
+#define RBUS_ELEMENTS_ANNOUNCE_TOPIC "_rbus.elements.registered"
+
 void rbusAsyncSubscribe_AddSubscription(rbusEventSubscription_t* subscription);
 void rbusAsyncSubscribe_RemoveSubscription(rbusEventSubscription_t* subscription);
+void rbusAsyncSubscribe_AnnounceElements(rbusHandle_t handle, int numElements, char const** names);
 void rbusAsyncSubscribe_CloseHandle(rbusHandle_t handle);
 
 #ifdef __cplusplus
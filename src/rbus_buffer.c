@@ -114,7 +114,10 @@ void rbusBuffer_Reserve(rbusBuffer_t buff, int len)
     int posNext = buff->posWrite+len;
     if(posNext > buff->lenAlloc)
     {
+        /*at least double so that encoding a large message doesn't realloc every block*/
         buff->lenAlloc = (posNext/BUFFER_BLOCK_SIZE+1)*BUFFER_BLOCK_SIZE;
+        if(buff->lenAlloc < 2*buff->posWrite)
+            buff->lenAlloc = (2*buff->posWrite/BUFFER_BLOCK_SIZE+1)*BUFFER_BLOCK_SIZE;
         if(buff->data == buff->block1)
         {
             buff->data = malloc(buff->lenAlloc);
@@ -138,7 +141,14 @@ void rbusBuffer_WriteTypeLengthValue(
   uint16_t lelength = rbusHostToLittleInt16(length);
   rbusBuffer_Write(buff, &letype, sizeof(uint16_t));
   rbusBuffer_Write(buff, &lelength, sizeof(uint16_t));
-  rbusBuffer_Write(buff, value, length);
+  if(length)
+    rbusBuffer_Write(buff, value, length);
+}
+
+void rbusBuffer_WriteUInt16(rbusBuffer_t buff, uint16_t u16)
+{
+    uint16_t temp = rbusHostToLittleInt16(u16);
+    rbusBuffer_Write(buff, &temp, sizeof(uint16_t));
 }
 
 void rbusBuffer_WriteStringTLV(rbusBuffer_t buff, char const* s, int len)
@@ -248,7 +258,7 @@ void rbusBuffer_WriteBytesTLV(rbusBuffer_t buff, uint8_t* bytes, int len)
 
 int rbusBuffer_Read(rbusBuffer_t const buff, void* data, int len)
 {
-    if(!(buff->posRead + len < buff->lenAlloc))
+    if(!(buff->posRead + len <= buff->lenAlloc))
     {
         RBUSLOG_WARN("rbusBuffer_Read failed");
         return -1;
@@ -258,6 +268,49 @@ int rbusBuffer_Read(rbusBuffer_t const buff, void* data, int len)
     return 0;
 }
 
+int rbusBuffer_ReadTypeLength(rbusBuffer_t const buff, uint16_t* type, uint16_t* length)
+{
+    if(rbusBuffer_ReadUInt16(buff, type) < 0 || rbusBuffer_ReadUInt16(buff, length) < 0)
+        return -1;
+    if(!(buff->posRead + *length <= buff->lenAlloc))
+    {
+        RBUSLOG_WARN("rbusBuffer_ReadTypeLength failed");
+        return -1;
+    }
+    return 0;
+}
+
+int rbusBuffer_ReadInt32TLV(rbusBuffer_t const buff, int32_t* i32)
+{
+    uint16_t type;
+    uint16_t length;
+    if(rbusBuffer_ReadTypeLength(buff, &type, &length) < 0)
+        return -1;
+    if(!(type == RBUS_INT32 && length == sizeof(int32_t)))
+    {
+        RBUSLOG_WARN("rbusBuffer_ReadInt32TLV failed");
+        return -1;
+    }
+    return rbusBuffer_ReadInt32(buff, i32);
+}
+
+int rbusBuffer_ReadStringTLV(rbusBuffer_t const buff, char const** s)
+{
+    uint16_t type;
+    uint16_t length;
+    if(rbusBuffer_ReadTypeLength(buff, &type, &length) < 0)
+        return -1;
+    /*length includes the null terminator, so an empty TLV is a NULL string*/
+    if(type != RBUS_STRING || (length > 0 && buff->data[buff->posRead + length - 1] != '\0'))
+    {
+        RBUSLOG_WARN("rbusBuffer_ReadStringTLV failed");
+        return -1;
+    }
+    *s = length > 0 ? (char const*)buff->data + buff->posRead : NULL;
+    buff->posRead += length;
+    return 0;
+}
+
 int rbusBuffer_ReadString(rbusBuffer_t const buff, char** s, int* len)
 {
     *len = buff->posRead;
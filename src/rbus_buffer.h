@@ -45,10 +45,33 @@ void rbusValue_SetTLV(rbusValue_t v, rbusValueType_t type, uint32_t length, void
 /*Decode/Encode can be used once we disable message pack and change ccsp
     Currently we push/pop name, type, value separately with rtMessage.
     This will change where we pass the rbusBuffer_t raw binary to the socket
-    and that will require changes in ccsp_base_api/message_bus I imagine
+    and that will require changes in ccsp_base_api/message_bus I imagine.
+    Get responses already carry their properties as a single Encode'd blob when
+    the consumer asks for it, see GET_OPTION_BINARY in rbus.c
 */
 int rbusValue_Decode(rbusValue_t* value, rbusBuffer_t const buff);
-void rbusValue_Encode(rbusValue_t value, rbusBuffer_t buff);
+int rbusValue_Encode(rbusValue_t value, rbusBuffer_t buff);
+
+/*Encode returns -1 if something can't fit a TLV (a string or bytes longer than 64K),
+  in which case the caller must fall back to rbusMessage.
+  Decode returns -1 on malformed or truncated input and leaves nothing to release.*/
+int rbusProperty_Encode(rbusProperty_t property, rbusBuffer_t buff);
+int rbusProperty_Decode(rbusProperty_t* property, rbusBuffer_t const buff);
+int rbusPropertyList_Encode(rbusProperty_t first, rbusBuffer_t buff);
+int rbusPropertyList_Decode(rbusProperty_t* first, rbusBuffer_t const buff);
+/*Relative encoding sends a name as the length of the prefix it shares with the previous name, starting
+  from base, and the remaining suffix. Decoded names are only rebuilt when rbusProperty_GetName is called.*/
+int rbusProperty_EncodeRelative(rbusProperty_t property, char const* previous, rbusBuffer_t buff);
+int rbusPropertyList_DecodeRelative(rbusProperty_t* first, int count, char const* base, rbusBuffer_t const buff);
+int rbusObject_Encode(rbusObject_t object, rbusBuffer_t buff);
+int rbusObject_Decode(rbusObject_t* object, rbusBuffer_t const buff);
+/*Objects and property lists inside values are decoded recursively, so input nested deeper than
+  RBUS_DECODE_MAX_DEPTH fails to decode instead of exhausting the stack.  The Decode functions
+  above start at depth 0, the Nested ones continue from inside something depth levels deep*/
+#define RBUS_DECODE_MAX_DEPTH 32
+int rbusValue_DecodeNested(rbusValue_t* value, rbusBuffer_t const buff, int depth);
+int rbusPropertyList_DecodeNested(rbusProperty_t* first, rbusBuffer_t const buff, int depth);
+int rbusObject_DecodeNested(rbusObject_t* object, rbusBuffer_t const buff, int depth);
 
 void rbusFilter_Encode(rbusFilter_t filter, rbusBuffer_t buff);
 int rbusFilter_Decode(rbusFilter_t* filter, rbusBuffer_t const buff);
@@ -57,6 +80,7 @@ void rbusBuffer_Create(rbusBuffer_t* buff);
 void rbusBuffer_Destroy(rbusBuffer_t buff);
 void rbusBuffer_Reserve(rbusBuffer_t buff, int len);
 void rbusBuffer_Write(rbusBuffer_t buff, void const* data, int len);
+void rbusBuffer_WriteUInt16(rbusBuffer_t buff, uint16_t u16);
 void rbusBuffer_WriteTypeLengthValue(rbusBuffer_t buff, rbusValueType_t type, uint16_t length, void const* value);
 void rbusBuffer_WriteBooleanTLV(rbusBuffer_t buff, bool b);
 void rbusBuffer_WriteCharTLV(rbusBuffer_t buff, char c);
@@ -92,6 +116,9 @@ int rbusBuffer_ReadDouble(rbusBuffer_t const buff, double* f64);
 int rbusBuffer_ReadString(rbusBuffer_t const buff, char** s, int* len);/* caller must free *s */
 int rbusBuffer_ReadDateTime(rbusBuffer_t const buff, rbusDateTime_t* tv);
 int rbusBuffer_ReadBytes(rbusBuffer_t const buff, uint8_t** bytes, int* len);/* caller must free *bytes */
+int rbusBuffer_ReadTypeLength(rbusBuffer_t const buff, uint16_t* type, uint16_t* length);/* also checks length bytes follow */
+int rbusBuffer_ReadInt32TLV(rbusBuffer_t const buff, int32_t* i32);
+int rbusBuffer_ReadStringTLV(rbusBuffer_t const buff, char const** s);/* *s points into buff and is not copied */
 
 #ifdef __cplusplus
 }
@@ -1,60 +1,297 @@
 #include "rbus_config.h"
+#include "rbus_handle.h"
 #include "rbus_log.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
 
 /* These RBUS_* defines are the list of config settings with their default values
- * Each can be overridden using an environment variable of the same name
+ * Each can be overridden in the file named by the RBUS_CONFIG_FILE environment variable,
+ * then by an environment variable of the same name, and later by rbus_setConfig
  */
 #define RBUS_TMP_DIRECTORY      "/tmp"      /*temp directory where persistent data can be stored*/
 #define RBUS_SUBSCRIBE_TIMEOUT   600000     /*subscribe retry timeout in miliseconds*/
 #define RBUS_SUBSCRIBE_MAXWAIT   60000      /*subscribe retry max wait between retries in miliseconds*/
 #define RBUS_VALUECHANGE_PERIOD  2000       /*polling period for valuechange detector*/
+#define RBUS_SHM_THRESHOLD       65536      /*min size of a message sent through shared memory*/
+#define RBUS_SHM_LINGER          10000      /*time an unconfirmed shared memory message stays available in miliseconds*/
+#define RBUS_REG_ELEMENTS_THREADS 4         /*threads registering elements with the broker*/
+#define RBUS_SUBSCRIBE_THREADS   8          /*threads sending the subscriptions of rbusEvent_SubscribeEx*/
+#define RBUS_DELIVERY_QUEUE_DEPTH 1024      /*default queue depth per delivery thread*/
+#define RBUS_SEND_WINDOW         8          /*initial number of pending rbusMessage_SendAsync messages*/
 
-#define initStr(P,N) \
-{ \
-    char* V = getenv(#N); \
-    P=strdup((V && strlen(V)) ? V : N); \
-    RBUSLOG_DEBUG(#N"=%s",P); \
+#define CONFIG_LINE_MAX          1024
+
+typedef struct
+{
+    char const*     name;
+    size_t          offset;
+    int             minValue;
+    int             maxValue;
+} rbusConfigSettingInfo_t;
+
+#define INT_SETTING(N,F,MIN,MAX) { #N, offsetof(rbusConfig_t, F), MIN, MAX }
+
+/*indexed by rbusConfigSetting_t; maxValue 0 marks the string setting*/
+static rbusConfigSettingInfo_t const gSettings[RBUS_CONFIG_MAX] =
+{
+    [RBUS_CONFIG_TMP_DIRECTORY]         = { "RBUS_TMP_DIRECTORY", offsetof(rbusConfig_t, tmpDir), 0, 0 },
+    [RBUS_CONFIG_SUBSCRIBE_TIMEOUT]     = INT_SETTING(RBUS_SUBSCRIBE_TIMEOUT,    subscribeTimeout,   0, INT_MAX),
+    [RBUS_CONFIG_SUBSCRIBE_MAXWAIT]     = INT_SETTING(RBUS_SUBSCRIBE_MAXWAIT,    subscribeMaxWait,   0, INT_MAX),
+    [RBUS_CONFIG_VALUECHANGE_PERIOD]    = INT_SETTING(RBUS_VALUECHANGE_PERIOD,   valueChangePeriod,  1, INT_MAX),
+    [RBUS_CONFIG_SHM_THRESHOLD]         = INT_SETTING(RBUS_SHM_THRESHOLD,        shmThreshold,       0, INT_MAX),
+    [RBUS_CONFIG_SHM_LINGER]            = INT_SETTING(RBUS_SHM_LINGER,           shmLinger,          0, INT_MAX),
+    [RBUS_CONFIG_REG_ELEMENTS_THREADS]  = INT_SETTING(RBUS_REG_ELEMENTS_THREADS, regElementsThreads, 1, RBUS_REG_ELEMENTS_THREADS_MAX),
+    [RBUS_CONFIG_SUBSCRIBE_THREADS]     = INT_SETTING(RBUS_SUBSCRIBE_THREADS,    subscribeThreads,   1, RBUS_SUBSCRIBE_THREADS_MAX),
+    [RBUS_CONFIG_DELIVERY_QUEUE_DEPTH]  = INT_SETTING(RBUS_DELIVERY_QUEUE_DEPTH, deliveryQueueDepth, 1, INT_MAX),
+    [RBUS_CONFIG_SEND_WINDOW]           = INT_SETTING(RBUS_SEND_WINDOW,          sendWindow,         1, RBUS_SEND_WINDOW_MAX)
+};
+
+/*loaded once and kept for the whole process, so settings changed at runtime survive
+  the last handle being closed and rbusConfig_Get never returns freed memory*/
+static rbusConfig_t gConfigData;
+static rbusConfig_t* const gConfig = &gConfigData;
+static bool gConfigLoaded = false;
+
+/*serializes loading and updates; readers of the integer settings don't lock*/
+static pthread_mutex_t gConfigMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int* rbusConfig_IntPtr(rbusConfigSetting_t setting)
+{
+    return (int*)((char*)gConfig + gSettings[setting].offset);
+}
+
+static bool rbusConfig_ParseInt(rbusConfigSetting_t setting, char const* s, int* value)
+{
+    char* end;
+    long n;
+
+    errno = 0;
+    n = strtol(s, &end, 10);
+    if(end == s || *end || errno == ERANGE || n < gSettings[setting].minValue || n > gSettings[setting].maxValue)
+        return false;
+    *value = (int)n;
+    return true;
 }
 
-#define initInt(P,N) \
-{ \
-    char* V = getenv(#N); \
-    P=((V && strlen(V)) ? atoi(V) : N); \
-    RBUSLOG_DEBUG(#N"=%d",P); \
+/*called with gConfigMutex held*/
+static rbusError_t rbusConfig_SetLocked(rbusConfigSetting_t setting, char const* s)
+{
+    if(gSettings[setting].maxValue == 0)
+    {
+        char* tmpDir;
+
+        /*rbus_open copies the directory, so it may only change while nothing can be reading it*/
+        if(rbusHandle_Count() > 0)
+        {
+            RBUSLOG_WARN("%s can't be changed while an rbus handle is open", gSettings[setting].name);
+            return RBUS_ERROR_INVALID_OPERATION;
+        }
+        if(!*s)
+            return RBUS_ERROR_INVALID_INPUT;
+        if(!(tmpDir = strdup(s)))
+            return RBUS_ERROR_OUT_OF_RESOURCES;
+        free(gConfig->tmpDir);
+        gConfig->tmpDir = tmpDir;
+        RBUSLOG_DEBUG("%s=%s", gSettings[setting].name, s);
+    }
+    else
+    {
+        int value;
+        if(!rbusConfig_ParseInt(setting, s, &value))
+        {
+            RBUSLOG_WARN("invalid value %s for %s", s, gSettings[setting].name);
+            return RBUS_ERROR_INVALID_INPUT;
+        }
+        __atomic_store_n(rbusConfig_IntPtr(setting), value, __ATOMIC_RELAXED);
+        RBUSLOG_DEBUG("%s=%d", gSettings[setting].name, value);
+    }
+    return RBUS_ERROR_SUCCESS;
 }
 
-static rbusConfig_t* gConfig = NULL;
+static rbusConfigSetting_t rbusConfig_FindSetting(char const* name)
+{
+    int i;
+    for(i = 0; i < RBUS_CONFIG_MAX; i++)
+    {
+        if(strcmp(gSettings[i].name, name) == 0)
+            break;
+    }
+    return (rbusConfigSetting_t)i;
+}
 
-void rbusConfig_CreateOnce()
+/*Each line is NAME=value using the names of the RBUS_* defines above.  Blank lines
+  and lines starting with # are skipped.  Called with gConfigMutex held.*/
+static rbusError_t rbusConfig_LoadLocked(char const* filePath)
 {
-    if(gConfig)
-        return;
+    char line[CONFIG_LINE_MAX];
+    rbusError_t rc = RBUS_ERROR_SUCCESS;
+    int lineNum = 0;
+    FILE* file;
 
-    RBUSLOG_DEBUG("%s", __FUNCTION__);
+    if(!(file = fopen(filePath, "r")))
+    {
+        RBUSLOG_WARN("failed to open config file %s: %s", filePath, strerror(errno));
+        return RBUS_ERROR_INVALID_INPUT;
+    }
+
+    while(fgets(line, sizeof(line), file))
+    {
+        char* name = line;
+        char* value;
+        char* end;
+        rbusConfigSetting_t setting;
+
+        lineNum++;
+        while(isspace((unsigned char)*name))
+            name++;
+        if(!*name || *name == '#')
+            continue;
 
-    gConfig = malloc(sizeof(struct _rbusConfig_t));
+        if(!(value = strchr(name, '=')))
+        {
+            RBUSLOG_WARN("%s:%d: expected NAME=value", filePath, lineNum);
+            rc = RBUS_ERROR_INVALID_INPUT;
+            continue;
+        }
+        for(end = value; end > name && isspace((unsigned char)end[-1]); end--);
+        *end = 0;
+        for(value++; isspace((unsigned char)*value); value++);
+        for(end = value + strlen(value); end > value && isspace((unsigned char)end[-1]); end--);
+        *end = 0;
 
-    initStr(gConfig->tmpDir,                RBUS_TMP_DIRECTORY);
-    initInt(gConfig->subscribeTimeout,      RBUS_SUBSCRIBE_TIMEOUT);
-    initInt(gConfig->subscribeMaxWait,      RBUS_SUBSCRIBE_MAXWAIT);
-    initInt(gConfig->valueChangePeriod,     RBUS_VALUECHANGE_PERIOD);
+        if((setting = rbusConfig_FindSetting(name)) == RBUS_CONFIG_MAX)
+        {
+            RBUSLOG_WARN("%s:%d: unknown setting %s", filePath, lineNum, name);
+            rc = RBUS_ERROR_INVALID_INPUT;
+        }
+        else if(rbusConfig_SetLocked(setting, value) != RBUS_ERROR_SUCCESS)
+        {
+            rc = RBUS_ERROR_INVALID_INPUT;
+        }
+    }
+    fclose(file);
+    return rc;
 }
 
-void rbusConfig_Destroy()
+/*called with gConfigMutex held*/
+static void rbusConfig_CreateLocked()
 {
-    if(!gConfig)
+    static int const defaults[RBUS_CONFIG_MAX] =
+    {
+        [RBUS_CONFIG_SUBSCRIBE_TIMEOUT]     = RBUS_SUBSCRIBE_TIMEOUT,
+        [RBUS_CONFIG_SUBSCRIBE_MAXWAIT]     = RBUS_SUBSCRIBE_MAXWAIT,
+        [RBUS_CONFIG_VALUECHANGE_PERIOD]    = RBUS_VALUECHANGE_PERIOD,
+        [RBUS_CONFIG_SHM_THRESHOLD]         = RBUS_SHM_THRESHOLD,
+        [RBUS_CONFIG_SHM_LINGER]            = RBUS_SHM_LINGER,
+        [RBUS_CONFIG_REG_ELEMENTS_THREADS]  = RBUS_REG_ELEMENTS_THREADS,
+        [RBUS_CONFIG_SUBSCRIBE_THREADS]     = RBUS_SUBSCRIBE_THREADS,
+        [RBUS_CONFIG_DELIVERY_QUEUE_DEPTH]  = RBUS_DELIVERY_QUEUE_DEPTH,
+        [RBUS_CONFIG_SEND_WINDOW]           = RBUS_SEND_WINDOW
+    };
+    char const* filePath;
+    char* tmpDir;
+    int i;
+
+    if(gConfigLoaded)
         return;
 
     RBUSLOG_DEBUG("%s", __FUNCTION__);
 
-    free(gConfig->tmpDir);
-    free(gConfig);
-    gConfig = NULL;
+    if((tmpDir = strdup(RBUS_TMP_DIRECTORY)) != NULL)
+        gConfig->tmpDir = tmpDir;
+    for(i = 0; i < RBUS_CONFIG_MAX; i++)
+    {
+        if(gSettings[i].maxValue != 0)
+            __atomic_store_n(rbusConfig_IntPtr((rbusConfigSetting_t)i), defaults[i], __ATOMIC_RELAXED);
+    }
+    gConfigLoaded = true;
+
+    if((filePath = getenv("RBUS_CONFIG_FILE")) && strlen(filePath))
+        rbusConfig_LoadLocked(filePath);
+
+    for(i = 0; i < RBUS_CONFIG_MAX; i++)
+    {
+        char* V = getenv(gSettings[i].name);
+        if(V && strlen(V))
+            rbusConfig_SetLocked((rbusConfigSetting_t)i, V);
+    }
+}
+
+void rbusConfig_CreateOnce()
+{
+    pthread_mutex_lock(&gConfigMutex);
+    rbusConfig_CreateLocked();
+    pthread_mutex_unlock(&gConfigMutex);
 }
 
 rbusConfig_t* rbusConfig_Get()
 {
     return gConfig;
 }
+
+rbusError_t rbus_setConfig(rbusConfigSetting_t setting, rbusValue_t value)
+{
+    char buf[RBUS_VALUE_FORMAT_MAX];
+    char const* s = buf;
+    rbusError_t rc;
+
+    if((int)setting < 0 || setting >= RBUS_CONFIG_MAX || !value)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    if(rbusValue_GetType(value) == RBUS_STRING)
+    {
+        s = rbusValue_GetString(value, NULL);
+        if(!s)
+            return RBUS_ERROR_INVALID_INPUT;
+    }
+    else if(gSettings[setting].maxValue == 0 ||
+            rbusValue_GetType(value) == RBUS_BOOLEAN || rbusValue_GetType(value) == RBUS_CHAR ||
+            rbusValue_GetType(value) == RBUS_SINGLE || rbusValue_GetType(value) == RBUS_DOUBLE ||
+            rbusValue_Format(value, buf, sizeof(buf)) < 0)
+    {
+        /*integer settings take any integer type, formatted and parsed like the config file*/
+        return RBUS_ERROR_INVALID_INPUT;
+    }
+
+    pthread_mutex_lock(&gConfigMutex);
+    rbusConfig_CreateLocked();
+    rc = rbusConfig_SetLocked(setting, s);
+    pthread_mutex_unlock(&gConfigMutex);
+    return rc;
+}
+
+rbusError_t rbus_getConfig(rbusConfigSetting_t setting, rbusValue_t* value)
+{
+    if((int)setting < 0 || setting >= RBUS_CONFIG_MAX || !value)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    rbusValue_Init(value);
+    pthread_mutex_lock(&gConfigMutex);
+    rbusConfig_CreateLocked();
+    if(gSettings[setting].maxValue == 0)
+        rbusValue_SetString(*value, gConfig->tmpDir);
+    else
+        rbusValue_SetInt32(*value, __atomic_load_n(rbusConfig_IntPtr(setting), __ATOMIC_RELAXED));
+    pthread_mutex_unlock(&gConfigMutex);
+    return RBUS_ERROR_SUCCESS;
+}
+
+rbusError_t rbus_loadConfig(char const* filePath)
+{
+    rbusError_t rc;
+
+    if(!filePath)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    pthread_mutex_lock(&gConfigMutex);
+    rbusConfig_CreateLocked();
+    rc = rbusConfig_LoadLocked(filePath);
+    pthread_mutex_unlock(&gConfigMutex);
+    return rc;
+}
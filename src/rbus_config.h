@@ -26,16 +26,27 @@
 extern "C" {
 #endif
 
+#define RBUS_REG_ELEMENTS_THREADS_MAX   16  /*upper limit of regElementsThreads*/
+#define RBUS_SUBSCRIBE_THREADS_MAX      16  /*upper limit of subscribeThreads*/
+#define RBUS_SEND_WINDOW_MAX            64  /*upper limit of sendWindow and rbusMessage_SetSendWindow*/
+
+/*Integer settings may be changed by rbus_setConfig while rbus runs, so they are
+  read where they are used instead of being copied*/
 typedef struct _rbusConfig_t
 {
     char*           tmpDir;           /*temp directory where rbus can persist data*/
     int             subscribeTimeout; /*max time to attempt subscribe retries in milisecond*/
     int             subscribeMaxWait; /*max time to wait between subscribe retries in miliseconds*/
     int             valueChangePeriod;/*polling period for valuechange detector in miliseconds*/
+    int             shmThreshold;     /*min message size in bytes to send with RBUS_MESSAGE_SHARED_MEMORY through shared memory*/
+    int             shmLinger;        /*time in miliseconds a shared memory message stays available if receipt isn't confirmed*/
+    int             regElementsThreads;/*threads registering elements with the broker in rbus_regDataElements*/
+    int             subscribeThreads; /*threads sending the subscriptions of rbusEvent_SubscribeEx*/
+    int             deliveryQueueDepth;/*default queue depth of rbus_setDeliveryThreads*/
+    int             sendWindow;       /*initial window of rbusMessage_SendAsync*/
 } rbusConfig_t;
 
 void rbusConfig_CreateOnce();
-void rbusConfig_Destroy();
 rbusConfig_t* rbusConfig_Get();
 
 #ifdef __cplusplus
@@ -0,0 +1,425 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include "rbus_delivery.h"
+#include "rbus_handle.h"
+#include "rbus_config.h"
+#include "rbus_log.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#define DELIVERY_THREADS_MAX 32
+
+typedef struct _rbusDeliveryItem
+{
+    void const*                 key;
+    rbusDeliveryFunc_t          run;
+    rbusDeliveryFunc_t          release;
+    void*                       arg;
+    struct _rbusDeliveryItem*   next;
+} rbusDeliveryItem_t;
+
+/*Each key hashes to one worker, so the work of a key runs in order on one thread
+  while different keys spread across the threads.  Each worker has its own bounded
+  queue so one slow key only backs up the keys sharing its worker.*/
+typedef struct
+{
+    pthread_t               thread;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          condQueued;
+    pthread_cond_t          condIdle;
+    rbusDeliveryItem_t*     head;
+    rbusDeliveryItem_t*     tail;
+    int                     count;
+    void const*             runningKey;
+    rbusDeliveryItem_t*     deferred;   /*releases waiting for the running work to finish*/
+    bool                    closing;
+    struct _rbusDelivery*   freeOnExit; /*closed from this thread's work, so it frees the pool*/
+    uint64_t                delivered;
+    uint64_t                dropped;
+    uint32_t                maxQueued;
+} rbusDeliveryWorker_t;
+
+struct _rbusDelivery
+{
+    int                     numWorkers;
+    int                     queueDepth;
+    rbusDeliveryWorker_t    workers[];
+};
+
+/*guards handle->delivery so it can't be freed while work is being submitted*/
+static pthread_mutex_t gDeliveryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static rbusDeliveryWorker_t* rbusDelivery_GetWorker(struct _rbusDelivery* delivery, void const* key)
+{
+    uintptr_t h = (uintptr_t)key;
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return &delivery->workers[h % (uintptr_t)delivery->numWorkers];
+}
+
+static void* rbusDelivery_ThreadFunc(void* p)
+{
+    rbusDeliveryWorker_t* worker = (rbusDeliveryWorker_t*)p;
+    struct _rbusDelivery* freeDelivery;
+
+    pthread_mutex_lock(&worker->mutex);
+    for (;;)
+    {
+        rbusDeliveryItem_t* item;
+
+        while (!worker->head && !worker->closing)
+            pthread_cond_wait(&worker->condQueued, &worker->mutex);
+        if (!worker->head)
+            break;
+
+        item = worker->head;
+        worker->head = item->next;
+        if (!worker->head)
+            worker->tail = NULL;
+        worker->count--;
+        worker->runningKey = item->key;
+        pthread_mutex_unlock(&worker->mutex);
+
+        item->run(item->arg);
+        item->release(item->arg);
+        free(item);
+
+        pthread_mutex_lock(&worker->mutex);
+        worker->runningKey = NULL;
+        worker->delivered++;
+        pthread_cond_broadcast(&worker->condIdle);
+        while (worker->deferred)
+        {
+            item = worker->deferred;
+            worker->deferred = item->next;
+            pthread_mutex_unlock(&worker->mutex);
+            item->release(item->arg);
+            free(item);
+            pthread_mutex_lock(&worker->mutex);
+        }
+    }
+    freeDelivery = worker->freeOnExit;
+    pthread_mutex_unlock(&worker->mutex);
+
+    if (freeDelivery)
+    {
+        pthread_cond_destroy(&worker->condIdle);
+        pthread_cond_destroy(&worker->condQueued);
+        pthread_mutex_destroy(&worker->mutex);
+        free(freeDelivery);
+    }
+    return NULL;
+}
+
+static void rbusDelivery_Destroy(struct _rbusDelivery* delivery)
+{
+    rbusDeliveryWorker_t* self = NULL;
+    rbusDeliveryItem_t* dropped;
+    int i;
+
+    /*the threads run whatever is still queued before they exit*/
+    for (i = 0; i < delivery->numWorkers; ++i)
+    {
+        rbusDeliveryWorker_t* worker = &delivery->workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        worker->closing = true;
+        pthread_cond_signal(&worker->condQueued);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+    for (i = 0; i < delivery->numWorkers; ++i)
+    {
+        rbusDeliveryWorker_t* worker = &delivery->workers[i];
+        if (pthread_equal(worker->thread, pthread_self()))
+        {
+            self = worker;
+            continue;
+        }
+        pthread_join(worker->thread, NULL);
+        pthread_cond_destroy(&worker->condIdle);
+        pthread_cond_destroy(&worker->condQueued);
+        pthread_mutex_destroy(&worker->mutex);
+    }
+
+    if (!self)
+    {
+        free(delivery);
+        return;
+    }
+
+    /*closed from a handler, which can't join its own thread.  What is still queued
+      behind it is dropped since its handle is going away, and the thread frees the
+      pool once the handler returns*/
+    pthread_mutex_lock(&self->mutex);
+    dropped = self->head;
+    self->head = self->tail = NULL;
+    self->count = 0;
+    self->freeOnExit = delivery;
+    pthread_mutex_unlock(&self->mutex);
+    pthread_detach(pthread_self());
+
+    while (dropped)
+    {
+        rbusDeliveryItem_t* item = dropped;
+        dropped = item->next;
+        item->release(item->arg);
+        free(item);
+    }
+}
+
+static bool rbusDelivery_IsWorkerThread(struct _rbusDelivery* delivery)
+{
+    int i;
+    for (i = 0; i < delivery->numWorkers; ++i)
+    {
+        if (pthread_equal(delivery->workers[i].thread, pthread_self()))
+            return true;
+    }
+    return false;
+}
+
+rbusError_t rbus_setDeliveryThreads(
+    rbusHandle_t handle,
+    int numThreads,
+    int queueDepth)
+{
+    struct _rbusDelivery* delivery = NULL;
+    struct _rbusDelivery* old;
+    int i;
+
+    if (!handle || numThreads < 0 || numThreads > DELIVERY_THREADS_MAX || queueDepth < 0)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    if (numThreads > 0)
+    {
+        delivery = calloc(1, sizeof(struct _rbusDelivery) + numThreads * sizeof(rbusDeliveryWorker_t));
+        if (!delivery)
+            return RBUS_ERROR_OUT_OF_RESOURCES;
+        delivery->queueDepth = queueDepth ? queueDepth : rbusConfig_Get()->deliveryQueueDepth;
+        for (i = 0; i < numThreads; ++i)
+        {
+            rbusDeliveryWorker_t* worker = &delivery->workers[i];
+            pthread_mutex_init(&worker->mutex, NULL);
+            pthread_cond_init(&worker->condQueued, NULL);
+            pthread_cond_init(&worker->condIdle, NULL);
+            if (pthread_create(&worker->thread, NULL, rbusDelivery_ThreadFunc, worker) != 0)
+            {
+                RBUSLOG_ERROR("%s: failed to start delivery thread", __FUNCTION__);
+                pthread_cond_destroy(&worker->condIdle);
+                pthread_cond_destroy(&worker->condQueued);
+                pthread_mutex_destroy(&worker->mutex);
+                break;
+            }
+            delivery->numWorkers++;
+        }
+        if (delivery->numWorkers < numThreads)
+        {
+            rbusDelivery_Destroy(delivery);
+            return RBUS_ERROR_OUT_OF_RESOURCES;
+        }
+    }
+
+    pthread_mutex_lock(&gDeliveryMutex);
+    old = handle->delivery;
+    if (old && rbusDelivery_IsWorkerThread(old))
+    {
+        pthread_mutex_unlock(&gDeliveryMutex);
+        if (delivery)
+            rbusDelivery_Destroy(delivery);
+        RBUSLOG_WARN("%s: can't be called from a handler running on a delivery thread", __FUNCTION__);
+        return RBUS_ERROR_INVALID_OPERATION;
+    }
+    handle->delivery = delivery;
+    pthread_mutex_unlock(&gDeliveryMutex);
+
+    if (old)
+        rbusDelivery_Destroy(old);
+    return RBUS_ERROR_SUCCESS;
+}
+
+rbusError_t rbus_getDeliveryStats(
+    rbusHandle_t handle,
+    rbusDeliveryStats_t* stats)
+{
+    struct _rbusDelivery* delivery;
+    int i;
+
+    if (!handle || !stats)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    memset(stats, 0, sizeof(rbusDeliveryStats_t));
+    pthread_mutex_lock(&gDeliveryMutex);
+    delivery = handle->delivery;
+    for (i = 0; delivery && i < delivery->numWorkers; ++i)
+    {
+        rbusDeliveryWorker_t* worker = &delivery->workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        stats->delivered += worker->delivered;
+        stats->dropped += worker->dropped;
+        stats->queued += (uint32_t)worker->count;
+        if (worker->maxQueued > stats->maxQueued)
+            stats->maxQueued = worker->maxQueued;
+        pthread_mutex_unlock(&worker->mutex);
+    }
+    pthread_mutex_unlock(&gDeliveryMutex);
+    return RBUS_ERROR_SUCCESS;
+}
+
+bool rbusDelivery_Submit(rbusHandle_t handle, void const* key, rbusDeliveryFunc_t run, rbusDeliveryFunc_t release, void* arg)
+{
+    struct _rbusDelivery* delivery;
+    rbusDeliveryWorker_t* worker;
+    rbusDeliveryItem_t* item;
+
+    pthread_mutex_lock(&gDeliveryMutex);
+    delivery = handle->delivery;
+    if (!delivery)
+    {
+        pthread_mutex_unlock(&gDeliveryMutex);
+        return false;
+    }
+    worker = rbusDelivery_GetWorker(delivery, key);
+    pthread_mutex_lock(&worker->mutex);
+    pthread_mutex_unlock(&gDeliveryMutex);
+
+    item = NULL;
+    if (worker->count < delivery->queueDepth)
+        item = malloc(sizeof(rbusDeliveryItem_t));
+    if (!item)
+    {
+        worker->dropped++;
+        pthread_mutex_unlock(&worker->mutex);
+        RBUSLOG_WARN("%s: delivery queue full, dropping callback", __FUNCTION__);
+        release(arg);
+        return true;
+    }
+
+    item->key = key;
+    item->run = run;
+    item->release = release;
+    item->arg = arg;
+    item->next = NULL;
+    if (worker->tail)
+        worker->tail->next = item;
+    else
+        worker->head = item;
+    worker->tail = item;
+    worker->count++;
+    if ((uint32_t)worker->count > worker->maxQueued)
+        worker->maxQueued = (uint32_t)worker->count;
+    pthread_cond_signal(&worker->condQueued);
+    pthread_mutex_unlock(&worker->mutex);
+    return true;
+}
+
+void rbusDelivery_Cancel(rbusHandle_t handle, void const* key, rbusDeliveryFunc_t release, void* arg)
+{
+    struct _rbusDelivery* delivery;
+    rbusDeliveryWorker_t* worker;
+    rbusDeliveryItem_t* dropped = NULL;
+    rbusDeliveryItem_t** link;
+    bool fromWorker;
+
+    pthread_mutex_lock(&gDeliveryMutex);
+    delivery = handle->delivery;
+    if (!delivery)
+    {
+        pthread_mutex_unlock(&gDeliveryMutex);
+        if (release)
+            release(arg);
+        return;
+    }
+    worker = rbusDelivery_GetWorker(delivery, key);
+    fromWorker = rbusDelivery_IsWorkerThread(delivery);
+    pthread_mutex_lock(&worker->mutex);
+    pthread_mutex_unlock(&gDeliveryMutex);
+
+    link = &worker->head;
+    worker->tail = NULL;
+    while (*link)
+    {
+        rbusDeliveryItem_t* item = *link;
+        if (item->key == key)
+        {
+            *link = item->next;
+            item->next = dropped;
+            dropped = item;
+            worker->count--;
+        }
+        else
+        {
+            worker->tail = item;
+            link = &item->next;
+        }
+    }
+
+    /*A delivery thread never waits: two handlers canceling each other's keys would
+      wait on each other, and one canceling its own key would wait on itself.  Instead
+      the worker running the key releases arg once that work returns.*/
+    if (worker->runningKey == key && fromWorker)
+    {
+        rbusDeliveryItem_t* item = release ? malloc(sizeof(rbusDeliveryItem_t)) : NULL;
+        if (item)
+        {
+            item->key = key;
+            item->run = NULL;
+            item->release = release;
+            item->arg = arg;
+            item->next = worker->deferred;
+            worker->deferred = item;
+        }
+        else if (release)
+        {
+            /*leaked rather than freed under the running work*/
+            RBUSLOG_ERROR("%s: failed to defer release", __FUNCTION__);
+        }
+        release = NULL;
+    }
+    else
+    {
+        while (worker->runningKey == key)
+            pthread_cond_wait(&worker->condIdle, &worker->mutex);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+
+    while (dropped)
+    {
+        rbusDeliveryItem_t* item = dropped;
+        dropped = item->next;
+        item->release(item->arg);
+        free(item);
+    }
+    if (release)
+        release(arg);
+}
+
+void rbusDelivery_CloseHandle(rbusHandle_t handle)
+{
+    struct _rbusDelivery* delivery;
+
+    pthread_mutex_lock(&gDeliveryMutex);
+    delivery = handle->delivery;
+    handle->delivery = NULL;
+    pthread_mutex_unlock(&gDeliveryMutex);
+
+    if (delivery)
+        rbusDelivery_Destroy(delivery);
+}
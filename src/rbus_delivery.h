@@ -0,0 +1,51 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef RBUS_DELIVERY_H
+#define RBUS_DELIVERY_H
+
+#include <rbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*rbusDeliveryFunc_t)(void* arg);
+
+/*queue run(arg) on the handle's delivery threads, after which release(arg) is called.
+  Work with the same key runs in the order submitted, one at a time.
+  returns false if the handle has no delivery threads, in which case the caller runs
+  the work inline and keeps ownership of arg.  If the key's queue is full the work is
+  dropped and counted, release(arg) is called and true is returned*/
+bool rbusDelivery_Submit(rbusHandle_t handle, void const* key, rbusDeliveryFunc_t run, rbusDeliveryFunc_t release, void* arg);
+
+/*drop the work queued for a key, then call release(arg), if given, once none of the
+  key's work is running.  Other threads wait for work already running, but a delivery
+  thread never waits, so handlers may cancel their own or each other's keys; the
+  release is then left to the thread running the key's work, after it returns*/
+void rbusDelivery_Cancel(rbusHandle_t handle, void const* key, rbusDeliveryFunc_t release, void* arg);
+
+/*runs the work still queued and stops the delivery threads.  Called from a delivery
+  thread, the work queued behind the caller's on that thread is dropped instead, and the
+  thread frees the pool once the caller's work returns*/
+void rbusDelivery_CloseHandle(rbusHandle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <rbus.h>
 #include <assert.h>
+#include <pthread.h>
 #include "rbus_element.h"
 #include "rbus_subscriptions.h"
 
@@ -29,6 +30,14 @@
 
 elementNode* pruneNode = NULL;
 
+/*guards the cacheValue, cacheExpires and cacheGeneration of all nodes, which the
+  get, set and value-change threads use*/
+static pthread_mutex_t gCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*held while table rows are added or removed and while the instances of an element
+  are walked, so a walk never sees a half linked or freed row*/
+static pthread_mutex_t gRowsMutex = PTHREAD_MUTEX_INITIALIZER;
+
 //****************************** UTILITY FUNCTIONS ***************************//
 char const* getTypeString(rbusElementType_t type)
 {
@@ -85,6 +94,10 @@ static void freeElementRecurse(elementNode* node)
     {
         free(node->changeComp);
     }
+    if (node->cacheValue)
+    {
+        rbusValue_Release(node->cacheValue);
+    }
 
     free(node);
 
@@ -143,6 +156,10 @@ void freeElementNode(elementNode* node)
     {
         free(node->changeComp);
     }
+    if (node->cacheValue)
+    {
+        rbusValue_Release(node->cacheValue);
+    }
     free(node);
 
     /*remove objects with no children
@@ -180,6 +197,13 @@ static void createElementChain(elementNode* node, elementNode*** chainOut, int*
         parent = parent->parent;
     }
     chain = malloc(num * sizeof(elementNode*));
+    if(!chain)
+    {
+        RBUSLOG_ERROR("%s: failed to allocate chain of %d", __FUNCTION__, num);
+        *chainOut = NULL;
+        *numChain = 0;
+        return;
+    }
     parent = node;
     while(parent)
     {
@@ -689,12 +713,16 @@ void removeElement(elementNode* element)
     printf("removeElement %s\n", element->fullName);
 #endif
     createElementChain(element, &chain, &numChain);
+    if(!chain)
+        return;
+    pthread_mutex_lock(&gRowsMutex);
     if(numChain > 1)
         removeElementInternal(chain[0], &chain[1], numChain-1);
     else
         freeElementNode(chain[0]);
-    free(chain);
     pruneTree();    
+    pthread_mutex_unlock(&gRowsMutex);
+    free(chain);
 }
 
 static void printElement(elementNode* node, int level)
@@ -893,6 +921,8 @@ static elementNode* duplicateNode(elementNode* sourceNode, elementNode* parentNo
     node->name = strdup(name);
     node->type = sourceNode->type;
     node->cbTable = sourceNode->cbTable;
+    node->cacheMaxAge = __atomic_load_n(&sourceNode->cacheMaxAge, __ATOMIC_RELAXED);
+    node->cacheInvalidateOnSet = __atomic_load_n(&sourceNode->cacheInvalidateOnSet, __ATOMIC_RELAXED);
     node->parent = parentNode;
 
     /*add new node to the parent's child list*/
@@ -989,12 +1019,14 @@ elementNode* instantiateTableRow(elementNode* tableNode, uint32_t instNum, char
 
     snprintf(name, 32, "%u", instNum);
 
+    pthread_mutex_lock(&gRowsMutex);
     elementNode* row = duplicateNode(rowTemplate, tableNode, name);
 
     if(alias)
     {
         row->alias = strdup(alias);
     }
+    pthread_mutex_unlock(&gRowsMutex);
 
 #if DEBUG_ELEMENTS
     {
@@ -1032,7 +1064,9 @@ void deleteTableRow(elementNode* rowNode)
         RBUSLOG_INFO("#####################################################");
     }
 #endif
+    pthread_mutex_lock(&gRowsMutex);
     freeElementNode(rowNode);
+    pthread_mutex_unlock(&gRowsMutex);
 #if DEBUG_ELEMENTS
     if(parent)
     {
@@ -1148,3 +1182,199 @@ void setPropertyChangeComponent(elementNode* node, char const* componentName)
     rtTime_Now(&node->changeTime);
 
 }
+
+static rbusError_t addElementInstancesLocked(elementNodeSet* set, elementNode* element);
+
+rbusError_t setElementCachePolicy(elementNode* element, uint32_t maxAge, bool invalidateOnSet)
+{
+    elementNodeSet instances;
+    rbusError_t rc;
+    int i;
+
+    memset(&instances, 0, sizeof(instances));
+
+    /*rows copy the policy of the registration element when added, so holding the rows
+      lock while setting it on those that exist covers every row*/
+    pthread_mutex_lock(&gRowsMutex);
+    if((rc = addElementInstancesLocked(&instances, element)) == RBUS_ERROR_SUCCESS)
+    {
+        for(i = 0; i < instances.count; i++)
+        {
+            elementNode* node = instances.nodes[i];
+            __atomic_store_n(&node->cacheInvalidateOnSet, invalidateOnSet, __ATOMIC_RELAXED);
+            __atomic_store_n(&node->cacheMaxAge, maxAge, __ATOMIC_RELAXED);
+            invalidateElementCache(node);
+        }
+    }
+    pthread_mutex_unlock(&gRowsMutex);
+    freeElementSet(&instances);
+    return rc;
+}
+
+/*Sets the property's value from the cache if it hasn't gone stale.  On a miss, generation
+  is what to pass setElementCachedValue after calling the getHandler.*/
+bool getElementCachedValue(elementNode* node, rbusProperty_t property, uint32_t* generation)
+{
+    bool hit = false;
+
+    if(!__atomic_load_n(&node->cacheMaxAge, __ATOMIC_RELAXED))
+        return false;
+
+    pthread_mutex_lock(&gCacheMutex);
+    if(node->cacheValue)
+    {
+        rtTime_t now;
+        rtTime_Now(&now);
+        if(rtTime_Compare(&now, &node->cacheExpires) < 0)
+        {
+            rbusProperty_SetValue(property, node->cacheValue);
+            hit = true;
+        }
+    }
+    *generation = node->cacheGeneration;
+    pthread_mutex_unlock(&gCacheMutex);
+    return hit;
+}
+
+void setElementCachedValue(elementNode* node, rbusValue_t value, uint32_t generation)
+{
+    rbusValue_t copy;
+    rbusValue_t old = NULL;
+    uint32_t maxAge = __atomic_load_n(&node->cacheMaxAge, __ATOMIC_RELAXED);
+
+    if(!maxAge || !value)
+        return;
+
+    /*the getHandler may keep the value it returned and change it later*/
+    rbusValue_Init(&copy);
+    rbusValue_Copy(copy, value);
+
+    pthread_mutex_lock(&gCacheMutex);
+    /*skip it if a set or value-change invalidated the cache while the getHandler ran*/
+    if(generation == node->cacheGeneration)
+    {
+        old = node->cacheValue;
+        node->cacheValue = copy;
+        copy = NULL;
+        rtTime_Later(NULL, maxAge, &node->cacheExpires);
+    }
+    pthread_mutex_unlock(&gCacheMutex);
+    if(old)
+        rbusValue_Release(old);
+    if(copy)
+        rbusValue_Release(copy);
+}
+
+void invalidateElementCache(elementNode* node)
+{
+    rbusValue_t old;
+
+    pthread_mutex_lock(&gCacheMutex);
+    old = node->cacheValue;
+    node->cacheValue = NULL;
+    node->cacheGeneration++;
+    pthread_mutex_unlock(&gCacheMutex);
+    if(old)
+        rbusValue_Release(old);
+}
+
+static rbusError_t addElementSubtreeToSet(elementNodeSet* set, elementNode* node)
+{
+    elementNode* child;
+
+    if(set->count == set->capacity)
+    {
+        int capacity = set->capacity ? set->capacity * 2 : 64;
+        elementNode** nodes = realloc(set->nodes, capacity * sizeof(elementNode*));
+        if(!nodes)
+        {
+            RBUSLOG_ERROR("%s: failed to grow set to %d nodes", __FUNCTION__, capacity);
+            return RBUS_ERROR_OUT_OF_RESOURCES;
+        }
+        set->nodes = nodes;
+        set->capacity = capacity;
+    }
+    set->nodes[set->count++] = node;
+
+    for(child = node->child; child; child = child->nextSibling)
+    {
+        rbusError_t rc = addElementSubtreeToSet(set, child);
+        if(rc != RBUS_ERROR_SUCCESS)
+            return rc;
+    }
+    return RBUS_ERROR_SUCCESS;
+}
+
+/*follow the chain of a registration element down from node, branching into every row
+  of each table on the way, to reach all of its instances*/
+static rbusError_t addElementInstancesInternal(elementNodeSet* set, elementNode* node, elementNode** chain, int numChain)
+{
+    elementNode* child;
+
+    if(numChain == 0)
+        return addElementSubtreeToSet(set, node);
+
+    for(child = node->child; child; child = child->nextSibling)
+    {
+        if(strcmp(child->name, chain[0]->name) == 0 ||
+          (node->type == RBUS_ELEMENT_TYPE_TABLE && strcmp(chain[0]->name, "{i}") == 0))
+        {
+            rbusError_t rc = addElementInstancesInternal(set, child, &chain[1], numChain-1);
+            if(rc != RBUS_ERROR_SUCCESS)
+                return rc;
+        }
+    }
+    return RBUS_ERROR_SUCCESS;
+}
+
+/*called with gRowsMutex held*/
+static rbusError_t addElementInstancesLocked(elementNodeSet* set, elementNode* element)
+{
+    elementNode** chain = NULL;
+    int numChain = 0;
+    rbusError_t rc;
+
+    createElementChain(element, &chain, &numChain);
+    if(!chain)
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    rc = addElementInstancesInternal(set, chain[0], &chain[1], numChain-1);
+    free(chain);
+    return rc;
+}
+
+rbusError_t addElementInstancesToSet(elementNodeSet* set, elementNode* element)
+{
+    rbusError_t rc;
+
+    pthread_mutex_lock(&gRowsMutex);
+    rc = addElementInstancesLocked(set, element);
+    pthread_mutex_unlock(&gRowsMutex);
+    return rc;
+}
+
+static int compareElementNodes(const void* left, const void* right)
+{
+    uintptr_t l = (uintptr_t)*(elementNode* const*)left;
+    uintptr_t r = (uintptr_t)*(elementNode* const*)right;
+    return l < r ? -1 : l > r ? 1 : 0;
+}
+
+void sortElementSet(elementNodeSet* set)
+{
+    if(set->count > 1)
+        qsort(set->nodes, set->count, sizeof(elementNode*), compareElementNodes);
+}
+
+bool elementSetContains(elementNodeSet const* set, elementNode const* node)
+{
+    if(set->count == 0)
+        return false;
+    return bsearch(&node, set->nodes, set->count, sizeof(elementNode*), compareElementNodes) != NULL;
+}
+
+void freeElementSet(elementNodeSet* set)
+{
+    free(set->nodes);
+    set->nodes = NULL;
+    set->count = set->capacity = 0;
+}
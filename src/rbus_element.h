@@ -50,8 +50,23 @@ typedef struct elementNode
     char*                   alias;          /* For table rows */
     char*                   changeComp;     /* For properties, the last component to set the value */
     rtTime_t                changeTime;     /* For properties, the time the value was last set*/
+    uint32_t                cacheMaxAge;    /* For properties, milliseconds a get result is reused, 0 for no caching */
+    bool                    cacheInvalidateOnSet; /* For properties, drop the cached result when set */
+    uint32_t                cacheGeneration;/* Bumped on invalidation so a get started before it isn't cached */
+    rbusValue_t             cacheValue;     /* For properties, the cached get result */
+    rtTime_t                cacheExpires;   /* For properties, when cacheValue goes stale */
 } elementNode;
 
+/* A set of element nodes, sorted by address with sortElementSet before
+   being searched with elementSetContains.  addElementInstancesToSet returns
+   RBUS_ERROR_OUT_OF_RESOURCES if the set couldn't hold every node, leaving it partial */
+typedef struct elementNodeSet
+{
+    elementNode**           nodes;
+    int                     count;
+    int                     capacity;
+} elementNodeSet;
+
 
 /******************************** FUNCTIONS **********************************/
 elementNode* getEmptyElementNode(void);
@@ -70,6 +85,15 @@ elementNode* instantiateTableRow(elementNode* tableNode, uint32_t instNum, char
 void deleteTableRow(elementNode* rowNode);
 void getPropertyInstanceNames(elementNode* root, char const* query, rtVector propNameList);
 void setPropertyChangeComponent(elementNode* node, char const* componentName);
+/*sets the get cache policy of a registration element and all of its row instances*/
+rbusError_t setElementCachePolicy(elementNode* element, uint32_t maxAge, bool invalidateOnSet);
+bool getElementCachedValue(elementNode* node, rbusProperty_t property, uint32_t* generation);
+void setElementCachedValue(elementNode* node, rbusValue_t value, uint32_t generation);
+void invalidateElementCache(elementNode* node);
+rbusError_t addElementInstancesToSet(elementNodeSet* set, elementNode* element);
+void sortElementSet(elementNodeSet* set);
+bool elementSetContains(elementNodeSet const* set, elementNode const* node);
+void freeElementSet(elementNodeSet* set);
 
 #ifdef __cplusplus
 }
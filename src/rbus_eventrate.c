@@ -0,0 +1,364 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+    Event Rate Limiting:
+    Enforces, on the provider side, the max delivery rate a consumer requested with
+    rbusEventSubscription_t.publishInterval so that events over the rate are never sent.
+    An event published before a subscription's interval has elapsed is either dropped or,
+    if the subscription coalesces, held as that subscription's single pending event.
+    A newer event replaces the pending one ("latest value wins").
+    A single thread, started when the first event is held, sends pending events when their
+    interval elapses.
+*/
+
+#define _GNU_SOURCE 1 //needed for pthread_mutexattr_settype
+
+#include "rbus_eventrate.h"
+#include "rbus_handle.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <rtVector.h>
+#include <rtTime.h>
+
+#define ERROR_CHECK(CMD) \
+{ \
+  int err; \
+  if((err=CMD) != 0) \
+  { \
+    RBUSLOG_ERROR("Error %d:%s running command " #CMD, err, strerror(err)); \
+  } \
+}
+#define READY_BATCH_MAX 32 /*due events the thread sends per pass*/
+
+#define LOCK() ERROR_CHECK(pthread_mutex_lock(&gER.mutex))
+#define UNLOCK() ERROR_CHECK(pthread_mutex_unlock(&gER.mutex))
+
+typedef struct EventRateLimiter_t
+{
+    int              running;
+    int              stopping;      /*a close is joining the thread, it can't be restarted until stopped is signaled*/
+    rtVector         pending;
+    pthread_mutex_t  mutex;
+    pthread_t        thread;
+    pthread_cond_t   cond;
+    pthread_cond_t   stopped;
+} EventRateLimiter_t;
+
+typedef struct PendingEventRecord
+{
+    rbusHandle_t handle;        //needed for the component name to publish from
+    rbusSubscription_t* sub;    //the subscriber the event is held for
+    rbusMessage msg;            //the latest event published during the interval
+    rtTime_t sendTime;          //when the subscriber's interval elapses
+} PendingEventRecord;
+
+/*an event taken off the pending list to be sent once gER.mutex is released; it owns copies
+  of the names since the handle and subscription may go away while it is being sent*/
+typedef struct ReadyEvent
+{
+    char* componentName;
+    char* eventName;
+    char* listener;
+    rbusMessage msg;
+} ReadyEvent;
+
+static EventRateLimiter_t gER;
+static pthread_once_t gERInitOnce = PTHREAD_ONCE_INIT;
+
+static void rbusEventRate_Init()
+{
+    pthread_mutexattr_t attrib;
+    pthread_condattr_t cattrib;
+
+    RBUSLOG_DEBUG("%s", __FUNCTION__);
+
+    gER.running = 0;
+    gER.stopping = 0;
+    rtVector_Create(&gER.pending);
+
+    ERROR_CHECK(pthread_mutexattr_init(&attrib));
+    ERROR_CHECK(pthread_mutexattr_settype(&attrib, PTHREAD_MUTEX_ERRORCHECK));
+    ERROR_CHECK(pthread_mutex_init(&gER.mutex, &attrib));
+
+    ERROR_CHECK(pthread_condattr_init(&cattrib));
+    ERROR_CHECK(pthread_condattr_setclock(&cattrib, CLOCK_MONOTONIC));
+    ERROR_CHECK(pthread_cond_init(&gER.cond, &cattrib));
+    ERROR_CHECK(pthread_condattr_destroy(&cattrib));
+    ERROR_CHECK(pthread_cond_init(&gER.stopped, NULL));
+}
+
+static void pendingEvent_Free(void* p)
+{
+    PendingEventRecord* rec = (PendingEventRecord*)p;
+    if(rec->msg)
+        rbusMessage_Release(rec->msg);
+    free(rec);
+}
+
+static PendingEventRecord* pendingEvent_Find(rbusSubscription_t const* sub)
+{
+    size_t i;
+    for(i=0; i < rtVector_Size(gER.pending); ++i)
+    {
+        PendingEventRecord* rec = (PendingEventRecord*)rtVector_At(gER.pending, i);
+        if(rec && rec->sub == sub)
+            return rec;
+    }
+    return NULL;
+}
+
+static void* rbusEventRate_threadFunc(void *userData)
+{
+    (void)(userData);
+    RBUSLOG_DEBUG("%s: start", __FUNCTION__);
+    LOCK();
+    while(gER.running)
+    {
+        size_t i;
+        int err;
+        rtTime_t now;
+        rtTimespec_t ts;
+        PendingEventRecord* next = NULL;
+
+        for(i=0; i < rtVector_Size(gER.pending); ++i)
+        {
+            PendingEventRecord* rec = (PendingEventRecord*)rtVector_At(gER.pending, i);
+            if(rec && (!next || rtTime_Compare(&rec->sendTime, &next->sendTime) < 0))
+                next = rec;
+        }
+
+        if(!next)
+        {
+            err = pthread_cond_wait(&gER.cond, &gER.mutex);
+        }
+        else if(rtTime_Compare(&next->sendTime, rtTime_Now(&now)) > 0)
+        {
+            err = pthread_cond_timedwait(&gER.cond, 
+                                        &gER.mutex, 
+                                        rtTime_ToTimespec(&next->sendTime, &ts));
+        }
+        else
+        {
+            ReadyEvent ready[READY_BATCH_MAX];
+            int numReady = 0;
+            int j;
+
+            /*take the due events off the list and send them unlocked, so a slow send
+              doesn't hold up rbusEvent_Publish and a publish from the send path can't deadlock*/
+            i = 0;
+            while(i < rtVector_Size(gER.pending) && numReady < READY_BATCH_MAX)
+            {
+                PendingEventRecord* rec = (PendingEventRecord*)rtVector_At(gER.pending, i);
+                if(!rec || rtTime_Compare(&rec->sendTime, &now) > 0)
+                {
+                    i++;
+                    continue;
+                }
+                ready[numReady].componentName = strdup(rec->handle->componentName);
+                ready[numReady].eventName = strdup(rec->sub->eventName);
+                ready[numReady].listener = strdup(rec->sub->listener);
+                ready[numReady].msg = rec->msg;
+                rec->msg = NULL;
+                rec->sub->lastPublishTime = now;
+                rtVector_RemoveItem(gER.pending, rec, pendingEvent_Free);
+                numReady++;
+            }
+            UNLOCK();
+
+            for(j = 0; j < numReady; j++)
+            {
+                if(ready[j].componentName && ready[j].eventName && ready[j].listener)
+                {
+                    rbus_error_t coreerr;
+
+                    RBUSLOG_DEBUG("%s: publishing coalesced event %s to listener %s", __FUNCTION__, ready[j].eventName, ready[j].listener);
+
+                    coreerr = rbus_publishSubscriberEvent(
+                        ready[j].componentName,
+                        ready[j].eventName,
+                        ready[j].listener,
+                        ready[j].msg);
+
+                    if(coreerr != RTMESSAGE_BUS_SUCCESS)
+                    {
+                        RBUSLOG_INFO("%s: rbus_publishSubscriberEvent return error %d", __FUNCTION__, coreerr);
+                    }
+                }
+                else
+                {
+                    RBUSLOG_ERROR("%s: out of memory, dropping a coalesced event", __FUNCTION__);
+                }
+                free(ready[j].componentName);
+                free(ready[j].eventName);
+                free(ready[j].listener);
+                rbusMessage_Release(ready[j].msg);
+            }
+
+            LOCK();
+            err = 0;
+        }
+
+        if(err != 0 && err != ETIMEDOUT)
+        {
+            RBUSLOG_ERROR("Error %d:%s running command pthread_cond_wait", err, strerror(err));
+        }
+    }
+    UNLOCK();
+    RBUSLOG_DEBUG("%s: stop", __FUNCTION__);
+    return NULL;
+}
+
+bool rbusEventRate_CheckPublish(rbusHandle_t handle, rbusSubscription_t* sub, rbusMessage msg)
+{
+    PendingEventRecord* rec;
+    rtTime_t now;
+    bool sendNow;
+
+    pthread_once(&gERInitOnce, rbusEventRate_Init);
+
+    LOCK();//############ LOCK ############
+
+    rec = pendingEvent_Find(sub);
+    rtTime_Now(&now);
+
+    /*a zero lastPublishTime means nothing was published to this subscriber yet*/
+    if((sub->lastPublishTime.tv_sec == 0 && sub->lastPublishTime.tv_nsec == 0) ||
+        rtTime_Elapsed(&sub->lastPublishTime, &now) >= (int)sub->publishInterval)
+    {
+        /*this event supersedes any event still pending*/
+        if(rec)
+            rtVector_RemoveItem(gER.pending, rec, pendingEvent_Free);
+        sub->lastPublishTime = now;
+        sendNow = true;
+    }
+    else if(sub->coalesce)
+    {
+        rbusMessage_Retain(msg);
+        if(rec)
+        {
+            rbusMessage_Release(rec->msg);
+            rec->msg = msg;
+        }
+        else
+        {
+            rec = (PendingEventRecord*)malloc(sizeof(PendingEventRecord));
+            if(!rec)
+            {
+                RBUSLOG_ERROR("%s: out of memory, dropping coalesced event %s", __FUNCTION__, sub->eventName);
+                rbusMessage_Release(msg);
+                UNLOCK();
+                return false;
+            }
+            rec->handle = handle;
+            rec->sub = sub;
+            rec->msg = msg;
+            rtTime_Later(&sub->lastPublishTime, sub->publishInterval, &rec->sendTime);
+            rtVector_PushBack(gER.pending, rec);
+
+            /*a close that is stopping the thread joins it by its id, so wait for that before starting another*/
+            while(gER.stopping)
+                ERROR_CHECK(pthread_cond_wait(&gER.stopped, &gER.mutex));
+
+            if(!gER.running)
+            {
+                gER.running = 1;
+                pthread_create(&gER.thread, NULL, rbusEventRate_threadFunc, NULL);
+            }
+            else
+            {
+                ERROR_CHECK(pthread_cond_signal(&gER.cond));
+            }
+        }
+        sendNow = false;
+    }
+    else
+    {
+        sendNow = false;
+    }
+
+    UNLOCK();//############ UNLOCK ############
+
+    return sendNow;
+}
+
+void rbusEventRate_RemoveSubscription(rbusSubscription_t* sub)
+{
+    PendingEventRecord* rec;
+
+    pthread_once(&gERInitOnce, rbusEventRate_Init);
+
+    LOCK();
+    rec = pendingEvent_Find(sub);
+    if(rec)
+    {
+        RBUSLOG_DEBUG("%s: dropping pending event %s for listener %s", __FUNCTION__, sub->eventName, sub->listener);
+        rtVector_RemoveItem(gER.pending, rec, pendingEvent_Free);
+    }
+    UNLOCK();
+}
+
+void rbusEventRate_CloseHandle(rbusHandle_t handle)
+{
+    bool stopThread = false;
+    pthread_t thread;
+    size_t i = 0;
+
+    RBUSLOG_DEBUG("%s", __FUNCTION__);
+
+    pthread_once(&gERInitOnce, rbusEventRate_Init);
+
+    LOCK();
+    //remove all pending events for this bus handle
+    while(i < rtVector_Size(gER.pending))
+    {
+        PendingEventRecord* rec = (PendingEventRecord*)rtVector_At(gER.pending, i);
+        if(rec && rec->handle == handle)
+        {
+            rtVector_RemoveItem(gER.pending, rec, pendingEvent_Free);
+        }
+        else
+        {
+            //only i++ here because rtVector_RemoveItem does a right shift on all the elements after remove index
+            i++;
+        }
+    }
+    //stop the thread once nothing is pending for any rbus handle; the next held event restarts it
+    if(gER.running && !gER.stopping && rtVector_Size(gER.pending) == 0)
+    {
+        gER.running = 0;
+        gER.stopping = 1;
+        thread = gER.thread;
+        stopThread = true;
+    }
+    UNLOCK();
+
+    if(stopThread)
+    {
+        ERROR_CHECK(pthread_cond_signal(&gER.cond));
+        ERROR_CHECK(pthread_join(thread, NULL));
+
+        LOCK();
+        gER.stopping = 0;
+        ERROR_CHECK(pthread_cond_broadcast(&gER.stopped));
+        UNLOCK();
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef RBUS_EVENTRATE_H
+#define RBUS_EVENTRATE_H
+
+#include "rbus_subscriptions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*call for a subscription with a publishInterval before sending it msg.
+  returns true if the event should be sent now.
+  returns false if the subscriber's publishInterval has not elapsed since its last event,
+  in which case the event is dropped or, if the subscription coalesces, msg is retained
+  and sent once the interval elapses (replacing any event already pending)*/
+bool rbusEventRate_CheckPublish(rbusHandle_t handle, rbusSubscription_t* sub, rbusMessage msg);
+
+/*drop any event pending for a subscription; call before the subscription is freed*/
+void rbusEventRate_RemoveSubscription(rbusSubscription_t* sub);
+
+void rbusEventRate_CloseHandle(rbusHandle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,246 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include "rbus_handle.h"
+#include "rbus_log.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*listeners that subscribed to one or more handles, sorted by name.  an entry may
+  outlive the subscriptions it was added for; it is dropped when the listener
+  disconnects or the handles close, so a disconnect only ever costs a no-op call*/
+typedef struct _rbusListenerHandles
+{
+    char*                   listener;
+    struct _rbusHandle**    handles;
+    int                     numHandles;
+} rbusListenerHandles_t;
+
+static pthread_mutex_t gHandlesMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t gDisconnectMutex = PTHREAD_MUTEX_INITIALIZER; /*held while a disconnect is dispatched*/
+static struct _rbusHandle** gHandles = NULL;
+static int gNumHandles = 0;
+static int gMaxHandles = 0;
+static rbusListenerHandles_t* gListeners = NULL;
+static int gNumListeners = 0;
+static int gMaxListeners = 0;
+
+/*binary search for a listener, returning its index or where it would be inserted*/
+static int rbusHandle_FindListener(char const* listener, bool* found)
+{
+    int lo = 0, hi = gNumListeners;
+
+    *found = false;
+    while(lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        int rc = strcmp(gListeners[mid].listener, listener);
+        if(rc == 0)
+        {
+            *found = true;
+            return mid;
+        }
+        if(rc < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void rbusHandle_RemoveListenerAt(int i)
+{
+    free(gListeners[i].listener);
+    free(gListeners[i].handles);
+    memmove(&gListeners[i], &gListeners[i+1], (gNumListeners - i - 1) * sizeof(rbusListenerHandles_t));
+    gNumListeners--;
+}
+
+rbusError_t rbusHandle_Register(struct _rbusHandle* handle)
+{
+    rbusError_t rc = RBUS_ERROR_SUCCESS;
+
+    pthread_mutex_lock(&gHandlesMutex);
+    if(gNumHandles == gMaxHandles)
+    {
+        int max = gMaxHandles ? gMaxHandles * 2 : 8;
+        struct _rbusHandle** handles = realloc(gHandles, max * sizeof(struct _rbusHandle*));
+        if(handles)
+        {
+            gHandles = handles;
+            gMaxHandles = max;
+        }
+        else
+        {
+            rc = RBUS_ERROR_OUT_OF_RESOURCES;
+        }
+    }
+    if(rc == RBUS_ERROR_SUCCESS)
+        gHandles[gNumHandles++] = handle;
+    pthread_mutex_unlock(&gHandlesMutex);
+    return rc;
+}
+
+void rbusHandle_Unregister(struct _rbusHandle* handle)
+{
+    int i, j;
+
+    pthread_mutex_lock(&gHandlesMutex);
+    for(i = 0; i < gNumHandles; ++i)
+    {
+        if(gHandles[i] == handle)
+        {
+            gHandles[i] = gHandles[--gNumHandles];
+            break;
+        }
+    }
+    for(i = gNumListeners - 1; i >= 0; --i)
+    {
+        rbusListenerHandles_t* entry = &gListeners[i];
+        for(j = 0; j < entry->numHandles; ++j)
+        {
+            if(entry->handles[j] == handle)
+            {
+                entry->handles[j] = entry->handles[--entry->numHandles];
+                break;
+            }
+        }
+        if(entry->numHandles == 0)
+            rbusHandle_RemoveListenerAt(i);
+    }
+    if(gNumHandles == 0)
+    {
+        free(gHandles);
+        gHandles = NULL;
+        gMaxHandles = 0;
+        free(gListeners);
+        gListeners = NULL;
+        gMaxListeners = 0;
+    }
+    pthread_mutex_unlock(&gHandlesMutex);
+
+    /*wait out a disconnect that may have picked this handle before it was removed*/
+    pthread_mutex_lock(&gDisconnectMutex);
+    pthread_mutex_unlock(&gDisconnectMutex);
+}
+
+struct _rbusHandle* rbusHandle_FindByComponent(char const* componentName)
+{
+    struct _rbusHandle* handle = NULL;
+    int i;
+
+    pthread_mutex_lock(&gHandlesMutex);
+    for(i = 0; i < gNumHandles; ++i)
+    {
+        if(strcmp(gHandles[i]->componentName, componentName) == 0)
+        {
+            handle = gHandles[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gHandlesMutex);
+    return handle;
+}
+
+int rbusHandle_Count(void)
+{
+    int count;
+
+    pthread_mutex_lock(&gHandlesMutex);
+    count = gNumHandles;
+    pthread_mutex_unlock(&gHandlesMutex);
+    return count;
+}
+
+void rbusHandle_AddListener(struct _rbusHandle* handle, char const* listener)
+{
+    rbusListenerHandles_t* entry;
+    struct _rbusHandle** handles;
+    bool found;
+    int i;
+
+    pthread_mutex_lock(&gHandlesMutex);
+    i = rbusHandle_FindListener(listener, &found);
+    if(!found)
+    {
+        if(gNumListeners == gMaxListeners)
+        {
+            int max = gMaxListeners ? gMaxListeners * 2 : 16;
+            rbusListenerHandles_t* listeners = realloc(gListeners, max * sizeof(rbusListenerHandles_t));
+            if(!listeners)
+                goto out_of_memory;
+            gListeners = listeners;
+            gMaxListeners = max;
+        }
+        memmove(&gListeners[i+1], &gListeners[i], (gNumListeners - i) * sizeof(rbusListenerHandles_t));
+        gNumListeners++;
+        memset(&gListeners[i], 0, sizeof(rbusListenerHandles_t));
+        if((gListeners[i].listener = strdup(listener)) == NULL)
+        {
+            rbusHandle_RemoveListenerAt(i);
+            goto out_of_memory;
+        }
+    }
+    entry = &gListeners[i];
+    for(i = 0; i < entry->numHandles; ++i)
+    {
+        if(entry->handles[i] == handle)
+        {
+            pthread_mutex_unlock(&gHandlesMutex);
+            return;
+        }
+    }
+    if((handles = realloc(entry->handles, (entry->numHandles + 1) * sizeof(struct _rbusHandle*))) == NULL)
+        goto out_of_memory;
+    entry->handles = handles;
+    entry->handles[entry->numHandles++] = handle;
+    pthread_mutex_unlock(&gHandlesMutex);
+    return;
+
+out_of_memory:
+    pthread_mutex_unlock(&gHandlesMutex);
+    RBUSLOG_ERROR("%s: out of memory, %s won't be cleaned up if it disconnects", __FUNCTION__, listener);
+}
+
+void rbusHandle_DispatchClientDisconnect(char const* listener, void (*callback)(struct _rbusHandle* handle, char const* listener))
+{
+    rbusListenerHandles_t entry = {NULL, NULL, 0};
+    bool found;
+    int i;
+
+    pthread_mutex_lock(&gDisconnectMutex);
+
+    pthread_mutex_lock(&gHandlesMutex);
+    i = rbusHandle_FindListener(listener, &found);
+    if(found)
+    {
+        entry = gListeners[i];
+        memmove(&gListeners[i], &gListeners[i+1], (gNumListeners - i - 1) * sizeof(rbusListenerHandles_t));
+        gNumListeners--;
+    }
+    pthread_mutex_unlock(&gHandlesMutex);
+
+    for(i = 0; i < entry.numHandles; ++i)
+        callback(entry.handles[i], listener);
+
+    pthread_mutex_unlock(&gDisconnectMutex);
+
+    free(entry.listener);
+    free(entry.handles);
+}
@@ -8,7 +8,6 @@
 
 struct _rbusHandle
 {
-  int                   inUse;
   char*                 componentName;
   elementNode*          elementRoot;
 
@@ -19,8 +18,23 @@ struct _rbusHandle
   /* provider side subscriptions */
   rbusSubscriptions_t   subscriptions; 
 
-  rtVector              messageCallbacks;
+  struct _rbusMessageListeners* messageListeners; /* created by the first rbusMessage_AddListener */
+  struct _rbusMessageSendQueue* sendQueue; /* created by the first rbusMessage_SendAsync */
+  struct _rbusDelivery* delivery; /* set by rbus_setDeliveryThreads */
+  struct _rbusGetStream* getStreams; /* results kept for the next chunks of rbus_getExtStream */
   rtConnection          connection;
 };
 
+/*process wide registry of open handles*/
+rbusError_t rbusHandle_Register(struct _rbusHandle* handle);
+/*removes the handle and its listener index entries, waiting for any disconnect being dispatched to it*/
+void rbusHandle_Unregister(struct _rbusHandle* handle);
+struct _rbusHandle* rbusHandle_FindByComponent(char const* componentName);
+int rbusHandle_Count(void);
+
+/*index the handle as holding subscriptions from listener, so a disconnect of the listener only visits those handles*/
+void rbusHandle_AddListener(struct _rbusHandle* handle, char const* listener);
+/*call callback for each handle indexed under a listener that disconnected and drop its entry*/
+void rbusHandle_DispatchClientDisconnect(char const* listener, void (*callback)(struct _rbusHandle* handle, char const* listener));
+
 #endif
@@ -31,26 +31,70 @@
 #include <stdarg.h>
 #include "rtLog.h"
 
+/*
+ * Log statements below RBUS_LOG_MIN_LEVEL are removed at compile time.  Release builds
+ * can pass e.g. -DRBUS_LOG_MIN_LEVEL=RBUS_LOG_LEVEL_WARN to drop all debug and info logging.
+ * Statements above it still check the runtime level before their arguments are evaluated,
+ * so a disabled log costs a single compare.  Use RBUSLOG_ENABLED around any extra work
+ * (e.g. rbusValue_ToString) that is only done to feed a log statement.
+ */
+#define RBUS_LOG_LEVEL_TRACE    0
+#define RBUS_LOG_LEVEL_DEBUG    1
+#define RBUS_LOG_LEVEL_INFO     2
+#define RBUS_LOG_LEVEL_WARN     3
+#define RBUS_LOG_LEVEL_ERROR    4
+#define RBUS_LOG_LEVEL_FATAL    5
+
+#ifndef RBUS_LOG_MIN_LEVEL
+#define RBUS_LOG_MIN_LEVEL RBUS_LOG_LEVEL_TRACE
+#endif
+
 #ifdef ENABLE_RDKLOGGER
 #include "rdk_debug.h"
 
-#define RBUSLOG_TRACE(format, ...)       RDK_LOG(RDK_LOG_TRACE1, "LOG.RDK.RBUS", format"\n", ##__VA_ARGS__)
-#define RBUSLOG_DEBUG(format, ...)       RDK_LOG(RDK_LOG_DEBUG,  "LOG.RDK.RBUS", format"\n", ##__VA_ARGS__)
-#define RBUSLOG_INFO(format, ...)        RDK_LOG(RDK_LOG_INFO,   "LOG.RDK.RBUS", format"\n", ##__VA_ARGS__)
-#define RBUSLOG_WARN(format, ...)        RDK_LOG(RDK_LOG_WARN,   "LOG.RDK.RBUS", format"\n", ##__VA_ARGS__)
-#define RBUSLOG_ERROR(format, ...)       RDK_LOG(RDK_LOG_ERROR,  "LOG.RDK.RBUS", format"\n", ##__VA_ARGS__)
-#define RBUSLOG_FATAL(format, ...)       RDK_LOG(RDK_LOG_FATAL,  "LOG.RDK.RBUS", format"\n", ##__VA_ARGS__)
+#define RBUSLOG_RDK_LEVEL_TRACE RDK_LOG_TRACE1
+#define RBUSLOG_RDK_LEVEL_DEBUG RDK_LOG_DEBUG
+#define RBUSLOG_RDK_LEVEL_INFO  RDK_LOG_INFO
+#define RBUSLOG_RDK_LEVEL_WARN  RDK_LOG_WARN
+#define RBUSLOG_RDK_LEVEL_ERROR RDK_LOG_ERROR
+#define RBUSLOG_RDK_LEVEL_FATAL RDK_LOG_FATAL
+
+#define RBUSLOG_ENABLED(level) \
+    (RBUS_LOG_LEVEL_##level >= RBUS_LOG_MIN_LEVEL && rdk_dbg_enabled("LOG.RDK.RBUS", RBUSLOG_RDK_LEVEL_##level))
+
+#define RBUSLOG_PRINT(level, format, ...) \
+    do { if(RBUSLOG_ENABLED(level)) RDK_LOG(RBUSLOG_RDK_LEVEL_##level, "LOG.RDK.RBUS", format"\n", ##__VA_ARGS__); } while(0)
 
 #else
 
-#define RBUSLOG_TRACE rtLog_Debug
-#define RBUSLOG_DEBUG rtLog_Debug
-#define RBUSLOG_INFO rtLog_Info
-#define RBUSLOG_WARN rtLog_Warn
-#define RBUSLOG_ERROR rtLog_Error
-#define RBUSLOG_FATAL rtLog_Fatal
+#define RBUSLOG_RT_LEVEL_TRACE  RT_LOG_DEBUG
+#define RBUSLOG_RT_LEVEL_DEBUG  RT_LOG_DEBUG
+#define RBUSLOG_RT_LEVEL_INFO   RT_LOG_INFO
+#define RBUSLOG_RT_LEVEL_WARN   RT_LOG_WARN
+#define RBUSLOG_RT_LEVEL_ERROR  RT_LOG_ERROR
+#define RBUSLOG_RT_LEVEL_FATAL  RT_LOG_FATAL
+
+#define RBUSLOG_ENABLED(level) \
+    (RBUS_LOG_LEVEL_##level >= RBUS_LOG_MIN_LEVEL && (int)rtLog_GetLevel() <= (int)RBUSLOG_RT_LEVEL_##level)
+
+#define RBUSLOG_PRINT_TRACE rtLog_Debug
+#define RBUSLOG_PRINT_DEBUG rtLog_Debug
+#define RBUSLOG_PRINT_INFO  rtLog_Info
+#define RBUSLOG_PRINT_WARN  rtLog_Warn
+#define RBUSLOG_PRINT_ERROR rtLog_Error
+#define RBUSLOG_PRINT_FATAL rtLog_Fatal
+
+#define RBUSLOG_PRINT(level, format, ...) \
+    do { if(RBUSLOG_ENABLED(level)) RBUSLOG_PRINT_##level(format, ##__VA_ARGS__); } while(0)
 
 #endif /* ENABLE_RDKLOGGER */
+
+#define RBUSLOG_TRACE(format, ...)       RBUSLOG_PRINT(TRACE, format, ##__VA_ARGS__)
+#define RBUSLOG_DEBUG(format, ...)       RBUSLOG_PRINT(DEBUG, format, ##__VA_ARGS__)
+#define RBUSLOG_INFO(format, ...)        RBUSLOG_PRINT(INFO,  format, ##__VA_ARGS__)
+#define RBUSLOG_WARN(format, ...)        RBUSLOG_PRINT(WARN,  format, ##__VA_ARGS__)
+#define RBUSLOG_ERROR(format, ...)       RBUSLOG_PRINT(ERROR, format, ##__VA_ARGS__)
+#define RBUSLOG_FATAL(format, ...)       RBUSLOG_PRINT(FATAL, format, ##__VA_ARGS__)
 #endif
 
 /** @} */
@@ -18,17 +18,301 @@
 */
 #include "rbus.h"
 #include "rbus_handle.h"
+#include "rbus_message_internal.h"
+#include "rbus_delivery.h"
+#include "rbus_config.h"
+#include <rtTime.h>
 #include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <dirent.h>
+#include <signal.h>
+#include <arpa/inet.h>
+
+/*messages up to this size are gathered by rbusMessage_SendV on the stack*/
+#define SENDV_STACK_BUFFER_SIZE 1024
+
+/*a message queued by rbusMessage_SendAsync, owning copies of its topic and data*/
+typedef struct _rbusMessageSendItem
+{
+    rbusMessage_t                   message;
+    rbusMessageSendCallback_t       callback;
+    void*                           userData;
+    struct _rbusMessageSendItem*    next;
+} rbusMessageSendItem_t;
+
+/*Each send thread waits for the confirmation of one message at a time, so the
+  number of threads bounds how many messages are in flight.  Threads are started
+  on demand up to the window, and pending counts queued and in flight messages.*/
+struct _rbusMessageSendQueue
+{
+    rbusHandle_t            handle;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          condQueued;
+    pthread_cond_t          condDone;
+    rbusMessageSendItem_t*  head;
+    rbusMessageSendItem_t*  tail;
+    int                     pending;
+    int                     window;
+    int                     numThreads;
+    pthread_t               threads[RBUS_SEND_WINDOW_MAX];
+    bool                    closing;
+    bool                    freeOnExit; /*closed from a callback, so the thread running it frees the queue*/
+};
+
+static pthread_mutex_t gSendQueueCreateMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*With RBUS_MESSAGE_SHARED_MEMORY a large message is sent as this descriptor of the
+  POSIX shared memory object which holds its data.  Descriptors go to the message's
+  topic under SHM_TOPIC_PREFIX, which every listener also subscribes to, so they are
+  told apart from ordinary messages by topic rather than by their contents.*/
+#define SHM_MAGIC "rbus-shm"
+#define SHM_FILE_PREFIX "rbus-msg-"
+#define SHM_NAME_PREFIX "/" SHM_FILE_PREFIX
+#define SHM_TOPIC_PREFIX "_rbus.shm."
+
+/*rbusMessage_SendBatch packs consecutive messages to the same topic into a single
+  frame, sent under SHM_TOPIC_PREFIX like the descriptors, which holds BATCH_MAGIC,
+  the number of messages and then each message's length and data, all in network
+  byte order.  Listeners unpack it and dispatch its messages in order.*/
+#define BATCH_MAGIC "rbus-bat"
+#define BATCH_HEADER_SIZE 12
+#define BATCH_FRAME_MAX (64 * 1024)
+
+typedef struct
+{
+    char        magic[8];
+    uint64_t    length;
+    char        name[48];
+} rbusMessageShmDescriptor_t;
+
+/*an object kept until rbusConfig shmLinger passes so listeners have time to map it*/
+typedef struct _rbusMessageShmSegment
+{
+    rbusHandle_t                    handle;
+    char                            name[48];
+    rtTime_t                        expires;
+    struct _rbusMessageShmSegment*  next;
+} rbusMessageShmSegment_t;
+
+static pthread_mutex_t gShmMutex = PTHREAD_MUTEX_INITIALIZER;
+static rbusMessageShmSegment_t* gShmSegments = NULL;
+static uint32_t gShmSequence = 0;
+static pthread_once_t gShmOnce = PTHREAD_ONCE_INIT;
+
+/*data a handler kept with rbusMessage_RetainData: a mapped view, which is also
+  listed while its handlers run, or a copy of an ordinary message*/
+typedef struct _rbusMessageRetained
+{
+    uint8_t const*                  data;
+    uint32_t                        length;
+    bool                            mapped;
+    int                             refs;
+    struct _rbusMessageRetained*    next;
+} rbusMessageRetained_t;
+
+static pthread_mutex_t gRetainedMutex = PTHREAD_MUTEX_INITIALIZER;
+static rbusMessageRetained_t* gRetained = NULL;
+
+/*unlink the objects which have expired or, if handle isn't NULL, all those sent with it*/
+static void rbusMessage_UnlinkShared(rbusHandle_t handle)
+{
+    rbusMessageShmSegment_t** pseg;
+    rtTime_t now;
+
+    rtTime_Now(&now);
+    pthread_mutex_lock(&gShmMutex);
+    for (pseg = &gShmSegments; *pseg; )
+    {
+        rbusMessageShmSegment_t* seg = *pseg;
+        if (handle ? seg->handle == handle : rtTime_Compare(&seg->expires, &now) <= 0)
+        {
+            shm_unlink(seg->name);
+            *pseg = seg->next;
+            free(seg);
+        }
+        else
+        {
+            pseg = &seg->next;
+        }
+    }
+    pthread_mutex_unlock(&gShmMutex);
+}
+
+/*objects still waiting for listeners when the process exits without rbus_close*/
+static void rbusMessage_UnlinkSharedAtExit(void)
+{
+    rbusMessageShmSegment_t* seg;
+
+    pthread_mutex_lock(&gShmMutex);
+    for (seg = gShmSegments; seg; seg = seg->next)
+        shm_unlink(seg->name);
+    pthread_mutex_unlock(&gShmMutex);
+}
+
+/*unlink the objects left by senders which died before they could, then make sure
+  this process cleans up after itself*/
+static void rbusMessage_InitShared(void)
+{
+    DIR* dir = opendir("/dev/shm");
+
+    if (dir)
+    {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL)
+        {
+            char name[NAME_MAX + 2];
+            int pid;
+            unsigned seq;
+
+            if (sscanf(entry->d_name, SHM_FILE_PREFIX "%d-%u", &pid, &seq) == 2 &&
+                kill((pid_t)pid, 0) != 0 && errno == ESRCH)
+            {
+                snprintf(name, sizeof(name), "/%s", entry->d_name);
+                RBUSLOG_INFO("unlinking %s left by a process which exited", name);
+                shm_unlink(name);
+            }
+        }
+        closedir(dir);
+    }
+    atexit(rbusMessage_UnlinkSharedAtExit);
+}
+
+/*list data with one reference; return false if it can't be*/
+static bool rbusMessage_ListView(uint8_t const* data, uint32_t length, bool mapped)
+{
+    rbusMessageRetained_t* retained = malloc(sizeof(rbusMessageRetained_t));
+
+    if (!retained)
+        return false;
+    retained->data = data;
+    retained->length = length;
+    retained->mapped = mapped;
+    retained->refs = 1;
+    pthread_mutex_lock(&gRetainedMutex);
+    retained->next = gRetained;
+    gRetained = retained;
+    pthread_mutex_unlock(&gRetainedMutex);
+    return true;
+}
+
+/*drop a reference, unmapping or freeing the data with the last*/
+static bool rbusMessage_ReleaseView(uint8_t const* data)
+{
+    rbusMessageRetained_t** pretained;
+    rbusMessageRetained_t* retained = NULL;
+
+    pthread_mutex_lock(&gRetainedMutex);
+    for (pretained = &gRetained; *pretained; pretained = &(*pretained)->next)
+    {
+        if ((*pretained)->data == data)
+        {
+            retained = *pretained;
+            if (--retained->refs == 0)
+                *pretained = retained->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gRetainedMutex);
+
+    if (!retained)
+        return false;
+    if (retained->refs == 0)
+    {
+        if (retained->mapped)
+            munmap((void*)retained->data, retained->length);
+        else
+            free((void*)retained->data);
+        free(retained);
+    }
+    return true;
+}
+
+/*map the data of a descriptor read-only, returning NULL if it can't be*/
+static void* rbusMessage_MapShared(uint8_t const* buff, uint32_t* length)
+{
+    rbusMessageShmDescriptor_t desc;
+    struct stat st;
+    void* view;
+    int fd;
+
+    memcpy(&desc, buff, sizeof(desc));
+    desc.name[sizeof(desc.name)-1] = 0;
+    if (strncmp(desc.name, SHM_NAME_PREFIX, strlen(SHM_NAME_PREFIX)) || strchr(desc.name+1, '/') ||
+        desc.length == 0 || desc.length > INT32_MAX)
+    {
+        RBUSLOG_WARN("invalid shared memory descriptor %s", desc.name);
+        return NULL;
+    }
+
+    fd = shm_open(desc.name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        RBUSLOG_WARN("shm_open %s failed: %s", desc.name, strerror(errno));
+        return NULL;
+    }
+    view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (uint64_t)st.st_size >= desc.length)
+        view = mmap(NULL, desc.length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        RBUSLOG_WARN("failed to map %s", desc.name);
+        return NULL;
+    }
+    *length = (uint32_t)desc.length;
+    return view;
+}
 
 typedef struct
 {
-    rbusHandle_t          handle;
-    char*                 expression;
     rbusMessageHandler_t  handler;
     void*                 userData;
-    rtConnection          connection;
 } rbusMessageHandlerContext_t;
 
+/*Listeners are kept in a trie keyed on the '.' separated segments of their
+  expression, with the children of each node sorted by segment so adding and
+  removing a listener costs one binary search per segment rather than a scan
+  of every listener.  The trie only finds listeners by expression: matching
+  messages to expressions, wildcards included, is still done by the broker and
+  the connection, and the node is the closure the connection hands back.  An
+  expression has at most one listener, as the connection only takes one
+  registration for it.  A node is pending while the connection is called
+  unlocked to register or unregister it, and others wait for that to finish
+  before using the node.*/
+typedef struct _rbusMessageListenerNode
+{
+    char*                               segment;
+    char*                               expression; /*set while registered with the connection*/
+    struct _rbusMessageListenerNode*    parent;
+    struct _rbusMessageListenerNode**   children;
+    int                                 numChildren;
+    int                                 capChildren;
+    rbusMessageHandlerContext_t         context;
+    struct _rbusMessageListeners*       listeners;
+    uintptr_t                           key;        /*orders its messages on delivery threads, never reused*/
+    bool                                pending;
+} rbusMessageListenerNode_t;
+
+struct _rbusMessageListeners
+{
+    rbusHandle_t                handle;
+    pthread_mutex_t             mutex;
+    pthread_cond_t              condPending;
+    int                         numPending;
+    rbusMessageListenerNode_t   root;
+};
+
+static uintptr_t gListenerKey = 0;
+
+static pthread_mutex_t gListenersCreateMutex = PTHREAD_MUTEX_INITIALIZER;
+
 rbusError_t rtError_to_rBusError(rtError e)
 {
     rbusError_t err;
@@ -44,46 +328,435 @@ rbusError_t rtError_to_rBusError(rtError e)
     return err;
 }
 
-static void rtMessage_CallbackHandler(rtMessageHeader const* hdr, uint8_t const* buff, uint32_t n, void* userData)
+static int rbusMessage_CompareSegment(char const* segment, size_t len, char const* other)
+{
+    int rc = strncmp(segment, other, len);
+    if (rc == 0 && other[len] != '\0')
+        rc = -1;
+    return rc;
+}
+
+static rbusMessageListenerNode_t* rbusMessage_FindChild(
+    rbusMessageListenerNode_t* node,
+    char const* segment,
+    size_t len,
+    bool create)
 {
-    rbusMessageHandlerContext_t* ctx = (rbusMessageHandlerContext_t*)userData;
+    rbusMessageListenerNode_t* child;
+    int low = 0;
+    int high = node->numChildren - 1;
+
+    while (low <= high)
+    {
+        int mid = low + (high - low) / 2;
+        int rc = rbusMessage_CompareSegment(segment, len, node->children[mid]->segment);
+        if (rc == 0)
+            return node->children[mid];
+        if (rc < 0)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+
+    if (!create)
+        return NULL;
+
+    if (node->numChildren == node->capChildren)
+    {
+        int cap = node->capChildren ? node->capChildren * 2 : 4;
+        rbusMessageListenerNode_t** children = realloc(node->children, cap * sizeof(rbusMessageListenerNode_t*));
+        if (!children)
+            return NULL;
+        node->children = children;
+        node->capChildren = cap;
+    }
+
+    child = calloc(1, sizeof(rbusMessageListenerNode_t));
+    if (!child)
+        return NULL;
+    child->segment = strndup(segment, len);
+    if (!child->segment)
+    {
+        free(child);
+        return NULL;
+    }
+    child->parent = node;
+    child->listeners = node->listeners;
+
+    memmove(&node->children[low + 1], &node->children[low], (node->numChildren - low) * sizeof(rbusMessageListenerNode_t*));
+    node->children[low] = child;
+    node->numChildren++;
+    return child;
+}
+
+static rbusMessageListenerNode_t* rbusMessage_FindNode(
+    struct _rbusMessageListeners* listeners,
+    char const* expression,
+    bool create)
+{
+    rbusMessageListenerNode_t* node = &listeners->root;
+    char const* segment = expression;
+
+    for (;;)
+    {
+        char const* dot = strchr(segment, '.');
+        size_t len = dot ? (size_t)(dot - segment) : strlen(segment);
+
+        node = rbusMessage_FindChild(node, segment, len, create);
+        if (!node || !dot)
+            return node;
+        segment = dot + 1;
+    }
+}
+
+static void rbusMessage_FreeNode(rbusMessageListenerNode_t* node)
+{
+    int i;
+    for (i = 0; i < node->numChildren; ++i)
+        rbusMessage_FreeNode(node->children[i]);
+    free(node->children);
+    free(node->expression);
+    free(node->segment);
+    free(node);
+}
+
+/*remove nodes left with no listeners and no children, from node up toward the root*/
+static void rbusMessage_PruneNode(rbusMessageListenerNode_t* node)
+{
+    while (node->parent && node->numChildren == 0 && !node->expression)
+    {
+        rbusMessageListenerNode_t* parent = node->parent;
+        int i;
+
+        for (i = 0; i < parent->numChildren; ++i)
+        {
+            if (parent->children[i] == node)
+            {
+                memmove(&parent->children[i], &parent->children[i + 1], (parent->numChildren - i - 1) * sizeof(rbusMessageListenerNode_t*));
+                parent->numChildren--;
+                break;
+            }
+        }
+        rbusMessage_FreeNode(node);
+        node = parent;
+    }
+}
+
+static void rbusMessage_CollectExpressions(rbusMessageListenerNode_t* node, rtVector expressions, rtVector keys)
+{
+    int i;
+    if (node->expression)
+    {
+        char* expression = strdup(node->expression);
+        if (expression)
+        {
+            rtVector_PushBack(expressions, expression);
+            rtVector_PushBack(keys, (void*)node->key);
+        }
+    }
+    for (i = 0; i < node->numChildren; ++i)
+        rbusMessage_CollectExpressions(node->children[i], expressions, keys);
+}
+
+static struct _rbusMessageListeners* rbusMessage_GetListeners(rbusHandle_t handle)
+{
+    struct _rbusMessageListeners* listeners;
+
+    pthread_mutex_lock(&gListenersCreateMutex);
+    listeners = handle->messageListeners;
+    if (!listeners)
+    {
+        listeners = calloc(1, sizeof(struct _rbusMessageListeners));
+        if (listeners)
+        {
+            listeners->handle = handle;
+            listeners->root.listeners = listeners;
+            pthread_mutex_init(&listeners->mutex, NULL);
+            pthread_cond_init(&listeners->condPending, NULL);
+            handle->messageListeners = listeners;
+        }
+    }
+    pthread_mutex_unlock(&gListenersCreateMutex);
+    return listeners;
+}
+
+/*a message queued for a delivery thread, owning copies of its topic and data*/
+typedef struct
+{
+    rbusHandle_t                    handle;
+    rbusMessage_t                   message;
+    rbusMessageHandlerContext_t     context;
+} rbusMessageDelivery_t;
+
+static rbusMessageDelivery_t* rbusMessage_CreateDelivery(
+    rbusHandle_t handle,
+    char const* topic,
+    uint8_t const* data,
+    uint32_t length,
+    rbusMessageHandlerContext_t const* context)
+{
+    rbusMessageDelivery_t* delivery = malloc(sizeof(rbusMessageDelivery_t));
+    if (!delivery)
+        return NULL;
+    delivery->handle = handle;
+    delivery->message.topic = strdup(topic);
+    delivery->message.data = malloc(length ? length : 1);
+    delivery->message.length = length;
+    delivery->context = *context;
+    if (!delivery->message.topic || !delivery->message.data)
+    {
+        free((void*)delivery->message.topic);
+        free((void*)delivery->message.data);
+        free(delivery);
+        return NULL;
+    }
+    if (length)
+        memcpy((void*)delivery->message.data, data, length);
+    return delivery;
+}
+
+static void rbusMessage_RunDelivery(void* p)
+{
+    rbusMessageDelivery_t* delivery = (rbusMessageDelivery_t*)p;
+
+    if (delivery->context.handler)
+        delivery->context.handler(delivery->handle, &delivery->message, delivery->context.userData);
+}
+
+static void rbusMessage_ReleaseDelivery(void* p)
+{
+    rbusMessageDelivery_t* delivery = (rbusMessageDelivery_t*)p;
+
+    free((void*)delivery->message.topic);
+    free((void*)delivery->message.data);
+    free(delivery);
+}
+
+static void rbusMessage_Dispatch(
+    rbusMessageListenerNode_t* node,
+    rtMessageHeader const* hdr,
+    char const* topic,
+    uint8_t const* buff,
+    uint32_t n)
+{
+    struct _rbusMessageListeners* listeners = node->listeners;
+    rbusMessageHandlerContext_t context;
+    rbusMessage_t message;
 
     // if this is request, the sender wants confirmation of receipt
     // do that before dispatching application callback
-    if (rtMessageHeader_IsRequest(hdr))
+    // hdr is NULL for the messages of a batch after the first, which confirmed them all
+    if (hdr && rtMessageHeader_IsRequest(hdr))
     {
         uint8_t res = 0;
         uint32_t resLength = (uint32_t) sizeof(res);
 
-        rtError e = rtConnection_SendBinaryResponse(ctx->connection, hdr, &res, resLength, 2000);
+        rtError e = rtConnection_SendBinaryResponse(listeners->handle->connection, hdr, &res, resLength, 2000);
         if (e != RT_OK)
         {
             RBUSLOG_WARN("error sending response for confirmed receipt. %s", rtStrError(e));
         }
     }
 
-    if (ctx->handler)
+    /*copy the handler so it runs unlocked and may add or remove listeners itself*/
+    pthread_mutex_lock(&listeners->mutex);
+    context = node->context;
+    pthread_mutex_unlock(&listeners->mutex);
+    if (!context.handler)
+        return;
+
+    if (listeners->handle->delivery)
+    {
+        rbusMessageDelivery_t* delivery = rbusMessage_CreateDelivery(listeners->handle, topic, buff, n, &context);
+        if (delivery && rbusDelivery_Submit(listeners->handle, (void const*)node->key, rbusMessage_RunDelivery, rbusMessage_ReleaseDelivery, delivery))
+            return;
+        if (delivery)
+            rbusMessage_ReleaseDelivery(delivery);
+    }
+
+    message.topic = topic;
+    message.data = buff;
+    message.length = n;
+    context.handler(listeners->handle, &message, context.userData);
+}
+
+static void rtMessage_CallbackHandler(rtMessageHeader const* hdr, uint8_t const* buff, uint32_t n, void* userData)
+{
+    rbusMessage_Dispatch((rbusMessageListenerNode_t*)userData, hdr, hdr->topic, buff, n);
+}
+
+/*dispatch the messages packed in a batch frame, in order, after checking the whole frame*/
+static void rbusMessage_DispatchBatch(
+    rbusMessageListenerNode_t* node,
+    rtMessageHeader const* hdr,
+    char const* topic,
+    uint8_t const* buff,
+    uint32_t n)
+{
+    uint32_t count, i, offset, length;
+
+    memcpy(&count, buff + sizeof(((rbusMessageShmDescriptor_t*)0)->magic), sizeof(count));
+    count = ntohl(count);
+    for (i = 0, offset = BATCH_HEADER_SIZE; i < count; ++i, offset += length)
+    {
+        if (n - offset < sizeof(length))
+            break;
+        memcpy(&length, buff + offset, sizeof(length));
+        length = ntohl(length);
+        offset += sizeof(length);
+        if (length > n - offset)
+            break;
+    }
+    if (i < count || offset != n)
+    {
+        RBUSLOG_WARN("invalid batch of %u messages sent to %s", count, hdr->topic);
+        return;
+    }
+
+    for (i = 0, offset = BATCH_HEADER_SIZE; i < count; ++i, offset += length)
+    {
+        memcpy(&length, buff + offset, sizeof(length));
+        length = ntohl(length);
+        offset += sizeof(length);
+        rbusMessage_Dispatch(node, i == 0 ? hdr : NULL, topic, buff + offset, length);
+    }
+}
+
+static void rtMessage_SharedCallbackHandler(rtMessageHeader const* hdr, uint8_t const* buff, uint32_t n, void* userData)
+{
+    uint8_t const* view;
+    uint32_t length = 0;
+    bool listed;
+
+    if (n >= BATCH_HEADER_SIZE && memcmp(buff, BATCH_MAGIC, sizeof(((rbusMessageShmDescriptor_t*)0)->magic)) == 0 &&
+        strncmp(hdr->topic, SHM_TOPIC_PREFIX, strlen(SHM_TOPIC_PREFIX)) == 0)
+    {
+        rbusMessage_DispatchBatch((rbusMessageListenerNode_t*)userData, hdr, hdr->topic + strlen(SHM_TOPIC_PREFIX), buff, n);
+        return;
+    }
+
+    if (n != sizeof(rbusMessageShmDescriptor_t) || memcmp(buff, SHM_MAGIC, sizeof(((rbusMessageShmDescriptor_t*)0)->magic)) != 0 ||
+        strncmp(hdr->topic, SHM_TOPIC_PREFIX, strlen(SHM_TOPIC_PREFIX)) != 0)
+    {
+        RBUSLOG_WARN("invalid shared memory descriptor sent to %s", hdr->topic);
+        return;
+    }
+
+    /*map before confirming receipt since the sender unlinks the object once confirmed,
+      and if it can't be mapped don't confirm so the sender sees the failure*/
+    view = rbusMessage_MapShared(buff, &length);
+    if (!view)
+        return;
+
+    /*listed so handlers can keep it with rbusMessage_RetainData*/
+    listed = rbusMessage_ListView(view, length, true);
+    rbusMessage_Dispatch((rbusMessageListenerNode_t*)userData, hdr, hdr->topic + strlen(SHM_TOPIC_PREFIX), view, length);
+    if (!listed)
+        munmap((void*)view, length);
+    else
+        rbusMessage_ReleaseView(view);
+}
+
+rbusError_t rbusMessage_RetainData(
+    rbusMessage_t const* message,
+    uint8_t const** data)
+{
+    uint8_t* copy;
+    bool mapped = false;
+    rbusMessageRetained_t* retained;
+
+    if (!message || !data || message->length < 0 || (message->length > 0 && !message->data))
+        return RBUS_ERROR_INVALID_INPUT;
+
+    /*a mapped view is kept as is, anything else is copied*/
+    pthread_mutex_lock(&gRetainedMutex);
+    for (retained = gRetained; retained; retained = retained->next)
     {
-        rbusMessage_t message;
-        message.topic = hdr->topic;
-        message.data = buff;
-        message.length = n;
+        if (retained->data == message->data && retained->mapped)
+        {
+            retained->refs++;
+            mapped = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gRetainedMutex);
+    if (mapped)
+    {
+        *data = message->data;
+        return RBUS_ERROR_SUCCESS;
+    }
 
-        ctx->handler(ctx->handle, &message, ctx->userData);
+    copy = malloc(message->length > 0 ? message->length : 1);
+    if (!copy)
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    if (message->length > 0)
+        memcpy(copy, message->data, message->length);
+    if (!rbusMessage_ListView(copy, (uint32_t)message->length, false))
+    {
+        free(copy);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
     }
+    *data = copy;
+    return RBUS_ERROR_SUCCESS;
 }
 
-static void cleanupContext(void * p)
+rbusError_t rbusMessage_ReleaseData(
+    uint8_t const* data)
 {
-    rbusMessageHandlerContext_t* ctx = (rbusMessageHandlerContext_t*)p;
-    if(ctx->expression)
-        free(ctx->expression);
-    free(ctx);
+    if (!data || !rbusMessage_ReleaseView(data))
+        return RBUS_ERROR_INVALID_INPUT;
+    return RBUS_ERROR_SUCCESS;
 }
 
-static int compareContextExpression(const void *left, const void *right)
+/*the topic shared memory descriptors of messages sent to topic are sent to*/
+static char* rbusMessage_SharedTopic(char const* topic)
 {
-    return strcmp(((const rbusMessageHandlerContext_t*)left)->expression, (const char*)right);
+    size_t size = strlen(SHM_TOPIC_PREFIX) + strlen(topic) + 1;
+    char* shared = malloc(size);
+
+    if (shared)
+        snprintf(shared, size, SHM_TOPIC_PREFIX"%s", topic);
+    return shared;
+}
+
+/*subscribe node to the descriptors sent under expression, or unsubscribe if node is NULL*/
+static rtError rbusMessage_SharedListener(rbusHandle_t handle, char const* expression, rbusMessageListenerNode_t* node)
+{
+    char* shared = rbusMessage_SharedTopic(expression);
+    rtError e;
+
+    if (!shared)
+        return RT_ERROR;
+    if (node)
+        e = rtConnection_AddListener(handle->connection, shared, &rtMessage_SharedCallbackHandler, node);
+    else
+        e = rtConnection_RemoveListener(handle->connection, shared);
+    free(shared);
+    return e;
+}
+
+/*find or create the node for expression once nobody is registering or unregistering it;
+  called locked*/
+static rbusMessageListenerNode_t* rbusMessage_WaitNode(
+    struct _rbusMessageListeners* listeners,
+    char const* expression,
+    bool create)
+{
+    rbusMessageListenerNode_t* node;
+
+    /*look the node up again after each wait since it may have been pruned meanwhile*/
+    while ((node = rbusMessage_FindNode(listeners, expression, create)) != NULL && node->pending)
+        pthread_cond_wait(&listeners->condPending, &listeners->mutex);
+    return node;
+}
+
+/*called locked*/
+static void rbusMessage_SetPending(struct _rbusMessageListeners* listeners, rbusMessageListenerNode_t* node, bool pending)
+{
+    node->pending = pending;
+    listeners->numPending += pending ? 1 : -1;
+    if (!pending)
+        pthread_cond_broadcast(&listeners->condPending);
 }
 
 rbusError_t rbusMessage_AddListener(
@@ -92,71 +765,168 @@ rbusError_t rbusMessage_AddListener(
     rbusMessageHandler_t handler,
     void* userData)
 {
-    rtConnection con = ((struct _rbusHandle*)handle)->connection;
+    struct _rbusMessageListeners* listeners;
+    rbusMessageListenerNode_t* node;
+    rtError e;
+
+    if (!handle || !expression)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    listeners = rbusMessage_GetListeners(handle);
+    if (!listeners)
+        return RBUS_ERROR_OUT_OF_RESOURCES;
 
-    rbusMessageHandlerContext_t* ctx = malloc(sizeof(rbusMessageHandlerContext_t));
-    ctx->handle = handle;
-    ctx->expression = strdup(expression);
-    ctx->handler = handler;
-    ctx->userData = userData;
-    ctx->connection = con;
-    rtVector_PushBack(handle->messageCallbacks, ctx);
+    pthread_mutex_lock(&listeners->mutex);
+    node = rbusMessage_WaitNode(listeners, expression, true);
+    if (node && node->expression)
+    {
+        pthread_mutex_unlock(&listeners->mutex);
+        RBUSLOG_WARN("rbusMessage_AddListener: %s already has a listener", expression);
+        return RBUS_ERROR_INVALID_INPUT;
+    }
+    if (node)
+        node->expression = strdup(expression);
+    if (!node || !node->expression)
+    {
+        if (node)
+            rbusMessage_PruneNode(node);
+        pthread_mutex_unlock(&listeners->mutex);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+    node->context.handler = handler;
+    node->context.userData = userData;
+    node->key = __atomic_add_fetch(&gListenerKey, 1, __ATOMIC_RELAXED);
+    rbusMessage_SetPending(listeners, node, true);
+    pthread_mutex_unlock(&listeners->mutex);
 
-    rtError e = rtConnection_AddListener(con, expression, &rtMessage_CallbackHandler, ctx);
+    /*the connection is called unlocked since it may be dispatching to this trie*/
+    e = rtConnection_AddListener(handle->connection, expression, &rtMessage_CallbackHandler, node);
+    if (e == RT_OK)
+    {
+        e = rbusMessage_SharedListener(handle, expression, node);
+        if (e != RT_OK)
+            rtConnection_RemoveListener(handle->connection, expression);
+    }
+
+    pthread_mutex_lock(&listeners->mutex);
+    rbusMessage_SetPending(listeners, node, false);
     if (e != RT_OK)
     {
+        /*anyone who waited on the node tries to subscribe themselves*/
         RBUSLOG_WARN("rtConnection_AddListener:%s", rtStrError(e));
-        return RBUS_ERROR_BUS_ERROR;
+        memset(&node->context, 0, sizeof(node->context));
+        free(node->expression);
+        node->expression = NULL;
+        rbusMessage_PruneNode(node);
     }
+    pthread_mutex_unlock(&listeners->mutex);
 
-    return RBUS_ERROR_SUCCESS;
+    return e == RT_OK ? RBUS_ERROR_SUCCESS : RBUS_ERROR_BUS_ERROR;
 }
 
 rbusError_t rbusMessage_RemoveListener(
     rbusHandle_t handle,
     char const* expression)
 {
-    rtConnection con = ((struct _rbusHandle*)handle)->connection;
+    struct _rbusMessageListeners* listeners;
+    rbusMessageListenerNode_t* node = NULL;
+    uintptr_t key = 0;
+    rtError e;
+
+    if (!handle || !expression)
+        return RBUS_ERROR_INVALID_INPUT;
 
-    rtVector_RemoveItemByCompare(handle->messageCallbacks, expression, compareContextExpression, cleanupContext);
+    listeners = handle->messageListeners;
+    if (listeners)
+    {
+        pthread_mutex_lock(&listeners->mutex);
+        node = rbusMessage_WaitNode(listeners, expression, false);
+        if (node && node->expression)
+            rbusMessage_SetPending(listeners, node, true);
+        else
+            node = NULL;
+        pthread_mutex_unlock(&listeners->mutex);
+    }
 
-    rtError e = rtConnection_RemoveListener(con, expression);
+    /*unsubscribe first so the connection no longer dispatches to the node freed below*/
+    e = rtConnection_RemoveListener(handle->connection, expression);
     if (e != RT_OK)
     {
         RBUSLOG_WARN("rtConnection_RemoveListener:%s", rtStrError(e));
-        return RBUS_ERROR_BUS_ERROR;
     }
+    rbusMessage_SharedListener(handle, expression, NULL);
 
-    return RBUS_ERROR_SUCCESS;
+    if (node)
+    {
+        pthread_mutex_lock(&listeners->mutex);
+        key = node->key;
+        memset(&node->context, 0, sizeof(node->context));
+        free(node->expression);
+        node->expression = NULL;
+        rbusMessage_SetPending(listeners, node, false);
+        rbusMessage_PruneNode(node);
+        pthread_mutex_unlock(&listeners->mutex);
+
+        rbusDelivery_Cancel(handle, (void const*)key, NULL, NULL);
+    }
+
+    return e == RT_OK ? RBUS_ERROR_SUCCESS : RBUS_ERROR_BUS_ERROR;
 }
 
 rbusError_t rbusMessage_RemoveAllListeners(
     rbusHandle_t handle)
 {
-    rtConnection con = ((struct _rbusHandle*)handle)->connection;
+    struct _rbusMessageListeners* listeners;
+    rtVector expressions;
+    rtVector keys;
     int i, n;
 
-    for (i = 0, n = rtVector_Size(handle->messageCallbacks); i < n; ++i)
+    if (!handle)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    listeners = handle->messageListeners;
+    if (!listeners)
+        return RBUS_ERROR_SUCCESS;
+
+    rtVector_Create(&expressions);
+    rtVector_Create(&keys);
+    pthread_mutex_lock(&listeners->mutex);
+    while (listeners->numPending)
+        pthread_cond_wait(&listeners->condPending, &listeners->mutex);
+    rbusMessage_CollectExpressions(&listeners->root, expressions, keys);
+    pthread_mutex_unlock(&listeners->mutex);
+
+    for (i = 0, n = rtVector_Size(expressions); i < n; ++i)
     {
-        rbusMessageHandlerContext_t* ctx = rtVector_At(handle->messageCallbacks, i);
-        rtError e = rtConnection_RemoveListener(con, ctx->expression);
+        char const* expression = rtVector_At(expressions, i);
+        rtError e = rtConnection_RemoveListener(handle->connection, expression);
         if (e != RT_OK)
         {
-            RBUSLOG_WARN("rbusMessage_RemoveAllListener %s :%s", ctx->expression, rtStrError(e));
-        }    
-        free(ctx->expression);
-        free(ctx);
+            RBUSLOG_WARN("rbusMessage_RemoveAllListener %s :%s", expression, rtStrError(e));
+        }
+        rbusMessage_SharedListener(handle, expression, NULL);
     }
+    rtVector_Destroy(expressions, free);
+
+    pthread_mutex_lock(&listeners->mutex);
+    while (listeners->numPending)
+        pthread_cond_wait(&listeners->condPending, &listeners->mutex);
+    for (i = 0; i < listeners->root.numChildren; ++i)
+        rbusMessage_FreeNode(listeners->root.children[i]);
+    listeners->root.numChildren = 0;
+    pthread_mutex_unlock(&listeners->mutex);
+
+    for (i = 0, n = rtVector_Size(keys); i < n; ++i)
+        rbusDelivery_Cancel(handle, rtVector_At(keys, i), NULL, NULL);
+    rtVector_Destroy(keys, NULL);
     return RBUS_ERROR_SUCCESS;
 }
 
-rbusError_t rbusMessage_Send(
-    rbusHandle_t handle,
+static rbusError_t rbusMessage_SendBinary(
+    rtConnection con,
     rbusMessage_t* message,
     rbusMessageSendOptions_t opts)
 {
-    rtConnection con = ((struct _rbusHandle*)handle)->connection;
-
     if (opts & RBUS_MESSAGE_CONFIRM_RECEIPT)
     {
         uint8_t * res = NULL;
@@ -183,3 +953,532 @@ rbusError_t rbusMessage_Send(
 
     return RBUS_ERROR_SUCCESS;
 }
+
+/*send the data gathered from iov, length bytes in all, through a shared memory object
+  which it is written straight into*/
+static rbusError_t rbusMessage_SendShared(
+    rbusHandle_t handle,
+    char const* topic,
+    struct iovec const* iov,
+    int iovcnt,
+    size_t length,
+    rbusMessageSendOptions_t opts)
+{
+    rbusMessageShmDescriptor_t desc;
+    rbusMessage_t descMessage;
+    rbusMessageShmSegment_t* seg = NULL;
+    rbusError_t err;
+    void* view = MAP_FAILED;
+    size_t offset = 0;
+    int fd, i;
+
+    pthread_once(&gShmOnce, rbusMessage_InitShared);
+    rbusMessage_UnlinkShared(NULL);
+
+    /*an unconfirmed message stays until listeners have had time to map it*/
+    if (!(opts & RBUS_MESSAGE_CONFIRM_RECEIPT))
+    {
+        seg = malloc(sizeof(rbusMessageShmSegment_t));
+        if (!seg)
+            return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+
+    memset(&desc, 0, sizeof(desc));
+    memcpy(desc.magic, SHM_MAGIC, sizeof(desc.magic));
+    desc.length = (uint64_t)length;
+    snprintf(desc.name, sizeof(desc.name), SHM_NAME_PREFIX"%d-%u", (int)getpid(),
+        __atomic_fetch_add(&gShmSequence, 1, __ATOMIC_RELAXED));
+
+    fd = shm_open(desc.name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        RBUSLOG_WARN("shm_open %s failed: %s", desc.name, strerror(errno));
+        free(seg);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+    if (ftruncate(fd, length) == 0)
+        view = mmap(NULL, length, PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        RBUSLOG_WARN("failed to create %s of %zu bytes", desc.name, length);
+        shm_unlink(desc.name);
+        free(seg);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+    for (i = 0; i < iovcnt; ++i)
+    {
+        if (iov[i].iov_len)
+            memcpy((uint8_t*)view + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+    munmap(view, length);
+
+    descMessage.topic = rbusMessage_SharedTopic(topic);
+    descMessage.data = (uint8_t const*)&desc;
+    descMessage.length = sizeof(desc);
+    err = descMessage.topic ? rbusMessage_SendBinary(handle->connection, &descMessage, opts) : RBUS_ERROR_OUT_OF_RESOURCES;
+    free((void*)descMessage.topic);
+
+    /*a confirmed receipt means the listener has it mapped already*/
+    if (!seg || err != RBUS_ERROR_SUCCESS)
+    {
+        shm_unlink(desc.name);
+        free(seg);
+        return err;
+    }
+
+    seg->handle = handle;
+    memcpy(seg->name, desc.name, sizeof(seg->name));
+    rtTime_Now(&seg->expires);
+    rtTime_Later(&seg->expires, rbusConfig_Get()->shmLinger, &seg->expires);
+    pthread_mutex_lock(&gShmMutex);
+    seg->next = gShmSegments;
+    gShmSegments = seg;
+    pthread_mutex_unlock(&gShmMutex);
+    return err;
+}
+
+static bool rbusMessage_SendsShared(size_t length, rbusMessageSendOptions_t opts)
+{
+    return (opts & RBUS_MESSAGE_SHARED_MEMORY) && length > (size_t)rbusConfig_Get()->shmThreshold;
+}
+
+rbusError_t rbusMessage_Send(
+    rbusHandle_t handle,
+    rbusMessage_t* message,
+    rbusMessageSendOptions_t opts)
+{
+    if (rbusMessage_SendsShared(message->length, opts))
+    {
+        struct iovec iov;
+        iov.iov_base = (void*)message->data;
+        iov.iov_len = message->length;
+        return rbusMessage_SendShared(handle, message->topic, &iov, 1, iov.iov_len, opts);
+    }
+
+    return rbusMessage_SendBinary(((struct _rbusHandle*)handle)->connection, message, opts);
+}
+
+/*the number of messages from the first which can go in one frame, checking each; a message
+  sent through shared memory or too large to share a frame with another goes on its own*/
+static int rbusMessage_BatchRun(
+    rbusMessage_t const* messages,
+    int count,
+    rbusMessageSendOptions_t opts,
+    size_t* frameLength)
+{
+    size_t length = BATCH_HEADER_SIZE;
+    int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        rbusMessage_t const* message = &messages[i];
+
+        if (!message->topic || message->length < 0 || (message->length > 0 && !message->data))
+            return -1;
+        if (rbusMessage_SendsShared(message->length, opts) ||
+            length + sizeof(uint32_t) + message->length > BATCH_FRAME_MAX ||
+            (i > 0 && strcmp(message->topic, messages[0].topic) != 0))
+            break;
+        length += sizeof(uint32_t) + message->length;
+    }
+    *frameLength = length;
+    return i ? i : 1;
+}
+
+static rbusError_t rbusMessage_SendFrame(
+    rbusHandle_t handle,
+    rbusMessage_t const* messages,
+    int count,
+    size_t length,
+    rbusMessageSendOptions_t opts)
+{
+    rbusMessage_t frame;
+    uint8_t* data;
+    size_t offset = BATCH_HEADER_SIZE;
+    uint32_t value;
+    rbusError_t err;
+    int i;
+
+    data = malloc(length);
+    frame.topic = rbusMessage_SharedTopic(messages[0].topic);
+    if (!data || !frame.topic)
+    {
+        RBUSLOG_WARN("rbusMessage_SendBatch failed to allocate a frame of %zu bytes for %s", length, messages[0].topic);
+        free(data);
+        free((void*)frame.topic);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+
+    memcpy(data, BATCH_MAGIC, sizeof(((rbusMessageShmDescriptor_t*)0)->magic));
+    value = htonl((uint32_t)count);
+    memcpy(data + sizeof(((rbusMessageShmDescriptor_t*)0)->magic), &value, sizeof(value));
+    for (i = 0; i < count; ++i)
+    {
+        value = htonl((uint32_t)messages[i].length);
+        memcpy(data + offset, &value, sizeof(value));
+        offset += sizeof(value);
+        if (messages[i].length)
+            memcpy(data + offset, messages[i].data, messages[i].length);
+        offset += messages[i].length;
+    }
+
+    frame.data = data;
+    frame.length = (int)length;
+    err = rbusMessage_SendBinary(((struct _rbusHandle*)handle)->connection, &frame, opts);
+    free(data);
+    free((void*)frame.topic);
+    return err;
+}
+
+rbusError_t rbusMessage_SendBatch(
+    rbusHandle_t handle,
+    rbusMessage_t* messages,
+    int count,
+    rbusMessageSendOptions_t opts,
+    int* numSent)
+{
+    rbusError_t err = RBUS_ERROR_SUCCESS;
+    int sent = 0;
+    int i = 0;
+
+    if (numSent)
+        *numSent = 0;
+    if (!handle || count < 0 || (count > 0 && !messages))
+        return RBUS_ERROR_INVALID_INPUT;
+
+    while (i < count && err == RBUS_ERROR_SUCCESS)
+    {
+        size_t length = 0;
+        int n = rbusMessage_BatchRun(&messages[i], count - i, opts, &length);
+
+        if (n < 0)
+            err = RBUS_ERROR_INVALID_INPUT;
+        else if (n == 1)
+            err = rbusMessage_Send(handle, &messages[i], opts);
+        else
+            err = rbusMessage_SendFrame(handle, &messages[i], n, length, opts);
+        if (err == RBUS_ERROR_SUCCESS)
+            sent += n;
+        i += n;
+    }
+
+    if (err != RBUS_ERROR_SUCCESS)
+        RBUSLOG_WARN("rbusMessage_SendBatch stopped after sending %d of %d messages", sent, count);
+    if (numSent)
+        *numSent = sent;
+    return err;
+}
+
+rbusError_t rbusMessage_SendV(
+    rbusHandle_t handle,
+    char const* topic,
+    struct iovec const* iov,
+    int iovcnt,
+    rbusMessageSendOptions_t opts)
+{
+    uint8_t stackBuffer[SENDV_STACK_BUFFER_SIZE];
+    uint8_t* data = stackBuffer;
+    size_t length = 0;
+    size_t offset = 0;
+    rbusMessage_t message;
+    rbusError_t err;
+    int i;
+
+    if (!handle || !topic || iovcnt < 0 || (iovcnt > 0 && !iov))
+        return RBUS_ERROR_INVALID_INPUT;
+
+    for (i = 0; i < iovcnt; ++i)
+        length += iov[i].iov_len;
+    if (length > INT32_MAX)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    /*shared memory takes the segments as they are*/
+    if (rbusMessage_SendsShared(length, opts))
+        return rbusMessage_SendShared(handle, topic, iov, iovcnt, length, opts);
+
+    /*rtConnection only takes a single buffer, so a single segment is sent as is
+      and several are joined here rather than by every caller*/
+    if (iovcnt == 1)
+    {
+        data = (uint8_t*)iov[0].iov_base;
+    }
+    else
+    {
+        if (length > sizeof(stackBuffer))
+        {
+            data = malloc(length);
+            if (!data)
+            {
+                RBUSLOG_WARN("rbusMessage_SendV failed to allocate %zu bytes for %s", length, topic);
+                return RBUS_ERROR_OUT_OF_RESOURCES;
+            }
+        }
+        for (i = 0; i < iovcnt; ++i)
+        {
+            if (iov[i].iov_len)
+                memcpy(data + offset, iov[i].iov_base, iov[i].iov_len);
+            offset += iov[i].iov_len;
+        }
+    }
+
+    message.topic = topic;
+    message.data = data;
+    message.length = (int)length;
+    err = rbusMessage_Send(handle, &message, opts);
+
+    if (data != stackBuffer && iovcnt != 1)
+        free(data);
+    return err;
+}
+
+static void rbusMessage_FreeSendItem(rbusMessageSendItem_t* item)
+{
+    free((void*)item->message.topic);
+    free((void*)item->message.data);
+    free(item);
+}
+
+static void rbusMessage_FreeSendQueue(struct _rbusMessageSendQueue* queue)
+{
+    pthread_cond_destroy(&queue->condDone);
+    pthread_cond_destroy(&queue->condQueued);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue);
+}
+
+/*called with the queue locked, which is unlocked while the message is sent*/
+static void rbusMessage_SendNext(struct _rbusMessageSendQueue* queue)
+{
+    rbusMessageSendItem_t* item;
+    rbusError_t err;
+
+    item = queue->head;
+    queue->head = item->next;
+    if (!queue->head)
+        queue->tail = NULL;
+    pthread_mutex_unlock(&queue->mutex);
+
+    err = rbusMessage_Send(queue->handle, &item->message, RBUS_MESSAGE_CONFIRM_RECEIPT);
+
+    /*the message leaves the window before its callback runs, so the callback
+      can queue another without waiting on itself*/
+    pthread_mutex_lock(&queue->mutex);
+    queue->pending--;
+    pthread_cond_broadcast(&queue->condDone);
+    pthread_mutex_unlock(&queue->mutex);
+
+    if (item->callback)
+        item->callback(queue->handle, &item->message, err, item->userData);
+    rbusMessage_FreeSendItem(item);
+
+    pthread_mutex_lock(&queue->mutex);
+}
+
+static void* rbusMessage_SendThread(void* p)
+{
+    struct _rbusMessageSendQueue* queue = p;
+    bool freeQueue;
+
+    pthread_mutex_lock(&queue->mutex);
+    for (;;)
+    {
+        while (!queue->head && !queue->closing)
+            pthread_cond_wait(&queue->condQueued, &queue->mutex);
+        if (!queue->head)
+            break;
+        rbusMessage_SendNext(queue);
+    }
+    freeQueue = queue->freeOnExit;
+    pthread_mutex_unlock(&queue->mutex);
+
+    if (freeQueue)
+        rbusMessage_FreeSendQueue(queue);
+    return NULL;
+}
+
+static struct _rbusMessageSendQueue* rbusMessage_GetSendQueue(rbusHandle_t handle)
+{
+    struct _rbusMessageSendQueue* queue;
+
+    pthread_mutex_lock(&gSendQueueCreateMutex);
+    queue = handle->sendQueue;
+    if (!queue)
+    {
+        queue = calloc(1, sizeof(struct _rbusMessageSendQueue));
+        if (!queue)
+        {
+            pthread_mutex_unlock(&gSendQueueCreateMutex);
+            return NULL;
+        }
+        queue->handle = handle;
+        queue->window = rbusConfig_Get()->sendWindow;
+        pthread_mutex_init(&queue->mutex, NULL);
+        pthread_cond_init(&queue->condQueued, NULL);
+        pthread_cond_init(&queue->condDone, NULL);
+        handle->sendQueue = queue;
+    }
+    pthread_mutex_unlock(&gSendQueueCreateMutex);
+    return queue;
+}
+
+rbusError_t rbusMessage_SendAsync(
+    rbusHandle_t handle,
+    rbusMessage_t* message,
+    rbusMessageSendCallback_t callback,
+    void* userData)
+{
+    struct _rbusMessageSendQueue* queue;
+    rbusMessageSendItem_t* item;
+    rbusError_t err = RBUS_ERROR_SUCCESS;
+
+    if (!handle || !message || !message->topic || message->length < 0 || (message->length > 0 && !message->data))
+        return RBUS_ERROR_INVALID_INPUT;
+
+    queue = rbusMessage_GetSendQueue(handle);
+    item = calloc(1, sizeof(rbusMessageSendItem_t));
+    if (item)
+    {
+        item->message.topic = strdup(message->topic);
+        item->message.data = malloc(message->length > 0 ? message->length : 1);
+    }
+    if (!queue || !item || !item->message.topic || !item->message.data)
+    {
+        RBUSLOG_WARN("rbusMessage_SendAsync failed to allocate message for %s", message->topic);
+        if (item)
+            rbusMessage_FreeSendItem(item);
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+    item->message.length = message->length;
+    if (message->length > 0)
+        memcpy((void*)item->message.data, message->data, message->length);
+    item->callback = callback;
+    item->userData = userData;
+    item->next = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->pending >= queue->window && !queue->closing)
+        pthread_cond_wait(&queue->condDone, &queue->mutex);
+
+    if (queue->closing)
+    {
+        err = RBUS_ERROR_INVALID_INPUT;
+    }
+    else if (queue->numThreads < queue->window && queue->numThreads <= queue->pending)
+    {
+        /*every thread is busy so start another, though without any thread nothing would send the message*/
+        if (pthread_create(&queue->threads[queue->numThreads], NULL, rbusMessage_SendThread, queue) == 0)
+            queue->numThreads++;
+        else if (queue->numThreads == 0)
+            err = RBUS_ERROR_OUT_OF_RESOURCES;
+    }
+
+    if (err == RBUS_ERROR_SUCCESS)
+    {
+        if (queue->tail)
+            queue->tail->next = item;
+        else
+            queue->head = item;
+        queue->tail = item;
+        queue->pending++;
+        pthread_cond_signal(&queue->condQueued);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    if (err != RBUS_ERROR_SUCCESS)
+    {
+        RBUSLOG_WARN("rbusMessage_SendAsync failed to queue message for %s", message->topic);
+        rbusMessage_FreeSendItem(item);
+    }
+    return err;
+}
+
+rbusError_t rbusMessage_SetSendWindow(
+    rbusHandle_t handle,
+    int window)
+{
+    struct _rbusMessageSendQueue* queue;
+
+    if (!handle || window < 1 || window > RBUS_SEND_WINDOW_MAX)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    queue = rbusMessage_GetSendQueue(handle);
+    if (!queue)
+        return RBUS_ERROR_OUT_OF_RESOURCES;
+    pthread_mutex_lock(&queue->mutex);
+    queue->window = window;
+    /*a larger window may unblock senders*/
+    pthread_cond_broadcast(&queue->condDone);
+    pthread_mutex_unlock(&queue->mutex);
+    return RBUS_ERROR_SUCCESS;
+}
+
+static void rbusMessage_CloseListeners(rbusHandle_t handle)
+{
+    struct _rbusMessageListeners* listeners = handle->messageListeners;
+
+    if (!listeners)
+        return;
+    rbusMessage_RemoveAllListeners(handle);
+    pthread_mutex_lock(&gListenersCreateMutex);
+    handle->messageListeners = NULL;
+    pthread_mutex_unlock(&gListenersCreateMutex);
+    free(listeners->root.children);
+    pthread_cond_destroy(&listeners->condPending);
+    pthread_mutex_destroy(&listeners->mutex);
+    free(listeners);
+}
+
+void rbusMessage_CloseHandle(rbusHandle_t handle)
+{
+    struct _rbusMessageSendQueue* queue;
+    bool fromSendThread = false;
+    int i;
+
+    rbusMessage_CloseListeners(handle);
+
+    pthread_mutex_lock(&gSendQueueCreateMutex);
+    queue = handle->sendQueue;
+    handle->sendQueue = NULL;
+    pthread_mutex_unlock(&gSendQueueCreateMutex);
+    if (!queue)
+    {
+        rbusMessage_UnlinkShared(handle);
+        return;
+    }
+
+    /*the threads send whatever is still queued before they exit*/
+    pthread_mutex_lock(&queue->mutex);
+    queue->closing = true;
+    pthread_cond_broadcast(&queue->condQueued);
+    pthread_cond_broadcast(&queue->condDone);
+    pthread_mutex_unlock(&queue->mutex);
+
+    for (i = 0; i < queue->numThreads; ++i)
+    {
+        if (pthread_equal(queue->threads[i], pthread_self()))
+            fromSendThread = true;
+        else
+            pthread_join(queue->threads[i], NULL);
+    }
+
+    if (fromSendThread)
+    {
+        /*closed from a completion callback, which can't join its own thread.  The
+          other threads have exited, so whatever is still queued is sent here, and
+          this thread frees the queue once the callback returns*/
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->head)
+            rbusMessage_SendNext(queue);
+        queue->freeOnExit = true;
+        pthread_mutex_unlock(&queue->mutex);
+        pthread_detach(pthread_self());
+    }
+    else
+    {
+        rbusMessage_FreeSendQueue(queue);
+    }
+
+    rbusMessage_UnlinkShared(handle);
+}
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <assert.h>
 #include <rtRetainable.h>
+#include "rbus_buffer.h"
 
 struct _rbusObject
 {
@@ -569,3 +570,85 @@ rbusObject_t rbusObject_GetObject(rbusObject_t object, char const* name)
     return 0;
 }
 #endif
+
+/*an object is its name, its type, its property list and then its child objects, each encoded the same way*/
+int rbusObject_Encode(rbusObject_t object, rbusBuffer_t buff)
+{
+    rbusObject_t child;
+    size_t length = object->name ? strlen(object->name) + 1 : 0;
+    int32_t numChild = 0;
+
+    if(length > UINT16_MAX)
+        return -1;
+    rbusBuffer_WriteStringTLV(buff, object->name, (int)length);
+    rbusBuffer_WriteInt32TLV(buff, object->type);
+    if(rbusPropertyList_Encode(object->properties, buff) < 0)
+        return -1;
+
+    for(child = object->children; child; child = child->next)
+        numChild++;
+    rbusBuffer_WriteInt32TLV(buff, numChild);
+    for(child = object->children; child; child = child->next)
+    {
+        if(rbusObject_Encode(child, buff) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int rbusObject_Decode(rbusObject_t* object, rbusBuffer_t const buff)
+{
+    return rbusObject_DecodeNested(object, buff, 0);
+}
+
+int rbusObject_DecodeNested(rbusObject_t* object, rbusBuffer_t const buff, int depth)
+{
+    char const* name;
+    int32_t type;
+    int32_t numChild;
+    rbusProperty_t properties = NULL;
+    rbusObject_t children = NULL, previous = NULL;
+
+    if(depth > RBUS_DECODE_MAX_DEPTH)
+        return -1;
+    if(rbusBuffer_ReadStringTLV(buff, &name) < 0)
+        return -1;
+    if(rbusBuffer_ReadInt32TLV(buff, &type) < 0)
+        return -1;
+    if(rbusPropertyList_DecodeNested(&properties, buff, depth) < 0)
+        return -1;
+    if(rbusBuffer_ReadInt32TLV(buff, &numChild) < 0)
+        goto fail;
+
+    while(numChild-- > 0)
+    {
+        rbusObject_t next;
+        if(rbusObject_DecodeNested(&next, buff, depth + 1) < 0)
+            goto fail;
+        if(children == NULL)
+            children = next;
+        if(previous != NULL)
+        {
+            rbusObject_SetNext(previous, next);
+            rbusObject_Release(next);
+        }
+        previous = next;
+    }
+
+    rbusObject_Init(object, name);
+    (*object)->type = type;
+    rbusObject_SetProperties(*object, properties);
+    if(properties)
+        rbusProperty_Release(properties);
+    rbusObject_SetChildren(*object, children);
+    if(children)
+        rbusObject_Release(children);
+    return 0;
+
+fail:
+    if(properties)
+        rbusProperty_Release(properties);
+    if(children)
+        rbusObject_Release(children);
+    return -1;
+}
@@ -21,6 +21,31 @@
 #include <string.h>
 #include <stdlib.h>
 #include <rtRetainable.h>
+#include "rbus_buffer.h"
+#include "rbus_log.h"
+
+/*names decoded by rbusPropertyList_DecodeRelative, shared by all the properties of one response.
+  Entry i is the first prefixLength characters of name i-1 (or of base for entry 0) followed by suffix.
+  Full names are only rebuilt when rbusProperty_GetName first asks for one, and then all of them
+  are rebuilt in one pass, each from the one before, into a single allocation.
+  Properties of one response can be read from several threads, so the rebuilt names are published
+  with a compare and swap and the thread that loses the race frees its copy.*/
+typedef struct _rbusPropertyNameEntry
+{
+    uint16_t prefixLength;
+    uint16_t suffixLength;
+    char const* suffix;     /*points into suffixes*/
+} rbusPropertyNameEntry_t;
+
+typedef struct _rbusPropertyNames
+{
+    rtRetainable retainable;
+    char* base;
+    char* suffixes;
+    int count;
+    rbusPropertyNameEntry_t* entries;
+    char** built;           /*count name pointers followed by the names, or NULL, only accessed atomically*/
+} *rbusPropertyNames_t;
 
 struct _rbusProperty
 {
@@ -28,8 +53,63 @@ struct _rbusProperty
     char* name;
     rbusValue_t value;
     struct _rbusProperty* next;
+    rbusPropertyNames_t names;  /*while name is NULL, rebuild it from entry nameIndex in here*/
+    int nameIndex;
 };
 
+static void rbusPropertyNames_Destroy(rtRetainable* r)
+{
+    rbusPropertyNames_t names = (rbusPropertyNames_t)r;
+
+    free(names->built);
+    free(names->entries);
+    free(names->suffixes);
+    free(names->base);
+    free(names);
+}
+
+static char const* rbusPropertyNames_Get(rbusPropertyNames_t names, int index)
+{
+    char** built = __atomic_load_n(&names->built, __ATOMIC_ACQUIRE);
+    char** expected = NULL;
+    char const* previous = names->base;
+    size_t size = names->count * sizeof(char*);
+    char* next;
+    int i;
+
+    if(built)
+        return built[index];
+
+    for(i = 0; i < names->count; i++)
+        size += names->entries[i].prefixLength + names->entries[i].suffixLength + 1;
+    built = malloc(size);
+    if(!built)
+    {
+        RBUSLOG_ERROR("%s: out of memory rebuilding %d names", __FUNCTION__, names->count);
+        return NULL;
+    }
+
+    next = (char*)(built + names->count);
+    for(i = 0; i < names->count; i++)
+    {
+        rbusPropertyNameEntry_t* entry = &names->entries[i];
+
+        built[i] = next;
+        memcpy(next, previous, entry->prefixLength);
+        memcpy(next + entry->prefixLength, entry->suffix, entry->suffixLength);
+        next[entry->prefixLength + entry->suffixLength] = 0;
+        previous = next;
+        next += entry->prefixLength + entry->suffixLength + 1;
+    }
+
+    if(!__atomic_compare_exchange_n(&names->built, &expected, built, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        free(built);
+        built = expected;
+    }
+    return built[index];
+}
+
 void rbusProperty_Init(rbusProperty_t* p, char const* name, rbusValue_t value)
 {
     (*p) = malloc(sizeof(struct _rbusProperty));
@@ -40,6 +120,8 @@ void rbusProperty_Init(rbusProperty_t* p, char const* name, rbusValue_t value)
         (*p)->name = NULL;
 
     (*p)->next = NULL;
+    (*p)->names = NULL;
+    (*p)->nameIndex = 0;
 
     (*p)->value = NULL;
     if(value)
@@ -57,6 +139,8 @@ void rbusProperty_Destroy(rtRetainable* r)
         free(property->name);
         property->name = NULL;
     }
+    if(property->names)
+        rtRetainable_release(property->names, rbusPropertyNames_Destroy);
 
     rbusValue_Release(property->value);
     if(property->next)
@@ -120,7 +204,7 @@ int rbusProperty_Compare(rbusProperty_t property1, rbusProperty_t property2)
     if(property1 == property2)
         return 0;
 
-    rc = strcmp(property1->name, property2->name);
+    rc = strcmp(rbusProperty_GetName(property1), rbusProperty_GetName(property2));
     if(rc)
         return rc;/*return strcmp result so we can use rbusProperty_Compare to sort properties by name*/
 
@@ -129,11 +213,18 @@ int rbusProperty_Compare(rbusProperty_t property1, rbusProperty_t property2)
 
 char const* rbusProperty_GetName(rbusProperty_t property)
 {
+    if(!property->name && property->names)
+        return rbusPropertyNames_Get(property->names, property->nameIndex);
     return property->name;
 }
 
 void rbusProperty_SetName(rbusProperty_t property, char const* name)
 {
+    if(property->names)
+    {
+        rtRetainable_release(property->names, rbusPropertyNames_Destroy);
+        property->names = NULL;
+    }
     if(property->name)
         free(property->name);
     if(name)
@@ -190,3 +281,212 @@ uint32_t rbusProperty_Count(rbusProperty_t property)
     return count;
 }
 
+
+/*a property is its name as a string TLV followed by its value, which is RBUS_NONE if unset*/
+int rbusProperty_Encode(rbusProperty_t property, rbusBuffer_t buff)
+{
+    char const* name = rbusProperty_GetName(property);
+    size_t length = name ? strlen(name) + 1 : 0;
+
+    if(length > UINT16_MAX)
+        return -1;
+    rbusBuffer_WriteStringTLV(buff, name, (int)length);
+    if(property->value)
+        return rbusValue_Encode(property->value, buff);
+    rbusBuffer_WriteTypeLengthValue(buff, RBUS_NONE, 0, NULL);
+    return 0;
+}
+
+static int rbusProperty_DecodeNested(rbusProperty_t* property, rbusBuffer_t const buff, int depth)
+{
+    char const* name;
+    rbusValue_t value;
+
+    if(rbusBuffer_ReadStringTLV(buff, &name) < 0)
+        return -1;
+    if(rbusValue_DecodeNested(&value, buff, depth) < 0)
+        return -1;
+    rbusProperty_Init(property, name, value);
+    rbusValue_Release(value);
+    return 0;
+}
+
+int rbusProperty_Decode(rbusProperty_t* property, rbusBuffer_t const buff)
+{
+    return rbusProperty_DecodeNested(property, buff, 0);
+}
+
+/*a property list is the property count as an int32 TLV followed by each property*/
+int rbusPropertyList_Encode(rbusProperty_t first, rbusBuffer_t buff)
+{
+    rbusProperty_t prop;
+    int32_t count = 0;
+
+    for(prop = first; prop; prop = prop->next)
+        count++;
+    rbusBuffer_WriteInt32TLV(buff, count);
+    for(prop = first; prop; prop = prop->next)
+    {
+        if(rbusProperty_Encode(prop, buff) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int rbusPropertyList_Decode(rbusProperty_t* first, rbusBuffer_t const buff)
+{
+    return rbusPropertyList_DecodeNested(first, buff, 0);
+}
+
+int rbusPropertyList_DecodeNested(rbusProperty_t* first, rbusBuffer_t const buff, int depth)
+{
+    rbusProperty_t last = NULL;
+    int32_t count;
+
+    *first = NULL;
+    if(depth > RBUS_DECODE_MAX_DEPTH)
+    {
+        RBUSLOG_WARN("rbusPropertyList_Decode failed: nested more than %d deep", RBUS_DECODE_MAX_DEPTH);
+        return -1;
+    }
+    if(rbusBuffer_ReadInt32TLV(buff, &count) < 0)
+        return -1;
+    while(count-- > 0)
+    {
+        rbusProperty_t prop;
+        if(rbusProperty_DecodeNested(&prop, buff, depth) < 0)
+        {
+            if(*first)
+                rbusProperty_Release(*first);
+            *first = NULL;
+            return -1;
+        }
+        if(last)
+        {
+            rbusProperty_SetNext(last, prop);
+            rbusProperty_Release(prop);
+        }
+        else
+        {
+            *first = prop;
+        }
+        last = prop;
+    }
+    return 0;
+}
+
+/*a relative property is the length of the prefix it shares with previous as a uint16,
+  then the rest of its name as a string TLV and then its value*/
+int rbusProperty_EncodeRelative(rbusProperty_t property, char const* previous, rbusBuffer_t buff)
+{
+    char const* name = rbusProperty_GetName(property);
+    size_t prefixLength = 0;
+    size_t suffixLength;
+
+    if(!name)
+        return -1;
+    if(previous)
+    {
+        while(previous[prefixLength] && previous[prefixLength] == name[prefixLength])
+            prefixLength++;
+    }
+    suffixLength = strlen(name + prefixLength);
+    if(prefixLength + suffixLength > UINT16_MAX)
+        return -1;
+
+    rbusBuffer_WriteUInt16(buff, (uint16_t)prefixLength);
+    rbusBuffer_WriteStringTLV(buff, name + prefixLength, (int)suffixLength + 1);
+    if(property->value)
+        return rbusValue_Encode(property->value, buff);
+    rbusBuffer_WriteTypeLengthValue(buff, RBUS_NONE, 0, NULL);
+    return 0;
+}
+
+int rbusPropertyList_DecodeRelative(rbusProperty_t* first, int count, char const* base, rbusBuffer_t const buff)
+{
+    rbusPropertyNames_t names;
+    rbusProperty_t last = NULL;
+    int previousLength = base ? (int)strlen(base) : 0;
+    int start = buff->posRead;
+    int suffixesLength = 0;
+    int i;
+
+    *first = NULL;
+    if(count <= 0)
+        return 0;
+    /*each property takes at least its prefix length and the TLV headers of its suffix and value*/
+    if(count > (buff->lenAlloc - start) / 10)
+    {
+        RBUSLOG_WARN("rbusPropertyList_DecodeRelative failed: %d properties can't fit %d bytes", count, buff->lenAlloc - start);
+        return -1;
+    }
+
+    names = calloc(1, sizeof(struct _rbusPropertyNames));
+    if(!names)
+    {
+        RBUSLOG_ERROR("rbusPropertyList_DecodeRelative: out of memory");
+        return -1;
+    }
+    names->retainable.refCount = 1;
+    names->base = strdup(base ? base : "");
+    names->entries = calloc(count, sizeof(rbusPropertyNameEntry_t));
+    /*the suffixes are all inside the remaining buffer so it bounds the copy we keep of them*/
+    names->suffixes = malloc(buff->lenAlloc - start + 1);
+    if(!names->base || !names->entries || !names->suffixes)
+    {
+        RBUSLOG_ERROR("rbusPropertyList_DecodeRelative: out of memory");
+        rtRetainable_release(names, rbusPropertyNames_Destroy);
+        return -1;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        rbusPropertyNameEntry_t* entry = &names->entries[i];
+        rbusProperty_t prop;
+        rbusValue_t value;
+        uint16_t prefixLength;
+        char const* suffix;
+
+        if(rbusBuffer_ReadUInt16(buff, &prefixLength) < 0 ||
+           rbusBuffer_ReadStringTLV(buff, &suffix) < 0 ||
+           !suffix ||
+           prefixLength > previousLength ||
+           prefixLength + strlen(suffix) > UINT16_MAX ||
+           rbusValue_Decode(&value, buff) < 0)
+        {
+            RBUSLOG_WARN("rbusPropertyList_DecodeRelative failed at property %d of %d", i, count);
+            if(*first)
+                rbusProperty_Release(*first);
+            *first = NULL;
+            rtRetainable_release(names, rbusPropertyNames_Destroy);
+            return -1;
+        }
+
+        entry->prefixLength = prefixLength;
+        entry->suffixLength = (uint16_t)strlen(suffix);
+        entry->suffix = names->suffixes + suffixesLength;
+        memcpy(names->suffixes + suffixesLength, suffix, entry->suffixLength + 1);
+        suffixesLength += entry->suffixLength + 1;
+        names->count++;
+        previousLength = entry->prefixLength + entry->suffixLength;
+
+        rbusProperty_Init(&prop, NULL, value);
+        rbusValue_Release(value);
+        rtRetainable_retain(names);
+        prop->names = names;
+        prop->nameIndex = i;
+
+        if(last)
+        {
+            rbusProperty_SetNext(last, prop);
+            rbusProperty_Release(prop);
+        }
+        else
+        {
+            *first = prop;
+        }
+        last = prop;
+    }
+    rtRetainable_release(names, rbusPropertyNames_Destroy);
+    return 0;
+}
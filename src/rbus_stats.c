@@ -0,0 +1,264 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+    Stats:
+    Always-on counters and log2 latency histograms for the main rbus operations.
+    The counters are process wide and updated with relaxed atomics so recording
+    a call costs two clock reads and a few atomic adds, and never takes a lock.
+*/
+
+#include "rbus_stats_internal.h"
+#include "rbus_handle.h"
+#include "rbus_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RBUS_STATS_ROOT "Device.X_RBUS.Stats."
+#define RBUS_STATS_NUM_FIELDS 5
+
+static rbusStats_t gStats[RBUS_STATS_MAX];
+
+static char const* gMetricNames[RBUS_STATS_MAX] = {
+    "Get",
+    "GetExt",
+    "Set",
+    "EventPublish",
+    "MethodInvoke",
+    "GetHandler",
+    "SetHandler",
+    "ValueChangePoll",
+    "GetCacheHit"
+};
+
+static char const* gFieldNames[RBUS_STATS_NUM_FIELDS] = {
+    "Count",
+    "Errors",
+    "TotalUsec",
+    "MaxUsec",
+    "Histogram"
+};
+
+static int rbusStats_BucketIndex(uint64_t usec)
+{
+    int i;
+    if(usec < 2)
+        return 0;
+    i = 63 - __builtin_clzll(usec);
+    if(i >= RBUS_STATS_HISTOGRAM_BUCKETS)
+        i = RBUS_STATS_HISTOGRAM_BUCKETS - 1;
+    return i;
+}
+
+void rbusStats_Record(rbusStatsMetric_t metric, rtTime_t const* start, bool failed)
+{
+    rtTime_t now;
+    int64_t elapsed;
+    uint64_t usec;
+    uint64_t max;
+    rbusStats_t* stats;
+
+    if((unsigned)metric >= RBUS_STATS_MAX)
+        return;
+
+    rtTime_Now(&now);
+    elapsed = (int64_t)(now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000;
+    usec = elapsed > 0 ? (uint64_t)elapsed : 0;
+
+    stats = &gStats[metric];
+    __atomic_fetch_add(&stats->count, 1, __ATOMIC_RELAXED);
+    if(failed)
+        __atomic_fetch_add(&stats->errors, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->totalUsec, usec, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->buckets[rbusStats_BucketIndex(usec)], 1, __ATOMIC_RELAXED);
+
+    max = __atomic_load_n(&stats->maxUsec, __ATOMIC_RELAXED);
+    while(usec > max &&
+          !__atomic_compare_exchange_n(&stats->maxUsec, &max, usec, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+char const* rbusStats_MetricToString(rbusStatsMetric_t metric)
+{
+    if((unsigned)metric >= RBUS_STATS_MAX)
+        return NULL;
+    return gMetricNames[metric];
+}
+
+rbusError_t rbusStats_Get(rbusStatsMetric_t metric, rbusStats_t* stats)
+{
+    int i;
+    rbusStats_t* src;
+
+    if((unsigned)metric >= RBUS_STATS_MAX || !stats)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    src = &gStats[metric];
+    stats->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    stats->errors = __atomic_load_n(&src->errors, __ATOMIC_RELAXED);
+    stats->totalUsec = __atomic_load_n(&src->totalUsec, __ATOMIC_RELAXED);
+    stats->maxUsec = __atomic_load_n(&src->maxUsec, __ATOMIC_RELAXED);
+    for(i = 0; i < RBUS_STATS_HISTOGRAM_BUCKETS; ++i)
+        stats->buckets[i] = __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+    return RBUS_ERROR_SUCCESS;
+}
+
+void rbusStats_Reset(void)
+{
+    int m, i;
+    for(m = 0; m < RBUS_STATS_MAX; ++m)
+    {
+        rbusStats_t* stats = &gStats[m];
+        __atomic_store_n(&stats->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->errors, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->totalUsec, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->maxUsec, 0, __ATOMIC_RELAXED);
+        for(i = 0; i < RBUS_STATS_HISTOGRAM_BUCKETS; ++i)
+            __atomic_store_n(&stats->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+static rbusError_t rbusStats_GetHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
+{
+    char const* name = rbusProperty_GetName(property);
+    char const* field;
+    char const* metricEnd;
+    char const* metricStart;
+    rbusStats_t stats;
+    rbusValue_t value;
+    int m;
+
+    (void)handle;
+    (void)opts;
+
+    /*name is Device.X_RBUS.Stats.<component>.<metric>.<field>*/
+    field = strrchr(name, '.');
+    if(!field || field == name)
+        return RBUS_ERROR_INVALID_INPUT;
+    metricEnd = field++;
+    metricStart = metricEnd;
+    while(metricStart > name && *(metricStart-1) != '.')
+        metricStart--;
+
+    for(m = 0; m < RBUS_STATS_MAX; ++m)
+    {
+        if(strlen(gMetricNames[m]) == (size_t)(metricEnd - metricStart) &&
+           strncmp(gMetricNames[m], metricStart, metricEnd - metricStart) == 0)
+            break;
+    }
+    if(m == RBUS_STATS_MAX)
+        return RBUS_ERROR_INVALID_INPUT;
+
+    rbusStats_Get((rbusStatsMetric_t)m, &stats);
+
+    rbusValue_Init(&value);
+    if(strcmp(field, "Count") == 0)
+        rbusValue_SetUInt64(value, stats.count);
+    else if(strcmp(field, "Errors") == 0)
+        rbusValue_SetUInt64(value, stats.errors);
+    else if(strcmp(field, "TotalUsec") == 0)
+        rbusValue_SetUInt64(value, stats.totalUsec);
+    else if(strcmp(field, "MaxUsec") == 0)
+        rbusValue_SetUInt64(value, stats.maxUsec);
+    else if(strcmp(field, "Histogram") == 0)
+    {
+        char buff[RBUS_STATS_HISTOGRAM_BUCKETS * 21];
+        int i, len = 0;
+        buff[0] = 0;
+        for(i = 0; i < RBUS_STATS_HISTOGRAM_BUCKETS; ++i)
+            len += snprintf(buff + len, sizeof(buff) - len, i ? ",%llu" : "%llu", (unsigned long long)stats.buckets[i]);
+        rbusValue_SetString(value, buff);
+    }
+    else
+    {
+        rbusValue_Release(value);
+        return RBUS_ERROR_INVALID_INPUT;
+    }
+    rbusProperty_SetValue(property, value);
+    rbusValue_Release(value);
+    return RBUS_ERROR_SUCCESS;
+}
+
+/*builds the elements for the handle's component. the caller must free the names with rbusStats_FreeElements*/
+static void rbusStats_CreateElements(rbusHandle_t handle, rbusDataElement_t* elements)
+{
+    struct _rbusHandle* handleInfo = (struct _rbusHandle*)handle;
+    char component[RBUS_MAX_NAME_LENGTH];
+    char* p;
+    int m, f, i = 0;
+
+    snprintf(component, sizeof(component), "%s", handleInfo->componentName);
+    for(p = component; *p; ++p)
+    {
+        if(*p == '.')
+            *p = '_';
+    }
+
+    for(m = 0; m < RBUS_STATS_MAX; ++m)
+    {
+        for(f = 0; f < RBUS_STATS_NUM_FIELDS; ++f, ++i)
+        {
+            char name[RBUS_MAX_NAME_LENGTH];
+            snprintf(name, sizeof(name), RBUS_STATS_ROOT "%s.%s.%s", component, gMetricNames[m], gFieldNames[f]);
+            memset(&elements[i], 0, sizeof(rbusDataElement_t));
+            elements[i].name = strdup(name);
+            elements[i].type = RBUS_ELEMENT_TYPE_PROPERTY;
+            elements[i].cbTable.getHandler = rbusStats_GetHandler;
+        }
+    }
+}
+
+static void rbusStats_FreeElements(rbusDataElement_t* elements)
+{
+    int i;
+    for(i = 0; i < RBUS_STATS_MAX * RBUS_STATS_NUM_FIELDS; ++i)
+        free(elements[i].name);
+}
+
+rbusError_t rbusStats_RegisterDataElements(rbusHandle_t handle)
+{
+    rbusDataElement_t elements[RBUS_STATS_MAX * RBUS_STATS_NUM_FIELDS];
+    rbusError_t rc;
+
+    if(!handle)
+        return RBUS_ERROR_INVALID_HANDLE;
+
+    rbusStats_CreateElements(handle, elements);
+    rc = rbus_regDataElements(handle, RBUS_STATS_MAX * RBUS_STATS_NUM_FIELDS, elements);
+    rbusStats_FreeElements(elements);
+
+    if(rc != RBUS_ERROR_SUCCESS)
+        RBUSLOG_WARN("%s: failed to register stats data elements err=%d", __FUNCTION__, rc);
+    return rc;
+}
+
+rbusError_t rbusStats_UnregisterDataElements(rbusHandle_t handle)
+{
+    rbusDataElement_t elements[RBUS_STATS_MAX * RBUS_STATS_NUM_FIELDS];
+    rbusError_t rc;
+
+    if(!handle)
+        return RBUS_ERROR_INVALID_HANDLE;
+
+    rbusStats_CreateElements(handle, elements);
+    rc = rbus_unregDataElements(handle, RBUS_STATS_MAX * RBUS_STATS_NUM_FIELDS, elements);
+    rbusStats_FreeElements(elements);
+    return rc;
+}
@@ -18,6 +18,7 @@
 */
 
 #include "rbus_subscriptions.h"
+#include "rbus_eventrate.h"
 #include "rbus_buffer.h"
 #include "rbus_handle.h"
 #include <memory.h>
@@ -27,6 +28,7 @@
 #include <signal.h>
 
 #define CACHE_FILE_PATH_FORMAT "%s/rbus_subs_%s"
+#define CACHE_RECORD_VERSION 1  /*1 added the rate limit; version 0 records have no version field and start with the listener*/
 
 struct _rbusSubscriptions
 {
@@ -40,7 +42,7 @@ struct _rbusSubscriptions
 static void rbusSubscriptions_loadCache(rbusSubscriptions_t subscriptions);
 static void rbusSubscriptions_saveCache(rbusSubscriptions_t subscriptions);
 
-int subscribeHandlerImpl(rbusHandle_t handle, bool added, elementNode* el, char const* eventName, char const* listener, int32_t interval, int32_t duration, rbusFilter_t filter);
+int subscribeHandlerImpl(rbusHandle_t handle, bool added, elementNode* el, char const* eventName, char const* listener, int32_t interval, int32_t duration, uint32_t publishInterval, bool coalesce, rbusFilter_t filter);
 
 
 static int subscriptionKeyCompare(rbusSubscription_t* subscription, char const* listener, char const* eventName, rbusFilter_t filter)
@@ -69,6 +71,8 @@ static void subscriptionFree(void* p)
         removeElementSubscription(node, sub);
         rtListItem_GetNext(item, &item);
     }
+    if(sub->publishInterval)
+        rbusEventRate_RemoveSubscription(sub);
     if(sub->tokens)
         TokenChain_destroy(sub->tokens);
     if(sub->instances)
@@ -103,7 +107,7 @@ void rbusSubscriptions_destroy(rbusSubscriptions_t subscriptions)
 static void rbusSubscriptions_onSubscriptionCreated(rbusSubscription_t* sub, elementNode* node);
 
 /*add a new subscription*/
-rbusSubscription_t* rbusSubscriptions_addSubscription(rbusSubscriptions_t subscriptions, char const* listener, char const* eventName, rbusFilter_t filter, int32_t interval, int32_t duration, bool autoPublish, elementNode* registryElem)
+rbusSubscription_t* rbusSubscriptions_addSubscription(rbusSubscriptions_t subscriptions, char const* listener, char const* eventName, rbusFilter_t filter, int32_t interval, int32_t duration, uint32_t publishInterval, bool coalesce, bool autoPublish, elementNode* registryElem)
 {
     rbusSubscription_t* sub;
     TokenChain* tokens;
@@ -126,11 +130,15 @@ rbusSubscription_t* rbusSubscriptions_addSubscription(rbusSubscriptions_t subscr
         rbusFilter_Retain(sub->filter);
     sub->interval = interval;
     sub->duration = duration;
+    sub->publishInterval = publishInterval;
+    sub->coalesce = coalesce;
+    memset(&sub->lastPublishTime, 0, sizeof(sub->lastPublishTime));
     sub->autoPublish = autoPublish;
     sub->element = registryElem;
     sub->tokens = tokens;
     rtList_Create(&sub->instances);
     rtList_PushBack(subscriptions->subList, sub, NULL);
+    rbusHandle_AddListener(subscriptions->handle, listener);
 
     rbusSubscriptions_onSubscriptionCreated(sub, subscriptions->root);
 
@@ -344,6 +352,57 @@ void rbusSubscriptions_onElementDeleted(rbusSubscriptions_t subscriptions, eleme
     }
 }
 
+/*called before the nodes are freed by unregistering their elements.  Subscriptions to a removed
+  registration element are detached back to the state they are loaded from cache in, so
+  rbusSubscriptions_resubscribeCache picks them up again if the element is registered again*/
+void rbusSubscriptions_onElementsRemoved(rbusSubscriptions_t subscriptions, elementNodeSet const* nodes)
+{
+    rtListItem item;
+    rbusSubscription_t* sub;
+
+    if(nodes->count == 0)
+        return;
+
+    rtList_GetFront(subscriptions->subList, &item);
+
+    while(item)
+    {
+        rtListItem_GetData(item, (void**)&sub);
+
+        if(sub->element && elementSetContains(nodes, sub->element))
+        {
+            RBUSLOG_INFO("%s: detaching %s %s", __FUNCTION__, sub->eventName, sub->listener);
+            if(sub->publishInterval)
+                rbusEventRate_RemoveSubscription(sub);
+            if(sub->tokens)
+                TokenChain_destroy(sub->tokens);
+            sub->tokens = NULL;
+            sub->element = NULL;
+            /*its instances are all being removed along with the element*/
+            rtList_Destroy(sub->instances, NULL);
+            rtList_Create(&sub->instances);
+        }
+        else if(sub->instances)
+        {
+            rtListItem item2;
+            elementNode* inst;
+
+            rtList_GetFront(sub->instances, &item2);
+            while(item2)
+            {
+                rtListItem next;
+                rtListItem_GetNext(item2, &next);
+                rtListItem_GetData(item2, (void**)&inst);
+                if(elementSetContains(nodes, inst))
+                    rtList_RemoveItem(sub->instances, item2, NULL);
+                item2 = next;
+            }
+        }
+
+        rtListItem_GetNext(item, &item);
+    }
+}
+
 void rbusSubscriptions_onTableRowAdded(rbusSubscriptions_t subscriptions, elementNode* node)
 {
     rbusSubscriptions_onElementCreated(subscriptions, node);
@@ -401,6 +460,7 @@ static void rbusSubscriptions_loadCache(rbusSubscriptions_t subscriptions)
     long size;
     uint16_t type, length;
     int32_t hasFilter;
+    int32_t version;
     FILE* file = NULL;
     rbusBuffer_t buff = NULL;
     rbusSubscription_t* sub = NULL;
@@ -451,8 +511,22 @@ static void rbusSubscriptions_loadCache(rbusSubscriptions_t subscriptions)
     {
         sub = (rbusSubscription_t*)calloc(1, sizeof(struct _rbusSubscription));
 
-        //read listener
+        //read version
         if(rbusBuffer_ReadUInt16(buff, &type) < 0) goto remove_bad_file;
+        if(type == RBUS_INT32)
+        {
+            if(rbusBuffer_ReadUInt16(buff, &length) < 0) goto remove_bad_file;
+            if(length != sizeof(int32_t)) goto remove_bad_file;
+            if(rbusBuffer_ReadInt32(buff, &version) < 0) goto remove_bad_file;
+            if(version < 1 || version > CACHE_RECORD_VERSION) goto remove_bad_file;
+            if(rbusBuffer_ReadUInt16(buff, &type) < 0) goto remove_bad_file;
+        }
+        else
+        {
+            version = 0;
+        }
+
+        //read listener
         if(rbusBuffer_ReadUInt16(buff, &length) < 0) goto remove_bad_file;
         if(type != RBUS_STRING || length >= RBUS_MAX_NAME_LENGTH) goto remove_bad_file;
 
@@ -501,6 +575,20 @@ static void rbusSubscriptions_loadCache(rbusSubscriptions_t subscriptions)
         else
             sub->filter = NULL;
 
+        //read rate limit
+        if(version >= 1)
+        {
+            if(rbusBuffer_ReadUInt16(buff, &type) < 0) goto remove_bad_file;
+            if(rbusBuffer_ReadUInt16(buff, &length) < 0) goto remove_bad_file;
+            if(type != RBUS_UINT32 || length != sizeof(uint32_t)) goto remove_bad_file;
+            if(rbusBuffer_ReadUInt32(buff, &sub->publishInterval) < 0) goto remove_bad_file;
+
+            if(rbusBuffer_ReadUInt16(buff, &type) < 0) goto remove_bad_file;
+            if(rbusBuffer_ReadUInt16(buff, &length) < 0) goto remove_bad_file;
+            if(type != RBUS_BOOLEAN || length != sizeof(bool)) goto remove_bad_file;
+            if(rbusBuffer_ReadBoolean(buff, &sub->coalesce) < 0) goto remove_bad_file;
+        }
+
         /*
             It's possible that we can load a sub from the cache for a listener whose process is no longer running.
             Example, this provider exited with active subscribers and thus still had those subs in its cache.
@@ -517,6 +605,7 @@ static void rbusSubscriptions_loadCache(rbusSubscriptions_t subscriptions)
 
         rtList_Create(&sub->instances);
         rtList_PushBack(subscriptions->subList, sub, NULL);
+        rbusHandle_AddListener(subscriptions->handle, sub->listener);
 
         RBUSLOG_INFO("%s: loaded %s %s", __FUNCTION__, sub->listener, sub->eventName);
     }
@@ -582,6 +671,7 @@ static void rbusSubscriptions_saveCache(rbusSubscriptions_t subscriptions)
     while(item)
     {
         rtListItem_GetData(item, (void**)&sub);
+        rbusBuffer_WriteInt32TLV(buff, CACHE_RECORD_VERSION);
         rbusBuffer_WriteStringTLV(buff, sub->listener, strlen(sub->listener)+1);
         rbusBuffer_WriteStringTLV(buff, sub->eventName, strlen(sub->eventName)+1);
         rbusBuffer_WriteInt32TLV(buff, sub->interval);
@@ -590,6 +680,8 @@ static void rbusSubscriptions_saveCache(rbusSubscriptions_t subscriptions)
         rbusBuffer_WriteInt32TLV(buff, sub->filter ? 1 : 0);
         if(sub->filter)
           rbusFilter_Encode(sub->filter, buff);
+        rbusBuffer_WriteUInt32TLV(buff, sub->publishInterval);
+        rbusBuffer_WriteBooleanTLV(buff, sub->coalesce);
 
         RBUSLOG_DEBUG("%s: saved %s %s", __FUNCTION__, sub->listener, sub->eventName);
 
@@ -603,27 +695,59 @@ static void rbusSubscriptions_saveCache(rbusSubscriptions_t subscriptions)
     fclose(file);
 }
 
-void rbusSubscriptions_resubscribeCache(rbusHandle_t handle, rbusSubscriptions_t subscriptions, char const* elementName, elementNode* el)
+typedef struct
+{
+    char const* name;
+    elementNode* el;
+} rbusSubscriptionsIndexEntry_t;
+
+static int compareIndexEntry(const void* left, const void* right)
+{
+    return strcmp(((rbusSubscriptionsIndexEntry_t const*)left)->name, ((rbusSubscriptionsIndexEntry_t const*)right)->name);
+}
+
+void rbusSubscriptions_resubscribeCache(rbusHandle_t handle, rbusSubscriptions_t subscriptions, int numElements, char const** elementNames, elementNode** elements)
 {
     rtListItem item;
     rbusSubscription_t* sub;
+    rbusSubscriptionsIndexEntry_t* index = NULL;
+    int i;
 
-    RBUSLOG_INFO("%s: event %s", __FUNCTION__, elementName);
+    RBUSLOG_INFO("%s: %d events", __FUNCTION__, numElements);
 
     rtList_GetFront(subscriptions->subList, &item);
 
     while(item)
     {
+        rbusSubscriptionsIndexEntry_t key;
+        rbusSubscriptionsIndexEntry_t* entry = NULL;
+
         rtListItem_GetData(item, (void**)&sub);
 
-        if(sub->element == NULL && sub->tokens == NULL &&/*not already subscribed*/
-          strcmp(sub->eventName, elementName) == 0)
+        if(sub->element == NULL && sub->tokens == NULL)/*not already subscribed*/
+        {
+            /*index the registered names, sorted for a binary search, the first time a cached sub is found*/
+            if(!index)
+            {
+                index = malloc(numElements * sizeof(rbusSubscriptionsIndexEntry_t));
+                for(i = 0; i < numElements; ++i)
+                {
+                    index[i].name = elementNames[i];
+                    index[i].el = elements[i];
+                }
+                qsort(index, numElements, sizeof(rbusSubscriptionsIndexEntry_t), compareIndexEntry);
+            }
+            key.name = sub->eventName;
+            entry = bsearch(&key, index, numElements, sizeof(rbusSubscriptionsIndexEntry_t), compareIndexEntry);
+        }
+
+        if(entry)
         {
             rtListItem next;
             rbusError_t err;
             RBUSLOG_INFO("%s: subscribing %s %s", __FUNCTION__, sub->eventName, sub->listener);
             rtListItem_GetNext(item, &next);
-            err = subscribeHandlerImpl(handle, true, el, sub->eventName, sub->listener, sub->interval, sub->duration, sub->filter);
+            err = subscribeHandlerImpl(handle, true, entry->el, sub->eventName, sub->listener, sub->interval, sub->duration, sub->publishInterval, sub->coalesce, sub->filter);
             /*TODO figure out what to do if we get an error resubscribing
               It's conceivable that a provider might not like the sub due to some state change between this and the previous process run
              */
@@ -637,6 +761,8 @@ void rbusSubscriptions_resubscribeCache(rbusHandle_t handle, rbusSubscriptions_t
             rtListItem_GetNext(item, &item);
         }
     }
+
+    free(index);
 }
 
 void rbusSubscriptions_handleClientDisconnect(rbusHandle_t handle, rbusSubscriptions_t subscriptions, char const* listener)
@@ -660,7 +786,7 @@ void rbusSubscriptions_handleClientDisconnect(rbusHandle_t handle, rbusSubscript
             el = retrieveInstanceElement(handleInfo->elementRoot, sub->eventName);
             if(el)
             {
-                subscribeHandlerImpl(handle, false, sub->element, sub->eventName, sub->listener, 0, 0, 0);
+                subscribeHandlerImpl(handle, false, sub->element, sub->eventName, sub->listener, 0, 0, 0, false, 0);
             }
             else
             {
@@ -768,6 +894,7 @@ rbusSubscription_t* rbusSubscriptions_updateExisting(rbusSubscriptions_t subscri
 
                         free(sub->listener);
                         sub->listener = strdup(listener);
+                        rbusHandle_AddListener(subscriptions->handle, listener);
 
                         /*must save with new name in case this provider crashes*/
                         rbusSubscriptions_saveCache(subscriptions);
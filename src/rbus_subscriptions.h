@@ -40,6 +40,9 @@ typedef struct _rbusSubscription
     int32_t interval;           /* optional interval */
     int32_t duration;           /* optional duration */
     bool autoPublish;           /* auto publishing */
+    uint32_t publishInterval;   /* optional minimum milliseconds between events sent to the listener */
+    bool coalesce;              /* send the latest event held back by publishInterval once the interval elapses */
+    rtTime_t lastPublishTime;   /* when an event was last sent to the listener, used with publishInterval */
     TokenChain* tokens;         /* tokenized eventName for pattern matching */
     elementNode* element;       /* the registation element e.g. Device.WiFi.AccessPoint.{i}.AssociatedDevice.{i}.SignalStrength */
     rtList instances;           /* the instance elements e.g.   Device.WiFi.AccessPoint.1.AssociatedDevice.1.SignalStrength
@@ -54,7 +57,7 @@ void rbusSubscriptions_create(rbusSubscriptions_t* subscriptions, rbusHandle_t h
 void rbusSubscriptions_destroy(rbusSubscriptions_t subscriptions);
 
 /*add a new subscription with unique key [listener, eventName, filter] and the corresponding*/
-rbusSubscription_t* rbusSubscriptions_addSubscription(rbusSubscriptions_t subscriptions, char const* listener, char const* eventName, rbusFilter_t filter, int32_t interval, int32_t duration, bool autoPublish, elementNode* registryElem);
+rbusSubscription_t* rbusSubscriptions_addSubscription(rbusSubscriptions_t subscriptions, char const* listener, char const* eventName, rbusFilter_t filter, int32_t interval, int32_t duration, uint32_t publishInterval, bool coalesce, bool autoPublish, elementNode* registryElem);
 
 /*get an existing subscription by searching for its unique key [listener, eventName, filter]*/
 rbusSubscription_t* rbusSubscriptions_getSubscription(rbusSubscriptions_t subscriptions, char const* listener, char const* eventName, rbusFilter_t filter);
@@ -68,8 +71,12 @@ void rbusSubscriptions_onTableRowAdded(rbusSubscriptions_t subscriptions, elemen
 /*call right before an existing row is delete*/
 void rbusSubscriptions_onTableRowRemoved(rbusSubscriptions_t subscriptions, elementNode* node);
 
-/*call when registering an event data element to resubscribe any listeners that might have been loaded from cache*/
-void rbusSubscriptions_resubscribeCache(rbusHandle_t handle, rbusSubscriptions_t subscriptions, char const* elementName, elementNode* el);
+/*call right before the nodes of unregistered elements, sorted with sortElementSet, are freed*/
+void rbusSubscriptions_onElementsRemoved(rbusSubscriptions_t subscriptions, elementNodeSet const* nodes);
+
+/*call when registering event data elements to resubscribe any listeners that might have been loaded from cache.
+  elementNames and elements are parallel arrays of the registered names and their nodes*/
+void rbusSubscriptions_resubscribeCache(rbusHandle_t handle, rbusSubscriptions_t subscriptions, int numElements, char const** elementNames, elementNode** elements);
 
 /*unsubscribe any client when they disconnect from broker. handles cases where clients don't unsubscribe properly (e.g. because they crashed)*/
 void rbusSubscriptions_handleClientDisconnect(rbusHandle_t handle, rbusSubscriptions_t subscriptions, char const* listener);
@@ -140,201 +140,263 @@ void rbusValue_Release(rbusValue_t v)
     rtRetainable_release(v, rbusValue_Destroy);
 }
 
-char* rbusValue_ToString(rbusValue_t v, char* buf, size_t buflen)
+/* Two ASCII digits for each value 0..99, so integers are emitted two digits per division */
+static char const gDecimalPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static char const gHexDigits[] = "0123456789ABCDEF";
+
+/* Writes v in decimal to out (no null terminator); out must have room for 20 chars.  Returns the length. */
+static int rbusValue_FormatUnsigned(char* out, uint64_t v)
 {
-    char* p = NULL;
-    int n;
+    char tmp[20];
+    int i = sizeof(tmp);
 
-    if(v->type == RBUS_NONE)
-        return NULL;
+    while(v >= 100)
+    {
+        unsigned d = (unsigned)(v % 100) * 2;
+        v /= 100;
+        tmp[--i] = gDecimalPairs[d + 1];
+        tmp[--i] = gDecimalPairs[d];
+    }
+    if(v >= 10)
+    {
+        unsigned d = (unsigned)v * 2;
+        tmp[--i] = gDecimalPairs[d + 1];
+        tmp[--i] = gDecimalPairs[d];
+    }
+    else
+    {
+        tmp[--i] = (char)('0' + v);
+    }
+    memcpy(out, &tmp[i], sizeof(tmp) - i);
+    return (int)sizeof(tmp) - i;
+}
 
-    if (buf)
+/* Same as rbusValue_FormatUnsigned with a leading '-' for negative values; out needs 21 chars. */
+static int rbusValue_FormatSigned(char* out, int64_t v)
+{
+    if(v < 0)
     {
-      p = buf;
-      n = (int)buflen;
+        *out = '-';
+        return 1 + rbusValue_FormatUnsigned(out + 1, 0 - (uint64_t)v);
+    }
+    return rbusValue_FormatUnsigned(out, (uint64_t)v);
+}
 
-        switch(v->type)
-        {
-        case RBUS_STRING:
-            if(n > v->d.bytes->posWrite)
-                n = v->d.bytes->posWrite;
-            break;
-        case RBUS_BYTES:
-            if(n > v->d.bytes->posWrite + 1)
-                n = v->d.bytes->posWrite + 1;
-            break;
-        default:
-            break;
-        }
+/* Equivalent of printf("%0*d", width, v) for the date/time fields; out needs max(width,11) chars. */
+static int rbusValue_FormatPadded(char* out, int v, int width)
+{
+    char digits[20];
+    int n = rbusValue_FormatUnsigned(digits, v < 0 ? 0 - (uint64_t)(int64_t)v : (uint64_t)v);
+    int len = 0;
+
+    if(v < 0)
+    {
+        out[len++] = '-';
+        width--;
+    }
+    for(; width > n; width--)
+        out[len++] = '0';
+    memcpy(&out[len], digits, n);
+    return len + n;
+}
+
+/* Writes the ISO-8601 text of a datetime to out (no null terminator); out needs 80 chars. */
+static int rbusValue_FormatDateTime(char* out, rbusDateTime_t const* tv)
+{
+    struct tm const* t = &tv->m_time;
+    int len = 0;
+
+    /* tm_mon represents month from 0 to 11 and tm_year years since 1900,
+       except for the all zero date which is printed as is. */
+    if(0 == t->tm_year)
+    {
+        len += rbusValue_FormatPadded(&out[len], t->tm_year, 4);
+        out[len++] = '-';
+        len += rbusValue_FormatPadded(&out[len], t->tm_mon, 2);
     }
     else
     {
-        switch(v->type)
-        {
-        case RBUS_STRING:
-            n = v->d.bytes->posWrite;
-            break;
-        case RBUS_BYTES:
-            n = (2 * v->d.bytes->posWrite) + 1;
-            break;
-        case RBUS_BOOLEAN:
-            n = snprintf(p, 0, "%d", (int)v->d.b)+1;
-            break;
-        case RBUS_INT32:
-            n = snprintf(p, 0, "%d", v->d.i32)+1;
-            break;
-        case RBUS_UINT32:
-            n = snprintf(p, 0, "%u", v->d.u32)+1;
-            break;
-        case RBUS_CHAR:
-            n = snprintf(p, 0, "%c", v->d.c)+1;
-            break;
-        case RBUS_BYTE:
-            n = snprintf(p, 0, "%x", v->d.u)+1;
-            break;
-        case RBUS_INT8:
-            n = snprintf(p, 0, "%d", v->d.i8)+1;
-            break;
-        case RBUS_UINT8:
-            n = snprintf(p, 0, "%u", v->d.u8)+1;
-            break;
-        case RBUS_INT16:
-            n = snprintf(p, 0, "%hd", v->d.i16)+1;
-            break;
-        case RBUS_UINT16:
-            n = snprintf(p, 0, "%hu", v->d.u16)+1;
-            break;
-        case RBUS_INT64:
-            n = snprintf(p, 0, "%" PRIi64, v->d.i64)+1;
-            break;
-        case RBUS_UINT64:
-            n = snprintf(p, 0, "%" PRIu64, v->d.u64)+1;
-            break;
-        case RBUS_SINGLE:
-            n = snprintf(p, 0, "%*f", FLT_DIG, v->d.f32)+1;
-            break;
-        case RBUS_DOUBLE:
-            n = snprintf(p, 0, "%.*f", DBL_DIG, v->d.f64)+1;
-            break;
-        case RBUS_DATETIME:
-            n = snprintf(p, 0, "0000-00-00T00:00:00+00:00") + 1;
-            break;
-        default:
-            n = snprintf(p, 0, "FIXME TYPE %d", v->type)+1;
-            break;
-        }
-        p = calloc(n, 1);
+        len += rbusValue_FormatPadded(&out[len], t->tm_year + 1900, 4);
+        out[len++] = '-';
+        len += rbusValue_FormatPadded(&out[len], t->tm_mon + 1, 2);
+    }
+    out[len++] = '-';
+    len += rbusValue_FormatPadded(&out[len], t->tm_mday, 2);
+    out[len++] = 'T';
+    len += rbusValue_FormatPadded(&out[len], t->tm_hour, 2);
+    out[len++] = ':';
+    len += rbusValue_FormatPadded(&out[len], t->tm_min, 2);
+    out[len++] = ':';
+    len += rbusValue_FormatPadded(&out[len], t->tm_sec, 2);
+
+    if(tv->m_tz.m_tzhour || tv->m_tz.m_tzmin)
+    {
+        out[len++] = tv->m_tz.m_isWest ? '-' : '+';
+        len += rbusValue_FormatPadded(&out[len], tv->m_tz.m_tzhour, 2);
+        out[len++] = ':';
+        len += rbusValue_FormatPadded(&out[len], tv->m_tz.m_tzmin, 2);
+    }
+    else
+    {
+        out[len++] = 'Z';
     }
-    
+    return len;
+}
+
+int rbusValue_Format(rbusValue_t v, char* buf, size_t buflen)
+{
+    char tmp[128];
+    char const* src = tmp;
+    int len = 0;
+
+    if(buf && buflen)
+        buf[0] = 0;
+
+    if(!v || v->type == RBUS_NONE)
+        return -1;
+
     switch(v->type)
     {
     case RBUS_STRING:
-        strncpy(p, (char const* ) v->d.bytes->data, n);
+        if(v->d.bytes)
+        {
+            src = (char const*)v->d.bytes->data;
+            len = v->d.bytes->posWrite - 1;
+        }
         break;
     case RBUS_BYTES:
     {
-        int i = 0;
-        for (i = 0; i < v->d.bytes->posWrite; i++)
-            sprintf (&p[i * 2], "%02X", v->d.bytes->data[i]);
-        p[2 * v->d.bytes->posWrite] = 0;
-        break;
+        /* hex digits go straight to the caller's buffer, as many whole bytes as fit */
+        int i;
+        int n = v->d.bytes ? v->d.bytes->posWrite : 0;
+        if(buf && buflen)
+        {
+            int fit = (int)((buflen - 1) / 2);
+            if(fit > n)
+                fit = n;
+            for(i = 0; i < fit; i++)
+            {
+                buf[2 * i] = gHexDigits[v->d.bytes->data[i] >> 4];
+                buf[2 * i + 1] = gHexDigits[v->d.bytes->data[i] & 0xF];
+            }
+            buf[2 * fit] = 0;
+        }
+        return 2 * n;
     }
     case RBUS_BOOLEAN:
-        snprintf(p, n, "%d", (int)v->d.b);
-        break;
-    case RBUS_INT32:
-        snprintf(p, n, "%d", v->d.i32);
-        break;
-    case RBUS_UINT32:
-        snprintf(p, n, "%u", v->d.u32);
+        tmp[len++] = v->d.b ? '1' : '0';
         break;
     case RBUS_CHAR:
-        snprintf(p, n, "%c", v->d.c);
+        tmp[len++] = v->d.c;
         break;
     case RBUS_BYTE:
-        snprintf(p, n, "%x", v->d.u);
+        if(v->d.u >> 4)
+            tmp[len++] = (char)tolower(gHexDigits[v->d.u >> 4]);
+        tmp[len++] = (char)tolower(gHexDigits[v->d.u & 0xF]);
         break;
     case RBUS_INT8:
-        snprintf(p, n, "%d", v->d.i8);
+        len = rbusValue_FormatSigned(tmp, v->d.i8);
         break;
     case RBUS_UINT8:
-        snprintf(p, n, "%u", v->d.u8);
+        len = rbusValue_FormatUnsigned(tmp, v->d.u8);
         break;
     case RBUS_INT16:
-        snprintf(p, n, "%hd", v->d.i16);
+        len = rbusValue_FormatSigned(tmp, v->d.i16);
         break;
     case RBUS_UINT16:
-        snprintf(p, n, "%hu", v->d.u16);
+        len = rbusValue_FormatUnsigned(tmp, v->d.u16);
+        break;
+    case RBUS_INT32:
+        len = rbusValue_FormatSigned(tmp, v->d.i32);
+        break;
+    case RBUS_UINT32:
+        len = rbusValue_FormatUnsigned(tmp, v->d.u32);
         break;
     case RBUS_INT64:
-        snprintf(p, n, "%" PRIi64, v->d.i64);
+        len = rbusValue_FormatSigned(tmp, v->d.i64);
         break;
     case RBUS_UINT64:
-        snprintf(p, n, "%" PRIu64, v->d.u64);
+        len = rbusValue_FormatUnsigned(tmp, v->d.u64);
         break;
     case RBUS_SINGLE:
-        snprintf(p, n, "%*f", FLT_DIG, v->d.f32);
-        break;
+        return snprintf(buf, buf ? buflen : 0, "%*f", FLT_DIG, v->d.f32);
     case RBUS_DOUBLE:
-        snprintf(p, n, "%.*f", DBL_DIG, v->d.f64);
-        break;
+        return snprintf(buf, buf ? buflen : 0, "%.*f", DBL_DIG, v->d.f64);
     case RBUS_DATETIME:
-        {
-            char tmpBuff[40] = {0}; /* 27 bytes is good enough; */
-            if(v->d.tv.m_tz.m_tzhour || v->d.tv.m_tz.m_tzmin) {
-                if(v->d.tv.m_tz.m_isWest)
-                    snprintf(tmpBuff, 40, "-%02d:%02d",v->d.tv.m_tz.m_tzhour, v->d.tv.m_tz.m_tzmin);
-                else
-                    snprintf(tmpBuff, 40, "+%02d:%02d",v->d.tv.m_tz.m_tzhour, v->d.tv.m_tz.m_tzmin);
-            } else {
-                snprintf(tmpBuff, 40, "Z");
-            }
-            if(0 == v->d.tv.m_time.tm_year) {
-                snprintf(p, n, "%04d-%02d-%02dT%02d:%02d:%02d%s", v->d.tv.m_time.tm_year,
-                                                                    v->d.tv.m_time.tm_mon,
-                                                                    v->d.tv.m_time.tm_mday,
-                                                                    v->d.tv.m_time.tm_hour,
-                                                                    v->d.tv.m_time.tm_min,
-                                                                    v->d.tv.m_time.tm_sec,
-                                                                    tmpBuff);
-            } else {
-                /* tm_mon represents month from 0 to 11. So increment tm_mon by 1.
-                   tm_year represents years since 1900. So add 1900 to tm_year.
-                 */
-                snprintf(p, n, "%04d-%02d-%02dT%02d:%02d:%02d%s", v->d.tv.m_time.tm_year+1900,
-                                                                    v->d.tv.m_time.tm_mon+1,
-                                                                    v->d.tv.m_time.tm_mday,
-                                                                    v->d.tv.m_time.tm_hour,
-                                                                    v->d.tv.m_time.tm_min,
-                                                                    v->d.tv.m_time.tm_sec,
-                                                                    tmpBuff);
-            }
-            break;
-        }
-    case RBUS_NONE:
-        
-    default:
-        snprintf(p, n, "FIXME TYPE %d", v->type);
+        len = rbusValue_FormatDateTime(tmp, &v->d.tv);
         break;
+    default:
+        return snprintf(buf, buf ? buflen : 0, "FIXME TYPE %d", v->type);
     }
+
+    if(buf && buflen)
+    {
+        size_t n = (size_t)len < buflen ? (size_t)len : buflen - 1;
+        memcpy(buf, src, n);
+        buf[n] = 0;
+    }
+    return len;
+}
+
+char* rbusValue_ToString(rbusValue_t v, char* buf, size_t buflen)
+{
+    char tmp[RBUS_VALUE_FORMAT_MAX];
+    char* p;
+    int len;
+
+    if(v->type == RBUS_NONE)
+        return NULL;
+
+    if(buf)
+    {
+        rbusValue_Format(v, buf, buflen);
+        return buf;
+    }
+
+    /* strings and bytes are sized exactly; everything else fits the stack buffer,
+       so the value is formatted once and copied into a right-sized allocation */
+    if(v->type == RBUS_STRING || v->type == RBUS_BYTES)
+    {
+        len = rbusValue_Format(v, NULL, 0);
+        p = malloc(len + 1);
+        rbusValue_Format(v, p, len + 1);
+        return p;
+    }
+    len = rbusValue_Format(v, tmp, sizeof(tmp));
+    p = malloc(len + 1);
+    memcpy(p, tmp, len + 1);
     return p;
 }
 
 char* rbusValue_ToDebugString(rbusValue_t v, char* buf, size_t buflen)
 {
-    int len = buflen;
-    char* p = buf;
-    char* s = rbusValue_ToString(v, NULL, 0);
     char const* t = rbusValueType_ToDebugString(v->type);
-    char fmt[] = "rbusValue type:%s value:%s";
-    if(!p)
+    char fmt[] = "rbusValue type:%s value:";
+    size_t len;
+    int n;
+
+    if(!buf)
     {
-        len = snprintf(NULL, 0, fmt, t, s) + 1;
-        p = malloc(len);
+        n = rbusValue_Format(v, NULL, 0);
+        buflen = snprintf(NULL, 0, fmt, t) + (n > 0 ? n : 0) + 1;
+        buf = malloc(buflen);
     }
-    snprintf(p, len, fmt, t, s);
-    free(s);
-    return p;
+    n = snprintf(buf, buflen, fmt, t);
+    len = n > 0 ? (size_t)n : 0;
+    if(len < buflen)
+        rbusValue_Format(v, buf + len, buflen - len);
+    return buf;
 }
 
 rbusValueType_t rbusValue_GetType(rbusValue_t v)
@@ -691,78 +753,167 @@ void rbusValue_SetTLV(rbusValue_t v, rbusValueType_t type, uint32_t length, void
     assert(rbusValue_GetL(v) == length);
 }
 
+/*the TLV length of the fixed size types or 0 if the type isn't fixed size*/
+static uint16_t rbusValue_FixedLength(uint16_t type)
+{
+    switch(type)
+    {
+    case RBUS_BOOLEAN:
+    case RBUS_CHAR:
+    case RBUS_BYTE:
+    case RBUS_INT8:
+    case RBUS_UINT8:
+        return 1;
+    case RBUS_INT16:
+    case RBUS_UINT16:
+        return 2;
+    case RBUS_INT32:
+    case RBUS_UINT32:
+    case RBUS_SINGLE:
+        return 4;
+    case RBUS_INT64:
+    case RBUS_UINT64:
+    case RBUS_DOUBLE:
+        return 8;
+    case RBUS_DATETIME:
+        return sizeof(rbusDateTime_t);
+    default:
+        return 0;
+    }
+}
+
 int rbusValue_Decode(rbusValue_t* value, rbusBuffer_t const buff)
+{
+    return rbusValue_DecodeNested(value, buff, 0);
+}
+
+int rbusValue_DecodeNested(rbusValue_t* value, rbusBuffer_t const buff, int depth)
 {
     uint16_t    type;
     uint16_t    length;
+    uint16_t    fixedLength;
     rbusValue_t current;
+    int         rc = -1;
+
+    *value = NULL;
+
+    // read value
+    if(rbusBuffer_ReadTypeLength(buff, &type, &length) < 0)
+        return -1;
+    fixedLength = rbusValue_FixedLength(type);
+    if(fixedLength && fixedLength != length)
+    {
+        RBUSLOG_WARN("rbusValue_Decode failed: type %d length %d", type, length);
+        return -1;
+    }
 
     rbusValue_Init(value);
 
     current = *value;
+    if(fixedLength)
+        current->type = type;
 
-    // read value
-    rbusBuffer_ReadUInt16(buff, &type);
-    rbusBuffer_ReadUInt16(buff, &length);
-    current->type = type;
     switch(type)
     {
     /*Calling rbusValue_SetString/rbusValue_SetBytes so the value's internal buffer is created.*/
     case RBUS_STRING:
-        if(!(buff->posRead + length <= buff->lenAlloc))
-        {
-            RBUSLOG_WARN("rbusValue_Decode failed");
-            return -1;
-        }
-        assert(strlen((char const*)buff->data + buff->posRead) + 1 == (size_t)length);/*length should captures null term*/
+        /*length should captures null term*/
+        if(length == 0 || buff->data[buff->posRead + length - 1] != '\0')
+            break;
         rbusValue_SetString(current, (char const*)buff->data + buff->posRead);
         buff->posRead += length;
-        return length;
+        rc = length;
+        break;
     case RBUS_BYTES:
-        if(!(buff->posRead + length <= buff->lenAlloc))
-        {
-            RBUSLOG_WARN("rbusValue_Decode failed");
-            return -1;
-        }
         rbusValue_SetBytes(current, buff->data + buff->posRead, length);
         buff->posRead += length;
-        return length;
-    /* For the other types, its ok to read directly into them and set the type below */
+        rc = length;
+        break;
+    /*Objects and property lists are written with length 0 and followed by their own encoding*/
+    case RBUS_OBJECT:
+    {
+        rbusObject_t object;
+        if(length == 0 && rbusObject_DecodeNested(&object, buff, depth + 1) == 0)
+        {
+            rbusValue_SetObject(current, object);
+            rbusObject_Release(object);
+            rc = 0;
+        }
+        break;
+    }
+    case RBUS_PROPERTY:
+    {
+        rbusProperty_t property;
+        if(length == 0 && rbusPropertyList_DecodeNested(&property, buff, depth + 1) == 0)
+        {
+            rbusValue_SetProperty(current, property);
+            if(property)
+                rbusProperty_Release(property);
+            rc = 0;
+        }
+        break;
+    }
+    case RBUS_NONE:
+        if(length == 0)
+            rc = 0;
+        break;
+    /* For the other types, its ok to read directly into them */
     case RBUS_BOOLEAN:
-        return rbusBuffer_ReadBoolean(buff, &current->d.b);
+        rc = rbusBuffer_ReadBoolean(buff, &current->d.b);
+        break;
     case RBUS_INT32:
-        return rbusBuffer_ReadInt32(buff, &current->d.i32);
+        rc = rbusBuffer_ReadInt32(buff, &current->d.i32);
+        break;
     case RBUS_UINT32:
-        return rbusBuffer_ReadUInt32(buff, &current->d.u32);
+        rc = rbusBuffer_ReadUInt32(buff, &current->d.u32);
+        break;
     case RBUS_CHAR:
-        return rbusBuffer_ReadChar(buff, &current->d.c);
+        rc = rbusBuffer_ReadChar(buff, &current->d.c);
+        break;
     case RBUS_BYTE:
-        return rbusBuffer_ReadByte(buff, &current->d.u);
+        rc = rbusBuffer_ReadByte(buff, &current->d.u);
+        break;
     case RBUS_INT8:
-        return rbusBuffer_ReadInt8(buff, &current->d.i8);
+        rc = rbusBuffer_ReadInt8(buff, &current->d.i8);
+        break;
     case RBUS_UINT8:
-        return rbusBuffer_ReadUInt8(buff, &current->d.u8);
+        rc = rbusBuffer_ReadUInt8(buff, &current->d.u8);
+        break;
     case RBUS_INT16:
-        return rbusBuffer_ReadInt16(buff, &current->d.i16);
+        rc = rbusBuffer_ReadInt16(buff, &current->d.i16);
+        break;
     case RBUS_UINT16:
-        return rbusBuffer_ReadUInt16(buff, &current->d.u16);
+        rc = rbusBuffer_ReadUInt16(buff, &current->d.u16);
+        break;
     case RBUS_INT64:
-        return rbusBuffer_ReadInt64(buff, &current->d.i64);
+        rc = rbusBuffer_ReadInt64(buff, &current->d.i64);
+        break;
     case RBUS_UINT64:
-        return rbusBuffer_ReadUInt64(buff, &current->d.u64);
+        rc = rbusBuffer_ReadUInt64(buff, &current->d.u64);
+        break;
     case RBUS_SINGLE:
-        return rbusBuffer_ReadSingle(buff, &current->d.f32);
+        rc = rbusBuffer_ReadSingle(buff, &current->d.f32);
+        break;
     case RBUS_DOUBLE:
-        return rbusBuffer_ReadDouble(buff, &current->d.f64);
+        rc = rbusBuffer_ReadDouble(buff, &current->d.f64);
+        break;
     case RBUS_DATETIME:
-        return rbusBuffer_ReadDateTime(buff, &current->d.tv);
+        rc = rbusBuffer_ReadDateTime(buff, &current->d.tv);
+        break;
     default:
-        assert(false);
-        return -1;
+        break;
     }
+
+    if(rc < 0)
+    {
+        RBUSLOG_WARN("rbusValue_Decode failed: type %d length %d", type, length);
+        rbusValue_Release(current);
+        *value = NULL;
+    }
+    return rc;
 }
 
-void rbusValue_Encode(rbusValue_t value, rbusBuffer_t buff)
+int rbusValue_Encode(rbusValue_t value, rbusBuffer_t buff)
 {
     // encode value
     switch(value->type)
@@ -772,12 +923,16 @@ void rbusValue_Encode(rbusValue_t value, rbusBuffer_t buff)
         assert(value->d.bytes->posWrite <= value->d.bytes->lenAlloc);
         assert(value->d.bytes->posRead == 0);
         assert(strlen((char const*)value->d.bytes->data)+1 == (size_t)value->d.bytes->posWrite);
+        if(value->d.bytes->posWrite > UINT16_MAX)
+            return -1;
         rbusBuffer_WriteStringTLV(buff, (char const*)value->d.bytes->data, value->d.bytes->posWrite);
         break;
     case RBUS_BYTES:
         assert(value->d.bytes->data);
         assert(value->d.bytes->posWrite <= value->d.bytes->lenAlloc);
         assert(value->d.bytes->posRead == 0);
+        if(value->d.bytes->posWrite > UINT16_MAX)
+            return -1;
         rbusBuffer_WriteBytesTLV(buff, value->d.bytes->data, value->d.bytes->posWrite);
         break;
     case RBUS_BOOLEAN:
@@ -822,10 +977,20 @@ void rbusValue_Encode(rbusValue_t value, rbusBuffer_t buff)
     case RBUS_DATETIME:
         rbusBuffer_WriteDateTimeTLV(buff, &value->d.tv);
         break;
+    case RBUS_OBJECT:
+        rbusBuffer_WriteTypeLengthValue(buff, RBUS_OBJECT, 0, NULL);
+        return rbusObject_Encode(value->d.object, buff);
+    case RBUS_PROPERTY:
+        rbusBuffer_WriteTypeLengthValue(buff, RBUS_PROPERTY, 0, NULL);
+        return rbusPropertyList_Encode(value->d.property, buff);
+    case RBUS_NONE:
+        rbusBuffer_WriteTypeLengthValue(buff, RBUS_NONE, 0, NULL);
+        break;
     default:
         assert(false);
-        break;
+        return -1;
     }
+    return 0;
 }
 
 static double rbusValue_CoerceNumericToDouble(rbusValue_t v)
@@ -1011,6 +1176,256 @@ void rbusValue_Copy(rbusValue_t dest, rbusValue_t source)
     assert(rbusValue_Compare(dest, source)==0);
 }
 
+/*
+    Fast paths for rbusValue_SetFromString.  Values from legacy components arrive as
+    text with a known type, and nearly all of them are plain decimal numbers or dates
+    in the one format CCSP writes.  These parse that common form directly, without
+    locale lookups, base detection or strptime, and return false for anything else so
+    the generic strto and strptime based code below decides, with unchanged results.
+*/
+
+/*[+-]digits in base 10 without leading zeros, which strtol with base 0 would read as octal*/
+static bool rbusValue_ParseDecimal(char const* s, bool* negative, uint64_t* magnitude)
+{
+    uint64_t m = 0;
+
+    *negative = false;
+    if(*s == '-' || *s == '+')
+        *negative = (*s++ == '-');
+    if(*s < '0' || *s > '9' || (s[0] == '0' && s[1] != '\0'))
+        return false;
+    do
+    {
+        unsigned d = (unsigned)(*s - '0');
+        if(d > 9 || m > (UINT64_MAX - d) / 10)
+            return false;
+        m = m * 10 + d;
+    } while(*++s);
+    *magnitude = m;
+    return true;
+}
+
+/*[+-]digits[.digits][(e|E)[+-]digits] as an exact integer mantissa and power of ten*/
+static bool rbusValue_ParseDecimalFloat(char const* s, bool* negative, uint64_t* mantissa, int* exponent)
+{
+    uint64_t m = 0;
+    int digits = 0;
+    int e = 0;
+
+    *negative = false;
+    if(*s == '-' || *s == '+')
+        *negative = (*s++ == '-');
+    for(; *s >= '0' && *s <= '9'; ++s, ++digits)
+    {
+        if(m > (UINT64_MAX - 9) / 10)
+            return false;
+        m = m * 10 + (uint64_t)(*s - '0');
+    }
+    if(*s == '.')
+    {
+        for(++s; *s >= '0' && *s <= '9'; ++s, ++digits, --e)
+        {
+            if(m > (UINT64_MAX - 9) / 10)
+                return false;
+            m = m * 10 + (uint64_t)(*s - '0');
+        }
+    }
+    if(digits == 0)
+        return false;
+    if(*s == 'e' || *s == 'E')
+    {
+        bool negExp = false;
+        int x = 0;
+        ++s;
+        if(*s == '-' || *s == '+')
+            negExp = (*s++ == '-');
+        if(*s < '0' || *s > '9')
+            return false;
+        for(; *s >= '0' && *s <= '9'; ++s)
+        {
+            if(x > 1000)
+                return false;
+            x = x * 10 + (*s - '0');
+        }
+        e += negExp ? -x : x;
+    }
+    if(*s != '\0')
+        return false;
+    *mantissa = m;
+    *exponent = e;
+    return true;
+}
+
+/*the result is exact when both the mantissa and the power of ten are exactly
+  representable, so a single correctly rounded multiply or divide gives the same
+  value strtod does*/
+static bool rbusValue_ParseDouble(char const* s, double* value)
+{
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    bool negative;
+    uint64_t m;
+    int e;
+    double d;
+
+    if(!rbusValue_ParseDecimalFloat(s, &negative, &m, &e) || m > (1ULL << 53) || e < -22 || e > 22)
+        return false;
+    d = (double)m;
+    d = e < 0 ? d / pow10[-e] : d * pow10[e];
+    *value = negative ? -d : d;
+    return true;
+}
+
+static bool rbusValue_ParseSingle(char const* s, float* value)
+{
+    static const float pow10[] = {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+    bool negative;
+    uint64_t m;
+    int e;
+    float f;
+
+    if(!rbusValue_ParseDecimalFloat(s, &negative, &m, &e) || m > (1ULL << 24) || e < -10 || e > 10)
+        return false;
+    f = (float)m;
+    f = e < 0 ? f / pow10[-e] : f * pow10[e];
+    *value = negative ? -f : f;
+    return true;
+}
+
+static bool rbusValue_ParseDigits(char const* s, int count, int min, int max, int* value)
+{
+    int v = 0;
+    int i;
+
+    for(i = 0; i < count; ++i)
+    {
+        if(s[i] < '0' || s[i] > '9')
+            return false;
+        v = v * 10 + (s[i] - '0');
+    }
+    if(v < min || v > max)
+        return false;
+    *value = v;
+    return true;
+}
+
+/*"YYYY-MM-DD[T ]HH:MM:SS" optionally followed by a "+HH:MM" timezone, filled in
+  the same as strptime does, including tm_wday and tm_yday*/
+static bool rbusValue_ParseDateTime(char const* s, rbusDateTime_t* tv)
+{
+    static const int monthDays[2][12] = {
+        { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 },
+        { 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335 } };
+    struct tm* tm = &tv->m_time;
+    char const* tz;
+    int year, mon, mday, hour, min, sec;
+    int leap, y, wday;
+
+    if(s[4] != '-' || s[7] != '-' || s[13] != ':' || s[16] != ':' ||
+        !(s[10] == 'T' || (s[10] == ' ' && !strchr(s, 'T'))) ||
+        !rbusValue_ParseDigits(s, 4, 0, 9999, &year) ||
+        !rbusValue_ParseDigits(s + 5, 2, 1, 12, &mon) ||
+        !rbusValue_ParseDigits(s + 8, 2, 1, 31, &mday) ||
+        !rbusValue_ParseDigits(s + 11, 2, 0, 23, &hour) ||
+        !rbusValue_ParseDigits(s + 14, 2, 0, 59, &min) ||
+        !rbusValue_ParseDigits(s + 17, 2, 0, 61, &sec))
+        return false;
+
+    leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    tm->tm_year = year - 1900;
+    tm->tm_mon = mon - 1;
+    tm->tm_mday = mday;
+    tm->tm_hour = hour;
+    tm->tm_min = min;
+    tm->tm_sec = sec;
+    tm->tm_yday = monthDays[leap][mon - 1] + mday - 1;
+
+    /*days since 0000-03-01 with the year starting in march, 0000-03-01 being a wednesday*/
+    y = mon < 3 ? year - 1 : year;
+    wday = 365 * y + y / 4 - y / 100 + y / 400 + (153 * ((mon + 9) % 12) + 2) / 5 + mday - 1;
+    tm->tm_wday = (wday + 3) % 7;
+
+    tz = s + 19;
+    if(strlen(tz) == RBUS_TIMEZONE_LEN && isdigit((int)tz[1]) && isdigit((int)tz[2]) && isdigit((int)tz[4]) && isdigit((int)tz[5]))
+    {
+        tv->m_tz.m_isWest = ('-' == tz[0]);
+        tv->m_tz.m_tzhour = (tz[1] - '0') * 10 + (tz[2] - '0');
+        tv->m_tz.m_tzmin = tz[3] == ':' ? (tz[4] - '0') * 10 + (tz[5] - '0') : 0;
+    }
+    return true;
+}
+
+static bool rbusValue_SetFromStringFast(rbusValue_t value, rbusValueType_t type, const char* s)
+{
+    bool negative;
+    uint64_t m;
+
+    switch(type)
+    {
+    case RBUS_BOOLEAN:
+        if((s[0] == '1' || s[0] == '0') && s[1] == '\0')
+            rbusValue_SetBoolean(value, s[0] == '1');
+        else if(strcasecmp(s, "true") == 0)
+            rbusValue_SetBoolean(value, true);
+        else if(strcasecmp(s, "false") == 0)
+            rbusValue_SetBoolean(value, false);
+        else
+            return false;
+        return true;
+    case RBUS_INT32:
+        if(!rbusValue_ParseDecimal(s, &negative, &m) || m > (negative ? (uint64_t)INT32_MAX + 1 : (uint64_t)INT32_MAX))
+            return false;
+        rbusValue_SetInt32(value, negative ? (int32_t)(0 - m) : (int32_t)m);
+        return true;
+    case RBUS_UINT32:
+        if(!rbusValue_ParseDecimal(s, &negative, &m) || negative || m > UINT32_MAX)
+            return false;
+        rbusValue_SetUInt32(value, (uint32_t)m);
+        return true;
+    case RBUS_INT64:
+        if(!rbusValue_ParseDecimal(s, &negative, &m) || m > (negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX))
+            return false;
+        rbusValue_SetInt64(value, negative ? (int64_t)(0 - m) : (int64_t)m);
+        return true;
+    case RBUS_UINT64:
+        if(!rbusValue_ParseDecimal(s, &negative, &m) || negative)
+            return false;
+        rbusValue_SetUInt64(value, m);
+        return true;
+    case RBUS_SINGLE:
+    {
+        float f;
+        if(!rbusValue_ParseSingle(s, &f))
+            return false;
+        rbusValue_SetSingle(value, f);
+        return true;
+    }
+    case RBUS_DOUBLE:
+    {
+        double d;
+        if(!rbusValue_ParseDouble(s, &d))
+            return false;
+        rbusValue_SetDouble(value, d);
+        return true;
+    }
+    case RBUS_DATETIME:
+    {
+        rbusDateTime_t tv;
+        if(strncmp(s, "0000-", 5) == 0)
+            return false;
+        memset(&tv, 0, sizeof(tv));
+        if(strlen(s) < 19 || !rbusValue_ParseDateTime(s, &tv))
+            return false;
+        rbusValue_SetTime(value, &tv);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
 bool rbusValue_SetFromString(rbusValue_t value, rbusValueType_t type, const char* pStringInput)
 {
     bool tmpB = false;
@@ -1024,12 +1439,18 @@ bool rbusValue_SetFromString(rbusValue_t value, rbusValueType_t type, const char
     unsigned long long tmpULL = 0;
     errno = 0;
     char *endptr = NULL;
-    char sign = *pStringInput;
-    unsigned int tmp_strlen = strlen(pStringInput);
+    char sign;
+    unsigned int tmp_strlen;
 
     if (pStringInput == NULL)
         return false;
 
+    if (rbusValue_SetFromStringFast(value, type, pStringInput))
+        return true;
+
+    sign = *pStringInput;
+    tmp_strlen = strlen(pStringInput);
+
     switch(type)
     {
     case RBUS_STRING:
@@ -1236,10 +1657,15 @@ void rbusValue_fwrite(rbusValue_t value, int depth, FILE* fout)
     else
     {
         int i;
-        char* s = rbusValue_ToDebugString(value, NULL, 0);
+        char buf[RBUS_VALUE_FORMAT_MAX + 64];
+        char* s = rbusValue_ToDebugString(value, buf, sizeof(buf));
+        /* only long strings and bytes need a heap buffer */
+        if(strlen(s) == sizeof(buf) - 1)
+            s = rbusValue_ToDebugString(value, NULL, 0);
         for(i=0; i<depth; ++i)
             fprintf(fout, " ");
         fprintf(fout, "%s", s);
-        free(s);
+        if(s != buf)
+            free(s);
     }
 }
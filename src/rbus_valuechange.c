@@ -35,6 +35,7 @@
 #include "rbus_valuechange.h"
 #include "rbus_config.h"
 #include "rbus_handle.h"
+#include "rbus_stats_internal.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <memory.h>
@@ -131,6 +132,8 @@ static void* rbusValueChange_pollingThreadFunc(void *userData)
         int err;
         rtTime_t timeout;
         rtTimespec_t ts;
+        rtTime_t pollStart;
+        bool pollFailed;
 
         rtTime_Later(NULL, rbusConfig_Get()->valueChangePeriod, &timeout);
         
@@ -148,6 +151,9 @@ static void* rbusValueChange_pollingThreadFunc(void *userData)
             break;
         }
 
+        rtTime_Now(&pollStart);
+        pollFailed = false;
+
         for(i=0; i < rtVector_Size(gVC->params); ++i)
         {
             rbusProperty_t property;
@@ -168,12 +174,16 @@ static void* rbusValueChange_pollingThreadFunc(void *userData)
             if(result != RBUS_ERROR_SUCCESS)
             {
                 RBUSLOG_WARN("%s: failed to get current value of %s", __FUNCTION__, rbusProperty_GetName(property));
+                pollFailed = true;
                 continue;
             }
 
-            char* sValue = rbusValue_ToString(rbusProperty_GetValue(property), NULL, 0);
-            RBUSLOG_DEBUG("%s: %s=%s", __FUNCTION__, rbusProperty_GetName(property), sValue);
-            free(sValue);
+            if(RBUSLOG_ENABLED(DEBUG))
+            {
+                char sValue[RBUS_VALUE_FORMAT_MAX];
+                rbusValue_Format(rbusProperty_GetValue(property), sValue, sizeof(sValue));
+                RBUSLOG_DEBUG("%s: %s=%s", __FUNCTION__, rbusProperty_GetName(property), sValue);
+            }
 
             newVal = rbusProperty_GetValue(property);
             oldVal = rbusProperty_GetValue(rec->property);
@@ -186,6 +196,9 @@ static void* rbusValueChange_pollingThreadFunc(void *userData)
 
                 RBUSLOG_INFO("%s: value change detected for %s", __FUNCTION__, rbusProperty_GetName(rec->property));
 
+                if(__atomic_load_n(&rec->node->cacheMaxAge, __ATOMIC_RELAXED))
+                    invalidateElementCache((elementNode*)rec->node);
+
                 /*
                     mrollins: I added a 'filter=true|false' property to the event data when a filter it triggered.
                     This would let the consumer know if their filter got triggered by the property's value crossing
@@ -316,6 +329,7 @@ static void* rbusValueChange_pollingThreadFunc(void *userData)
                 rbusProperty_Release(property);
             }
         }
+        rbusStats_Record(RBUS_STATS_VALUE_CHANGE_POLL, &pollStart, pollFailed);
     }
     UNLOCK();
     RBUSLOG_DEBUG("%s: stop", __FUNCTION__);
@@ -384,9 +398,12 @@ void rbusValueChange_AddPropertyNode(rbusHandle_t handle, elementNode* propNode)
             return;
         }
 
-        char* sValue;
-        RBUSLOG_DEBUG("%s: %s=%s", __FUNCTION__, propNode->fullName, (sValue = rbusValue_ToString(rbusProperty_GetValue(rec->property), NULL, 0)));
-        free(sValue);
+        if(RBUSLOG_ENABLED(DEBUG))
+        {
+            char sValue[RBUS_VALUE_FORMAT_MAX];
+            rbusValue_Format(rbusProperty_GetValue(rec->property), sValue, sizeof(sValue));
+            RBUSLOG_DEBUG("%s: %s=%s", __FUNCTION__, propNode->fullName, sValue);
+        }
 
         LOCK();//############ LOCK ############
 
@@ -446,6 +463,52 @@ void rbusValueChange_RemovePropertyNode(rbusHandle_t handle, elementNode* propNo
     }
 }
 
+void rbusValueChange_RemovePropertyNodes(rbusHandle_t handle, elementNodeSet const* nodes)
+{
+    rtVector kept;
+    size_t i, removed = 0;
+    bool stopThread = false;
+
+    (void)(handle);
+
+    if(!gVC || nodes->count == 0)
+    {
+        return;
+    }
+
+    LOCK();//############ LOCK ############
+    /*rebuild the list in one pass rather than removing records one search at a time*/
+    rtVector_Create(&kept);
+    for(i=0; i < rtVector_Size(gVC->params); ++i)
+    {
+        ValueChangeRecord* rec = (ValueChangeRecord*)rtVector_At(gVC->params, i);
+        if(elementSetContains(nodes, rec->node))
+        {
+            vcParams_Free(rec);
+            removed++;
+        }
+        else
+        {
+            rtVector_PushBack(kept, rec);
+        }
+    }
+    rtVector_Destroy(gVC->params, NULL);
+    gVC->params = kept;
+    RBUSLOG_DEBUG("%s: removed %zu params", __FUNCTION__, removed);
+    /* if there's nothing left to poll then shutdown the polling thread */
+    if(removed && gVC->running && rtVector_Size(gVC->params) == 0)
+    {
+        stopThread = true;
+        gVC->running = 0;
+    }
+    UNLOCK();//############ UNLOCK ############
+    if(stopThread)
+    {
+        ERROR_CHECK(pthread_cond_signal(&gVC->cond));
+        ERROR_CHECK(pthread_join(gVC->thread, NULL));
+    }
+}
+
 void rbusValueChange_CloseHandle(rbusHandle_t handle)
 {
     RBUSLOG_DEBUG("%s", __FUNCTION__);
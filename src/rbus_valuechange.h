@@ -28,6 +28,8 @@ extern "C" {
 
 void rbusValueChange_AddPropertyNode(rbusHandle_t handle, elementNode* propNode);
 void rbusValueChange_RemovePropertyNode(rbusHandle_t handle, elementNode* propNode);
+/*stop polling every property in nodes, which must be sorted*/
+void rbusValueChange_RemovePropertyNodes(rbusHandle_t handle, elementNodeSet const* nodes);
 void rbusValueChange_CloseHandle(rbusHandle_t handle);
 
 #ifdef __cplusplus
@@ -80,6 +80,58 @@ static void test(rbusHandle_t handle, char const* query, int expectCount, ...)
     return;
 }
 
+typedef struct
+{
+    int chunkSize;
+    int chunks;
+    int total;
+    int bad;
+} StreamResult;
+
+static bool streamHandler(rbusHandle_t handle, int numProps, rbusProperty_t properties, void* userData)
+{
+    StreamResult* result = userData;
+    rbusProperty_t next = properties;
+    int count = 0;
+
+    (void)handle;
+
+    result->chunks++;
+    if(numProps > result->chunkSize)
+        result->bad++;
+
+    /*the provider returns each param's name as its value*/
+    while(next)
+    {
+        rbusValue_t value = rbusProperty_GetValue(next);
+        if(!value || rbusValue_GetType(value) != RBUS_STRING || strcmp(rbusValue_GetString(value, NULL), rbusProperty_GetName(next)))
+            result->bad++;
+        count++;
+        next = rbusProperty_GetNext(next);
+    }
+    if(count != numProps)
+        result->bad++;
+    result->total += count;
+    return true;
+}
+
+static void testStream(rbusHandle_t handle, char const* query, int chunkSize, int expectCount)
+{
+    rbusError_t rc;
+    StreamResult result = { chunkSize, 0, 0, 0 };
+
+    printf("test partial path stream query=%s chunkSize=%d expectCount=%d\n", query, chunkSize, expectCount);
+
+    rc = rbus_getExtStream(handle, query, chunkSize, streamHandler, &result);
+
+    printf("test partial path stream rc=%d chunks=%d total=%d bad=%d\n", rc, result.chunks, result.total, result.bad);
+
+    TEST(rc == RBUS_ERROR_SUCCESS);
+    TEST(result.total == expectCount);
+    TEST(result.chunks >= (expectCount + chunkSize - 1) / chunkSize);
+    TEST(result.bad == 0);
+}
+
 static void test1(rbusHandle_t handle, char const* prop)
 {
     rbusError_t rc;
@@ -273,6 +325,10 @@ void testPartialPath(rbusHandle_t handle, int* countPass, int* countFail)
         "Device.TestProvider.PartialPath2.2.SubTable.3.SubObject2.Param6",
         "Device.TestProvider.PartialPath2.2.SubTable.3.SubObject2.Param7");
 
+    testStream(handle, "Device.TestProvider.PartialPath1.", 3, 20);
+    testStream(handle, "Device.TestProvider.PartialPath2.", 3, 20);
+    testStream(handle, "Device.TestProvider.PartialPath1.2.", 5, 13);
+
     /*throw in some individual gets to ensure they are working with this data set*/
 
     test1(handle,  "Device.TestProvider.PartialPath1.1.Param1");
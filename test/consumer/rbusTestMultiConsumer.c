@@ -68,6 +68,135 @@ static void eventHandler(
     }
 }
 
+/*a param this process owns, for a set that spans it and a provider.  Like the
+  providers' Value it is only changed by a commit*/
+char consumerValue[64] = "";
+char consumerPending[64] = "";
+
+static rbusError_t consumerValueGetHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
+{
+    rbusValue_t value;
+
+    (void)handle;
+    (void)opts;
+
+    rbusValue_Init(&value);
+    rbusValue_SetString(value, consumerValue);
+    rbusProperty_SetValue(property, value);
+    rbusValue_Release(value);
+    return RBUS_ERROR_SUCCESS;
+}
+
+static rbusError_t consumerValueSetHandler(rbusHandle_t handle, rbusProperty_t property, rbusSetHandlerOptions_t* opts)
+{
+    rbusValue_t value = rbusProperty_GetValue(property);
+
+    (void)handle;
+
+    if(!value || rbusValue_GetType(value) != RBUS_STRING)
+        return RBUS_ERROR_INVALID_INPUT;
+    if(opts->commit)
+        snprintf(consumerValue, sizeof(consumerValue), "%s", rbusValue_GetString(value, NULL));
+    else
+        snprintf(consumerPending, sizeof(consumerPending), "%s", rbusValue_GetString(value, NULL));
+    return RBUS_ERROR_SUCCESS;
+}
+
+static rbusError_t setMultiStrings(rbusHandle_t handle, char const* name1, char const* value1, char const* name2, char const* value2)
+{
+    rbusProperty_t properties, next;
+    rbusValue_t value;
+    rbusSetOptions_t opts = {true, 0};
+    rbusError_t rc;
+
+    rbusValue_Init(&value);
+    rbusValue_SetString(value, value1);
+    rbusProperty_Init(&properties, name1, value);
+    rbusValue_Release(value);
+
+    rbusValue_Init(&value);
+    rbusValue_SetString(value, value2);
+    rbusProperty_Init(&next, name2, value);
+    rbusValue_Release(value);
+
+    rbusProperty_PushBack(properties, next);
+    rbusProperty_Release(next);
+
+    rc = rbus_setMulti(handle, 2, properties, &opts);
+    rbusProperty_Release(properties);
+    return rc;
+}
+
+static bool getStringIs(rbusHandle_t handle, char const* name, char const* expected)
+{
+    rbusValue_t value = NULL;
+    bool match = false;
+    rbusError_t rc = rbus_get(handle, name, &value);
+
+    if(rc == RBUS_ERROR_SUCCESS)
+    {
+        match = rbusValue_GetType(value) == RBUS_STRING && strcmp(rbusValue_GetString(value, NULL), expected) == 0;
+        printf("_test_:rbus_get param:'%s' value:'%s' expected:'%s'\n", name, rbusValue_GetString(value, NULL), expected);
+        rbusValue_Release(value);
+    }
+    else
+    {
+        printf("_test_:rbus_get result:FAIL param:'%s' rc:%d\n", name, rc);
+    }
+    return match;
+}
+
+static void testSetMulti(rbusHandle_t handle, rbusHandle_t other)
+{
+    rbusDataElement_t element = {"Device.MultiConsumer.Value", RBUS_ELEMENT_TYPE_PROPERTY, {consumerValueGetHandler,consumerValueSetHandler,NULL,NULL,NULL,NULL}};
+    rbusError_t rc;
+
+    printf("consumer: rbus_setMulti across components\n");
+
+    /*both components commit*/
+    rc = setMultiStrings(handle, "Device.MultiProvider1.Value", "a1", "Device.MultiProvider2.Value", "a2");
+    TEST(rc == RBUS_ERROR_SUCCESS);
+    TEST(getStringIs(handle, "Device.MultiProvider1.Value", "a1"));
+    TEST(getStringIs(handle, "Device.MultiProvider2.Value", "a2"));
+    printf("_test_:rbus_setMulti-commit rc:%d\n", rc);
+
+    /*MultiProvider2 has no setHandler for ReadOnly, so nothing is committed*/
+    rc = setMultiStrings(handle, "Device.MultiProvider1.Value", "b1", "Device.MultiProvider2.ReadOnly", "b2");
+    TEST(rc == RBUS_ERROR_INVALID_OPERATION);
+    TEST(getStringIs(handle, "Device.MultiProvider1.Value", "a1"));
+    printf("_test_:rbus_setMulti-prepare-reject rc:%d\n", rc);
+
+    /*MultiProvider2's setHandler rejects its value, so MultiProvider1 is never sent the commit*/
+    rc = setMultiStrings(handle, "Device.MultiProvider1.Value", "c1", "Device.MultiProvider2.Value", "fail");
+    TEST(rc == RBUS_ERROR_INVALID_INPUT);
+    TEST(getStringIs(handle, "Device.MultiProvider1.Value", "a1"));
+    TEST(getStringIs(handle, "Device.MultiProvider2.Value", "a2"));
+    printf("_test_:rbus_setMulti-rollback rc:%d\n", rc);
+
+    /*the same across this process and a provider, checking the setHandlers saw commit false*/
+    if(rbus_regDataElements(other, 1, &element) != RBUS_ERROR_SUCCESS)
+    {
+        TALLY(false);
+        printf("_test_:rbus_setMulti-local result:FAIL couldn't register %s\n", element.name);
+        return;
+    }
+    snprintf(consumerValue, sizeof(consumerValue), "d0");
+    rc = setMultiStrings(handle, "Device.MultiConsumer.Value", "d1", "Device.MultiProvider2.Value", "fail");
+    TEST(rc == RBUS_ERROR_INVALID_INPUT);
+    TEST(strcmp(consumerValue, "d0") == 0);
+    TEST(strcmp(consumerPending, "d1") == 0);
+    TEST(getStringIs(handle, "Device.MultiProvider2.Value", "a2"));
+    printf("_test_:rbus_setMulti-local-rollback rc:%d\n", rc);
+
+    rc = setMultiStrings(handle, "Device.MultiConsumer.Value", "e1", "Device.MultiProvider2.Value", "e2");
+    TEST(rc == RBUS_ERROR_SUCCESS);
+    TEST(strcmp(consumerValue, "e1") == 0);
+    TEST(getStringIs(handle, "Device.MultiProvider2.Value", "e2"));
+    printf("_test_:rbus_setMulti-local-commit rc:%d\n", rc);
+
+    rbus_unregDataElements(other, 1, &element);
+}
+
 int main(int argc, char *argv[])
 {
     (void)(argc);
@@ -132,6 +261,9 @@ int main(int argc, char *argv[])
         goto exit1;
     }
 
+    if(handles[1])
+        testSetMulti(handles[0], handles[1]);
+
     printf("consumer: subscribing 5 handles\n");
     for(i = 0; i < 5; ++i)
     {
@@ -246,5 +378,6 @@ exit1:
         }
     }
 
+    PRINT_TEST_RESULTS("test_MultiConsumer");
     return rc;
 }
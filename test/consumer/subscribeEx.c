@@ -39,9 +39,15 @@ bool testSubscribeHandleEvent(
     rbusEvent_t const* event,
     rbusEventSubscription_t* subscription) /*from subscribe.c*/;
 
+static int gRateLimitedCount = 0;
+static int gCoalescedCount = 0;
+static int gCoalescedStale = 0;
+static int gCoalescedLastIndex = -1;
+static int gWatcherLastIndex = -1;
+
 int getDurationSubscribeEx()
 {
-    return gDuration;
+    return gDuration * 3;
 }
 
 static void handler1(
@@ -62,6 +68,55 @@ static void handler2(
     testSubscribeHandleEvent("_test_SubscribeEx handle2", 1, event, subscription);
 }
 
+static void handlerRateLimited(
+    rbusHandle_t handle,
+    rbusEvent_t const* event,
+    rbusEventSubscription_t* subscription)
+{
+    (void)(handle);
+    PRINT_TEST_EVENT("_test_SubscribeEx handlerRateLimited", event, subscription);
+    gRateLimitedCount++;
+}
+
+static int getEventIndex(rbusEvent_t const* event)
+{
+    rbusValue_t index = rbusObject_GetValue(event->data, "index");
+    return index ? rbusValue_GetInt32(index) : -1;
+}
+
+/*sees every Event1 the provider publishes*/
+static void handlerWatcher(
+    rbusHandle_t handle,
+    rbusEvent_t const* event,
+    rbusEventSubscription_t* subscription)
+{
+    (void)(handle);
+    (void)(subscription);
+    gWatcherLastIndex = getEventIndex(event);
+}
+
+/*a coalesced event must carry the latest value published during the interval: with Event1 published
+  every second and a 2.5 second interval, each event after the first skips at least one index and
+  is no older than the last event the watcher saw*/
+static void handlerCoalesced(
+    rbusHandle_t handle,
+    rbusEvent_t const* event,
+    rbusEventSubscription_t* subscription)
+{
+    int index = getEventIndex(event);
+    (void)(handle);
+    PRINT_TEST_EVENT("_test_SubscribeEx handlerCoalesced", event, subscription);
+    if(index < 0 ||
+       index < gWatcherLastIndex - 1 ||
+       (gCoalescedLastIndex >= 0 && index < gCoalescedLastIndex + 2))
+    {
+        printf("_test_SubscribeEx handlerCoalesced stale index=%d last=%d watcher=%d\n", index, gCoalescedLastIndex, gWatcherLastIndex);
+        gCoalescedStale++;
+    }
+    gCoalescedLastIndex = index;
+    gCoalescedCount++;
+}
+
 void testSubscribeEx(rbusHandle_t handle, int* countPass, int* countFail)
 {
     int rc = RBUS_ERROR_SUCCESS;
@@ -92,6 +147,71 @@ void testSubscribeEx(rbusHandle_t handle, int* countPass, int* countFail)
     TALLY(rc == RBUS_ERROR_SUCCESS);
     printf("_test_SubscribeEx rbusEvent_UnsubscribeEx %s rc=%d\n", rc == RBUS_ERROR_SUCCESS ? "PASS":"FAIL", rc);
 
+    /* the provider publishes Event1 every second so limiting delivery to 1 event per 2.5 seconds
+       should give no more than 1 event at the start plus 1 per elapsed interval */
+    {
+        rbusEventSubscription_t rateLimited = {"Device.TestProvider.Event1!", NULL, 0, 0, handlerRateLimited, NULL, NULL, NULL};
+        rbusEventRateOptions_t rate = {2500, false};
+        int maxCount = 1 + (gDuration * 1000) / 2500;
+
+        rc = rbusEvent_SubscribeExWithRate(handle, &rateLimited, &rate, 1, 0);
+        TALLY(rc == RBUS_ERROR_SUCCESS);
+        printf("_test_SubscribeEx rbusEvent_SubscribeExWithRate publishInterval %s rc=%d\n", rc == RBUS_ERROR_SUCCESS ? "PASS":"FAIL", rc);
+        if(rc != RBUS_ERROR_SUCCESS)
+            goto exit0;
+
+        sleep(gDuration);
+
+        TALLY(gRateLimitedCount >= 1 && gRateLimitedCount <= maxCount);
+        printf("%s Device.TestProvider.Event1 publishInterval=2500 expectedMaxEventCount=%d actualEventCount=%d\n",
+                gRateLimitedCount >= 1 && gRateLimitedCount <= maxCount ? "PASS" : "FAIL", maxCount, gRateLimitedCount);
+
+        rc = rbusEvent_UnsubscribeEx(handle, &rateLimited, 1);
+        TALLY(rc == RBUS_ERROR_SUCCESS);
+        printf("_test_SubscribeEx rbusEvent_UnsubscribeEx publishInterval %s rc=%d\n", rc == RBUS_ERROR_SUCCESS ? "PASS":"FAIL", rc);
+    }
+
+    /* with coalesce set the event held back during the interval is delivered when it elapses, and it
+       is the latest one published; a second handle watches every event to know what latest is */
+    {
+        rbusHandle_t watcher = NULL;
+        rbusEventSubscription_t watch = {"Device.TestProvider.Event1!", NULL, 0, 0, handlerWatcher, NULL, NULL, NULL};
+        rbusEventSubscription_t coalesced = {"Device.TestProvider.Event1!", NULL, 0, 0, handlerCoalesced, NULL, NULL, NULL};
+        rbusEventRateOptions_t rate = {2500, true};
+        int maxCount = 1 + (gDuration * 1000) / 2500;
+
+        rc = rbus_open(&watcher, "subscribeExWatcher");
+        TALLY(rc == RBUS_ERROR_SUCCESS);
+        if(rc != RBUS_ERROR_SUCCESS)
+            goto exit0;
+
+        rc = rbusEvent_SubscribeEx(watcher, &watch, 1, 0);
+        TALLY(rc == RBUS_ERROR_SUCCESS);
+        if(rc == RBUS_ERROR_SUCCESS)
+        {
+            rc = rbusEvent_SubscribeExWithRate(handle, &coalesced, &rate, 1, 0);
+            TALLY(rc == RBUS_ERROR_SUCCESS);
+            printf("_test_SubscribeEx rbusEvent_SubscribeExWithRate coalesce %s rc=%d\n", rc == RBUS_ERROR_SUCCESS ? "PASS":"FAIL", rc);
+            if(rc == RBUS_ERROR_SUCCESS)
+            {
+                sleep(gDuration);
+
+                TALLY(gCoalescedCount >= 2 && gCoalescedCount <= maxCount);
+                printf("%s Device.TestProvider.Event1 coalesce expectedEventCount=2..%d actualEventCount=%d\n",
+                        gCoalescedCount >= 2 && gCoalescedCount <= maxCount ? "PASS" : "FAIL", maxCount, gCoalescedCount);
+
+                TALLY(gCoalescedStale == 0);
+                printf("%s Device.TestProvider.Event1 coalesce delivered latest value staleCount=%d\n",
+                        gCoalescedStale == 0 ? "PASS" : "FAIL", gCoalescedStale);
+
+                rc = rbusEvent_UnsubscribeEx(handle, &coalesced, 1);
+                TALLY(rc == RBUS_ERROR_SUCCESS);
+            }
+            rbusEvent_UnsubscribeEx(watcher, &watch, 1);
+        }
+        rbus_close(watcher);
+    }
+
 exit0:
     *countPass = gCountPass;
     *countFail = gCountFail;
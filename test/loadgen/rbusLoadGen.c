@@ -0,0 +1,781 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+/*
+    rbusLoadGen forks a number of provider and consumer processes against the local broker
+    and drives gets, sets and events through them at fixed rates.
+    Each process reports its throughput, latency percentiles, cpu time and peak rss when the run ends.
+
+    Providers are named LoadGenProvider<p> and register:
+        Device.LoadGen<p>.Prop<1..elements>         get/set Int32 properties
+        Device.LoadGen<p>.Table.{i}.Value           table with <rows> rows registered through rbusTable_registerRow
+        Device.LoadGen<p>.Event!                    event published at <event-rate> per second, carrying the send time
+    Consumers are named LoadGenConsumer<c>.  Each subscribes to <subscriptions> distinct events (first the providers' Event!,
+    then value-change on the properties, so at most providers * (1 + elements)) and does <get-rate> gets and <set-rate>
+    sets per second on random elements.
+
+    Latencies are measured with CLOCK_MONOTONIC which is shared by all processes on the box,
+    so event latency is from rbusEvent_Publish in the provider to the event handler in the consumer.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <rbus.h>
+#include <rtLog.h>
+
+#define HIST_SUB_BITS   4
+#define HIST_SUB_COUNT  (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS    (64 * HIST_SUB_COUNT)
+
+typedef enum
+{
+    OP_GET = 0,
+    OP_SET,
+    OP_EVENT,
+    OP_MAX
+} LoadOp;
+
+static char const* gOpNames[OP_MAX] = { "get", "set", "event" };
+
+typedef struct
+{
+    char role;                          /* 'P' provider or 'C' consumer */
+    int index;
+    pid_t pid;
+    double elapsed;                     /* seconds the process was generating or receiving load */
+    uint64_t count[OP_MAX];
+    uint64_t errors[OP_MAX];
+    uint64_t hist[OP_MAX][HIST_BUCKETS];/* latency in usec, log-linear with 16 sub buckets per power of 2 */
+    long utimeUsec;
+    long stimeUsec;
+    long maxRssKb;
+} LoadResult;
+
+typedef struct
+{
+    int providers;
+    int consumers;
+    int elements;
+    int rows;
+    int subscriptions;
+    int getRate;
+    int setRate;
+    int eventRate;
+    int duration;
+    rtLogLevel logLevel;
+} LoadConfig;
+
+static LoadConfig gConfig = { 1, 1, 10, 10, 1, 100, 10, 10, 10, RT_LOG_WARN };
+static LoadResult gResult;
+static volatile sig_atomic_t gStop = 0;
+static int32_t* gPropValues = NULL;
+
+static uint64_t nowNsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int histIndex(uint64_t usec)
+{
+    int msb;
+    if(usec < HIST_SUB_COUNT)
+        return (int)usec;
+    msb = 63 - __builtin_clzll(usec);
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB_COUNT + (int)((usec >> (msb - HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+}
+
+static uint64_t histValue(int index)
+{
+    int msb;
+    if(index < HIST_SUB_COUNT)
+        return (uint64_t)index;
+    msb = index / HIST_SUB_COUNT + HIST_SUB_BITS - 1;
+    return (uint64_t)(HIST_SUB_COUNT + index % HIST_SUB_COUNT) << (msb - HIST_SUB_BITS);
+}
+
+static void record(LoadResult* result, LoadOp op, uint64_t startNsec, bool failed)
+{
+    uint64_t usec = (nowNsec() - startNsec) / 1000;
+    result->count[op]++;
+    if(failed)
+        result->errors[op]++;
+    result->hist[op][histIndex(usec)]++;
+}
+
+static uint64_t percentile(uint64_t const* hist, double q)
+{
+    uint64_t total = 0, target, sum = 0;
+    int i;
+
+    for(i = 0; i < HIST_BUCKETS; ++i)
+        total += hist[i];
+    if(total == 0)
+        return 0;
+    target = (uint64_t)(q * total);
+    if(target == 0)
+        target = 1;
+    for(i = 0; i < HIST_BUCKETS; ++i)
+    {
+        sum += hist[i];
+        if(sum >= target)
+            return histValue(i);
+    }
+    return histValue(HIST_BUCKETS - 1);
+}
+
+/*sleep until the absolute monotonic time in nsec*/
+static void sleepUntil(uint64_t nsec)
+{
+    struct timespec ts;
+    ts.tv_sec = nsec / 1000000000ULL;
+    ts.tv_nsec = nsec % 1000000000ULL;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !gStop)
+        ;
+}
+
+static void onStopSignal(int sig)
+{
+    (void)sig;
+    gStop = 1;
+}
+
+static void finishResult(LoadResult* result, uint64_t startNsec)
+{
+    struct rusage usage;
+
+    result->elapsed = (nowNsec() - startNsec) / 1e9;
+    getrusage(RUSAGE_SELF, &usage);
+    result->utimeUsec = usage.ru_utime.tv_sec * 1000000L + usage.ru_utime.tv_usec;
+    result->stimeUsec = usage.ru_stime.tv_sec * 1000000L + usage.ru_stime.tv_usec;
+    result->maxRssKb = usage.ru_maxrss;
+}
+
+static int writeAll(int fd, void const* data, size_t len)
+{
+    char const* p = data;
+    while(len)
+    {
+        ssize_t n = write(fd, p, len);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int readAll(int fd, void* data, size_t len)
+{
+    char* p = data;
+    while(len)
+    {
+        ssize_t n = read(fd, p, len);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/****************************** provider ******************************/
+
+static rbusError_t propGetHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
+{
+    char const* name = rbusProperty_GetName(property);
+    char const* last = strrchr(name, '.');
+    rbusValue_t value;
+    int32_t v = 0;
+
+    (void)handle;
+    (void)opts;
+
+    if(last && strncmp(last, ".Prop", 5) == 0)
+    {
+        int k = atoi(last + 5);
+        if(k < 1 || k > gConfig.elements)
+            return RBUS_ERROR_INVALID_INPUT;
+        v = gPropValues[k-1];
+    }
+    else
+    {
+        /*Device.LoadGen<p>.Table.<row>.Value returns the row number*/
+        char const* row = strstr(name, ".Table.");
+        if(!row)
+            return RBUS_ERROR_INVALID_INPUT;
+        v = atoi(row + 7);
+    }
+
+    rbusValue_Init(&value);
+    rbusValue_SetInt32(value, v);
+    rbusProperty_SetValue(property, value);
+    rbusValue_Release(value);
+    return RBUS_ERROR_SUCCESS;
+}
+
+static rbusError_t propSetHandler(rbusHandle_t handle, rbusProperty_t property, rbusSetHandlerOptions_t* opts)
+{
+    char const* last = strrchr(rbusProperty_GetName(property), '.');
+    rbusValue_t value = rbusProperty_GetValue(property);
+    int k;
+
+    (void)handle;
+    (void)opts;
+
+    if(!last || strncmp(last, ".Prop", 5) != 0)
+        return RBUS_ERROR_INVALID_INPUT;
+    k = atoi(last + 5);
+    if(k < 1 || k > gConfig.elements || rbusValue_GetType(value) != RBUS_INT32)
+        return RBUS_ERROR_INVALID_INPUT;
+    gPropValues[k-1] = rbusValue_GetInt32(value);
+    return RBUS_ERROR_SUCCESS;
+}
+
+static int runProvider(int index, int readyFd, int resultFd)
+{
+    rbusHandle_t handle;
+    rbusDataElement_t* elements;
+    char componentName[RBUS_MAX_NAME_LENGTH];
+    char name[RBUS_MAX_NAME_LENGTH];
+    char eventName[RBUS_MAX_NAME_LENGTH];
+    int numElements = gConfig.elements + 3;
+    int i, rc;
+    uint64_t start, next, period;
+    int32_t seq = 0;
+
+    gResult.role = 'P';
+    gResult.index = index;
+    gResult.pid = getpid();
+
+    snprintf(componentName, sizeof(componentName), "LoadGenProvider%d", index);
+    rc = rbus_open(&handle, componentName);
+    if(rc != RBUS_ERROR_SUCCESS)
+    {
+        printf("%s: rbus_open failed: %d\n", componentName, rc);
+        return 1;
+    }
+
+    gPropValues = calloc(gConfig.elements, sizeof(int32_t));
+    elements = calloc(numElements, sizeof(rbusDataElement_t));
+    for(i = 0; i < gConfig.elements; ++i)
+    {
+        snprintf(name, sizeof(name), "Device.LoadGen%d.Prop%d", index, i+1);
+        elements[i].name = strdup(name);
+        elements[i].type = RBUS_ELEMENT_TYPE_PROPERTY;
+        elements[i].cbTable.getHandler = propGetHandler;
+        elements[i].cbTable.setHandler = propSetHandler;
+    }
+    snprintf(name, sizeof(name), "Device.LoadGen%d.Table.{i}.", index);
+    elements[i].name = strdup(name);
+    elements[i++].type = RBUS_ELEMENT_TYPE_TABLE;
+    snprintf(name, sizeof(name), "Device.LoadGen%d.Table.{i}.Value", index);
+    elements[i].name = strdup(name);
+    elements[i].type = RBUS_ELEMENT_TYPE_PROPERTY;
+    elements[i++].cbTable.getHandler = propGetHandler;
+    snprintf(eventName, sizeof(eventName), "Device.LoadGen%d.Event!", index);
+    elements[i].name = strdup(eventName);
+    elements[i].type = RBUS_ELEMENT_TYPE_EVENT;
+
+    rc = rbus_regDataElements(handle, numElements, elements);
+    if(rc != RBUS_ERROR_SUCCESS)
+        printf("%s: rbus_regDataElements failed: %d\n", componentName, rc);
+
+    snprintf(name, sizeof(name), "Device.LoadGen%d.Table.", index);
+    for(i = 1; i <= gConfig.rows; ++i)
+        rbusTable_registerRow(handle, name, NULL, i);
+
+    /*tell the parent we are registered*/
+    writeAll(readyFd, "P", 1);
+
+    start = nowNsec();
+    next = start;
+    period = gConfig.eventRate > 0 ? 1000000000ULL / gConfig.eventRate : 0;
+
+    while(!gStop)
+    {
+        if(period)
+        {
+            rbusEvent_t event = {0};
+            rbusObject_t data;
+            rbusValue_t value;
+            uint64_t sendTime = nowNsec();
+
+            rbusObject_Init(&data, NULL);
+            rbusValue_Init(&value);
+            rbusValue_SetInt64(value, (int64_t)sendTime);
+            rbusObject_SetValue(data, "ts", value);
+            rbusValue_SetInt32(value, seq++);
+            rbusObject_SetValue(data, "seq", value);
+            rbusValue_Release(value);
+
+            event.name = eventName;
+            event.data = data;
+            event.type = RBUS_EVENT_GENERAL;
+
+            rc = rbusEvent_Publish(handle, &event);
+            record(&gResult, OP_EVENT, sendTime, rc != RBUS_ERROR_SUCCESS && rc != RBUS_ERROR_NOSUBSCRIBERS);
+            rbusObject_Release(data);
+
+            next += period;
+            sleepUntil(next);
+        }
+        else
+        {
+            usleep(100000);
+        }
+    }
+
+    finishResult(&gResult, start);
+
+    rbus_unregDataElements(handle, numElements, elements);
+    for(i = 0; i < numElements; ++i)
+        free(elements[i].name);
+    free(elements);
+    rbus_close(handle);
+    free(gPropValues);
+
+    return writeAll(resultFd, &gResult, sizeof(gResult));
+}
+
+/****************************** consumer ******************************/
+
+typedef struct
+{
+    rbusHandle_t handle;
+    LoadOp op;
+    int rate;
+    unsigned int seed;
+    uint64_t endNsec;
+} RateThreadData;
+
+static pthread_mutex_t gEventMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void eventHandler(rbusHandle_t handle, rbusEvent_t const* event, rbusEventSubscription_t* subscription)
+{
+    rbusValue_t ts = rbusObject_GetValue(event->data, "ts");
+
+    (void)handle;
+    (void)subscription;
+
+    pthread_mutex_lock(&gEventMutex);
+    if(ts && rbusValue_GetType(ts) == RBUS_INT64)
+        record(&gResult, OP_EVENT, (uint64_t)rbusValue_GetInt64(ts), false);
+    else
+        gResult.count[OP_EVENT]++;
+    pthread_mutex_unlock(&gEventMutex);
+}
+
+static void* rateThread(void* p)
+{
+    RateThreadData* data = p;
+    uint64_t period = 1000000000ULL / data->rate;
+    uint64_t next = nowNsec();
+    char name[RBUS_MAX_NAME_LENGTH];
+
+    while(!gStop && next < data->endNsec)
+    {
+        int provider = rand_r(&data->seed) % gConfig.providers;
+        uint64_t start;
+        rbusError_t rc;
+
+        if(data->op == OP_GET && gConfig.rows > 0 && (rand_r(&data->seed) & 1))
+            snprintf(name, sizeof(name), "Device.LoadGen%d.Table.%d.Value", provider, 1 + rand_r(&data->seed) % gConfig.rows);
+        else
+            snprintf(name, sizeof(name), "Device.LoadGen%d.Prop%d", provider, 1 + rand_r(&data->seed) % gConfig.elements);
+
+        start = nowNsec();
+        if(data->op == OP_GET)
+        {
+            rbusValue_t value = NULL;
+            rc = rbus_get(data->handle, name, &value);
+            if(value)
+                rbusValue_Release(value);
+        }
+        else
+        {
+            rbusValue_t value;
+            rbusValue_Init(&value);
+            rbusValue_SetInt32(value, (int32_t)rand_r(&data->seed));
+            rc = rbus_set(data->handle, name, value, NULL);
+            rbusValue_Release(value);
+        }
+        record(&gResult, data->op, start, rc != RBUS_ERROR_SUCCESS);
+
+        /*open loop: if we fell behind we issue the next call right away instead of lowering the rate*/
+        next += period;
+        sleepUntil(next);
+    }
+    return NULL;
+}
+
+static int runConsumer(int index, int readyFd, int resultFd)
+{
+    rbusHandle_t handle;
+    char componentName[RBUS_MAX_NAME_LENGTH];
+    char name[RBUS_MAX_NAME_LENGTH];
+    char** subNames;
+    int i, rc, numThreads = 0;
+    pthread_t threads[2];
+    RateThreadData threadData[2];
+    uint64_t start;
+
+    gResult.role = 'C';
+    gResult.index = index;
+    gResult.pid = getpid();
+
+    snprintf(componentName, sizeof(componentName), "LoadGenConsumer%d", index);
+    rc = rbus_open(&handle, componentName);
+    if(rc != RBUS_ERROR_SUCCESS)
+    {
+        printf("%s: rbus_open failed: %d\n", componentName, rc);
+        return 1;
+    }
+
+    subNames = calloc(gConfig.subscriptions, sizeof(char*));
+    for(i = 0; i < gConfig.subscriptions; ++i)
+    {
+        if(i < gConfig.providers)
+        {
+            snprintf(name, sizeof(name), "Device.LoadGen%d.Event!", i);
+        }
+        else
+        {
+            int j = i - gConfig.providers;
+            snprintf(name, sizeof(name), "Device.LoadGen%d.Prop%d", j % gConfig.providers, 1 + j / gConfig.providers);
+        }
+        subNames[i] = strdup(name);
+        rc = rbusEvent_Subscribe(handle, subNames[i], eventHandler, NULL, 0);
+        if(rc != RBUS_ERROR_SUCCESS)
+            printf("%s: subscribe to %s failed: %d\n", componentName, subNames[i], rc);
+    }
+
+    writeAll(readyFd, "C", 1);
+
+    start = nowNsec();
+
+    if(gConfig.getRate > 0)
+    {
+        threadData[numThreads].handle = handle;
+        threadData[numThreads].op = OP_GET;
+        threadData[numThreads].rate = gConfig.getRate;
+        threadData[numThreads].seed = (unsigned int)(index * 7919 + 1);
+        threadData[numThreads].endNsec = start + gConfig.duration * 1000000000ULL;
+        pthread_create(&threads[numThreads], NULL, rateThread, &threadData[numThreads]);
+        numThreads++;
+    }
+    if(gConfig.setRate > 0)
+    {
+        threadData[numThreads].handle = handle;
+        threadData[numThreads].op = OP_SET;
+        threadData[numThreads].rate = gConfig.setRate;
+        threadData[numThreads].seed = (unsigned int)(index * 7919 + 2);
+        threadData[numThreads].endNsec = start + gConfig.duration * 1000000000ULL;
+        pthread_create(&threads[numThreads], NULL, rateThread, &threadData[numThreads]);
+        numThreads++;
+    }
+
+    sleepUntil(start + gConfig.duration * 1000000000ULL);
+
+    for(i = 0; i < numThreads; ++i)
+        pthread_join(threads[i], NULL);
+
+    for(i = 0; i < gConfig.subscriptions; ++i)
+    {
+        rbusEvent_Unsubscribe(handle, subNames[i]);
+        free(subNames[i]);
+    }
+    free(subNames);
+
+    pthread_mutex_lock(&gEventMutex);
+    finishResult(&gResult, start);
+    pthread_mutex_unlock(&gEventMutex);
+
+    rbus_close(handle);
+
+    return writeAll(resultFd, &gResult, sizeof(gResult));
+}
+
+/****************************** report ******************************/
+
+static void printResult(LoadResult const* result)
+{
+    int op;
+    double cpu = (result->utimeUsec + result->stimeUsec) / 1e6;
+
+    printf("%s%-3d pid=%-6d elapsed=%.2fs cpu=%.2fs (%.1f%%) maxrss=%ldKB\n",
+        result->role == 'P' ? "provider" : "consumer", result->index, (int)result->pid,
+        result->elapsed, cpu, result->elapsed > 0 ? 100.0 * cpu / result->elapsed : 0, result->maxRssKb);
+
+    for(op = 0; op < OP_MAX; ++op)
+    {
+        if(result->count[op] == 0)
+            continue;
+        printf("    %-6s count=%-8llu errors=%-6llu rate=%.1f/s p50=%lluus p99=%lluus p999=%lluus\n",
+            gOpNames[op],
+            (unsigned long long)result->count[op],
+            (unsigned long long)result->errors[op],
+            result->elapsed > 0 ? result->count[op] / result->elapsed : 0,
+            (unsigned long long)percentile(result->hist[op], 0.50),
+            (unsigned long long)percentile(result->hist[op], 0.99),
+            (unsigned long long)percentile(result->hist[op], 0.999));
+    }
+}
+
+static void usage()
+{
+    printf("rbusLoadGen [OPTIONS]\n");
+    printf("  -p, --providers NUM      number of provider processes (default %d)\n", gConfig.providers);
+    printf("  -c, --consumers NUM      number of consumer processes (default %d)\n", gConfig.consumers);
+    printf("  -e, --elements NUM       properties per provider (default %d)\n", gConfig.elements);
+    printf("  -r, --rows NUM           table rows per provider (default %d)\n", gConfig.rows);
+    printf("  -s, --subscriptions NUM  subscriptions per consumer, at most providers*(1+elements) (default %d)\n", gConfig.subscriptions);
+    printf("  -g, --get-rate NUM       gets per second per consumer (default %d)\n", gConfig.getRate);
+    printf("  -S, --set-rate NUM       sets per second per consumer (default %d)\n", gConfig.setRate);
+    printf("  -E, --event-rate NUM     events per second per provider (default %d)\n", gConfig.eventRate);
+    printf("  -d, --duration SEC       how long consumers generate load (default %d)\n", gConfig.duration);
+    printf("  -l, --log-level LEVEL    rtLog level (default warn)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int total, i, n, children = 0;
+    bool failed = false;
+    int* readyFds;
+    int* resultFds;
+    pid_t* pids;
+    LoadResult* results;
+    LoadResult* sum;
+    double elapsed = 0;
+    char c;
+
+    while (1)
+    {
+        int option_index = 0;
+        int opt;
+
+        static struct option long_options[] = 
+        {
+            {"providers",      required_argument,  0, 'p' },
+            {"consumers",      required_argument,  0, 'c' },
+            {"elements",       required_argument,  0, 'e' },
+            {"rows",           required_argument,  0, 'r' },
+            {"subscriptions",  required_argument,  0, 's' },
+            {"get-rate",       required_argument,  0, 'g' },
+            {"set-rate",       required_argument,  0, 'S' },
+            {"event-rate",     required_argument,  0, 'E' },
+            {"duration",       required_argument,  0, 'd' },
+            {"log-level",      required_argument,  0, 'l' },
+            {"help",           no_argument,        0, 'h' },
+            {0, 0, 0, 0}
+        };
+
+        opt = getopt_long(argc, argv, "p:c:e:r:s:g:S:E:d:l:h", long_options, &option_index);
+        if (opt == -1)
+            break;
+
+        switch (opt)
+        {
+        case 'p': gConfig.providers = atoi(optarg); break;
+        case 'c': gConfig.consumers = atoi(optarg); break;
+        case 'e': gConfig.elements = atoi(optarg); break;
+        case 'r': gConfig.rows = atoi(optarg); break;
+        case 's': gConfig.subscriptions = atoi(optarg); break;
+        case 'g': gConfig.getRate = atoi(optarg); break;
+        case 'S': gConfig.setRate = atoi(optarg); break;
+        case 'E': gConfig.eventRate = atoi(optarg); break;
+        case 'd': gConfig.duration = atoi(optarg); break;
+        case 'l': gConfig.logLevel = rtLogLevelFromString(optarg); break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if(gConfig.providers < 1 || gConfig.consumers < 0 || gConfig.elements < 1 || gConfig.rows < 0 ||
+       gConfig.subscriptions < 0 || gConfig.subscriptions > gConfig.providers * (1 + gConfig.elements) ||
+       gConfig.getRate < 0 || gConfig.setRate < 0 || gConfig.eventRate < 0 || gConfig.duration < 1)
+    {
+        usage();
+        return 1;
+    }
+
+    rtLog_SetLevel(gConfig.logLevel);
+
+    printf("rbusLoadGen: providers=%d consumers=%d elements=%d rows=%d subscriptions=%d get-rate=%d set-rate=%d event-rate=%d duration=%ds\n",
+        gConfig.providers, gConfig.consumers, gConfig.elements, gConfig.rows, gConfig.subscriptions,
+        gConfig.getRate, gConfig.setRate, gConfig.eventRate, gConfig.duration);
+
+    total = gConfig.providers + gConfig.consumers;
+    readyFds = calloc(total, sizeof(int));
+    resultFds = calloc(total, sizeof(int));
+    pids = calloc(total, sizeof(pid_t));
+    results = calloc(total + 2, sizeof(LoadResult));
+
+    signal(SIGUSR1, onStopSignal);
+
+    /*start providers first and wait until all are registered, then consumers.
+      each child gets its own ready pipe and the parent closes the write end, so a child
+      that exits before it is ready shows up as EOF instead of blocking the read forever*/
+    for(i = 0; i < total; ++i)
+    {
+        int readyPipe[2];
+        int resultPipe[2];
+        bool provider = i < gConfig.providers;
+
+        if(i == gConfig.providers)
+        {
+            for(n = 0; n < gConfig.providers; ++n)
+            {
+                if(readAll(readyFds[n], &c, 1) != 0)
+                {
+                    printf("provider%d: failed to start\n", n);
+                    failed = true;
+                }
+            }
+            if(failed)
+                break;
+        }
+
+        if(pipe(readyPipe) != 0)
+        {
+            perror("pipe");
+            failed = true;
+            break;
+        }
+        if(pipe(resultPipe) != 0)
+        {
+            perror("pipe");
+            close(readyPipe[0]);
+            close(readyPipe[1]);
+            failed = true;
+            break;
+        }
+
+        pids[i] = fork();
+        if(pids[i] == 0)
+        {
+            int rc;
+            close(resultPipe[0]);
+            close(readyPipe[0]);
+            if(provider)
+                rc = runProvider(i, readyPipe[1], resultPipe[1]);
+            else
+                rc = runConsumer(i - gConfig.providers, readyPipe[1], resultPipe[1]);
+            _exit(rc == 0 ? 0 : 1);
+        }
+        close(readyPipe[1]);
+        close(resultPipe[1]);
+        if(pids[i] < 0)
+        {
+            perror("fork");
+            close(readyPipe[0]);
+            close(resultPipe[0]);
+            failed = true;
+            break;
+        }
+        readyFds[i] = readyPipe[0];
+        resultFds[i] = resultPipe[0];
+        children++;
+    }
+
+    /*consumers stop themselves after the duration. stop the providers once all consumers are done*/
+    for(i = gConfig.providers; i < children; ++i)
+    {
+        if(readAll(resultFds[i], &results[i], sizeof(LoadResult)) != 0)
+            printf("consumer%d: no result\n", i - gConfig.providers);
+    }
+    if(children <= gConfig.providers && !failed)
+        sleep(gConfig.duration);
+
+    for(i = 0; i < children && i < gConfig.providers; ++i)
+        kill(pids[i], SIGUSR1);
+    for(i = 0; i < children && i < gConfig.providers; ++i)
+    {
+        if(readAll(resultFds[i], &results[i], sizeof(LoadResult)) != 0)
+            printf("provider%d: no result\n", i);
+    }
+    for(i = 0; i < children; ++i)
+    {
+        waitpid(pids[i], NULL, 0);
+        close(readyFds[i]);
+        close(resultFds[i]);
+    }
+
+    printf("\n");
+    for(i = 0; i < children; ++i)
+    {
+        if(results[i].role)
+            printResult(&results[i]);
+    }
+
+    /*totals for each role, histograms are merged so the percentiles are across all processes*/
+    for(n = 0; n < 2; ++n)
+    {
+        int op, b;
+        char role = n == 0 ? 'P' : 'C';
+
+        sum = &results[total + n];
+        sum->role = role;
+        sum->index = 0;
+        elapsed = 0;
+        for(i = 0; i < children; ++i)
+        {
+            if(results[i].role != role)
+                continue;
+            for(op = 0; op < OP_MAX; ++op)
+            {
+                sum->count[op] += results[i].count[op];
+                sum->errors[op] += results[i].errors[op];
+                for(b = 0; b < HIST_BUCKETS; ++b)
+                    sum->hist[op][b] += results[i].hist[op][b];
+            }
+            sum->utimeUsec += results[i].utimeUsec;
+            sum->stimeUsec += results[i].stimeUsec;
+            sum->maxRssKb += results[i].maxRssKb;
+            if(results[i].elapsed > elapsed)
+                elapsed = results[i].elapsed;
+        }
+        sum->elapsed = elapsed;
+        printf("\ntotal ");
+        printResult(sum);
+    }
+
+    free(readyFds);
+    free(resultFds);
+    free(pids);
+    free(results);
+    return failed ? 1 : 0;
+}
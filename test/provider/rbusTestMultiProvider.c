@@ -111,6 +111,82 @@ rbusError_t setHandler(rbusHandle_t handle, rbusProperty_t property, rbusSetHand
     return RBUS_ERROR_BUS_ERROR;
 }
 
+/*each provider's Value keeps what was last committed, so a consumer can tell which
+  parts of an rbus_setMulti were applied.  A set that isn't committed is remembered
+  under its session until a commit in the same session.  Setting it to "fail" makes
+  its setHandler fail to test one component rejecting its part*/
+char values[5][64] = {"", "", "", "", ""};
+char pendingValues[5][64];
+uint32_t pendingSessions[5];
+bool pending[5] = {false, false, false, false, false};
+
+static int valueIndex(char const* name)
+{
+    /*Device.MultiProviderN.Value*/
+    return name[strlen("Device.MultiProvider")] - '1';
+}
+
+rbusError_t valueGetHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
+{
+    char const* name = rbusProperty_GetName(property);
+    rbusValue_t value;
+
+    (void)handle;
+    (void)opts;
+
+    rbusValue_Init(&value);
+    rbusValue_SetString(value, values[valueIndex(name)]);
+    rbusProperty_SetValue(property, value);
+    rbusValue_Release(value);
+
+    printf("_test_:valueGetHandler result:SUCCESS param='%s' value='%s'\n", name, values[valueIndex(name)]);
+    return RBUS_ERROR_SUCCESS;
+}
+
+rbusError_t valueSetHandler(rbusHandle_t handle, rbusProperty_t property, rbusSetHandlerOptions_t* opts)
+{
+    char const* name = rbusProperty_GetName(property);
+    rbusValue_t value = rbusProperty_GetValue(property);
+
+    int i;
+
+    (void)handle;
+
+    if(!value || rbusValue_GetType(value) != RBUS_STRING)
+    {
+        printf("_test_:valueSetHandler result:FAIL error:'unexpected type' name='%s'\n", name);
+        return RBUS_ERROR_INVALID_INPUT;
+    }
+
+    if(strcmp(rbusValue_GetString(value, NULL), "fail") == 0)
+    {
+        printf("_test_:valueSetHandler result:SUCCESS param='%s' failing as asked\n", name);
+        return RBUS_ERROR_INVALID_INPUT;
+    }
+
+    if(!opts->commit)
+    {
+        i = valueIndex(name);
+        snprintf(pendingValues[i], sizeof(pendingValues[0]), "%s", rbusValue_GetString(value, NULL));
+        pendingSessions[i] = opts->sessionId;
+        pending[i] = true;
+        printf("_test_:valueSetHandler result:SUCCESS param='%s' pending='%s' session=%u\n", name, pendingValues[i], opts->sessionId);
+        return RBUS_ERROR_SUCCESS;
+    }
+
+    for(i = 0; i < 5; ++i)
+    {
+        if(pending[i] && pendingSessions[i] == opts->sessionId)
+        {
+            snprintf(values[i], sizeof(values[0]), "%s", pendingValues[i]);
+            pending[i] = false;
+        }
+    }
+    snprintf(values[valueIndex(name)], sizeof(values[0]), "%s", rbusValue_GetString(value, NULL));
+    printf("_test_:valueSetHandler result:SUCCESS param='%s' value='%s'\n", name, values[valueIndex(name)]);
+    return RBUS_ERROR_SUCCESS;
+}
+
 rbusError_t eventSubHandler(rbusHandle_t handle, rbusEventSubAction_t action, const char* eventName, rbusFilter_t filter, int32_t interval, bool* autoPublish)
 {
     (void)handle;
@@ -187,10 +263,28 @@ int main(int argc, char *argv[])
         }
     };
 
+    /*Value, and ReadOnly which has no setHandler, for the rbus_setMulti tests*/
+    char setNames[5][2][64];
+    rbusDataElement_t setElements[5][2];
+
     int rc = RBUS_ERROR_SUCCESS;
     int i;
     int eventCount = 0;
 
+    memset(setElements, 0, sizeof(setElements));
+    for(i = 0; i < 5; ++i)
+    {
+        snprintf(setNames[i][0], 64, "Device.%s.Value", componentNames[i]);
+        snprintf(setNames[i][1], 64, "Device.%s.ReadOnly", componentNames[i]);
+        setElements[i][0].name = setNames[i][0];
+        setElements[i][0].type = RBUS_ELEMENT_TYPE_PROPERTY;
+        setElements[i][0].cbTable.getHandler = valueGetHandler;
+        setElements[i][0].cbTable.setHandler = valueSetHandler;
+        setElements[i][1].name = setNames[i][1];
+        setElements[i][1].type = RBUS_ELEMENT_TYPE_PROPERTY;
+        setElements[i][1].cbTable.getHandler = valueGetHandler;
+    }
+
     printf("provider: opening 5 handles\n");
 
     for(i = 0; i < 5; ++i)
@@ -226,6 +320,17 @@ int main(int argc, char *argv[])
         {
             printf("_test_:rbus_regDataElements result:FAIL component:%s rc:%d\n", componentNames[i], rc);
         }
+
+        rc = rbus_regDataElements(handles[i], 2, setElements[i]);
+        printf("provider: rbus_regDataElements set elements %s=%d\n", componentNames[i], rc);
+        if(rc == RBUS_ERROR_SUCCESS)
+        {
+            printf("_test_:rbus_regDataElements-set result:SUCCESS component:%s\n", componentNames[i]);
+        }
+        else
+        {
+            printf("_test_:rbus_regDataElements-set result:FAIL component:%s rc:%d\n", componentNames[i], rc);
+        }
     }
 
     if(runningParamProvider_Init(handles[0], "Device.MultiProvider.TestRunning") != RBUS_ERROR_SUCCESS)
@@ -293,6 +398,7 @@ exit1:
     {
         if(handles[i])
         {
+            rbus_unregDataElements(handles[i], 2, setElements[i]);
             rc = rbus_unregDataElements(handles[i], 2, dataElements[i]);
             printf("provider: rbusEventProvider_Unregister %s=%d\n", componentNames[i], rc);
             if(rc == RBUS_ERROR_SUCCESS)
@@ -0,0 +1,142 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+
+#include <rbus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../src/rbus_config.h"
+
+static int getIntConfig(rbusConfigSetting_t setting)
+{
+  rbusValue_t value = NULL;
+  int result = -1;
+
+  EXPECT_EQ(rbus_getConfig(setting, &value), RBUS_ERROR_SUCCESS);
+  if(value)
+  {
+    EXPECT_EQ(rbusValue_GetType(value), RBUS_INT32);
+    result = rbusValue_GetInt32(value);
+    rbusValue_Release(value);
+  }
+  return result;
+}
+
+TEST(rbusConfigTest, setAndGet)
+{
+  rbusValue_t value;
+  int period = getIntConfig(RBUS_CONFIG_VALUECHANGE_PERIOD);
+  int threads = getIntConfig(RBUS_CONFIG_SUBSCRIBE_THREADS);
+
+  rbusValue_Init(&value);
+  rbusValue_SetUInt16(value, 250);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_VALUECHANGE_PERIOD), 250);
+
+  rbusValue_SetString(value, "12");
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_SUBSCRIBE_THREADS, value), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_SUBSCRIBE_THREADS), 12);
+
+  /*out of range, not a number, or not an integer type leave the setting as it was*/
+  rbusValue_SetInt32(value, 0);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_INVALID_INPUT);
+  rbusValue_SetInt32(value, 65);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_SEND_WINDOW, value), RBUS_ERROR_INVALID_INPUT);
+  rbusValue_SetString(value, "12ms");
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_INVALID_INPUT);
+  rbusValue_SetDouble(value, 100.0);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_INVALID_INPUT);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_MAX, value), RBUS_ERROR_INVALID_INPUT);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_VALUECHANGE_PERIOD), 250);
+
+  rbusValue_SetInt32(value, period);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_SUCCESS);
+  rbusValue_SetInt32(value, threads);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_SUBSCRIBE_THREADS, value), RBUS_ERROR_SUCCESS);
+  rbusValue_Release(value);
+}
+
+TEST(rbusConfigTest, loadFile)
+{
+  char path[] = "/tmp/rbusConfigTestXXXXXX";
+  int fd = mkstemp(path);
+  FILE* file;
+  int linger = getIntConfig(RBUS_CONFIG_SHM_LINGER);
+  int depth = getIntConfig(RBUS_CONFIG_DELIVERY_QUEUE_DEPTH);
+
+  ASSERT_NE(fd, -1);
+  file = fdopen(fd, "w");
+  fprintf(file, "# tuned for a test\n\n  RBUS_SHM_LINGER = 5000\nRBUS_DELIVERY_QUEUE_DEPTH=64\n");
+  fclose(file);
+  EXPECT_EQ(rbus_loadConfig(path), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_SHM_LINGER), 5000);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_DELIVERY_QUEUE_DEPTH), 64);
+
+  /*a bad line is reported but the good ones still apply*/
+  file = fopen(path, "w");
+  fprintf(file, "RBUS_NOT_A_SETTING=1\nRBUS_SHM_LINGER=%d\nRBUS_DELIVERY_QUEUE_DEPTH=%d\n", linger, depth);
+  fclose(file);
+  EXPECT_EQ(rbus_loadConfig(path), RBUS_ERROR_INVALID_INPUT);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_SHM_LINGER), linger);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_DELIVERY_QUEUE_DEPTH), depth);
+
+  unlink(path);
+  EXPECT_EQ(rbus_loadConfig(path), RBUS_ERROR_INVALID_INPUT);
+}
+
+TEST(rbusConfigTest, lifetime)
+{
+  rbusConfig_t* config;
+  rbusHandle_t handle;
+  rbusValue_t value;
+  int period = getIntConfig(RBUS_CONFIG_VALUECHANGE_PERIOD);
+
+  ASSERT_EQ(rbus_open(&handle, "rbusConfigLifetime"), RBUS_ERROR_SUCCESS);
+  config = rbusConfig_Get();
+  ASSERT_NE(config, nullptr);
+
+  rbusValue_Init(&value);
+  rbusValue_SetInt32(value, 333);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(config->valueChangePeriod, 333);
+
+  /*closing the last handle keeps the settings and their memory*/
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbusConfig_Get(), config);
+  EXPECT_EQ(config->valueChangePeriod, 333);
+  EXPECT_NE(config->tmpDir, nullptr);
+
+  ASSERT_EQ(rbus_open(&handle, "rbusConfigLifetime"), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbusConfig_Get(), config);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_VALUECHANGE_PERIOD), 333);
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+
+  /*and so does a set made while no handle is open*/
+  rbusValue_SetInt32(value, 444);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_SUCCESS);
+  ASSERT_EQ(rbus_open(&handle, "rbusConfigLifetime"), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(getIntConfig(RBUS_CONFIG_VALUECHANGE_PERIOD), 444);
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+
+  rbusValue_SetInt32(value, period);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, value), RBUS_ERROR_SUCCESS);
+  rbusValue_Release(value);
+}
@@ -220,6 +220,133 @@ static void subscribeHandler(
 }
 
 
+typedef struct
+{
+  int chunks;
+  int total;
+  int bad;
+  int seen[GTEST_STREAM_ROWS + 1];
+  int getsAfterFirst;
+  bool removeRow;
+  bool stop;
+} streamResult_t;
+
+static bool streamHandler(rbusHandle_t handle, int numProps, rbusProperty_t properties, void* userData)
+{
+  streamResult_t *result = (streamResult_t *)userData;
+  rbusProperty_t next = properties;
+  int count = 0;
+
+  result->chunks++;
+  while(next)
+  {
+    rbusValue_t value = rbusProperty_GetValue(next);
+    char const* name = rbusProperty_GetName(next);
+    int row = 0;
+
+    /*the provider returns each row's name as its value*/
+    if(!value || rbusValue_GetType(value) != RBUS_STRING || strcmp(rbusValue_GetString(value, NULL), name) ||
+        sscanf(name, "Device.rbusProvider.Stream.%d.Value", &row) != 1 || row < 1 || row > GTEST_STREAM_ROWS)
+      result->bad++;
+    else
+      result->seen[row]++;
+    count++;
+    next = rbusProperty_GetNext(next);
+  }
+  if(count != numProps)
+    result->bad++;
+  result->total += count;
+
+  if(result->removeRow && result->chunks == 1)
+  {
+    /*the provider only walked as far as the first chunk*/
+    EXPECT_EQ(rbus_getInt(handle, "Device.rbusProvider.StreamGets", &result->getsAfterFirst), RBUS_ERROR_SUCCESS);
+    /*the walk resumes from the row it stopped at, found by name, so removing a row that
+      was already returned must not shift the later chunks*/
+    EXPECT_EQ(rbusTable_removeRow(handle, "Device.rbusProvider.Stream.1"), RBUS_ERROR_SUCCESS);
+  }
+  else if(result->removeRow && result->chunks == 2)
+  {
+    /*removing the row the walk stopped at continues from the row that took its place*/
+    EXPECT_EQ(rbusTable_removeRow(handle, "Device.rbusProvider.Stream.4"), RBUS_ERROR_SUCCESS);
+  }
+  return !result->stop;
+}
+
+/*the value-change events of enough of the provider's properties that rbusEvent_SubscribeEx
+  sends them from several threads*/
+static const char* subscribeExParams[] = {
+  "Device.rbusProvider.Param1",
+  "Device.rbusProvider.Param2",
+  "Device.rbusProvider.Param3",
+  "Device.rbusProvider.Int16",
+  "Device.rbusProvider.Int32",
+  "Device.rbusProvider.Int64",
+  "Device.rbusProvider.UInt16",
+  "Device.rbusProvider.UInt32",
+  "Device.rbusProvider.UInt64",
+  "Device.rbusProvider.Single",
+  "Device.rbusProvider.Double",
+  "Device.rbusProvider.NoSuchParam"
+};
+#define SUBSCRIBE_EX_VALID ((int)(sizeof(subscribeExParams)/sizeof(subscribeExParams[0])) - 1)
+
+static int exec_rbus_subscribe_ex_test(rbusHandle_t handle, bool includeMissing)
+{
+  rbusEventSubscription_t subs[SUBSCRIBE_EX_VALID + 1];
+  int count = SUBSCRIBE_EX_VALID + (includeMissing ? 1 : 0);
+  int rc;
+  int i;
+
+  memset(subs, 0, sizeof(subs));
+  for(i = 0; i < count; i++)
+  {
+    subs[i].eventName = subscribeExParams[i];
+    subs[i].handler = (void *)eventReceiveHandler;
+  }
+  /*put the one that fails in the middle so some succeed on either side of it*/
+  if(includeMissing)
+  {
+    subs[count - 1].eventName = subs[count / 2].eventName;
+    subs[count / 2].eventName = subscribeExParams[SUBSCRIBE_EX_VALID];
+  }
+
+  rc = rbusEvent_SubscribeEx(handle, subs, count, 0);
+  if(!includeMissing)
+  {
+    EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+    if(rc != RBUS_ERROR_SUCCESS)
+      return rc;
+    /*each was recorded once, so each is found and unsubscribed once*/
+    rc = rbusEvent_UnsubscribeEx(handle, subs, count);
+    EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+    EXPECT_EQ(rbusEvent_Unsubscribe(handle, subscribeExParams[0]),RBUS_ERROR_INVALID_OPERATION);
+    return rc;
+  }
+
+  EXPECT_NE(rc,RBUS_ERROR_SUCCESS);
+  if(rc == RBUS_ERROR_SUCCESS)
+    return RBUS_ERROR_BUS_ERROR;
+
+  /*the failure undid every subscription that had succeeded*/
+  rc = RBUS_ERROR_SUCCESS;
+  for(i = 0; i < SUBSCRIBE_EX_VALID; i++)
+  {
+    int unsubRc = rbusEvent_Unsubscribe(handle, subscribeExParams[i]);
+    EXPECT_EQ(unsubRc,RBUS_ERROR_INVALID_OPERATION);
+    if(unsubRc != RBUS_ERROR_INVALID_OPERATION)
+      rc = RBUS_ERROR_BUS_ERROR;
+  }
+
+  /*and left nothing behind to stop subscribing to them again*/
+  subs[count / 2].eventName = subs[count - 1].eventName;
+  rc |= rbusEvent_SubscribeEx(handle, subs, SUBSCRIBE_EX_VALID, 0);
+  EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+  rc |= rbusEvent_UnsubscribeEx(handle, subs, SUBSCRIBE_EX_VALID);
+  EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+  return rc;
+}
+
 int rbusConsumer(rbusGtest_t test, pid_t pid, int runtime)
 {
   int rc = RBUS_ERROR_BUS_ERROR;
@@ -721,6 +848,57 @@ int rbusConsumer(rbusGtest_t test, pid_t pid, int runtime)
         EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
       }
       break;
+    case RBUS_GTEST_GET_STREAM1:
+      {
+        streamResult_t result;
+        int gets = 0;
+        int row;
+
+        memset(&result, 0, sizeof(result));
+        result.removeRow = true;
+        isElementPresent(handle, "Device.rbusProvider.StreamGets");
+
+        rc = rbus_getExtStream(handle, "Device.rbusProvider.Stream.", 2, streamHandler, &result);
+        EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+        EXPECT_EQ(result.chunks, (GTEST_STREAM_ROWS + 1) / 2);
+        EXPECT_EQ(result.total, GTEST_STREAM_ROWS);
+        EXPECT_EQ(result.bad, 0);
+        for(row = 1; row <= GTEST_STREAM_ROWS; row++)
+          EXPECT_EQ(result.seen[row], 1);
+        EXPECT_EQ(result.getsAfterFirst, 2);
+
+        /*each row's getHandler ran once for the whole stream*/
+        rc |= rbus_getInt(handle, "Device.rbusProvider.StreamGets", &gets);
+        EXPECT_EQ(gets, GTEST_STREAM_ROWS);
+        if(result.total != GTEST_STREAM_ROWS || result.bad || gets != GTEST_STREAM_ROWS)
+          rc = RBUS_ERROR_BUS_ERROR;
+      }
+      break;
+    case RBUS_GTEST_GET_STREAM2:
+      {
+        streamResult_t result;
+
+        /*stop after the first chunk*/
+        memset(&result, 0, sizeof(result));
+        result.stop = true;
+        isElementPresent(handle, "Device.rbusProvider.StreamGets");
+
+        rc = rbus_getExtStream(handle, "Device.rbusProvider.Stream.", 2, streamHandler, &result);
+        EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+        EXPECT_EQ(result.chunks, 1);
+        EXPECT_EQ(result.total, 2);
+
+        /*the default chunk size returns the whole table at once*/
+        memset(&result, 0, sizeof(result));
+        rc |= rbus_getExtStream(handle, "Device.rbusProvider.Stream.", 0, streamHandler, &result);
+        EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+        EXPECT_EQ(result.chunks, 1);
+        EXPECT_EQ(result.total, GTEST_STREAM_ROWS);
+        EXPECT_EQ(result.bad, 0);
+        if(result.chunks != 1 || result.total != GTEST_STREAM_ROWS || result.bad)
+          rc = RBUS_ERROR_BUS_ERROR;
+      }
+      break;
     case RBUS_GTEST_DISC_COMP1:
       {
         int i;
@@ -842,6 +1020,30 @@ int rbusConsumer(rbusGtest_t test, pid_t pid, int runtime)
         rc = exec_rbus_set_test(handle, RBUS_ERROR_SUCCESS, param, "register_row");
       }
       break;
+    case RBUS_GTEST_SUBSCRIBE_EX1:
+    case RBUS_GTEST_SUBSCRIBE_EX2:
+      {
+        isElementPresent(handle, event_param);
+        rc = exec_rbus_subscribe_ex_test(handle, RBUS_GTEST_SUBSCRIBE_EX2 == test);
+      }
+      break;
+    case RBUS_GTEST_UNREG_SUBS:
+      {
+        /*the provider unregisters both while they are subscribed, then registers Param1 again*/
+        const char *row = "Device.rbusProvider.Stream.1.Value";
+        isElementPresent(handle, event_param);
+        isElementPresent(handle, row);
+        rc = rbusEvent_Subscribe(handle, event_param, eventReceiveHandler, NULL, 0);
+        EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+        rc |= rbusEvent_Subscribe(handle, row, eventReceiveHandler, NULL, 0);
+        EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+
+        sleep(runtime);
+
+        rbusEvent_Unsubscribe(handle, row);
+        rbusEvent_Unsubscribe(handle, event_param);
+      }
+      break;
     case RBUS_GTEST_UNREG_ROW:
       {
         const char *param = "Device.rbusProvider.Param2";
@@ -18,6 +18,7 @@
 */
 
 #include <rbus.h>
+#include <pthread.h>
 #include "../src/rbus_element.h"
 #include "../include/rbus_filter.h"
 #include "gtest/gtest.h"
@@ -304,3 +305,150 @@ TEST(rbusElementTest, negtestElement3)
 
     freeElementNode(root);
 }
+
+TEST(rbusElementTest, getCache)
+{
+    elementNode* root = getEmptyElementNode();
+    elementNode* reg;
+    elementNode* row;
+    rbusProperty_t prop;
+    rbusValue_t value;
+    uint32_t generation = 0, staleGeneration = 0;
+
+    root->name = strdup("root");
+    root->fullName = strdup("root");
+    insertElem(root, "Device.Foo.Table1.{i}.", RBUS_ELEMENT_TYPE_TABLE);
+    insertElem(root, "Device.Foo.Table1.{i}.Prop1", RBUS_ELEMENT_TYPE_PROPERTY);
+    reg = retrieveElement(root, "Device.Foo.Table1.{i}.Prop1");
+    setElementCachePolicy(reg, 60000, true);
+
+    /*rows added after the policy was set inherit it*/
+    addRow(root, "Device.Foo.Table1.", 1, NULL);
+    row = retrieveInstanceElement(root, "Device.Foo.Table1.1.Prop1");
+    ASSERT_NE(nullptr, row);
+    EXPECT_EQ(row->cacheMaxAge, 60000u);
+
+    rbusProperty_Init(&prop, "Device.Foo.Table1.1.Prop1", NULL);
+    rbusValue_Init(&value);
+    rbusValue_SetInt32(value, 42);
+
+    EXPECT_FALSE(getElementCachedValue(row, prop, &generation));
+    setElementCachedValue(row, value, generation);
+    EXPECT_TRUE(getElementCachedValue(row, prop, &generation));
+    EXPECT_EQ(rbusValue_GetInt32(rbusProperty_GetValue(prop)), 42);
+
+    /*the cache keeps its own copy, so the getHandler changing its value later doesn't reach it*/
+    rbusValue_SetInt32(value, 43);
+    EXPECT_TRUE(getElementCachedValue(row, prop, &generation));
+    EXPECT_EQ(rbusValue_GetInt32(rbusProperty_GetValue(prop)), 42);
+
+    /*a get that started before an invalidation must not refill the cache*/
+    invalidateElementCache(row);
+    EXPECT_FALSE(getElementCachedValue(row, prop, &staleGeneration));
+    invalidateElementCache(row);
+    setElementCachedValue(row, value, staleGeneration);
+    EXPECT_FALSE(getElementCachedValue(row, prop, &generation));
+
+    /*a maxAge of 0 turns caching off and drops the cached value*/
+    setElementCachedValue(row, value, generation);
+    setElementCachePolicy(row, 0, false);
+    EXPECT_FALSE(getElementCachedValue(row, prop, &generation));
+    setElementCachedValue(row, value, generation);
+    EXPECT_EQ(row->cacheValue, nullptr);
+
+    /*setting it on the registration element reaches rows already added*/
+    EXPECT_EQ(setElementCachePolicy(reg, 5000, false), RBUS_ERROR_SUCCESS);
+    EXPECT_EQ(row->cacheMaxAge, 5000u);
+    EXPECT_FALSE(row->cacheInvalidateOnSet);
+
+    rbusValue_Release(value);
+    rbusProperty_Release(prop);
+    freeElementNode(root);
+}
+
+#define CACHE_ROWS_ROUNDS 200
+
+static void* getCacheRowsThread(void* table)
+{
+    elementNode* rows[4];
+    int round, i;
+
+    for(round = 0; round < CACHE_ROWS_ROUNDS; round++)
+    {
+        for(i = 0; i < 4; i++)
+            rows[i] = instantiateTableRow((elementNode*)table, round * 4 + i + 1, NULL);
+        for(i = 0; i < 3; i++)
+            deleteTableRow(rows[i]);
+    }
+    return NULL;
+}
+
+/*rows added and removed while the policy changes all end up with the last policy*/
+TEST(rbusElementTest, getCachePolicyRows)
+{
+    elementNode* root = getEmptyElementNode();
+    elementNode* reg;
+    elementNode* table;
+    elementNodeSet set;
+    pthread_t thread;
+    uint32_t maxAge = 0;
+    int i;
+
+    root->name = strdup("root");
+    root->fullName = strdup("root");
+    insertElem(root, "Device.Foo.Table1.{i}.", RBUS_ELEMENT_TYPE_TABLE);
+    insertElem(root, "Device.Foo.Table1.{i}.Prop1", RBUS_ELEMENT_TYPE_PROPERTY);
+    reg = retrieveElement(root, "Device.Foo.Table1.{i}.Prop1");
+    table = retrieveInstanceElement(root, "Device.Foo.Table1.");
+    ASSERT_NE(nullptr, table);
+
+    ASSERT_EQ(pthread_create(&thread, NULL, getCacheRowsThread, table), 0);
+    for(i = 0; i < CACHE_ROWS_ROUNDS * 4; i++)
+    {
+        maxAge = (uint32_t)(i % 7 + 1) * 1000;
+        EXPECT_EQ(setElementCachePolicy(reg, maxAge, i % 2), RBUS_ERROR_SUCCESS);
+    }
+    pthread_join(thread, NULL);
+
+    memset(&set, 0, sizeof(set));
+    EXPECT_EQ(addElementInstancesToSet(&set, reg), RBUS_ERROR_SUCCESS);
+    EXPECT_EQ(set.count, CACHE_ROWS_ROUNDS + 1);
+    for(i = 0; i < set.count; i++)
+    {
+        EXPECT_EQ(set.nodes[i]->cacheMaxAge, maxAge);
+        EXPECT_EQ(set.nodes[i]->cacheInvalidateOnSet, (CACHE_ROWS_ROUNDS * 4 - 1) % 2 == 1);
+    }
+    freeElementSet(&set);
+    freeElementNode(root);
+}
+
+TEST(rbusElementTest, instanceSet)
+{
+    elementNode* root = getEmptyElementNode();
+    elementNodeSet set;
+    int row;
+
+    root->name = strdup("root");
+    root->fullName = strdup("root");
+    insertElem(root, "Device.Foo.Table1.{i}.", RBUS_ELEMENT_TYPE_TABLE);
+    insertElem(root, "Device.Foo.Table1.{i}.Prop1", RBUS_ELEMENT_TYPE_PROPERTY);
+    insertElem(root, "Device.Foo.Prop1", RBUS_ELEMENT_TYPE_PROPERTY);
+    /*enough rows for the set to grow past its first allocation*/
+    for(row = 1; row <= 100; row++)
+        addRow(root, "Device.Foo.Table1.", row, NULL);
+
+    /*the registration element and every row instance of it, but nothing else*/
+    memset(&set, 0, sizeof(set));
+    EXPECT_EQ(addElementInstancesToSet(&set, retrieveElement(root, "Device.Foo.Table1.{i}.Prop1")), RBUS_ERROR_SUCCESS);
+    EXPECT_EQ(set.count, 101);
+    sortElementSet(&set);
+    EXPECT_TRUE(elementSetContains(&set, retrieveElement(root, "Device.Foo.Table1.{i}.Prop1")));
+    EXPECT_TRUE(elementSetContains(&set, retrieveInstanceElement(root, "Device.Foo.Table1.1.Prop1")));
+    EXPECT_TRUE(elementSetContains(&set, retrieveInstanceElement(root, "Device.Foo.Table1.100.Prop1")));
+    EXPECT_FALSE(elementSetContains(&set, retrieveElement(root, "Device.Foo.Prop1")));
+    EXPECT_FALSE(elementSetContains(&set, retrieveInstanceElement(root, "Device.Foo.Table1.1")));
+    freeElementSet(&set);
+    EXPECT_EQ(set.count, 0);
+
+    freeElementNode(root);
+}
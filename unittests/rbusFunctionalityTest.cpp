@@ -35,6 +35,11 @@ static void exec_func_test(rbusGtest_t test)
       runtime = 5;
       break;
     }
+    case RBUS_GTEST_UNREG_SUBS:
+    {
+      runtime = 8;
+      break;
+    }
     case RBUS_GTEST_FILTER2:
     case RBUS_GTEST_ASYNC_SUB4:
     {
@@ -177,6 +182,16 @@ TEST(rbusApiGetExt, test2)
     wait(NULL);
 }
 
+TEST(rbusApiGetExtStream, test1)
+{
+  exec_func_test(RBUS_GTEST_GET_STREAM1);
+}
+
+TEST(rbusApiGetExtStream, test2)
+{
+  exec_func_test(RBUS_GTEST_GET_STREAM2);
+}
+
 TEST(rbusApiGet, test1)
 {
   exec_func_test(RBUS_GTEST_GET1);
@@ -491,3 +506,516 @@ TEST(rbusUnRegRowTest, test)
 {
   exec_func_test(RBUS_GTEST_UNREG_ROW);
 }
+
+TEST(rbusApiUnregDataElements, test1)
+{
+  exec_func_test(RBUS_GTEST_UNREG_SUBS);
+}
+
+TEST(rbusApiSubscribeEx, test1)
+{
+  exec_func_test(RBUS_GTEST_SUBSCRIBE_EX1);
+}
+
+TEST(rbusApiSubscribeEx, test2)
+{
+  exec_func_test(RBUS_GTEST_SUBSCRIBE_EX2);
+}
+
+#define REG_BULK_COUNT 64
+#define REG_BULK_DUP   40
+
+static rbusError_t regBulkGetHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
+{
+  (void)handle;
+  (void)property;
+  (void)opts;
+  return RBUS_ERROR_SUCCESS;
+}
+
+/*count how many of names are registered by componentName*/
+static int regBulkCountOwned(rbusHandle_t handle, int num, char const** names, char const* componentName)
+{
+  int numComponents = 0;
+  char** componentNames = NULL;
+  int owned = 0;
+  int i;
+
+  if(rbus_discoverComponentName(handle, num, names, &numComponents, &componentNames) != RBUS_ERROR_SUCCESS)
+    return 0;
+  for(i = 0; i < numComponents; i++)
+  {
+    if(componentNames[i] && strcmp(componentNames[i], componentName) == 0)
+      owned++;
+    free(componentNames[i]);
+  }
+  free(componentNames);
+  return owned;
+}
+
+TEST(rbusApiRegDataElements, test1)
+{
+  rbusHandle_t handle;
+  rbusDataElement_t elements[REG_BULK_COUNT];
+  char names[REG_BULK_COUNT][64];
+  char const* pnames[REG_BULK_COUNT];
+  rbusValue_t threads;
+  int toChild[2], toParent[2];
+  char c = 0;
+  int i;
+
+  memset(elements, 0, sizeof(elements));
+  for(i = 0; i < REG_BULK_COUNT; i++)
+  {
+    snprintf(names[i], sizeof(names[i]), "Device.rbusRegBulk.Param%d", i);
+    pnames[i] = elements[i].name = names[i];
+    elements[i].type = RBUS_ELEMENT_TYPE_PROPERTY;
+    elements[i].cbTable.getHandler = regBulkGetHandler;
+  }
+
+  /*another component owns one name, so registering it fails part way through*/
+  ASSERT_EQ(pipe(toChild), 0);
+  ASSERT_EQ(pipe(toParent), 0);
+  pid_t pid = fork();
+  if(0 == pid) {
+    rbusHandle_t owner;
+    rbusDataElement_t dup = {(char *)"Device.rbusRegBulk.Dup", RBUS_ELEMENT_TYPE_PROPERTY, {regBulkGetHandler, NULL, NULL, NULL, NULL, NULL}};
+    int rc = rbus_open(&owner, "rbusRegBulkOwner");
+    if(rc == RBUS_ERROR_SUCCESS)
+      rc = rbus_regDataElements(owner, 1, &dup);
+    write(toParent[1], &c, 1);
+    read(toChild[0], &c, 1);
+    if(rc == RBUS_ERROR_SUCCESS)
+      rbus_unregDataElements(owner, 1, &dup);
+    rbus_close(owner);
+    exit(rc);
+  }
+  ASSERT_EQ(read(toParent[0], &c, 1), 1);
+
+  ASSERT_EQ(rbus_open(&handle, "rbusRegBulk"), RBUS_ERROR_SUCCESS);
+  rbusValue_Init(&threads);
+  rbusValue_SetInt32(threads, 8);
+  EXPECT_EQ(rbus_setConfig(RBUS_CONFIG_REG_ELEMENTS_THREADS, threads), RBUS_ERROR_SUCCESS);
+
+  /*registered by several threads, every element can be found*/
+  EXPECT_EQ(rbus_regDataElements(handle, REG_BULK_COUNT, elements), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(regBulkCountOwned(handle, REG_BULK_COUNT, pnames, "rbusRegBulk"), REG_BULK_COUNT);
+  EXPECT_EQ(rbus_unregDataElements(handle, REG_BULK_COUNT, elements), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(regBulkCountOwned(handle, REG_BULK_COUNT, pnames, "rbusRegBulk"), 0);
+
+  /*one failure rolls back every element, with the broker and locally*/
+  elements[REG_BULK_DUP].name = (char *)"Device.rbusRegBulk.Dup";
+  EXPECT_EQ(rbus_regDataElements(handle, REG_BULK_COUNT, elements), RBUS_ERROR_ELEMENT_NAME_DUPLICATE);
+  EXPECT_EQ(regBulkCountOwned(handle, REG_BULK_COUNT, pnames, "rbusRegBulk"), 0);
+  elements[REG_BULK_DUP].name = names[REG_BULK_DUP];
+  EXPECT_EQ(rbus_regDataElements(handle, REG_BULK_COUNT, elements), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(regBulkCountOwned(handle, REG_BULK_COUNT, pnames, "rbusRegBulk"), REG_BULK_COUNT);
+  EXPECT_EQ(rbus_unregDataElements(handle, REG_BULK_COUNT, elements), RBUS_ERROR_SUCCESS);
+
+  rbusValue_SetInt32(threads, 4);
+  rbus_setConfig(RBUS_CONFIG_REG_ELEMENTS_THREADS, threads);
+  rbusValue_Release(threads);
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+
+  int status;
+  write(toChild[1], &c, 1);
+  EXPECT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_EQ(WEXITSTATUS(status), RBUS_ERROR_SUCCESS);
+  for(i = 0; i < 2; i++)
+  {
+    close(toChild[i]);
+    close(toParent[i]);
+  }
+}
+
+#define ASYNC_RETRIER_COUNT   6
+#define ASYNC_RETRIER_TIMEOUT 1500
+
+typedef struct
+{
+  int done;
+  int order;
+  rbusError_t error;
+  struct timespec start;
+  struct timespec end;
+} asyncRetrierRecord_t;
+
+static pthread_mutex_t asyncRetrierMutex = PTHREAD_MUTEX_INITIALIZER;
+static int asyncRetrierDone = 0;
+
+static int asyncRetrierElapsedMs(struct timespec* from, struct timespec* to)
+{
+  return (int)((to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000);
+}
+
+static void asyncRetrierEventHandler(rbusHandle_t handle, rbusEvent_t const* event, rbusEventSubscription_t* subscription)
+{
+  (void)handle;
+  (void)event;
+  (void)subscription;
+}
+
+static void asyncRetrierSubscribeHandler(rbusHandle_t handle, rbusEventSubscription_t* subscription, rbusError_t error)
+{
+  asyncRetrierRecord_t* record = (asyncRetrierRecord_t*)subscription->userData;
+
+  (void)handle;
+  pthread_mutex_lock(&asyncRetrierMutex);
+  clock_gettime(CLOCK_MONOTONIC, &record->end);
+  record->error = error;
+  record->order = asyncRetrierDone++;
+  record->done = 1;
+  pthread_mutex_unlock(&asyncRetrierMutex);
+}
+
+/*wait up to timeout ms for count subscribe callbacks*/
+static void asyncRetrierWait(int count, int timeout)
+{
+  int done;
+
+  for(; timeout > 0; timeout -= 50)
+  {
+    pthread_mutex_lock(&asyncRetrierMutex);
+    done = asyncRetrierDone;
+    pthread_mutex_unlock(&asyncRetrierMutex);
+    if(done >= count)
+      break;
+    usleep(50000);
+  }
+}
+
+static void asyncRetrierSetConfig(rbusConfigSetting_t setting, int32_t value)
+{
+  rbusValue_t v;
+
+  rbusValue_Init(&v);
+  rbusValue_SetInt32(v, value);
+  EXPECT_EQ(rbus_setConfig(setting, v), RBUS_ERROR_SUCCESS);
+  rbusValue_Release(v);
+}
+
+/*subscriptions started at different times give up in start order, each close to its own
+  deadline, so the retrier always wakes for whichever item is due first*/
+TEST(rbusAsyncSubRetrier, test1)
+{
+  rbusHandle_t handle;
+  asyncRetrierRecord_t records[ASYNC_RETRIER_COUNT];
+  char names[ASYNC_RETRIER_COUNT][64];
+  int i;
+
+  memset(records, 0, sizeof(records));
+  asyncRetrierDone = 0;
+
+  ASSERT_EQ(rbus_open(&handle, "rbusAsyncRetrier"), RBUS_ERROR_SUCCESS);
+  asyncRetrierSetConfig(RBUS_CONFIG_SUBSCRIBE_TIMEOUT, ASYNC_RETRIER_TIMEOUT);
+  asyncRetrierSetConfig(RBUS_CONFIG_SUBSCRIBE_MAXWAIT, 300);
+
+  for(i = 0; i < ASYNC_RETRIER_COUNT; i++)
+  {
+    snprintf(names[i], sizeof(names[i]), "Device.rbusAsyncRetrier.Missing%d", i);
+    clock_gettime(CLOCK_MONOTONIC, &records[i].start);
+    EXPECT_EQ(rbusEvent_SubscribeAsync(handle, names[i], asyncRetrierEventHandler,
+                asyncRetrierSubscribeHandler, &records[i], 0), RBUS_ERROR_SUCCESS);
+    usleep(130000);
+  }
+  asyncRetrierWait(ASYNC_RETRIER_COUNT, ASYNC_RETRIER_TIMEOUT * 3);
+
+  for(i = 0; i < ASYNC_RETRIER_COUNT; i++)
+  {
+    int elapsed = asyncRetrierElapsedMs(&records[i].start, &records[i].end);
+
+    ASSERT_EQ(records[i].done, 1);
+    EXPECT_EQ(records[i].error, RBUS_ERROR_TIMEOUT);
+    EXPECT_EQ(records[i].order, i);
+    EXPECT_GE(elapsed, ASYNC_RETRIER_TIMEOUT);
+    EXPECT_LT(elapsed, ASYNC_RETRIER_TIMEOUT + 500);
+  }
+
+  asyncRetrierSetConfig(RBUS_CONFIG_SUBSCRIBE_TIMEOUT, 600000);
+  asyncRetrierSetConfig(RBUS_CONFIG_SUBSCRIBE_MAXWAIT, 60000);
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+}
+
+/*a provider that registers while the retrier is backing off is subscribed to right
+  away instead of on the next retry*/
+TEST(rbusAsyncSubRetrier, test2)
+{
+  rbusHandle_t handle;
+  asyncRetrierRecord_t record;
+  struct timespec registered;
+  int toChild[2], toParent[2];
+  char c = 0;
+  int i;
+
+  memset(&record, 0, sizeof(record));
+  asyncRetrierDone = 0;
+
+  ASSERT_EQ(pipe(toChild), 0);
+  ASSERT_EQ(pipe(toParent), 0);
+  pid_t pid = fork();
+  if(0 == pid) {
+    rbusHandle_t provider;
+    rbusDataElement_t late = {(char *)"Device.rbusAsyncRetrier.Late", RBUS_ELEMENT_TYPE_PROPERTY, {regBulkGetHandler, NULL, NULL, NULL, NULL, NULL}};
+    int rc;
+
+    read(toChild[0], &c, 1);
+    rc = rbus_open(&provider, "rbusAsyncRetrierProvider");
+    if(rc == RBUS_ERROR_SUCCESS)
+      rc = rbus_regDataElements(provider, 1, &late);
+    write(toParent[1], &c, 1);
+    read(toChild[0], &c, 1);
+    if(rc == RBUS_ERROR_SUCCESS)
+      rbus_unregDataElements(provider, 1, &late);
+    rbus_close(provider);
+    exit(rc);
+  }
+
+  ASSERT_EQ(rbus_open(&handle, "rbusAsyncRetrier"), RBUS_ERROR_SUCCESS);
+  clock_gettime(CLOCK_MONOTONIC, &record.start);
+  EXPECT_EQ(rbusEvent_SubscribeAsync(handle, "Device.rbusAsyncRetrier.Late", asyncRetrierEventHandler,
+              asyncRetrierSubscribeHandler, &record, 0), RBUS_ERROR_SUCCESS);
+
+  /*retries go out at 0, 1 and 3 seconds, the next one isn't due until 7*/
+  usleep(3500000);
+  write(toChild[1], &c, 1);
+  ASSERT_EQ(read(toParent[0], &c, 1), 1);
+  clock_gettime(CLOCK_MONOTONIC, &registered);
+
+  asyncRetrierWait(1, 3000);
+  ASSERT_EQ(record.done, 1);
+  EXPECT_EQ(record.error, RBUS_ERROR_SUCCESS);
+  EXPECT_LT(asyncRetrierElapsedMs(&registered, &record.end), 1000);
+  EXPECT_LT(asyncRetrierElapsedMs(&record.start, &record.end), 5000);
+
+  EXPECT_EQ(rbusEvent_Unsubscribe(handle, "Device.rbusAsyncRetrier.Late"), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+
+  int status;
+  write(toChild[1], &c, 1);
+  EXPECT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_EQ(WEXITSTATUS(status), RBUS_ERROR_SUCCESS);
+  for(i = 0; i < 2; i++)
+  {
+    close(toChild[i]);
+    close(toParent[i]);
+  }
+}
+
+#define HANDLE_REG_COUNT 8
+
+static rbusHandle_t handleRegHandles[HANDLE_REG_COUNT];
+static int handleRegSubs[HANDLE_REG_COUNT];
+
+static rbusError_t handleRegSubHandler(rbusHandle_t handle, rbusEventSubAction_t action, const char* eventName, rbusFilter_t filter, int32_t interval, bool* autoPublish)
+{
+  int i;
+
+  (void)eventName;
+  (void)filter;
+  (void)interval;
+  *autoPublish = false;
+  for(i = 0; i < HANDLE_REG_COUNT; i++)
+  {
+    if(handleRegHandles[i] == handle)
+      __atomic_add_fetch(&handleRegSubs[i], action == RBUS_EVENT_ACTION_SUBSCRIBE ? 1 : -1, __ATOMIC_SEQ_CST);
+  }
+  return RBUS_ERROR_SUCCESS;
+}
+
+static void handleRegOpen(int i, char names[][64])
+{
+  char component[32];
+  rbusDataElement_t element = {names[i], RBUS_ELEMENT_TYPE_PROPERTY, {regBulkGetHandler, NULL, NULL, NULL, handleRegSubHandler, NULL}};
+
+  snprintf(component, sizeof(component), "rbusHandleReg%d", i);
+  ASSERT_EQ(rbus_open(&handleRegHandles[i], component), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_regDataElements(handleRegHandles[i], 1, &element), RBUS_ERROR_SUCCESS);
+}
+
+static int handleRegTotalSubs(void)
+{
+  int total = 0;
+  int i;
+
+  for(i = 0; i < HANDLE_REG_COUNT; i++)
+    total += __atomic_load_n(&handleRegSubs[i], __ATOMIC_SEQ_CST);
+  return total;
+}
+
+/*more handles than the old fixed array held, some closed and reopened, and a listener
+  that disconnects without unsubscribing is cleaned up on every handle still open*/
+TEST(rbusHandleRegistry, test1)
+{
+  char names[HANDLE_REG_COUNT][64];
+  int toChild[2], toParent[2];
+  char c = 0;
+  int i, wait;
+
+  memset(handleRegSubs, 0, sizeof(handleRegSubs));
+  for(i = 0; i < HANDLE_REG_COUNT; i++)
+  {
+    snprintf(names[i], sizeof(names[i]), "Device.rbusHandleReg%d.Value", i);
+    handleRegOpen(i, names);
+  }
+
+  /*closing a handle gives its registry slot back, reopening takes one again*/
+  EXPECT_EQ(rbus_close(handleRegHandles[2]), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_close(handleRegHandles[5]), RBUS_ERROR_SUCCESS);
+  handleRegOpen(5, names);
+  handleRegOpen(2, names);
+
+  ASSERT_EQ(pipe(toChild), 0);
+  ASSERT_EQ(pipe(toParent), 0);
+  pid_t pid = fork();
+  if(0 == pid) {
+    rbusHandle_t consumer;
+    int rc = rbus_open(&consumer, "rbusHandleRegConsumer");
+    for(i = 0; i < HANDLE_REG_COUNT && rc == RBUS_ERROR_SUCCESS; i++)
+      rc = rbusEvent_Subscribe(consumer, names[i], asyncRetrierEventHandler, NULL, 0);
+    write(toParent[1], &c, 1);
+    read(toChild[0], &c, 1);
+    /*exit without unsubscribing or closing, the broker reports the disconnect*/
+    _exit(rc);
+  }
+  ASSERT_EQ(read(toParent[0], &c, 1), 1);
+
+  for(i = 0; i < HANDLE_REG_COUNT; i++)
+    EXPECT_EQ(handleRegSubs[i], 1);
+
+  /*a closed handle drops out of the listener index, the disconnect skips it*/
+  EXPECT_EQ(rbus_close(handleRegHandles[3]), RBUS_ERROR_SUCCESS);
+  handleRegHandles[3] = NULL;
+  handleRegSubs[3] = 0;
+
+  int status;
+  write(toChild[1], &c, 1);
+  EXPECT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_EQ(WEXITSTATUS(status), RBUS_ERROR_SUCCESS);
+
+  for(wait = 0; wait < 60 && handleRegTotalSubs() != 0; wait++)
+    usleep(50000);
+  for(i = 0; i < HANDLE_REG_COUNT; i++)
+    EXPECT_EQ(handleRegSubs[i], 0);
+
+  for(i = 0; i < HANDLE_REG_COUNT; i++)
+  {
+    if(handleRegHandles[i])
+      EXPECT_EQ(rbus_close(handleRegHandles[i]), RBUS_ERROR_SUCCESS);
+  }
+  for(i = 0; i < 2; i++)
+  {
+    close(toChild[i]);
+    close(toParent[i]);
+  }
+}
+
+#define GET_CACHE_NAME "Device.rbusGetCache.Value"
+
+static int getCacheValue = 1;
+static int getCacheCalls = 0;
+static int getCacheEvents = 0;
+
+static rbusError_t getCacheGetHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
+{
+  rbusValue_t value;
+
+  (void)handle;
+  (void)opts;
+  __atomic_add_fetch(&getCacheCalls, 1, __ATOMIC_SEQ_CST);
+  rbusValue_Init(&value);
+  rbusValue_SetInt32(value, __atomic_load_n(&getCacheValue, __ATOMIC_SEQ_CST));
+  rbusProperty_SetValue(property, value);
+  rbusValue_Release(value);
+  return RBUS_ERROR_SUCCESS;
+}
+
+static rbusError_t getCacheSetHandler(rbusHandle_t handle, rbusProperty_t property, rbusSetHandlerOptions_t* opts)
+{
+  (void)handle;
+  (void)opts;
+  __atomic_store_n(&getCacheValue, rbusValue_GetInt32(rbusProperty_GetValue(property)), __ATOMIC_SEQ_CST);
+  return RBUS_ERROR_SUCCESS;
+}
+
+static void getCacheEventHandler(rbusHandle_t handle, rbusEvent_t const* event, rbusEventSubscription_t* subscription)
+{
+  (void)handle;
+  (void)event;
+  (void)subscription;
+  __atomic_add_fetch(&getCacheEvents, 1, __ATOMIC_SEQ_CST);
+}
+
+static int getCacheGet(rbusHandle_t handle)
+{
+  rbusValue_t value = NULL;
+  int result = -1;
+
+  EXPECT_EQ(rbus_get(handle, GET_CACHE_NAME, &value), RBUS_ERROR_SUCCESS);
+  if(value)
+  {
+    result = rbusValue_GetInt32(value);
+    rbusValue_Release(value);
+  }
+  return result;
+}
+
+/*repeated gets are answered from the cache until maxAge passes, a set or a value change
+  seen by the poller makes the next get call the getHandler again*/
+TEST(rbusGetCache, test1)
+{
+  rbusHandle_t handle, consumer;
+  rbusDataElement_t element = {(char *)GET_CACHE_NAME, RBUS_ELEMENT_TYPE_PROPERTY, {getCacheGetHandler, getCacheSetHandler, NULL, NULL, NULL, NULL}};
+  rbusGetCachePolicy_t policy = {1000, true};
+  rbusValue_t value;
+  int calls, wait;
+
+  __atomic_store_n(&getCacheValue, 1, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&getCacheCalls, 0, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&getCacheEvents, 0, __ATOMIC_SEQ_CST);
+
+  ASSERT_EQ(rbus_open(&handle, "rbusGetCache"), RBUS_ERROR_SUCCESS);
+  ASSERT_EQ(rbus_regDataElements(handle, 1, &element), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_setGetCachePolicy(handle, GET_CACHE_NAME, &policy), RBUS_ERROR_SUCCESS);
+
+  EXPECT_EQ(getCacheGet(handle), 1);
+  EXPECT_EQ(getCacheGet(handle), 1);
+  EXPECT_EQ(__atomic_load_n(&getCacheCalls, __ATOMIC_SEQ_CST), 1);
+
+  /*past maxAge*/
+  usleep(1100000);
+  EXPECT_EQ(getCacheGet(handle), 1);
+  EXPECT_EQ(__atomic_load_n(&getCacheCalls, __ATOMIC_SEQ_CST), 2);
+
+  /*invalidateOnSet*/
+  rbusValue_Init(&value);
+  rbusValue_SetInt32(value, 2);
+  EXPECT_EQ(rbus_set(handle, GET_CACHE_NAME, value, NULL), RBUS_ERROR_SUCCESS);
+  rbusValue_Release(value);
+  EXPECT_EQ(getCacheGet(handle), 2);
+  EXPECT_EQ(__atomic_load_n(&getCacheCalls, __ATOMIC_SEQ_CST), 3);
+  EXPECT_EQ(getCacheGet(handle), 2);
+  EXPECT_EQ(__atomic_load_n(&getCacheCalls, __ATOMIC_SEQ_CST), 3);
+
+  /*a value change found by the poller, with a maxAge that won't pass during the test*/
+  policy.maxAge = 60000;
+  EXPECT_EQ(rbus_setGetCachePolicy(handle, GET_CACHE_NAME, &policy), RBUS_ERROR_SUCCESS);
+  asyncRetrierSetConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, 100);
+  ASSERT_EQ(rbus_open(&consumer, "rbusGetCacheConsumer"), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbusEvent_Subscribe(consumer, GET_CACHE_NAME, getCacheEventHandler, NULL, 0), RBUS_ERROR_SUCCESS);
+
+  EXPECT_EQ(getCacheGet(consumer), 2);
+  calls = __atomic_load_n(&getCacheCalls, __ATOMIC_SEQ_CST);
+  EXPECT_EQ(getCacheGet(consumer), 2);
+  __atomic_store_n(&getCacheValue, 3, __ATOMIC_SEQ_CST);
+  for(wait = 0; wait < 80 && __atomic_load_n(&getCacheEvents, __ATOMIC_SEQ_CST) == 0; wait++)
+    usleep(50000);
+  EXPECT_EQ(__atomic_load_n(&getCacheEvents, __ATOMIC_SEQ_CST), 1);
+  EXPECT_EQ(getCacheGet(consumer), 3);
+  EXPECT_GT(__atomic_load_n(&getCacheCalls, __ATOMIC_SEQ_CST), calls);
+
+  asyncRetrierSetConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, 2000);
+  EXPECT_EQ(rbusEvent_Unsubscribe(consumer, GET_CACHE_NAME), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_close(consumer), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_unregDataElements(handle, 1, &element), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+}
@@ -39,7 +39,12 @@ typedef enum
   RBUS_GTEST_MSG6,
   RBUS_GTEST_MSG7,
   RBUS_GTEST_MSG8,
-  RBUS_GTEST_MSG9
+  RBUS_GTEST_MSG9,
+  RBUS_GTEST_MSG10,
+  RBUS_GTEST_MSG11,
+  RBUS_GTEST_MSG12,
+  RBUS_GTEST_MSG13,
+  RBUS_GTEST_MSG14
 } rbusGtestMsg_t;
 
 typedef struct rbusMsgData
@@ -390,6 +395,486 @@ exit:
   return ret;
 }
 
+#define MSG_COLLECT_MAX 16
+
+typedef struct rbusMsgCollect
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int count;
+  int length[MSG_COLLECT_MAX];
+  char data[MSG_COLLECT_MAX][64];
+  uint32_t sum[MSG_COLLECT_MAX];
+  bool retain;
+  uint8_t const* retained[MSG_COLLECT_MAX];
+  int delayMs;
+  int lastSeq;
+  bool outOfOrder;
+} rbusMsgCollect_t;
+
+static uint32_t rbus_msg_sum(uint8_t const *data, int length)
+{
+  uint32_t sum = 0;
+  int i;
+
+  for(i = 0; i < length; i++)
+    sum = sum * 31 + data[i];
+  return sum;
+}
+
+static void rbusCollectHandler(rbusHandle_t handle, rbusMessage_t* msg, void * pUserData)
+{
+  (void)handle;
+  rbusMsgCollect_t *collect = (rbusMsgCollect_t *)pUserData;
+
+  if(collect->delayMs)
+  {
+    int seq = atoi((char const *)msg->data);
+    usleep(collect->delayMs * 1000);
+    pthread_mutex_lock(&collect->lock);
+    if(seq <= collect->lastSeq)
+      collect->outOfOrder = true;
+    collect->lastSeq = seq;
+    collect->count++;
+    pthread_mutex_unlock(&collect->lock);
+    return;
+  }
+
+  pthread_mutex_lock(&collect->lock);
+  if(collect->count < MSG_COLLECT_MAX)
+  {
+    collect->length[collect->count] = msg->length;
+    snprintf(collect->data[collect->count], sizeof(collect->data[0]), "%.*s", msg->length, (char const *)msg->data);
+    collect->sum[collect->count] = rbus_msg_sum(msg->data, msg->length);
+    if(collect->retain)
+      EXPECT_EQ(rbusMessage_RetainData(msg, &collect->retained[collect->count]), RBUS_ERROR_SUCCESS);
+  }
+  collect->count++;
+  pthread_cond_broadcast(&collect->cond);
+  pthread_mutex_unlock(&collect->lock);
+}
+
+/* Closes the handle from the delivery thread running the handler */
+static void rbusCloseHandler(rbusHandle_t handle, rbusMessage_t* msg, void * pUserData)
+{
+  (void)msg;
+  rbusMsgCollect_t *collect = (rbusMsgCollect_t *)pUserData;
+
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+  pthread_mutex_lock(&collect->lock);
+  collect->count++;
+  pthread_cond_broadcast(&collect->cond);
+  pthread_mutex_unlock(&collect->lock);
+}
+
+static int rbus_collect_wait(rbusMsgCollect_t *collect, int count, int seconds)
+{
+  struct timespec deadline;
+  int received;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += seconds;
+  pthread_mutex_lock(&collect->lock);
+  while(collect->count < count)
+  {
+    if(pthread_cond_timedwait(&collect->cond, &collect->lock, &deadline) == ETIMEDOUT)
+      break;
+  }
+  received = collect->count;
+  pthread_mutex_unlock(&collect->lock);
+  return received;
+}
+
+/* Retries the first message until the receiver's listener is in place */
+static rbusError_t rbus_send_when_listening(rbusHandle_t handle, char const *topic, struct iovec const *iov, int iovcnt)
+{
+  rbusError_t ret = RBUS_ERROR_DESTINATION_NOT_FOUND;
+  int tries = 100;
+
+  while(tries-- && RBUS_ERROR_DESTINATION_NOT_FOUND == ret)
+  {
+    ret = rbusMessage_SendV(handle, topic, iov, iovcnt, RBUS_MESSAGE_CONFIRM_RECEIPT);
+    if(RBUS_ERROR_DESTINATION_NOT_FOUND == ret)
+      usleep(100000);
+  }
+  return ret;
+}
+
+static int rbus_send_batch(const char *topic)
+{
+  rbusHandle_t handle;
+  struct iovec iov[3];
+  rbusMessage_t msgs[3];
+  static char large[2][1500];
+  int ret = RBUS_ERROR_BUS_ERROR;
+  int sent = -1;
+
+  ret = rbus_open(&handle, "rbus_send_batch");
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  if(RBUS_ERROR_SUCCESS != ret) return ret;
+
+  iov[0].iov_base = (void*)"header:";
+  iov[0].iov_len = 7;
+  iov[1].iov_base = (void*)"";
+  iov[1].iov_len = 0;
+  iov[2].iov_base = (void*)"body";
+  iov[2].iov_len = 4;
+  ret = rbus_send_when_listening(handle, topic, iov, 3);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*larger than the stack buffer SendV joins small messages in*/
+  memset(large[0], 'x', sizeof(large[0]));
+  memset(large[1], 'y', sizeof(large[1]));
+  iov[0].iov_base = large[0];
+  iov[0].iov_len = sizeof(large[0]);
+  iov[1].iov_base = large[1];
+  iov[1].iov_len = sizeof(large[1]);
+  ret |= rbusMessage_SendV(handle, topic, iov, 2, RBUS_MESSAGE_CONFIRM_RECEIPT);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  msgs[0].topic = msgs[1].topic = msgs[2].topic = topic;
+  msgs[0].data = (uint8_t const*)"batch 1";
+  msgs[1].data = (uint8_t const*)"batch 2";
+  msgs[2].data = (uint8_t const*)"batch 3";
+  msgs[0].length = msgs[1].length = msgs[2].length = 7;
+  ret |= rbusMessage_SendBatch(handle, msgs, 3, RBUS_MESSAGE_CONFIRM_RECEIPT, &sent);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(sent, 3);
+
+  /*a batch stops at the first message nobody listens for*/
+  msgs[1].topic = "A.B.Nobody";
+  EXPECT_EQ(rbusMessage_SendBatch(handle, msgs, 3, RBUS_MESSAGE_CONFIRM_RECEIPT, &sent), RBUS_ERROR_DESTINATION_NOT_FOUND);
+  EXPECT_EQ(sent, 1);
+
+  EXPECT_EQ(rbusMessage_SendV(handle, topic, NULL, 2, RBUS_MESSAGE_NONE), RBUS_ERROR_INVALID_INPUT);
+
+  ret |= rbus_close(handle);
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  return ret;
+}
+
+/* Receives until the sender exits and the expected number of messages arrived */
+static int rbus_recv_collect(const char *topic, pid_t pid, rbusMsgCollect_t *collect, int expected)
+{
+  rbusHandle_t handle;
+  int ret = RBUS_ERROR_BUS_ERROR, status = -1;
+
+  ret = rbus_open(&handle, "rbus_recv_collect");
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  if(RBUS_ERROR_SUCCESS != ret) return ret;
+
+  ret = rbusMessage_AddListener(handle, topic, &rbusCollectHandler, collect);
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+
+  EXPECT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_EQ(WEXITSTATUS(status), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_collect_wait(collect, expected, 5), expected);
+
+  ret |= rbusMessage_RemoveListener(handle, topic);
+  ret |= rbus_close(handle);
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  return ret;
+}
+
+static bool rbus_collect_has(rbusMsgCollect_t *collect, const char *data)
+{
+  int i;
+
+  for(i = 0; i < collect->count && i < MSG_COLLECT_MAX; i++)
+  {
+    if(strcmp(collect->data[i], data) == 0)
+      return true;
+  }
+  return false;
+}
+
+typedef struct rbusAsyncSent
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int completed;
+  int failed;
+  bool closed;
+} rbusAsyncSent_t;
+
+static void rbusAsyncSentCallback(rbusHandle_t handle, rbusMessage_t* msg, rbusError_t error, void* userData)
+{
+  (void)handle;
+  (void)msg;
+  rbusAsyncSent_t *sent = (rbusAsyncSent_t *)userData;
+
+  pthread_mutex_lock(&sent->lock);
+  if(RBUS_ERROR_SUCCESS != error)
+    sent->failed++;
+  sent->completed++;
+  pthread_cond_broadcast(&sent->cond);
+  pthread_mutex_unlock(&sent->lock);
+}
+
+/* Queues another message from the send thread running the callback */
+static void rbusAsyncChainCallback(rbusHandle_t handle, rbusMessage_t* msg, rbusError_t error, void* userData)
+{
+  rbusMessage_t next;
+
+  EXPECT_EQ(error, RBUS_ERROR_SUCCESS);
+  next.topic = msg->topic;
+  next.data = (uint8_t const*)"async chained";
+  next.length = 13;
+  EXPECT_EQ(rbusMessage_SendAsync(handle, &next, rbusAsyncSentCallback, userData), RBUS_ERROR_SUCCESS);
+  rbusAsyncSentCallback(handle, msg, error, userData);
+}
+
+/* Closes the handle from the send thread running the callback */
+static void rbusAsyncCloseCallback(rbusHandle_t handle, rbusMessage_t* msg, rbusError_t error, void* userData)
+{
+  (void)msg;
+  rbusAsyncSent_t *sent = (rbusAsyncSent_t *)userData;
+
+  EXPECT_EQ(error, RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+  pthread_mutex_lock(&sent->lock);
+  sent->closed = true;
+  pthread_cond_broadcast(&sent->cond);
+  pthread_mutex_unlock(&sent->lock);
+}
+
+static bool rbus_async_wait(rbusAsyncSent_t *sent, int completed, bool closed)
+{
+  struct timespec deadline;
+  bool done;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += 10;
+  pthread_mutex_lock(&sent->lock);
+  while(sent->completed < completed || sent->closed != closed)
+  {
+    if(pthread_cond_timedwait(&sent->cond, &sent->lock, &deadline) == ETIMEDOUT)
+      break;
+  }
+  done = sent->completed >= completed && sent->closed == closed;
+  pthread_mutex_unlock(&sent->lock);
+  return done;
+}
+
+static int rbus_send_async(const char *topic)
+{
+  rbusHandle_t handle;
+  rbusAsyncSent_t sent;
+  rbusMessage_t msg;
+  struct iovec iov;
+  char buff[16];
+  int ret = RBUS_ERROR_BUS_ERROR;
+  int i;
+
+  memset(&sent, 0, sizeof(sent));
+  pthread_mutex_init(&sent.lock, NULL);
+  pthread_cond_init(&sent.cond, NULL);
+
+  ret = rbus_open(&handle, "rbus_send_async");
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  if(RBUS_ERROR_SUCCESS != ret) return ret;
+
+  iov.iov_base = (void*)"async 0";
+  iov.iov_len = 7;
+  ret = rbus_send_when_listening(handle, topic, &iov, 1);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbusMessage_SetSendWindow(handle, 4), RBUS_ERROR_SUCCESS);
+
+  /*the messages are copied, so the buffer is reused for every one*/
+  msg.topic = topic;
+  for(i = 1; i <= 8; i++)
+  {
+    msg.length = snprintf(buff, sizeof(buff), "async %d", i);
+    msg.data = (uint8_t const*)buff;
+    ret |= rbusMessage_SendAsync(handle, &msg, rbusAsyncSentCallback, &sent);
+  }
+  msg.topic = "A.B.Nobody";
+  ret |= rbusMessage_SendAsync(handle, &msg, rbusAsyncSentCallback, &sent);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*every completion fires, with the error confirmation would have returned*/
+  EXPECT_TRUE(rbus_async_wait(&sent, 9, false));
+  EXPECT_EQ(sent.completed, 9);
+  EXPECT_EQ(sent.failed, 1);
+
+  /*a callback can send another message even when it fills the window*/
+  EXPECT_EQ(rbusMessage_SetSendWindow(handle, 1), RBUS_ERROR_SUCCESS);
+  msg.topic = topic;
+  msg.data = (uint8_t const*)"async chain";
+  msg.length = 11;
+  ret |= rbusMessage_SendAsync(handle, &msg, rbusAsyncChainCallback, &sent);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+  EXPECT_TRUE(rbus_async_wait(&sent, 11, false));
+  EXPECT_EQ(sent.failed, 1);
+
+  /*rbus_close from a completion callback still sends what is queued behind it*/
+  msg.topic = topic;
+  msg.data = (uint8_t const*)"async close";
+  msg.length = 11;
+  ret |= rbusMessage_SendAsync(handle, &msg, rbusAsyncCloseCallback, &sent);
+  msg.data = (uint8_t const*)"async last";
+  msg.length = 10;
+  ret |= rbusMessage_SendAsync(handle, &msg, rbusAsyncSentCallback, &sent);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+  EXPECT_TRUE(rbus_async_wait(&sent, 12, true));
+  EXPECT_EQ(sent.failed, 1);
+
+  /*the send thread frees the queue after the callback returns*/
+  usleep(100000);
+  return ret;
+}
+
+#define SHM_TEST_LENGTH 200000
+
+static int rbus_send_shared(const char *topic)
+{
+  rbusHandle_t handle;
+  rbusMessage_t msg;
+  struct iovec iov;
+  static uint8_t large[SHM_TEST_LENGTH];
+  char small[64];
+  int ret = RBUS_ERROR_BUS_ERROR;
+  int i;
+
+  for(i = 0; i < SHM_TEST_LENGTH; i++)
+    large[i] = (uint8_t)(i * 7);
+
+  ret = rbus_open(&handle, "rbus_send_shared");
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  if(RBUS_ERROR_SUCCESS != ret) return ret;
+
+  iov.iov_base = (void*)"ready";
+  iov.iov_len = 5;
+  ret = rbus_send_when_listening(handle, topic, &iov, 1);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  msg.topic = topic;
+  msg.data = large;
+  msg.length = SHM_TEST_LENGTH;
+  ret |= rbusMessage_Send(handle, &msg, (rbusMessageSendOptions_t)(RBUS_MESSAGE_SHARED_MEMORY | RBUS_MESSAGE_CONFIRM_RECEIPT));
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*an ordinary message that happens to look like a descriptor is delivered as it is*/
+  memset(small, 0, sizeof(small));
+  memcpy(small, "rbus-shm", 8);
+  msg.data = (uint8_t const*)small;
+  msg.length = sizeof(small);
+  ret |= rbusMessage_Send(handle, &msg, RBUS_MESSAGE_CONFIRM_RECEIPT);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*unconfirmed, so the object stays until rbus_close*/
+  msg.data = large;
+  msg.length = SHM_TEST_LENGTH;
+  ret |= rbusMessage_Send(handle, &msg, RBUS_MESSAGE_SHARED_MEMORY);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*give the listener time to map it*/
+  sleep(1);
+  ret |= rbus_close(handle);
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  return ret;
+}
+
+/* Sends until the receiver removes its listener on topic */
+static rbusError_t rbus_send_until_removed(rbusHandle_t handle, char const *topic)
+{
+  struct iovec iov;
+  rbusError_t ret = RBUS_ERROR_SUCCESS;
+  int tries = 100;
+
+  iov.iov_base = (void*)"poll";
+  iov.iov_len = 4;
+  while(tries-- && RBUS_ERROR_SUCCESS == ret)
+  {
+    ret = rbusMessage_SendV(handle, topic, &iov, 1, RBUS_MESSAGE_CONFIRM_RECEIPT);
+    if(RBUS_ERROR_SUCCESS == ret)
+      usleep(100000);
+  }
+  return ret;
+}
+
+static int rbus_send_listeners(void)
+{
+  rbusHandle_t handle;
+  struct iovec iov;
+  int ret = RBUS_ERROR_BUS_ERROR;
+
+  ret = rbus_open(&handle, "rbus_send_listeners");
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  if(RBUS_ERROR_SUCCESS != ret) return ret;
+
+  /*the receiver listens on A.B.C.D last, so both its A.B.C listeners are in place*/
+  iov.iov_base = (void*)"child";
+  iov.iov_len = 5;
+  ret = rbus_send_when_listening(handle, "A.B.C.D", &iov, 1);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+  iov.iov_base = (void*)"one";
+  iov.iov_len = 3;
+  ret |= rbusMessage_SendV(handle, "A.B.C", &iov, 1, RBUS_MESSAGE_CONFIRM_RECEIPT);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*removing the child leaves the listeners on its parent*/
+  EXPECT_EQ(rbus_send_until_removed(handle, "A.B.C.D"), RBUS_ERROR_DESTINATION_NOT_FOUND);
+  iov.iov_base = (void*)"two";
+  ret |= rbusMessage_SendV(handle, "A.B.C", &iov, 1, RBUS_MESSAGE_CONFIRM_RECEIPT);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*the expression goes once both handles have removed their listener*/
+  EXPECT_EQ(rbus_send_until_removed(handle, "A.B.C"), RBUS_ERROR_DESTINATION_NOT_FOUND);
+
+  ret |= rbus_close(handle);
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  return ret;
+}
+
+static bool rbus_collect_wait_for(rbusMsgCollect_t *collect, const char *data)
+{
+  int tries = 100;
+  bool found = false;
+
+  while(tries-- && !found)
+  {
+    pthread_mutex_lock(&collect->lock);
+    found = rbus_collect_has(collect, data);
+    pthread_mutex_unlock(&collect->lock);
+    if(!found)
+      usleep(100000);
+  }
+  return found;
+}
+
+#define DELIVERY_TEST_COUNT 40
+
+static int rbus_send_sequence(const char *topic)
+{
+  rbusHandle_t handle;
+  struct iovec iov;
+  char buff[16];
+  int ret = RBUS_ERROR_BUS_ERROR;
+  int i;
+
+  ret = rbus_open(&handle, "rbus_send_sequence");
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  if(RBUS_ERROR_SUCCESS != ret) return ret;
+
+  iov.iov_base = buff;
+  iov.iov_len = snprintf(buff, sizeof(buff), "%d", 1);
+  ret = rbus_send_when_listening(handle, topic, &iov, 1);
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  /*receipt is confirmed as soon as a message is queued, so these outrun the slow handler*/
+  for(i = 2; i <= DELIVERY_TEST_COUNT; i++)
+  {
+    iov.iov_len = snprintf(buff, sizeof(buff), "%d", i);
+    ret |= rbusMessage_SendV(handle, topic, &iov, 1, RBUS_MESSAGE_CONFIRM_RECEIPT);
+  }
+  EXPECT_EQ(ret, RBUS_ERROR_SUCCESS);
+
+  ret |= rbus_close(handle);
+  EXPECT_EQ(ret,RBUS_ERROR_SUCCESS);
+  return ret;
+}
+
 static void exec_msg_test(rbusGtestMsg_t test)
 {
   switch(test)
@@ -527,6 +1012,209 @@ static void exec_msg_test(rbusGtestMsg_t test)
           EXPECT_EQ(rbus_close(rbus),0);
       }
       break;
+    case RBUS_GTEST_MSG10:
+      {
+        rbusMsgCollect_t collect;
+        pid_t pid;
+
+        memset(&collect, 0, sizeof(collect));
+        pthread_mutex_init(&collect.lock, NULL);
+        pthread_cond_init(&collect.cond, NULL);
+        pid = fork();
+        if (0 == pid) {
+          exit(rbus_send_batch("A.B.C"));
+        } else {
+          /*the segments joined, the large message, the batch and the part of the second batch before it stopped*/
+          EXPECT_EQ(rbus_recv_collect("A.B.C", pid, &collect, 6), RBUS_ERROR_SUCCESS);
+          EXPECT_STREQ(collect.data[0], "header:body");
+          EXPECT_EQ(collect.length[1], 3000);
+          EXPECT_EQ(collect.data[1][0], 'x');
+          EXPECT_STREQ(collect.data[2], "batch 1");
+          EXPECT_STREQ(collect.data[3], "batch 2");
+          EXPECT_STREQ(collect.data[4], "batch 3");
+          EXPECT_STREQ(collect.data[5], "batch 1");
+        }
+      }
+      break;
+    case RBUS_GTEST_MSG11:
+      {
+        rbusMsgCollect_t collect;
+        char name[16];
+        pid_t pid;
+        int i;
+
+        memset(&collect, 0, sizeof(collect));
+        pthread_mutex_init(&collect.lock, NULL);
+        pthread_cond_init(&collect.cond, NULL);
+        pid = fork();
+        if (0 == pid) {
+          exit(rbus_send_async("A.B.C"));
+        } else {
+          /*async messages may arrive in any order*/
+          EXPECT_EQ(rbus_recv_collect("A.B.C", pid, &collect, 13), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(collect.count, 13);
+          EXPECT_STREQ(collect.data[0], "async 0");
+          for(i = 1; i <= 8; i++)
+          {
+            snprintf(name, sizeof(name), "async %d", i);
+            EXPECT_TRUE(rbus_collect_has(&collect, name)) << name;
+          }
+          EXPECT_TRUE(rbus_collect_has(&collect, "async chain"));
+          EXPECT_TRUE(rbus_collect_has(&collect, "async chained"));
+          EXPECT_TRUE(rbus_collect_has(&collect, "async close"));
+          EXPECT_TRUE(rbus_collect_has(&collect, "async last"));
+        }
+      }
+      break;
+    case RBUS_GTEST_MSG13:
+      {
+        rbusMsgCollect_t collect[3];
+        rbusHandle_t handle, handle2;
+        int status = -1;
+        pid_t pid;
+        int i;
+
+        memset(collect, 0, sizeof(collect));
+        for(i = 0; i < 3; i++)
+        {
+          pthread_mutex_init(&collect[i].lock, NULL);
+          pthread_cond_init(&collect[i].cond, NULL);
+        }
+        pid = fork();
+        if (0 == pid) {
+          exit(rbus_send_listeners());
+        } else {
+          /*an expression has one listener per handle, so the second is on its own handle*/
+          EXPECT_EQ(rbus_open(&handle, "rbus_recv_listeners"), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbus_open(&handle2, "rbus_recv_listeners2"), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbusMessage_AddListener(handle, "A.B.C", &rbusCollectHandler, &collect[0]), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbusMessage_AddListener(handle, "A.B.C", &rbusCollectHandler, &collect[1]), RBUS_ERROR_INVALID_INPUT);
+          EXPECT_EQ(rbusMessage_AddListener(handle2, "A.B.C", &rbusCollectHandler, &collect[1]), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbusMessage_AddListener(handle, "A.B.C.D", &rbusCollectHandler, &collect[2]), RBUS_ERROR_SUCCESS);
+
+          /*both listeners on A.B.C get every message sent to it*/
+          EXPECT_TRUE(rbus_collect_wait_for(&collect[0], "one"));
+          EXPECT_TRUE(rbus_collect_wait_for(&collect[1], "one"));
+          EXPECT_STREQ(collect[2].data[0], "child");
+          EXPECT_EQ(rbusMessage_RemoveListener(handle, "A.B.C.D"), RBUS_ERROR_SUCCESS);
+
+          /*removing the child leaves its parent's listener in the trie*/
+          EXPECT_TRUE(rbus_collect_wait_for(&collect[0], "two"));
+          EXPECT_TRUE(rbus_collect_wait_for(&collect[1], "two"));
+          EXPECT_FALSE(rbus_collect_has(&collect[2], "two"));
+          EXPECT_EQ(rbusMessage_RemoveListener(handle, "A.B.C"), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbusMessage_RemoveListener(handle2, "A.B.C"), RBUS_ERROR_SUCCESS);
+
+          EXPECT_EQ(waitpid(pid, &status, 0), pid);
+          EXPECT_EQ(WEXITSTATUS(status), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(collect[0].count, collect[1].count);
+          EXPECT_EQ(rbus_close(handle2), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+        }
+      }
+      break;
+    case RBUS_GTEST_MSG14:
+      {
+        rbusMsgCollect_t collect, closed;
+        rbusDeliveryStats_t stats;
+        rbusHandle_t handle, handle2;
+        struct iovec iov;
+        int status = -1;
+        int tries = 100;
+        pid_t pid;
+
+        memset(&collect, 0, sizeof(collect));
+        pthread_mutex_init(&collect.lock, NULL);
+        pthread_cond_init(&collect.cond, NULL);
+        collect.delayMs = 50;
+        pid = fork();
+        if (0 == pid) {
+          exit(rbus_send_sequence("A.B.C"));
+        } else {
+          EXPECT_EQ(rbus_open(&handle, "rbus_recv_sequence"), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbus_setDeliveryThreads(handle, 2, 4), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbusMessage_AddListener(handle, "A.B.C", &rbusCollectHandler, &collect), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(waitpid(pid, &status, 0), pid);
+          EXPECT_EQ(WEXITSTATUS(status), RBUS_ERROR_SUCCESS);
+
+          /*wait for the queue to drain*/
+          do
+          {
+            usleep(100000);
+            EXPECT_EQ(rbus_getDeliveryStats(handle, &stats), RBUS_ERROR_SUCCESS);
+          } while(tries-- && (stats.queued || stats.delivered + stats.dropped < DELIVERY_TEST_COUNT));
+
+          /*what wasn't dropped ran in the order sent, and nothing was lost uncounted*/
+          EXPECT_FALSE(collect.outOfOrder);
+          EXPECT_GT(stats.dropped, 0u);
+          EXPECT_LE(stats.maxQueued, 4u);
+          EXPECT_EQ(stats.delivered, (uint64_t)collect.count);
+          EXPECT_EQ(stats.delivered + stats.dropped, (uint64_t)DELIVERY_TEST_COUNT);
+
+          /*a handler on a delivery thread can close its own handle*/
+          memset(&closed, 0, sizeof(closed));
+          pthread_mutex_init(&closed.lock, NULL);
+          pthread_cond_init(&closed.cond, NULL);
+          EXPECT_EQ(rbus_open(&handle2, "rbus_recv_close"), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbus_setDeliveryThreads(handle2, 2, 4), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbusMessage_AddListener(handle2, "A.B.D", &rbusCloseHandler, &closed), RBUS_ERROR_SUCCESS);
+          iov.iov_base = (void*)"close";
+          iov.iov_len = 5;
+          EXPECT_EQ(rbus_send_when_listening(handle, "A.B.D", &iov, 1), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbus_collect_wait(&closed, 1, 5), 1);
+
+          EXPECT_EQ(rbusMessage_RemoveListener(handle, "A.B.C"), RBUS_ERROR_SUCCESS);
+          EXPECT_EQ(rbus_close(handle), RBUS_ERROR_SUCCESS);
+        }
+      }
+      break;
+    case RBUS_GTEST_MSG12:
+      {
+        rbusMsgCollect_t collect;
+        static uint8_t expected[SHM_TEST_LENGTH];
+        char name[64];
+        uint32_t sum;
+        pid_t pid;
+        int i;
+
+        for(i = 0; i < SHM_TEST_LENGTH; i++)
+          expected[i] = (uint8_t)(i * 7);
+        sum = rbus_msg_sum(expected, SHM_TEST_LENGTH);
+
+        memset(&collect, 0, sizeof(collect));
+        pthread_mutex_init(&collect.lock, NULL);
+        pthread_cond_init(&collect.cond, NULL);
+        collect.retain = true;
+        pid = fork();
+        if (0 == pid) {
+          exit(rbus_send_shared("A.B.C"));
+        } else {
+          EXPECT_EQ(rbus_recv_collect("A.B.C", pid, &collect, 4), RBUS_ERROR_SUCCESS);
+          EXPECT_STREQ(collect.data[0], "ready");
+          EXPECT_EQ(collect.length[1], SHM_TEST_LENGTH);
+          EXPECT_EQ(collect.sum[1], sum);
+          EXPECT_EQ(collect.length[2], 64);
+          EXPECT_STREQ(collect.data[2], "rbus-shm");
+          EXPECT_EQ(collect.length[3], SHM_TEST_LENGTH);
+          EXPECT_EQ(collect.sum[3], sum);
+
+          /*the retained data outlives the handler, the sender and the unlinked object*/
+          for(i = 0; i < 4 && i < collect.count; i++)
+          {
+            EXPECT_EQ(rbus_msg_sum(collect.retained[i], collect.length[i]), collect.sum[i]);
+            EXPECT_EQ(rbusMessage_ReleaseData(collect.retained[i]), RBUS_ERROR_SUCCESS);
+            EXPECT_EQ(rbusMessage_ReleaseData(collect.retained[i]), RBUS_ERROR_INVALID_INPUT);
+          }
+
+          /*nothing is left behind in shared memory*/
+          for(i = 0; i < 2; i++)
+          {
+            snprintf(name, sizeof(name), "/dev/shm/rbus-msg-%d-%d", (int)pid, i);
+            EXPECT_NE(access(name, F_OK), 0) << name;
+          }
+        }
+      }
+      break;
   }
 }
 
@@ -574,3 +1262,28 @@ TEST(rbusMessageTest, test_multi_recv)
 {
   exec_msg_test(RBUS_GTEST_MSG8);
 }
+
+TEST(rbusMessageTest, test_sendv_batch)
+{
+  exec_msg_test(RBUS_GTEST_MSG10);
+}
+
+TEST(rbusMessageTest, test_sendasync)
+{
+  exec_msg_test(RBUS_GTEST_MSG11);
+}
+
+TEST(rbusMessageTest, test_send_shared)
+{
+  exec_msg_test(RBUS_GTEST_MSG12);
+}
+
+TEST(rbusMessageTest, test_shared_listeners)
+{
+  exec_msg_test(RBUS_GTEST_MSG13);
+}
+
+TEST(rbusMessageTest, test_delivery_threads)
+{
+  exec_msg_test(RBUS_GTEST_MSG14);
+}
@@ -19,6 +19,8 @@
 #include "gtest/gtest.h"
 
 #include <rbus.h>
+#include <pthread.h>
+#include "../src/rbus_buffer.h"
 
 TEST(rbusPropertyTest, testName)
 {
@@ -249,3 +251,129 @@ TEST(rbusPropertyTest, testFwrite)
   pRet += strlen("value:");
   EXPECT_EQ(strncmp(pRet,"test1",strlen("test1")),0);
 }
+
+TEST(rbusPropertyTest, testEncodeDecodeRelative)
+{
+  char const* names[] = {
+    "Device.WiFi.AccessPoint.3.AssociatedDevice.17.SignalStrength",
+    "Device.WiFi.AccessPoint.3.AssociatedDevice.17.Noise",
+    "Device.WiFi.AccessPoint.3.AssociatedDevice.18.SignalStrength",
+    "Device.WiFi.Radio.1.Enable" };
+  int count = sizeof(names)/sizeof(names[0]);
+  char const* previous = "Device.WiFi.";
+  rbusProperty_t first = NULL, prop;
+  rbusBuffer_t buff;
+  rbusValue_t value;
+  int i;
+
+  rbusBuffer_Create(&buff);
+  for(i = 0; i < count; i++)
+  {
+    rbusValue_Init(&value);
+    rbusValue_SetInt32(value, i);
+    rbusProperty_Init(&prop, names[i], value);
+    EXPECT_EQ(rbusProperty_EncodeRelative(prop, previous, buff), 0);
+    rbusProperty_Release(prop);
+    rbusValue_Release(value);
+    previous = names[i];
+  }
+
+  EXPECT_EQ(rbusPropertyList_DecodeRelative(&first, count, "Device.WiFi.", buff), 0);
+
+  /*names can be rebuilt in any order*/
+  for(i = count-1; i >= 0; i--)
+  {
+    int j;
+    for(j = 0, prop = first; j < i; j++)
+      prop = rbusProperty_GetNext(prop);
+    EXPECT_STREQ(rbusProperty_GetName(prop), names[i]);
+    EXPECT_EQ(rbusValue_GetInt32(rbusProperty_GetValue(prop)), i);
+  }
+
+  /*a property outlives the list it was decoded with*/
+  prop = rbusProperty_GetNext(first);
+  rbusProperty_Retain(prop);
+  rbusProperty_Release(first);
+  EXPECT_STREQ(rbusProperty_GetName(prop), names[1]);
+  rbusProperty_Release(prop);
+
+  /*a base shorter than the first prefix is malformed*/
+  buff->posRead = 0;
+  EXPECT_LT(rbusPropertyList_DecodeRelative(&first, count, "Dev", buff), 0);
+  EXPECT_EQ(first, nullptr);
+
+  rbusBuffer_Destroy(buff);
+}
+
+#define NAME_RACE_COUNT 256
+#define NAME_RACE_THREADS 8
+
+typedef struct
+{
+  rbusProperty_t first;
+  int reverse;
+  int bad;
+} nameRaceArg_t;
+
+static void* nameRaceThread(void* p)
+{
+  nameRaceArg_t* arg = (nameRaceArg_t*)p;
+  rbusProperty_t props[NAME_RACE_COUNT];
+  rbusProperty_t prop;
+  char expect[64];
+  int i;
+
+  for(i = 0, prop = arg->first; prop; i++, prop = rbusProperty_GetNext(prop))
+    props[i] = prop;
+  for(i = 0; i < NAME_RACE_COUNT; i++)
+  {
+    int k = arg->reverse ? NAME_RACE_COUNT - 1 - i : i;
+    char const* name = rbusProperty_GetName(props[k]);
+    snprintf(expect, sizeof(expect), "Device.Hosts.Host.%d.IPAddress", k);
+    if(!name || strcmp(name, expect))
+      arg->bad++;
+  }
+  return NULL;
+}
+
+TEST(rbusPropertyTest, testDecodeRelativeNameRace)
+{
+  char name[64], previous[64] = "Device.Hosts.";
+  rbusProperty_t first = NULL, prop;
+  pthread_t threads[NAME_RACE_THREADS];
+  nameRaceArg_t args[NAME_RACE_THREADS];
+  rbusBuffer_t buff;
+  rbusValue_t value;
+  int i;
+
+  rbusBuffer_Create(&buff);
+  for(i = 0; i < NAME_RACE_COUNT; i++)
+  {
+    snprintf(name, sizeof(name), "Device.Hosts.Host.%d.IPAddress", i);
+    rbusValue_Init(&value);
+    rbusValue_SetInt32(value, i);
+    rbusProperty_Init(&prop, name, value);
+    EXPECT_EQ(rbusProperty_EncodeRelative(prop, previous, buff), 0);
+    rbusProperty_Release(prop);
+    rbusValue_Release(value);
+    strcpy(previous, name);
+  }
+  ASSERT_EQ(rbusPropertyList_DecodeRelative(&first, NAME_RACE_COUNT, "Device.Hosts.", buff), 0);
+
+  /*every thread rebuilds names of the same decoded list, half of them from the end back*/
+  for(i = 0; i < NAME_RACE_THREADS; i++)
+  {
+    args[i].first = first;
+    args[i].reverse = i % 2;
+    args[i].bad = 0;
+    ASSERT_EQ(pthread_create(&threads[i], NULL, nameRaceThread, &args[i]), 0);
+  }
+  for(i = 0; i < NAME_RACE_THREADS; i++)
+  {
+    pthread_join(threads[i], NULL);
+    EXPECT_EQ(args[i].bad, 0);
+  }
+
+  rbusProperty_Release(first);
+  rbusBuffer_Destroy(buff);
+}
@@ -46,6 +46,8 @@ typedef enum _rbus_legacy_support
     RBUS_LEGACY_NONE
 } rbusLegacyDataType_t;
 
+static int32_t param1Gets = 0;
+
 rbusError_t getVCHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
 {
   char const* name = rbusProperty_GetName(property);
@@ -64,6 +66,7 @@ rbusError_t getVCHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHa
     static int32_t mymin = 0, mymax=5; /*keep value between mymin and mymax*/
 
     mycount++;
+    __atomic_add_fetch(&param1Gets, 1, __ATOMIC_RELAXED);
 
     if((mycount % myfreq) == 0)
     {
@@ -227,6 +230,74 @@ rbusError_t ppParamGetHandler(rbusHandle_t handle, rbusProperty_t property, rbus
   }
 }
 
+static int32_t streamGetCount = 0;
+
+rbusError_t streamGetHandler(rbusHandle_t handle, rbusProperty_t property, rbusGetHandlerOptions_t* opts)
+{
+  char const* name = rbusProperty_GetName(property);
+  rbusValue_t value;
+
+  (void)handle;
+  (void)opts;
+
+  rbusValue_Init(&value);
+  if(strcmp("Device.rbusProvider.StreamGets",name) == 0) {
+    rbusValue_SetInt32(value, streamGetCount);
+  } else {
+    /*set value to the name of the parameter so consumer can easily verify result*/
+    __atomic_add_fetch(&streamGetCount, 1, __ATOMIC_RELAXED);
+    rbusValue_SetString(value, name);
+  }
+  rbusProperty_SetValue(property, value);
+  rbusValue_Release(value);
+
+  return RBUS_ERROR_SUCCESS;
+}
+
+/*wait up to seconds for the value-change poll to call the getHandler counted by gets*/
+static bool waitForGets(int32_t* gets, int32_t after, int seconds)
+{
+  int i;
+  for(i = 0; i < seconds * 10; i++)
+  {
+    if(__atomic_load_n(gets, __ATOMIC_RELAXED) > after)
+      return true;
+    usleep(100000);
+  }
+  return false;
+}
+
+/*unregister Param1 and the Stream table, whose rows the consumer polls for value changes,
+  while it is subscribed.  The polling must stop, and registering Param1 again must
+  resubscribe it from the subscription detached by the unregister*/
+static void unregSubscribedElements(rbusHandle_t handle, rbusDataElement_t* param1, rbusDataElement_t* stream)
+{
+  int32_t gets;
+  rbusValue_t period;
+
+  EXPECT_TRUE(waitForGets(&param1Gets, 0, 5));
+  EXPECT_TRUE(waitForGets(&streamGetCount, 0, 5));
+
+  EXPECT_EQ(rbus_unregDataElements(handle, 1, param1), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(rbus_unregDataElements(handle, 2, stream), RBUS_ERROR_SUCCESS);
+
+  /*let a poll already calling a getHandler finish, then there should be no more*/
+  usleep(300000);
+  gets = __atomic_load_n(&param1Gets, __ATOMIC_RELAXED);
+  EXPECT_FALSE(waitForGets(&param1Gets, gets, 1));
+  gets = __atomic_load_n(&streamGetCount, __ATOMIC_RELAXED);
+  EXPECT_FALSE(waitForGets(&streamGetCount, gets, 1));
+
+  EXPECT_EQ(rbus_regDataElements(handle, 1, param1), RBUS_ERROR_SUCCESS);
+  gets = __atomic_load_n(&param1Gets, __ATOMIC_RELAXED);
+  EXPECT_TRUE(waitForGets(&param1Gets, gets, 2));
+
+  rbusValue_Init(&period);
+  rbusValue_SetInt32(period, 2000);
+  rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, period);
+  rbusValue_Release(period);
+}
+
 static rbusError_t methodHandler(rbusHandle_t handle, char const* methodName, rbusObject_t inParams, rbusObject_t outParams, rbusMethodAsyncHandle_t asyncHandle)
 {
   (void)handle;
@@ -280,7 +351,10 @@ int rbusProvider(rbusGtest_t test, pid_t pid, int *consumer_status)
     {(char *)"Device.rbusProvider.PartialPath.{i}.Param1", RBUS_ELEMENT_TYPE_PROPERTY, {ppParamGetHandler, setHandler, NULL, NULL, NULL, NULL}},
     {(char *)"Device.rbusProvider.PartialPath.{i}.Param2", RBUS_ELEMENT_TYPE_PROPERTY, {ppParamGetHandler, NULL, NULL, NULL, NULL, NULL}},
     {(char *)"Device.rbusProvider.Method()", RBUS_ELEMENT_TYPE_METHOD, {NULL, NULL, NULL, NULL, NULL, methodHandler}},
-    {(char *)"Device.rbusProvider.MethodAsync1()", RBUS_ELEMENT_TYPE_METHOD, {NULL, NULL, NULL, NULL, NULL, methodHandler}}
+    {(char *)"Device.rbusProvider.MethodAsync1()", RBUS_ELEMENT_TYPE_METHOD, {NULL, NULL, NULL, NULL, NULL, methodHandler}},
+    {(char *)"Device.rbusProvider.Stream.{i}.", RBUS_ELEMENT_TYPE_TABLE, {NULL, NULL, NULL, ppTableRemRowHandler, NULL, NULL}},
+    {(char *)"Device.rbusProvider.Stream.{i}.Value", RBUS_ELEMENT_TYPE_PROPERTY, {streamGetHandler, NULL, NULL, NULL, NULL, NULL}},
+    {(char *)"Device.rbusProvider.StreamGets", RBUS_ELEMENT_TYPE_PROPERTY, {streamGetHandler, NULL, NULL, NULL, NULL, NULL}}
   };
 #define elements_count sizeof(dataElements)/sizeof(dataElements[0])
 
@@ -310,6 +384,31 @@ int rbusProvider(rbusGtest_t test, pid_t pid, int *consumer_status)
     EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
   }
 
+  if(RBUS_GTEST_UNREG_SUBS == test)
+  {
+    rbusValue_t period;
+    rbusValue_Init(&period);
+    rbusValue_SetInt32(period, 100);
+    rbus_setConfig(RBUS_CONFIG_VALUECHANGE_PERIOD, period);
+    rbusValue_Release(period);
+  }
+
+  if(RBUS_GTEST_GET_STREAM1 == test ||
+      RBUS_GTEST_GET_STREAM2 == test ||
+      RBUS_GTEST_UNREG_SUBS == test)
+  {
+    uint32_t row;
+    streamGetCount = 0;
+    for(row = 1; row <= GTEST_STREAM_ROWS; row++)
+    {
+      rc |= rbusTable_registerRow(handle, "Device.rbusProvider.Stream.", NULL, row);
+      EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+    }
+  }
+
+  if(RBUS_GTEST_UNREG_SUBS == test)
+    unregSubscribedElements(handle, &dataElements[0], &dataElements[19]);
+
   wait_ret = waitpid(pid, consumer_status, 0);
   EXPECT_EQ(wait_ret,pid);
 
@@ -60,6 +60,8 @@ typedef enum
   RBUS_GTEST_GET31,
   RBUS_GTEST_GET_EXT1,
   RBUS_GTEST_GET_EXT2,
+  RBUS_GTEST_GET_STREAM1,
+  RBUS_GTEST_GET_STREAM2,
   RBUS_GTEST_SET1,
   RBUS_GTEST_SET2,
   RBUS_GTEST_SET3,
@@ -85,6 +87,9 @@ typedef enum
   RBUS_GTEST_METHOD_ASYNC,
   RBUS_GTEST_REG_ROW,
   RBUS_GTEST_UNREG_ROW,
+  RBUS_GTEST_UNREG_SUBS,
+  RBUS_GTEST_SUBSCRIBE_EX1,
+  RBUS_GTEST_SUBSCRIBE_EX2,
 } rbusGtest_t;
 
 int rbusConsumer(rbusGtest_t test, pid_t pid, int runtime);
@@ -103,3 +108,4 @@ int rbuscoreProvider(rbusGtest_t test, pid_t pid, int *consumer_status);
 #define GTEST_VAL_SINGLE (float)3.141592653589793f
 #define GTEST_VAL_DOUBLE (double)3.141592653589793
 #define GTEST_VAL_STRING "legacy_test"
+#define GTEST_STREAM_ROWS 5
@@ -47,3 +47,80 @@ TEST(rbusSessionTest, test1)
   }
   free(componentName);
 }
+
+TEST(rbusSessionTest, lease)
+{
+  int rc = RBUS_ERROR_BUS_ERROR;
+  rbusHandle_t handle = NULL;
+  rbusSessionLease_t lease = NULL;
+  uint32_t sessionIds[5] = {0};
+
+  rc = rbus_open(&handle, "sessionleasetest");
+  EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+
+  if(RBUS_ERROR_SUCCESS == rc)
+  {
+    rc = rbusSessionLease_Open(handle, 2, &lease);
+    EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+
+    /*more sessions than the block holds, so the lease has to reserve again*/
+    for(int i = 0; i < 5 && RBUS_ERROR_SUCCESS == rc; i++)
+    {
+      rc = rbusSessionLease_Acquire(lease, &sessionIds[i]);
+      EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+      EXPECT_NE(sessionIds[i], 0u);
+      for(int j = 0; j < i; j++)
+        EXPECT_NE(sessionIds[i], sessionIds[j]);
+      rc = rbusSessionLease_Release(lease, sessionIds[i]);
+      EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+    }
+
+    rc = rbusSessionLease_Close(lease);
+    EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+    rbus_close(handle);
+  }
+}
+
+TEST(rbusSessionTest, lease_fallback)
+{
+  int rc = RBUS_ERROR_BUS_ERROR;
+  rbusHandle_t handle = NULL;
+  rbusSessionLease_t lease = NULL;
+  uint32_t sessionId = 0, heldId = 0, nextId = 0;
+
+  rc = rbus_open(&handle, "sessionleasefallbacktest");
+  EXPECT_EQ(rc,RBUS_ERROR_SUCCESS);
+
+  if(RBUS_ERROR_SUCCESS == rc)
+  {
+    /*the session manager doesn't reserve blocks, so the lease uses a session per
+      request, and like rbus_createSession only one can be open at a time*/
+    rc = rbusSessionLease_Open(handle, 3, &lease);
+    EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+
+    if(RBUS_ERROR_SUCCESS == rc)
+    {
+      rc = rbusSessionLease_Acquire(lease, &heldId);
+      EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+      EXPECT_NE(heldId, 0u);
+
+      rc = rbus_getCurrentSession(handle, &sessionId);
+      EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+      EXPECT_EQ(sessionId, heldId);
+
+      EXPECT_EQ(rbusSessionLease_Acquire(lease, &nextId), RBUS_ERROR_SESSION_ALREADY_EXIST);
+      EXPECT_EQ(nextId, 0u);
+
+      EXPECT_EQ(rbusSessionLease_Release(lease, heldId), RBUS_ERROR_SUCCESS);
+
+      rc = rbusSessionLease_Acquire(lease, &nextId);
+      EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+      EXPECT_NE(nextId, 0u);
+      EXPECT_EQ(rbusSessionLease_Release(lease, nextId), RBUS_ERROR_SUCCESS);
+
+      rc = rbusSessionLease_Close(lease);
+      EXPECT_EQ(rc, RBUS_ERROR_SUCCESS);
+    }
+    rbus_close(handle);
+  }
+}
@@ -0,0 +1,61 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file
+ * the following copyright and licenses apply:
+ *
+ * Copyright 2021 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+
+#include <rbus.h>
+#include <rtTime.h>
+#include "../src/rbus_stats_internal.h"
+
+TEST(rbusStatsTest, recordAndReset)
+{
+  rbusStats_t stats;
+  rtTime_t start;
+
+  rbusStats_Reset();
+  rtTime_Now(&start);
+  rbusStats_Record(RBUS_STATS_GET, &start, false);
+  rbusStats_Record(RBUS_STATS_GET, &start, true);
+
+  EXPECT_EQ(rbusStats_Get(RBUS_STATS_GET, &stats), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(stats.count, 2u);
+  EXPECT_EQ(stats.errors, 1u);
+
+  uint64_t total = 0;
+  for(int i = 0; i < RBUS_STATS_HISTOGRAM_BUCKETS; ++i)
+    total += stats.buckets[i];
+  EXPECT_EQ(total, 2u);
+  EXPECT_GE(stats.totalUsec, stats.maxUsec);
+
+  rbusStats_Reset();
+  EXPECT_EQ(rbusStats_Get(RBUS_STATS_GET, &stats), RBUS_ERROR_SUCCESS);
+  EXPECT_EQ(stats.count, 0u);
+  EXPECT_EQ(stats.maxUsec, 0u);
+}
+
+TEST(rbusStatsTest, negtestStats)
+{
+  rbusStats_t stats;
+
+  EXPECT_EQ(rbusStats_Get(RBUS_STATS_MAX, &stats), RBUS_ERROR_INVALID_INPUT);
+  EXPECT_EQ(rbusStats_Get(RBUS_STATS_SET, NULL), RBUS_ERROR_INVALID_INPUT);
+  EXPECT_EQ(rbusStats_MetricToString(RBUS_STATS_MAX), nullptr);
+  EXPECT_STREQ(rbusStats_MetricToString(RBUS_STATS_EVENT_PUBLISH), "EventPublish");
+  EXPECT_EQ(rbusStats_RegisterDataElements(NULL), RBUS_ERROR_INVALID_HANDLE);
+}
@@ -20,6 +20,10 @@
 #include <rbus.h>
 #include <limits.h>
 #include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <ctype.h>
+#include <float.h>
 #include "../src/rbus_buffer.h"
 
 TEST(rbusValueTest, validate_types)
@@ -1126,3 +1130,423 @@ TEST(rbusValueEncDecTlv, enc_dec_tlv_string)
   sprintf(buffer,"%s","test string");
   exec_encode_decode_tlv_test(RBUS_STRING,buffer);
 }
+
+TEST(rbusValueEncDecTlv, enc_dec_tlv_object)
+{
+  rbusObject_t obj, child, objOut;
+  rbusValue_t valIn, valOut, val;
+  rbusBuffer_t buff;
+  int len, lenAlloc;
+
+  rbusObject_Init(&obj, "root");
+  rbusObject_InitMultiInstance(&child, "table");
+  rbusValue_Init(&val);
+  rbusValue_SetString(val, "test string");
+  rbusObject_SetValue(obj, "name", val);
+  rbusValue_SetInt16(val, -5);
+  rbusObject_SetValue(child, "level", val);
+  rbusValue_Release(val);
+  rbusObject_SetChildren(obj, child);
+  rbusObject_Release(child);
+
+  rbusValue_Init(&valIn);
+  rbusValue_SetObject(valIn, obj);
+
+  rbusBuffer_Create(&buff);
+  EXPECT_EQ(rbusValue_Encode(valIn, buff), 0);
+  EXPECT_GE(rbusValue_Decode(&valOut, buff), 0);
+  EXPECT_EQ(buff->posRead, buff->posWrite);
+
+  ASSERT_EQ(rbusValue_GetType(valOut), RBUS_OBJECT);
+  objOut = rbusValue_GetObject(valOut);
+  EXPECT_EQ(rbusObject_Compare(obj, objOut, true), 0);
+  EXPECT_EQ(rbusObject_GetType(rbusObject_GetChildren(objOut)), RBUS_OBJECT_MULTI_INSTANCE);
+  rbusValue_Release(valOut);
+
+  /*truncated input fails without returning anything*/
+  len = buff->posWrite;
+  lenAlloc = buff->lenAlloc;
+  for(buff->lenAlloc = 0; buff->lenAlloc < len; buff->lenAlloc++)
+  {
+    buff->posRead = 0;
+    EXPECT_LT(rbusValue_Decode(&valOut, buff), 0);
+    EXPECT_EQ(valOut, nullptr);
+  }
+  buff->lenAlloc = lenAlloc;
+  rbusBuffer_Destroy(buff);
+
+  rbusValue_Release(valIn);
+  rbusObject_Release(obj);
+}
+
+/*an object holding itself depth times, once through a child and once through a value*/
+static rbusValue_t nested_object_value(int depth)
+{
+  rbusValue_t value;
+  rbusObject_t obj;
+  int i;
+
+  rbusValue_Init(&value);
+  rbusValue_SetInt32(value, 0);
+  for(i = 0; i < depth; i++)
+  {
+    rbusValue_t outer;
+
+    rbusObject_Init(&obj, "level");
+    if(i % 2)
+    {
+      rbusObject_t child;
+
+      rbusObject_Init(&child, "child");
+      rbusObject_SetValue(child, "v", value);
+      rbusObject_SetChildren(obj, child);
+      rbusObject_Release(child);
+    }
+    else
+    {
+      rbusObject_SetValue(obj, "v", value);
+    }
+    rbusValue_Release(value);
+    rbusValue_Init(&outer);
+    rbusValue_SetObject(outer, obj);
+    rbusObject_Release(obj);
+    value = outer;
+  }
+  return value;
+}
+
+TEST(rbusValueEncDecTlv, enc_dec_tlv_nesting)
+{
+  rbusValue_t valIn, valOut;
+  rbusBuffer_t buff;
+
+  /*a reasonable depth decodes*/
+  valIn = nested_object_value(8);
+  rbusBuffer_Create(&buff);
+  EXPECT_EQ(rbusValue_Encode(valIn, buff), 0);
+  EXPECT_GE(rbusValue_Decode(&valOut, buff), 0);
+  ASSERT_NE(valOut, nullptr);
+  EXPECT_EQ(rbusValue_Compare(valIn, valOut), 0);
+  rbusValue_Release(valOut);
+  rbusBuffer_Destroy(buff);
+  rbusValue_Release(valIn);
+
+  /*input nested deeper than the limit fails instead of recursing without bound*/
+  valIn = nested_object_value(RBUS_DECODE_MAX_DEPTH * 2);
+  rbusBuffer_Create(&buff);
+  EXPECT_EQ(rbusValue_Encode(valIn, buff), 0);
+  EXPECT_LT(rbusValue_Decode(&valOut, buff), 0);
+  EXPECT_EQ(valOut, nullptr);
+  rbusBuffer_Destroy(buff);
+  rbusValue_Release(valIn);
+}
+
+/*what rbusValue_SetFromString gave before the fast parser, using strto and strptime*/
+static bool legacy_from_string(rbusValueType_t type, const char* s, rbusValue_t value)
+{
+  char* end = NULL;
+  errno = 0;
+  switch(type)
+  {
+  case RBUS_INT32:
+  {
+    long l = strtol(s, &end, 0);
+    if(s == end || *end || (errno == ERANGE && (l == LONG_MAX || l == LONG_MIN)) || l > INT32_MAX || l < INT32_MIN)
+      return false;
+    rbusValue_SetInt32(value, (int32_t)l);
+    return true;
+  }
+  case RBUS_UINT32:
+  {
+    unsigned long ul = strtoul(s, &end, 0);
+    if(s == end || *end || (*s == '-' && ul != 0) || (errno == ERANGE && (ul == ULONG_MAX || ul == 0)) || ul > UINT32_MAX)
+      return false;
+    rbusValue_SetUInt32(value, (uint32_t)ul);
+    return true;
+  }
+  case RBUS_INT64:
+  {
+    long long ll = strtoll(s, &end, 0);
+    if(s == end || *end || (errno == ERANGE && (ll == LLONG_MAX || ll == LLONG_MIN)))
+      return false;
+    rbusValue_SetInt64(value, (int64_t)ll);
+    return true;
+  }
+  case RBUS_UINT64:
+  {
+    unsigned long long ull = strtoull(s, &end, 0);
+    if(s == end || *end || (*s == '-' && ull != 0) || (errno == ERANGE && (ull == ULLONG_MAX || ull == 0)))
+      return false;
+    rbusValue_SetUInt64(value, (uint64_t)ull);
+    return true;
+  }
+  case RBUS_SINGLE:
+  {
+    float f = strtof(s, &end);
+    if(s == end || *end || errno == ERANGE)
+      return false;
+    rbusValue_SetSingle(value, f);
+    return true;
+  }
+  case RBUS_DOUBLE:
+  {
+    double d = strtod(s, &end);
+    if(s == end || *end || errno == ERANGE)
+      return false;
+    rbusValue_SetDouble(value, d);
+    return true;
+  }
+  case RBUS_DATETIME:
+  {
+    rbusDateTime_t tv;
+    memset(&tv, 0, sizeof(tv));
+    if(strncmp(s, "0000-", 5) != 0)
+    {
+      char const* p = strptime(s, strchr(s, 'T') ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S", &tv.m_time);
+      if(!p)
+        return false;
+      if(strlen(p) == sizeof("+HH:MM") - 1 && isdigit((int)p[1]) && isdigit((int)p[2]) && isdigit((int)p[4]) && isdigit((int)p[5]))
+      {
+        tv.m_tz.m_isWest = ('-' == p[0]);
+        sscanf(p + 1, "%02d:%02d", &tv.m_tz.m_tzhour, &tv.m_tz.m_tzmin);
+      }
+    }
+    rbusValue_SetTime(value, &tv);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+static void exec_from_string_test(rbusValueType_t type, const char* s)
+{
+  rbusValue_t expected, actual;
+  bool expectedOk, actualOk;
+
+  rbusValue_Init(&expected);
+  rbusValue_Init(&actual);
+  expectedOk = legacy_from_string(type, s, expected);
+  actualOk = rbusValue_SetFromString(actual, type, s);
+
+  EXPECT_EQ(actualOk, expectedOk) << s;
+  if(actualOk && expectedOk)
+  {
+    ASSERT_EQ(rbusValue_GetType(actual), type) << s;
+    switch(type)
+    {
+    case RBUS_SINGLE:
+    {
+      float e = rbusValue_GetSingle(expected), a = rbusValue_GetSingle(actual);
+      EXPECT_EQ(memcmp(&e, &a, sizeof(float)), 0) << s << " " << e << " " << a;
+      break;
+    }
+    case RBUS_DOUBLE:
+    {
+      double e = rbusValue_GetDouble(expected), a = rbusValue_GetDouble(actual);
+      EXPECT_EQ(memcmp(&e, &a, sizeof(double)), 0) << s << " " << e << " " << a;
+      break;
+    }
+    case RBUS_DATETIME:
+    {
+      rbusDateTime_t const* e = rbusValue_GetTime(expected);
+      rbusDateTime_t const* a = rbusValue_GetTime(actual);
+      EXPECT_EQ(a->m_time.tm_year, e->m_time.tm_year) << s;
+      EXPECT_EQ(a->m_time.tm_mon, e->m_time.tm_mon) << s;
+      EXPECT_EQ(a->m_time.tm_mday, e->m_time.tm_mday) << s;
+      EXPECT_EQ(a->m_time.tm_hour, e->m_time.tm_hour) << s;
+      EXPECT_EQ(a->m_time.tm_min, e->m_time.tm_min) << s;
+      EXPECT_EQ(a->m_time.tm_sec, e->m_time.tm_sec) << s;
+      EXPECT_EQ(a->m_time.tm_wday, e->m_time.tm_wday) << s;
+      EXPECT_EQ(a->m_time.tm_yday, e->m_time.tm_yday) << s;
+      EXPECT_EQ(a->m_tz.m_isWest, e->m_tz.m_isWest) << s;
+      EXPECT_EQ(a->m_tz.m_tzhour, e->m_tz.m_tzhour) << s;
+      EXPECT_EQ(a->m_tz.m_tzmin, e->m_tz.m_tzmin) << s;
+      break;
+    }
+    default:
+      EXPECT_EQ(rbusValue_Compare(actual, expected), 0) << s;
+      break;
+    }
+  }
+  rbusValue_Release(expected);
+  rbusValue_Release(actual);
+}
+
+TEST(rbusValueTest, from_string_integers)
+{
+  static const char* inputs[] = {
+    "0", "-0", "+0", "7", "+7", "-7", "007", "010", "-010", "08", "0x1F", "-0x1F",
+    "2147483647", "2147483648", "-2147483648", "-2147483649", "4294967295", "4294967296",
+    "9223372036854775807", "9223372036854775808", "-9223372036854775808", "-9223372036854775809",
+    "18446744073709551615", "18446744073709551616", "99999999999999999999999",
+    "-1", "", "-", "+", " 5", "5 ", "5x", "1.0", "1e3" };
+  static const rbusValueType_t types[] = { RBUS_INT32, RBUS_UINT32, RBUS_INT64, RBUS_UINT64 };
+  size_t i, j;
+
+  for(j = 0; j < sizeof(types)/sizeof(types[0]); j++)
+    for(i = 0; i < sizeof(inputs)/sizeof(inputs[0]); i++)
+      exec_from_string_test(types[j], inputs[i]);
+
+  /*the limits themselves come back exactly*/
+  rbusValue_t v;
+  rbusValue_Init(&v);
+  EXPECT_TRUE(rbusValue_SetFromString(v, RBUS_INT32, "-2147483648"));
+  EXPECT_EQ(rbusValue_GetInt32(v), INT32_MIN);
+  EXPECT_TRUE(rbusValue_SetFromString(v, RBUS_INT64, "-9223372036854775808"));
+  EXPECT_EQ(rbusValue_GetInt64(v), INT64_MIN);
+  EXPECT_TRUE(rbusValue_SetFromString(v, RBUS_INT32, "010"));
+  EXPECT_EQ(rbusValue_GetInt32(v), 8);
+  rbusValue_Release(v);
+}
+
+TEST(rbusValueTest, from_string_floats)
+{
+  static const char* inputs[] = {
+    "0", "-0", "0.0", "-0.0", "1", "-1", "0.1", "-0.1", "3.14159", "123.456e-5", "1e10", "1e-10",
+    "1e22", "1e23", "1e-22", "1e-23", "16777216", "16777217", "9007199254740992", "9007199254740993",
+    "9007199254740993.0", "1e39", "1e-50", "1e400", "1e-400", ".5", "5.", "-.5", "007.5",
+    "0x1p3", "inf", "nan", "1e", "1e+", ".", "", " 1", "1 " };
+  size_t i;
+
+  for(i = 0; i < sizeof(inputs)/sizeof(inputs[0]); i++)
+  {
+    exec_from_string_test(RBUS_SINGLE, inputs[i]);
+    exec_from_string_test(RBUS_DOUBLE, inputs[i]);
+  }
+
+  /*2^53+1 isn't a double, it rounds to even the same as strtod*/
+  rbusValue_t v;
+  rbusValue_Init(&v);
+  EXPECT_TRUE(rbusValue_SetFromString(v, RBUS_DOUBLE, "9007199254740993"));
+  EXPECT_EQ(rbusValue_GetDouble(v), 9007199254740992.0);
+  EXPECT_TRUE(rbusValue_SetFromString(v, RBUS_DOUBLE, "-0"));
+  EXPECT_TRUE(signbit(rbusValue_GetDouble(v)));
+  rbusValue_Release(v);
+}
+
+TEST(rbusValueTest, from_string_datetime)
+{
+  static const char* inputs[] = {
+    "2024-02-29T12:34:56", "2024-02-29 12:34:56", "2023-12-31T23:59:59+05:30", "2023-12-31 23:59:59-08:00",
+    "2000-03-01T00:00:00Z", "1900-01-01T00:00:00", "1970-01-01T00:00:00+00:00", "2100-12-31T23:59:60",
+    "1999-07-04T08:09:10-11:45", "0000-00-00T00:00:00", "2024-13-01T00:00:00", "2024-01-32T00:00:00",
+    "2024-01-01T24:00:00", "2024-01-01", "2024-1-1T00:00:00", "2024-01-01T00:00:00+0530", "garbage" };
+  size_t i;
+
+  for(i = 0; i < sizeof(inputs)/sizeof(inputs[0]); i++)
+    exec_from_string_test(RBUS_DATETIME, inputs[i]);
+
+  /*wday and yday are filled in too*/
+  rbusValue_t v;
+  rbusValue_Init(&v);
+  EXPECT_TRUE(rbusValue_SetFromString(v, RBUS_DATETIME, "2024-12-31T10:00:00-03:30"));
+  EXPECT_EQ(rbusValue_GetTime(v)->m_time.tm_wday, 2);
+  EXPECT_EQ(rbusValue_GetTime(v)->m_time.tm_yday, 365);
+  EXPECT_EQ(rbusValue_GetTime(v)->m_tz.m_isWest, 1);
+  EXPECT_EQ(rbusValue_GetTime(v)->m_tz.m_tzhour, 3);
+  EXPECT_EQ(rbusValue_GetTime(v)->m_tz.m_tzmin, 30);
+  rbusValue_Release(v);
+}
+
+/*format into every buffer size from 0 to past the end and check each result is the
+  same text cut short, terminated, and that nothing past buflen is written*/
+static void exec_format_test(rbusValue_t v, const char* expected)
+{
+  char buf[RBUS_VALUE_FORMAT_MAX + 8];
+  int len = (int)strlen(expected);
+  int n;
+
+  EXPECT_EQ(rbusValue_Format(v, NULL, 0), len) << expected;
+  ASSERT_LT(len + 3, (int)sizeof(buf));
+
+  for(n = 0; n <= len + 2; n++)
+  {
+    int keep = n == 0 ? 0 : (n - 1 < len ? n - 1 : len);
+
+    if(rbusValue_GetType(v) == RBUS_BYTES)
+      keep &= ~1;
+    memset(buf, '#', sizeof(buf));
+    EXPECT_EQ(rbusValue_Format(v, buf, n), len) << expected << " buflen " << n;
+    if(n > 0)
+    {
+      EXPECT_EQ(strncmp(buf, expected, keep), 0) << expected << " buflen " << n;
+      EXPECT_EQ(buf[keep], 0) << expected << " buflen " << n;
+    }
+    for(int i = n; i < (int)sizeof(buf); i++)
+    {
+      if(i == keep && n > 0)
+        continue;
+      ASSERT_EQ(buf[i], '#') << expected << " buflen " << n << " wrote at " << i;
+    }
+  }
+}
+
+TEST(rbusValueTest, format)
+{
+  rbusValue_t v;
+  rbusDateTime_t tv;
+  uint8_t bytes[] = { 0x00, 0x1f, 0xa0, 0xff, 0x7e };
+  char* s;
+
+  rbusValue_Init(&v);
+
+  EXPECT_EQ(rbusValue_Format(NULL, NULL, 0), -1);
+  EXPECT_EQ(rbusValue_Format(v, NULL, 0), -1);
+
+  rbusValue_SetInt64(v, INT64_MIN);
+  exec_format_test(v, "-9223372036854775808");
+  rbusValue_SetUInt64(v, UINT64_MAX);
+  exec_format_test(v, "18446744073709551615");
+  rbusValue_SetInt32(v, INT32_MIN);
+  exec_format_test(v, "-2147483648");
+  rbusValue_SetInt8(v, -128);
+  exec_format_test(v, "-128");
+  rbusValue_SetUInt16(v, 0);
+  exec_format_test(v, "0");
+  rbusValue_SetBoolean(v, true);
+  exec_format_test(v, "1");
+  rbusValue_SetString(v, "hello world");
+  exec_format_test(v, "hello world");
+  rbusValue_SetString(v, "");
+  exec_format_test(v, "");
+  rbusValue_SetBytes(v, bytes, sizeof(bytes));
+  exec_format_test(v, "001FA0FF7E");
+  rbusValue_SetDouble(v, -1.5);
+  exec_format_test(v, "-1.500000000000000");
+
+  memset(&tv, 0, sizeof(tv));
+  tv.m_time.tm_year = 124;
+  tv.m_time.tm_mon = 1;
+  tv.m_time.tm_mday = 29;
+  tv.m_time.tm_hour = 7;
+  tv.m_time.tm_min = 5;
+  tv.m_time.tm_sec = 9;
+  rbusValue_SetTime(v, &tv);
+  exec_format_test(v, "2024-02-29T07:05:09Z");
+  tv.m_tz.m_isWest = 1;
+  tv.m_tz.m_tzhour = 3;
+  tv.m_tz.m_tzmin = 30;
+  rbusValue_SetTime(v, &tv);
+  exec_format_test(v, "2024-02-29T07:05:09-03:30");
+
+  /*the same text rbusValue_ToString allocates*/
+  rbusValue_SetSingle(v, -3.25f);
+  s = rbusValue_ToString(v, NULL, 0);
+  exec_format_test(v, s);
+  free(s);
+
+  /*the longest values fit RBUS_VALUE_FORMAT_MAX*/
+  rbusValue_SetDouble(v, -DBL_MAX);
+  EXPECT_LT(rbusValue_Format(v, NULL, 0), RBUS_VALUE_FORMAT_MAX);
+  s = rbusValue_ToString(v, NULL, 0);
+  exec_format_test(v, s);
+  free(s);
+  rbusValue_SetSingle(v, -FLT_MAX);
+  EXPECT_LT(rbusValue_Format(v, NULL, 0), RBUS_VALUE_FORMAT_MAX);
+  tv.m_time.tm_year = 9999 - 1900;
+  rbusValue_SetTime(v, &tv);
+  EXPECT_LT(rbusValue_Format(v, NULL, 0), RBUS_VALUE_FORMAT_MAX);
+
+  rbusValue_Release(v);
+}